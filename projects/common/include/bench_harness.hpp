@@ -0,0 +1,485 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#include "perf_counters.hpp"
+
+// Shared benchmark harness for the session benchmarks.
+//
+//   bench::Runner runner;                       // config from BENCH_* env vars
+//   runner.run("contig", {{"N", "500"}}, N*N*N, [&] { matmul(...); });
+//   runner.run("virtual", {}, orders, [&](bench::Timing& t) {
+//       setup(); t.start(); work(); t.stop(); verify();
+//   });
+//   runner.write_reports();                     // results.csv + results.json
+//
+// Each case is warmed up until consecutive samples agree, then repeated
+// until the relative MAD drops below a target (or a repeat/time budget runs
+// out). Bodies that take a Timing& time only the region between start() and
+// stop(); other bodies are timed whole. PerfCounters are read around the same
+// region. Results carry their raw samples so that bench_compare can test two
+// result files for significant differences.
+//
+// Environment:
+//   BENCH_MIN_REPS     minimum measured repeats            (default 5)
+//   BENCH_MAX_REPS     maximum measured repeats            (default 30)
+//   BENCH_TARGET_MAD   stop once MAD/median <= this        (default 0.01)
+//   BENCH_MAX_WARMUP   maximum warmup iterations           (default 5)
+//   BENCH_MAX_SECONDS  time budget per case, warmup incl.  (default 10)
+//   BENCH_PIN_CPU      CPU list to pin to, e.g. "3" or "2,4-7" (default: no pinning)
+//   BENCH_OUT          path prefix for write_reports()     (default "results")
+
+namespace bench {
+
+template <class T>
+inline void do_not_optimize(T const& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(value) : "memory");
+#else
+    volatile const void* sink = &value;
+    (void)sink;
+#endif
+}
+
+using Params = std::vector<std::pair<std::string, std::string>>;
+
+struct Config {
+    int min_reps = 5;
+    int max_reps = 30;
+    double target_rel_mad = 0.01;
+    int max_warmup = 5;
+    double warmup_tolerance = 0.05; // consecutive warmup samples within 5%
+    double max_seconds = 10.0;
+    std::string pin_cpus;           // empty = don't pin
+    std::string out_prefix = "results";
+
+    static Config from_env() {
+        Config c;
+        if (const char* v = std::getenv("BENCH_MIN_REPS"))    c.min_reps = std::atoi(v);
+        if (const char* v = std::getenv("BENCH_MAX_REPS"))    c.max_reps = std::atoi(v);
+        if (const char* v = std::getenv("BENCH_TARGET_MAD"))  c.target_rel_mad = std::atof(v);
+        if (const char* v = std::getenv("BENCH_MAX_WARMUP"))  c.max_warmup = std::atoi(v);
+        if (const char* v = std::getenv("BENCH_MAX_SECONDS")) c.max_seconds = std::atof(v);
+        if (const char* v = std::getenv("BENCH_PIN_CPU"))     c.pin_cpus = v;
+        if (const char* v = std::getenv("BENCH_OUT"))         c.out_prefix = v;
+        return c;
+    }
+};
+
+// Linear-interpolated percentile of an already sorted sample, q in [0, 1].
+inline double percentile_sorted(const std::vector<double>& s, double q) {
+    if (s.empty()) return NAN;
+    double pos = q * (double)(s.size() - 1);
+    size_t lo = (size_t)pos;
+    size_t hi = std::min(lo + 1, s.size() - 1);
+    double frac = pos - (double)lo;
+    return s[lo] + (s[hi] - s[lo]) * frac;
+}
+
+struct Stats {
+    size_t n = 0;
+    double min = NAN, max = NAN, mean = NAN, median = NAN, mad = NAN;
+    double p5 = NAN, p25 = NAN, p75 = NAN, p95 = NAN, p99 = NAN;
+
+    static Stats from(std::vector<double> v) {
+        Stats s;
+        s.n = v.size();
+        if (v.empty()) return s;
+        std::sort(v.begin(), v.end());
+        double sum = 0.0;
+        for (double x : v) sum += x;
+        s.min = v.front();
+        s.max = v.back();
+        s.mean = sum / (double)v.size();
+        s.median = percentile_sorted(v, 0.50);
+        s.p5  = percentile_sorted(v, 0.05);
+        s.p25 = percentile_sorted(v, 0.25);
+        s.p75 = percentile_sorted(v, 0.75);
+        s.p95 = percentile_sorted(v, 0.95);
+        s.p99 = percentile_sorted(v, 0.99);
+        std::vector<double> dev;
+        dev.reserve(v.size());
+        for (double x : v) dev.push_back(std::fabs(x - s.median));
+        std::sort(dev.begin(), dev.end());
+        s.mad = percentile_sorted(dev, 0.50);
+        return s;
+    }
+
+    double rel_mad() const { return (median > 0.0) ? mad / median : NAN; }
+};
+
+// Pin the calling thread (and threads it creates later) to a CPU list such
+// as "3" or "0,2,4-7". Returns false if unsupported or the list is invalid.
+inline bool pin_to_cpus(const std::string& list) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    const char* s = list.c_str();
+    bool any = false;
+    while (*s) {
+        char* end = nullptr;
+        long a = std::strtol(s, &end, 10);
+        if (end == s) return false;
+        long b = a;
+        if (*end == '-') {
+            s = end + 1;
+            b = std::strtol(s, &end, 10);
+            if (end == s) return false;
+        }
+        for (long c = a; c <= b && c < CPU_SETSIZE; ++c) {
+            if (c >= 0) { CPU_SET((int)c, &set); any = true; }
+        }
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return any && sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)list;
+    return false;
+#endif
+}
+
+// Host/compiler description written into every result file.
+struct MachineInfo {
+    std::string host = "unknown";
+    std::string cpu = "unknown";
+    unsigned hw_threads = std::thread::hardware_concurrency();
+    std::string compiler =
+#if defined(__VERSION__)
+        __VERSION__;
+#else
+        "unknown";
+#endif
+    std::string timestamp;
+
+    static MachineInfo detect() {
+        MachineInfo m;
+#if defined(__linux__)
+        char buf[256] = {0};
+        if (gethostname(buf, sizeof(buf) - 1) == 0) m.host = buf;
+        std::ifstream in("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.rfind("model name", 0) == 0) {
+                auto colon = line.find(':');
+                if (colon != std::string::npos) m.cpu = line.substr(colon + 2);
+                break;
+            }
+        }
+#endif
+        char ts[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        m.timestamp = ts;
+        return m;
+    }
+};
+
+// Handed to bodies that want to exclude setup/verification from the timing.
+class Timing {
+public:
+    explicit Timing(PerfCounters& pc) : pc_(pc) {}
+
+    void start() {
+        pc_.start();
+        t0_ = std::chrono::steady_clock::now();
+    }
+
+    void stop() {
+        auto t1 = std::chrono::steady_clock::now();
+        perf_ = pc_.stop();
+        ns_ = std::chrono::duration<double, std::nano>(t1 - t0_).count();
+    }
+
+    double ns() const { return ns_; }
+    const PerfSample& perf() const { return perf_; }
+
+private:
+    PerfCounters& pc_;
+    std::chrono::steady_clock::time_point t0_{};
+    double ns_ = 0.0;
+    PerfSample perf_;
+};
+
+// Correctness checks a bench runs before timing anything: one "ok" or
+// "FAIL" line each. The bench exits with status 1 if any failed.
+class Checks {
+public:
+    bool expect(const char* what, bool ok) {
+        if (!ok) ++failures_;
+        std::printf("  %-4s %s\n", ok ? "ok" : "FAIL", what);
+        return ok;
+    }
+
+    // A failure the bench reports in its own words.
+    void fail() { ++failures_; }
+    int failures() const { return failures_; }
+    bool passed() const { return failures_ == 0; }
+
+private:
+    int failures_ = 0;
+};
+
+struct CaseResult {
+    std::string name;
+    Params params;
+    double ops_per_iter = 1.0;
+    int warmup_iters = 0;
+    bool stable = false;          // reached target_rel_mad within the budget
+    std::vector<double> samples_ns;
+    Stats stats;
+    PerfSample perf;              // summed over the measured samples
+
+    double ns_per_op() const { return stats.median / ops_per_iter; }
+    double ops_per_sec() const { return (stats.median > 0.0) ? ops_per_iter * 1e9 / stats.median : 0.0; }
+
+    std::string params_str() const {
+        std::string s;
+        for (const auto& [k, v] : params) {
+            if (!s.empty()) s += ';';
+            s += k + "=" + v;
+        }
+        return s;
+    }
+
+    // The value of one param, "" if the case does not set it.
+    std::string param(const std::string& key) const {
+        for (const auto& [k, v] : params)
+            if (k == key) return v;
+        return "";
+    }
+
+    double per_op(PerfEvent e) const {
+        return perf.per_op(e, ops_per_iter * (double)samples_ns.size());
+    }
+};
+
+class Runner {
+public:
+    explicit Runner(Config cfg = Config::from_env())
+        : cfg_(std::move(cfg)), machine_(MachineInfo::detect()) {
+        if (cfg_.min_reps < 1) cfg_.min_reps = 1;
+        if (cfg_.max_reps < cfg_.min_reps) cfg_.max_reps = cfg_.min_reps;
+        if (!cfg_.pin_cpus.empty()) pinned_ = pin_to_cpus(cfg_.pin_cpus);
+    }
+
+    Config& config() { return cfg_; }
+    PerfCounters& counters() { return perf_; }
+    const std::vector<CaseResult>& results() const { return results_; }
+
+    // Params that also get a CSV column of their own, after `params`, for
+    // results that are sliced by them (e.g. "threads").
+    void add_csv_column(std::string key) { csv_columns_.push_back(std::move(key)); }
+
+    // Run one case. `body` is either void() (timed whole) or void(Timing&).
+    template <class F>
+    const CaseResult& run(std::string name, Params params, double ops_per_iter, F&& body) {
+        CaseResult r;
+        r.name = std::move(name);
+        r.params = std::move(params);
+        r.ops_per_iter = ops_per_iter > 0.0 ? ops_per_iter : 1.0;
+
+        const auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(cfg_.max_seconds));
+        auto out_of_time = [&] { return std::chrono::steady_clock::now() >= deadline; };
+
+        // Warmup: run until two consecutive samples agree within tolerance.
+        double prev = -1.0;
+        for (int w = 0; w < cfg_.max_warmup; ++w) {
+            Timing t = sample(body);
+            ++r.warmup_iters;
+            if (prev > 0.0 && std::fabs(t.ns() - prev) <= cfg_.warmup_tolerance * prev) break;
+            prev = t.ns();
+            if (out_of_time()) break;
+        }
+
+        // Measure: at least min_reps, then until stable or out of budget.
+        while ((int)r.samples_ns.size() < cfg_.max_reps) {
+            Timing t = sample(body);
+            r.samples_ns.push_back(t.ns());
+            r.perf += t.perf();
+            if ((int)r.samples_ns.size() < cfg_.min_reps) continue;
+            r.stats = Stats::from(r.samples_ns);
+            if (r.stats.rel_mad() <= cfg_.target_rel_mad) { r.stable = true; break; }
+            if (out_of_time()) break;
+        }
+        r.stats = Stats::from(r.samples_ns);
+        results_.push_back(std::move(r));
+        return results_.back();
+    }
+
+    // "# host=... cpu=... ..." comment line, written at the top of every report.
+    void print_header(std::FILE* out) const {
+        std::fprintf(out, "# host=%s cpu=\"%s\" hw_threads=%u compiler=\"%s\" time=%s pinned=%s\n",
+                     machine_.host.c_str(), machine_.cpu.c_str(), machine_.hw_threads,
+                     machine_.compiler.c_str(), machine_.timestamp.c_str(),
+                     pinned_ ? cfg_.pin_cpus.c_str() : "no");
+        perf_.describe(out);
+    }
+
+    // One human-readable line per case.
+    static void print_case(std::FILE* out, const CaseResult& r) {
+        std::string label = r.name;
+        std::string p = r.params_str();
+        if (!p.empty()) label += " [" + p + "]";
+        const double m = r.stats.median;
+        const double scale = (m >= 1e6) ? 1e6 : (m >= 1e3) ? 1e3 : 1.0;
+        const char* unit = (m >= 1e6) ? "ms" : (m >= 1e3) ? "us" : "ns";
+        std::fprintf(out, "%-40s median %10.3f %s  mad %5.2f%%  p95 %10.3f %s  n=%zu%s  ns/op %.3f",
+                     label.c_str(), m / scale, unit, 100.0 * r.stats.rel_mad(),
+                     r.stats.p95 / scale, unit, r.stats.n, r.stable ? "" : " (unstable)", r.ns_per_op());
+        if (r.perf.any())
+            std::fprintf(out, "  IPC %.3f  br/op %.4f  L1d/op %.4f  LLC/op %.5f  dTLB/op %.5f",
+                         r.perf.ipc(), r.per_op(PerfEvent::BranchMisses), r.per_op(PerfEvent::L1DMisses),
+                         r.per_op(PerfEvent::LLCMisses), r.per_op(PerfEvent::DTLBMisses));
+        std::fprintf(out, "\n");
+    }
+
+    std::string csv_header() const {
+        std::string h = "name,params,";
+        for (const auto& c : csv_columns_) h += c + ",";
+        return h + "ops_per_iter,n,warmup,stable,median_ns,mad_ns,mean_ns,min_ns,max_ns,"
+                   "p5_ns,p25_ns,p75_ns,p95_ns,p99_ns,ns_per_op,ops_per_sec,"
+                   "ipc,cycles_per_op,branch_misses_per_op,l1d_misses_per_op,llc_misses_per_op,dtlb_misses_per_op,"
+                   "samples_ns\n";
+    }
+
+    void write_csv(std::FILE* out) const {
+        print_header(out);
+        std::fputs(csv_header().c_str(), out);
+        for (const auto& r : results_) {
+            const Stats& s = r.stats;
+            std::fprintf(out, "%s,%s,", r.name.c_str(), r.params_str().c_str());
+            for (const auto& c : csv_columns_) std::fprintf(out, "%s,", r.param(c).c_str());
+            std::fprintf(out, "%.17g,%zu,%d,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,"
+                              "%.6f,%.3f,%.4f,%.4f,%.6f,%.6f,%.6f,%.6f,",
+                         r.ops_per_iter, s.n, r.warmup_iters,
+                         r.stable ? 1 : 0, s.median, s.mad, s.mean, s.min, s.max,
+                         s.p5, s.p25, s.p75, s.p95, s.p99, r.ns_per_op(), r.ops_per_sec(),
+                         r.perf.ipc(), r.per_op(PerfEvent::Cycles), r.per_op(PerfEvent::BranchMisses),
+                         r.per_op(PerfEvent::L1DMisses), r.per_op(PerfEvent::LLCMisses),
+                         r.per_op(PerfEvent::DTLBMisses));
+            for (size_t i = 0; i < r.samples_ns.size(); ++i)
+                std::fprintf(out, "%s%.1f", i ? ";" : "", r.samples_ns[i]);
+            std::fprintf(out, "\n");
+        }
+    }
+
+    bool write_csv(const std::string& path) const {
+        std::FILE* f = std::fopen(path.c_str(), "w");
+        if (!f) return false;
+        write_csv(f);
+        std::fclose(f);
+        return true;
+    }
+
+    bool write_json(const std::string& path) const {
+        std::FILE* f = std::fopen(path.c_str(), "w");
+        if (!f) return false;
+        auto num = [f](double v) {
+            if (std::isfinite(v)) std::fprintf(f, "%.17g", v);
+            else std::fputs("null", f);
+        };
+        std::fprintf(f, "{\n  \"machine\": {\"host\": \"%s\", \"cpu\": \"%s\", \"hw_threads\": %u, "
+                        "\"compiler\": \"%s\", \"time\": \"%s\", \"pinned\": \"%s\"},\n",
+                     json_escape(machine_.host).c_str(), json_escape(machine_.cpu).c_str(),
+                     machine_.hw_threads, json_escape(machine_.compiler).c_str(),
+                     machine_.timestamp.c_str(), pinned_ ? json_escape(cfg_.pin_cpus).c_str() : "");
+        std::fprintf(f, "  \"config\": {\"min_reps\": %d, \"max_reps\": %d, \"target_rel_mad\": %g, "
+                        "\"max_warmup\": %d, \"max_seconds\": %g},\n",
+                     cfg_.min_reps, cfg_.max_reps, cfg_.target_rel_mad, cfg_.max_warmup, cfg_.max_seconds);
+        std::fprintf(f, "  \"results\": [\n");
+        for (size_t k = 0; k < results_.size(); ++k) {
+            const auto& r = results_[k];
+            const Stats& s = r.stats;
+            std::fprintf(f, "    {\"name\": \"%s\", \"params\": {", json_escape(r.name).c_str());
+            for (size_t i = 0; i < r.params.size(); ++i)
+                std::fprintf(f, "%s\"%s\": \"%s\"", i ? ", " : "", json_escape(r.params[i].first).c_str(),
+                             json_escape(r.params[i].second).c_str());
+            std::fprintf(f, "}, \"ops_per_iter\": ");   num(r.ops_per_iter);
+            std::fprintf(f, ", \"warmup\": %d, \"stable\": %s, \"n\": %zu", r.warmup_iters,
+                         r.stable ? "true" : "false", s.n);
+            const std::pair<const char*, double> fields[] = {
+                {"median_ns", s.median}, {"mad_ns", s.mad}, {"mean_ns", s.mean},
+                {"min_ns", s.min}, {"max_ns", s.max}, {"p5_ns", s.p5}, {"p25_ns", s.p25},
+                {"p75_ns", s.p75}, {"p95_ns", s.p95}, {"p99_ns", s.p99},
+                {"ns_per_op", r.ns_per_op()}, {"ops_per_sec", r.ops_per_sec()},
+                {"ipc", r.perf.ipc()}, {"cycles_per_op", r.per_op(PerfEvent::Cycles)},
+                {"branch_misses_per_op", r.per_op(PerfEvent::BranchMisses)},
+                {"l1d_misses_per_op", r.per_op(PerfEvent::L1DMisses)},
+                {"llc_misses_per_op", r.per_op(PerfEvent::LLCMisses)},
+                {"dtlb_misses_per_op", r.per_op(PerfEvent::DTLBMisses)},
+            };
+            for (const auto& [key, v] : fields) {
+                std::fprintf(f, ", \"%s\": ", key);
+                num(v);
+            }
+            std::fprintf(f, ", \"samples_ns\": [");
+            for (size_t i = 0; i < r.samples_ns.size(); ++i) {
+                if (i) std::fputs(", ", f);
+                num(r.samples_ns[i]);
+            }
+            std::fprintf(f, "]}%s\n", (k + 1 < results_.size()) ? "," : "");
+        }
+        std::fprintf(f, "  ]\n}\n");
+        std::fclose(f);
+        return true;
+    }
+
+    // <out_prefix>.csv and <out_prefix>.json
+    bool write_reports() const {
+        bool ok = write_csv(cfg_.out_prefix + ".csv");
+        ok = write_json(cfg_.out_prefix + ".json") && ok;
+        if (!ok) std::fprintf(stderr, "failed to write %s.csv/.json\n", cfg_.out_prefix.c_str());
+        return ok;
+    }
+
+private:
+    template <class F>
+    Timing sample(F& body) {
+        Timing t(perf_);
+        if constexpr (std::is_invocable_v<F&, Timing&>) {
+            body(t);
+        } else {
+            t.start();
+            body();
+            t.stop();
+        }
+        return t;
+    }
+
+    static std::string json_escape(const std::string& in) {
+        std::string out;
+        for (char c : in) {
+            if (c == '"' || c == '\\') { out += '\\'; out += c; }
+            else if ((unsigned char)c < 0x20) out += ' ';
+            else out += c;
+        }
+        return out;
+    }
+
+    Config cfg_;
+    MachineInfo machine_;
+    PerfCounters perf_;
+    bool pinned_ = false;
+    std::vector<CaseResult> results_;
+    std::vector<std::string> csv_columns_;
+};
+
+} // namespace bench
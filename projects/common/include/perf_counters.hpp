@@ -0,0 +1,172 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// In-process hardware counters via perf_event_open(2).
+//
+// Each event is opened on its own (not as a group) so that a missing or
+// unsupported event only drops that column instead of the whole set, and
+// so the kernel can multiplex when there are more events than PMU slots;
+// counts are scaled by time_enabled / time_running. Counters are
+// user-space only (works with perf_event_paranoid <= 2) and inherited by
+// threads created after construction.
+//
+// On non-Linux builds, in VMs without a virtual PMU, or when the syscall
+// is refused, available() is false and every value reads as NaN.
+
+enum class PerfEvent : int {
+    Cycles = 0,
+    Instructions,
+    BranchMisses,
+    L1DMisses,
+    LLCMisses,
+    DTLBMisses,
+    Count
+};
+
+constexpr int kPerfEventCount = static_cast<int>(PerfEvent::Count);
+
+inline const char* perf_event_name(PerfEvent e) {
+    switch (e) {
+        case PerfEvent::Cycles:       return "cycles";
+        case PerfEvent::Instructions: return "instructions";
+        case PerfEvent::BranchMisses: return "branch_misses";
+        case PerfEvent::L1DMisses:    return "l1d_misses";
+        case PerfEvent::LLCMisses:    return "llc_misses";
+        case PerfEvent::DTLBMisses:   return "dtlb_misses";
+        case PerfEvent::Count:        break;
+    }
+    return "unknown";
+}
+
+struct PerfSample {
+    double value[kPerfEventCount];
+    bool   valid[kPerfEventCount];
+
+    PerfSample() {
+        for (int i = 0; i < kPerfEventCount; ++i) { value[i] = 0.0; valid[i] = false; }
+    }
+
+    bool any() const {
+        for (bool v : valid) if (v) return true;
+        return false;
+    }
+
+    double get(PerfEvent e) const {
+        int i = static_cast<int>(e);
+        return valid[i] ? value[i] : NAN;
+    }
+
+    double ipc() const {
+        double c = get(PerfEvent::Cycles);
+        return (c > 0.0) ? get(PerfEvent::Instructions) / c : NAN;
+    }
+
+    double per_op(PerfEvent e, double ops) const {
+        return (ops > 0.0) ? get(e) / ops : NAN;
+    }
+
+    // Accumulate another region (e.g. summing repeats before averaging).
+    PerfSample& operator+=(const PerfSample& o) {
+        for (int i = 0; i < kPerfEventCount; ++i) {
+            value[i] += o.value[i];
+            valid[i] = valid[i] || o.valid[i];
+        }
+        return *this;
+    }
+};
+
+class PerfCounters {
+public:
+    PerfCounters() {
+        for (int i = 0; i < kPerfEventCount; ++i) fd_[i] = -1;
+#if defined(__linux__)
+        const auto cache = [](std::uint64_t id, std::uint64_t result) {
+            return id | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+        };
+        const struct { std::uint32_t type; std::uint64_t config; } ev[kPerfEventCount] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D,  PERF_COUNT_HW_CACHE_RESULT_MISS) },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+        };
+        for (int i = 0; i < kPerfEventCount; ++i) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = ev[i].type;
+            attr.config = ev[i].config;
+            attr.disabled = 1;
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fd_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (int fd : fd_) if (fd >= 0) close(fd);
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const {
+        for (int fd : fd_) if (fd >= 0) return true;
+        return false;
+    }
+
+    bool available(PerfEvent e) const { return fd_[static_cast<int>(e)] >= 0; }
+
+    void start() {
+#if defined(__linux__)
+        for (int fd : fd_) if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        for (int fd : fd_) if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    PerfSample stop() {
+        PerfSample s;
+#if defined(__linux__)
+        for (int fd : fd_) if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        for (int i = 0; i < kPerfEventCount; ++i) {
+            if (fd_[i] < 0) continue;
+            std::uint64_t buf[3] = {0, 0, 0}; // value, time_enabled, time_running
+            if (read(fd_[i], buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf))) continue;
+            if (buf[2] == 0) continue; // never scheduled on the PMU
+            s.value[i] = static_cast<double>(buf[0]) * static_cast<double>(buf[1]) / static_cast<double>(buf[2]);
+            s.valid[i] = true;
+        }
+#endif
+        return s;
+    }
+
+    // One-line note for benchmark headers, e.g. "# perf counters: cycles instructions ..."
+    void describe(std::FILE* out) const {
+        if (!available()) {
+            std::fprintf(out, "# perf counters: unavailable (non-Linux, no PMU, or perf_event_paranoid too high)\n");
+            return;
+        }
+        std::fprintf(out, "# perf counters:");
+        for (int i = 0; i < kPerfEventCount; ++i)
+            if (fd_[i] >= 0) std::fprintf(out, " %s", perf_event_name(static_cast<PerfEvent>(i)));
+        std::fprintf(out, "\n");
+    }
+
+private:
+    int fd_[kPerfEventCount];
+};
+
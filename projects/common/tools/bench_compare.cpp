@@ -0,0 +1,163 @@
+// Compare two bench::Runner CSV result files and flag significant changes.
+//
+//   bench_compare base.csv new.csv [alpha] [threshold]
+//
+// Cases are matched on (name, params). For each pair the raw samples are
+// compared with a two-sided Mann-Whitney U test (normal approximation with
+// tie correction). A case is a REGRESSION when p < alpha (default 0.05) and
+// the median got slower by more than `threshold` (default 0.02 = 2%);
+// IMPROVEMENT is the mirror image. Exit status is 1 if any case regressed.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench_harness.hpp"
+
+namespace {
+
+struct Row {
+    std::string key;            // name [params]
+    std::vector<double> samples;
+};
+
+std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> out;
+    std::string cur;
+    std::istringstream in(s);
+    while (std::getline(in, cur, sep)) out.push_back(cur);
+    if (!s.empty() && s.back() == sep) out.emplace_back();
+    return out;
+}
+
+// Columns are looked up by header name, so files from older/newer versions of
+// the harness still compare as long as name, params and samples_ns exist.
+bool load(const char* path, std::vector<Row>& rows, std::string& machine) {
+    std::ifstream in(path);
+    if (!in) {
+        std::fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    std::string line;
+    int c_name = -1, c_params = -1, c_samples = -1;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        if (line[0] == '#') {
+            if (machine.empty() && line.rfind("# host=", 0) == 0) machine = line.substr(2);
+            continue;
+        }
+        auto cols = split(line, ',');
+        if (c_name < 0) {
+            for (int i = 0; i < (int)cols.size(); ++i) {
+                if (cols[i] == "name") c_name = i;
+                else if (cols[i] == "params") c_params = i;
+                else if (cols[i] == "samples_ns") c_samples = i;
+            }
+            if (c_name < 0 || c_samples < 0) {
+                std::fprintf(stderr, "%s: missing name/samples_ns columns\n", path);
+                return false;
+            }
+            continue;
+        }
+        if ((int)cols.size() <= c_samples) continue;
+        Row r;
+        r.key = cols[c_name];
+        if (c_params >= 0 && !cols[c_params].empty()) r.key += " [" + cols[c_params] + "]";
+        for (const auto& v : split(cols[c_samples], ';'))
+            if (!v.empty()) r.samples.push_back(std::atof(v.c_str()));
+        rows.push_back(std::move(r));
+    }
+    return true;
+}
+
+// Two-sided p-value of the Mann-Whitney U test, normal approximation.
+double mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b) {
+    const size_t n1 = a.size(), n2 = b.size();
+    if (n1 == 0 || n2 == 0) return 1.0;
+    std::vector<std::pair<double, int>> all;
+    all.reserve(n1 + n2);
+    for (double v : a) all.emplace_back(v, 0);
+    for (double v : b) all.emplace_back(v, 1);
+    std::sort(all.begin(), all.end());
+
+    // average ranks over ties, accumulating the tie correction term
+    double rank_sum_a = 0.0, tie_term = 0.0;
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j].first == all[i].first) ++j;
+        double avg_rank = 0.5 * (double)(i + 1 + j);
+        double t = (double)(j - i);
+        tie_term += t * t * t - t;
+        for (size_t k = i; k < j; ++k)
+            if (all[k].second == 0) rank_sum_a += avg_rank;
+        i = j;
+    }
+    const double N = (double)(n1 + n2);
+    const double u = rank_sum_a - (double)n1 * (double)(n1 + 1) / 2.0;
+    const double mu = (double)n1 * (double)n2 / 2.0;
+    const double var = (double)n1 * (double)n2 / 12.0 * ((N + 1.0) - tie_term / (N * (N - 1.0)));
+    if (var <= 0.0) return 1.0;
+    double z = (std::fabs(u - mu) - 0.5) / std::sqrt(var); // continuity correction
+    if (z < 0.0) z = 0.0;
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s base.csv new.csv [alpha=0.05] [threshold=0.02]\n", argv[0]);
+        return 2;
+    }
+    const double alpha = (argc > 3) ? std::atof(argv[3]) : 0.05;
+    const double threshold = (argc > 4) ? std::atof(argv[4]) : 0.02;
+
+    std::vector<Row> base, cand;
+    std::string base_machine, cand_machine;
+    if (!load(argv[1], base, base_machine) || !load(argv[2], cand, cand_machine)) return 2;
+
+    std::printf("base: %s\n", base_machine.empty() ? argv[1] : base_machine.c_str());
+    std::printf("new:  %s\n", cand_machine.empty() ? argv[2] : cand_machine.c_str());
+    std::printf("%-48s %14s %14s %9s %9s  %s\n", "case", "base med ns", "new med ns", "change", "p", "verdict");
+
+    std::map<std::string, const Row*> by_key;
+    for (const auto& r : base) by_key[r.key] = &r;
+
+    int regressions = 0, improvements = 0, unmatched = 0;
+    for (const auto& r : cand) {
+        auto it = by_key.find(r.key);
+        if (it == by_key.end()) {
+            std::printf("%-48s %14s %14s %9s %9s  %s\n", r.key.c_str(), "-", "-", "-", "-", "new case");
+            ++unmatched;
+            continue;
+        }
+        const double mb = bench::Stats::from(it->second->samples).median;
+        const double mc = bench::Stats::from(r.samples).median;
+        const double change = (mb > 0.0) ? (mc - mb) / mb : 0.0;
+        const double p = mann_whitney_p(it->second->samples, r.samples);
+
+        const char* verdict = "same";
+        if (p < alpha && change > threshold)       { verdict = "REGRESSION"; ++regressions; }
+        else if (p < alpha && change < -threshold) { verdict = "improvement"; ++improvements; }
+        else if (p < alpha)                        { verdict = "same (significant, below threshold)"; }
+
+        std::printf("%-48s %14.1f %14.1f %+8.2f%% %9.4f  %s\n",
+                    r.key.c_str(), mb, mc, 100.0 * change, p, verdict);
+        by_key.erase(it);
+    }
+    for (const auto& [key, row] : by_key) {
+        (void)row;
+        std::printf("%-48s %14s %14s %9s %9s  %s\n", key.c_str(), "-", "-", "-", "-", "missing in new");
+        ++unmatched;
+    }
+
+    std::printf("\n%d regression(s), %d improvement(s), %d unmatched case(s)\n",
+                regressions, improvements, unmatched);
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,181 @@
+// Per-tick fan-out cost of the server's broadcast transports versus client
+// count.
+//
+//   ./broadcast_bench [ticks per sample] [clients,...]
+//
+// Every client is a real TCP loopback connection, as in hft_server. One
+// sample broadcasts `ticks` ticks and then waits for every write to
+// complete (flush), so the io_uring backends are charged for the work
+// they hand to the kernel, not only for queueing it. The client ends are
+// drained outside the timed region, and each must have received exactly
+// every byte sent, or the run fails.
+//
+// Also printed per case: syscalls per tick and the time the publisher
+// spends in broadcast() per tick (what the price thread actually waits).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "bench_harness.hpp"
+#include "broadcast.hpp"
+
+using namespace std;
+
+// "1,2,4" -> {1, 2, 4}
+static vector<int> parseList(const char* s) {
+    vector<int> out;
+    while (*s) {
+        char* end = nullptr;
+        long v = strtol(s, &end, 10);
+        if (end == s) break;
+        if (v > 0) out.push_back((int)v);
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return out;
+}
+
+struct Connection {
+    int serverFd;  // what the broadcaster writes to
+    int clientFd;  // drained by the benchmark
+};
+
+// n loopback connections through one listener on an ephemeral port
+static bool connectPairs(int n, vector<Connection>& out) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0;
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    socklen_t len = sizeof addr;
+    if (listener < 0 || ::bind(listener, (sockaddr*)&addr, sizeof addr) < 0 || listen(listener, 1024) < 0 ||
+        getsockname(listener, (sockaddr*)&addr, &len) < 0) {
+        perror("listener");
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        int c = socket(AF_INET, SOCK_STREAM, 0);
+        if (c < 0 || connect(c, (sockaddr*)&addr, sizeof addr) < 0) {
+            perror("connect");
+            return false;
+        }
+        int s = accept(listener, nullptr, nullptr);
+        if (s < 0) {
+            perror("accept");
+            return false;
+        }
+        int one = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        fcntl(c, F_SETFL, fcntl(c, F_GETFL, 0) | O_NONBLOCK);
+        out.push_back(Connection{s, c});
+    }
+    close(listener);
+    return true;
+}
+
+// Read everything waiting on a client end. Data can still be in flight on
+// loopback right after flush, so keep reading until `expect` bytes arrived.
+static size_t drain(int fd, size_t expect) {
+    char buf[65536];
+    size_t total = 0;
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    while (total < expect && chrono::steady_clock::now() < deadline) {
+        const ssize_t got = recv(fd, buf, sizeof buf, 0);
+        if (got > 0) total += (size_t)got;
+    }
+    return total;
+}
+
+int main(int argc, char** argv) {
+    int ticks = 256;
+    vector<int> clientCounts = {1, 4, 16, 64, 256};
+    if (argc > 1) ticks = max(1, atoi(argv[1]));
+    if (argc > 2) clientCounts = parseList(argv[2]);
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+    int failures = 0;
+
+    for (int n : clientCounts) {
+        vector<Connection> conns;
+        if (!connectPairs(n, conns)) return 1;
+
+        for (Transport t : {Transport::Send, Transport::Uring, Transport::UringSqpoll}) {
+            string why;
+            unique_ptr<Broadcaster> b = makeBroadcaster(t, &why);
+            if (b->transport() != t) {
+                printf("    %s unavailable (%s), skipped\n", transportName(t), why.c_str());
+                continue;
+            }
+            for (auto& c : conns) {
+                if (!b->addClient(c.serverFd)) {
+                    fprintf(stderr, "%s: could not add client %d\n", transportName(t), c.serverFd);
+                    return 1;
+                }
+            }
+
+            // same length for every tick, so the byte count is easy to check
+            int nextId = 100000;
+            char line[48];
+            vector<double> callNs;
+            callNs.reserve(ticks);
+            uint64_t samples = 0, missing = 0;
+            const uint64_t syscallsBefore = b->syscalls();
+
+            const bench::CaseResult& r = runner.run(
+                "fanout", {{"transport", transportName(t)}, {"clients", to_string(n)}}, ticks,
+                [&](bench::Timing& timing) {
+                    size_t bytes = 0;
+                    callNs.clear();
+                    timing.start();
+                    for (int i = 0; i < ticks; i++, nextId++) {
+                        const int len = snprintf(line, sizeof line, "%d,%.6f\n", nextId, 100.0 + (nextId % 1000) / 10.0);
+                        const auto t0 = chrono::steady_clock::now();
+                        b->broadcast(line, (size_t)len);
+                        callNs.push_back(chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count());
+                        bytes += (size_t)len;
+                    }
+                    b->flush();
+                    timing.stop();
+                    for (auto& c : conns) {
+                        const size_t got = drain(c.clientFd, bytes);
+                        if (got != bytes) missing++;
+                    }
+                    samples++;
+                });
+            bench::Runner::print_case(stdout, r);
+
+            sort(callNs.begin(), callNs.end());
+            const bench::Stats s = bench::Stats::from(callNs);
+            const double syscallsPerTick = (double)(b->syscalls() - syscallsBefore) / ((double)samples * ticks);
+            printf("    %-40s %9.1f ns/tick  %7.1f ns/client  %6.2f syscalls/tick  broadcast() p50 %.0f ns p99 %.0f ns\n",
+                   (r.name + " [" + r.params_str() + "]").c_str(), r.ns_per_op(), r.ns_per_op() / n,
+                   syscallsPerTick, s.median, s.p99);
+
+            if (missing || b->errors()) {
+                failures++;
+                fprintf(stderr, "fanout %s x%d: %llu short client reads, %llu write errors\n", transportName(t), n,
+                        (unsigned long long)missing, (unsigned long long)b->errors());
+            }
+            for (auto& c : conns) b->removeClient(c.serverFd);
+        }
+
+        for (auto& c : conns) {
+            close(c.serverFd);
+            close(c.clientFd);
+        }
+    }
+
+    runner.write_reports();
+    return failures == 0 ? 0 : 1;
+}
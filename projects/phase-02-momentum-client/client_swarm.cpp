@@ -0,0 +1,581 @@
+// Load generator: hundreds of simulated momentum clients against one
+// hft_server, with a report on throughput, fan-out skew and first-hit
+// fairness.
+//
+//   ./client_swarm --clients 200 --threads 2 --duration 10
+//       --reaction exp:300us --reaction uniform:50us,1ms
+//       --server ./hft_server --interval-us 1000
+//
+// Each client is one connection running the momentum rule on coroutines
+// (coro_runtime.hpp); clients are spread over --threads event loops. When
+// the rule fires, a client waits a reaction time drawn from its group's
+// distribution and then sends the order. --reaction may be given several
+// times; clients are dealt to the groups round-robin, so the groups race
+// each other for the same prices.
+//
+// With --server the swarm starts hft_server itself (quiet, journaling) and
+// stops it at the end; with --journal it reads the journal of a server that
+// was run by hand and has since been stopped. From the journal it reports
+// what the server saw: tick and order rates, tick-to-client latency, and who
+// won each price compared with who sent first.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "async_client.hpp"
+#include "coro_runtime.hpp"
+#include "journal.hpp"
+
+using namespace std;
+
+// Reaction time distribution -------------------------------------------------
+
+// "250us" / "2ms" / "1s" / "800ns" / "300" (microseconds) -> ns
+static bool parseDurationNs(const string& s, double& ns) {
+    char* end = nullptr;
+    const double v = strtod(s.c_str(), &end);
+    if (end == s.c_str() || v < 0) return false;
+    const string unit(end);
+    if (unit == "ns") ns = v;
+    else if (unit == "us" || unit.empty()) ns = v * 1e3;
+    else if (unit == "ms") ns = v * 1e6;
+    else if (unit == "s") ns = v * 1e9;
+    else return false;
+    return true;
+}
+
+struct Reaction {
+    enum Kind { Fixed, Uniform, Exponential, Lognormal } kind = Fixed;
+    double a = 0;  // fixed value, uniform low, exponential mean, lognormal median (ns)
+    double b = 0;  // uniform high (ns), lognormal sigma
+    string spec;
+
+    //   fixed:T  uniform:LO,HI  exp:MEAN  lognormal:MEDIAN,SIGMA
+    static bool parse(const string& spec, Reaction& out) {
+        out = Reaction{};
+        out.spec = spec;
+        const size_t colon = spec.find(':');
+        if (colon == string::npos) return false;
+        const string kind = spec.substr(0, colon);
+        const string args = spec.substr(colon + 1);
+        const size_t comma = args.find(',');
+        const string first = args.substr(0, comma);
+        const string second = comma == string::npos ? "" : args.substr(comma + 1);
+        if (kind == "fixed") {
+            out.kind = Fixed;
+            return comma == string::npos && parseDurationNs(first, out.a);
+        }
+        if (kind == "uniform") {
+            out.kind = Uniform;
+            return parseDurationNs(first, out.a) && parseDurationNs(second, out.b) && out.a <= out.b;
+        }
+        if (kind == "exp") {
+            out.kind = Exponential;
+            return comma == string::npos && parseDurationNs(first, out.a) && out.a > 0;
+        }
+        if (kind == "lognormal") {
+            out.kind = Lognormal;
+            char* end = nullptr;
+            out.b = strtod(second.c_str(), &end);
+            return parseDurationNs(first, out.a) && out.a > 0 && end != second.c_str() && out.b >= 0;
+        }
+        return false;
+    }
+
+    uint64_t sampleNs(mt19937_64& rng) const {
+        double ns = 0;
+        switch (kind) {
+            case Fixed: ns = a; break;
+            case Uniform: ns = uniform_real_distribution<double>(a, b)(rng); break;
+            case Exponential: ns = exponential_distribution<double>(1.0 / a)(rng); break;
+            case Lognormal: ns = lognormal_distribution<double>(log(a), b)(rng); break;
+        }
+        return (uint64_t)max(0.0, ns);
+    }
+};
+
+// What the clients saw, per loop thread, merged at the end -------------------
+
+struct TickSeen {
+    uint64_t firstNs = UINT64_MAX;  // steady clock, earliest client receive
+    uint64_t lastNs = 0;
+    int clients = 0;
+};
+
+struct SentOrder {
+    int client;
+    int priceId;
+    uint64_t sendNs;
+};
+
+struct LoopRecord {
+    unordered_map<int, TickSeen> ticks;
+    vector<SentOrder> orders;
+};
+
+// One simulated client: the momentum rule plus a reaction delay.
+class SwarmClient {
+public:
+    SwarmClient(EventLoop& loop, int fd, int index, string name, const Reaction& reaction, int window,
+                LoopRecord& record, uint64_t seed)
+        : loop_(loop), fd_(fd), index_(index), name_(std::move(name)), reaction_(reaction), record_(record),
+          rng_(seed), momentum_(window), orders_(loop) {}
+
+    bool start() {
+        const int flags = fcntl(fd_, F_GETFL, 0);
+        if (flags < 0 || fcntl(fd_, F_SETFL, flags | O_NONBLOCK) < 0) return false;
+        if (!loop_.watch(fd_)) return false;
+        loop_.spawn(marketData());
+        loop_.spawn(orderSender());
+        return true;
+    }
+
+    // Stop reading and writing; the fd is closed by the destructor.
+    void stop() {
+        if (stopped_) return;
+        stopped_ = true;
+        orders_.close();
+        loop_.unwatch(fd_);
+        ::shutdown(fd_, SHUT_RDWR);
+    }
+
+    ~SwarmClient() { close(fd_); }
+
+    uint64_t ticks() const { return ticks_; }
+    uint64_t orders() const { return orders_sent_; }
+
+private:
+    EventLoop& loop_;
+    int fd_;
+    int index_;
+    string name_;
+    const Reaction& reaction_;
+    LoopRecord& record_;
+    mt19937_64 rng_;
+    MomentumStrategy momentum_;
+    Channel<int> orders_;
+    bool stopped_ = false;
+    uint64_t ticks_ = 0;
+    uint64_t orders_sent_ = 0;
+
+    Task marketData() {
+        const char* p = name_.c_str();
+        size_t n = name_.size();
+        while (!stopped_ && n > 0) {
+            const ssize_t w = send(fd_, p, n, MSG_NOSIGNAL);
+            if (w > 0) {
+                p += w;
+                n -= (size_t)w;
+            } else if (w < 0 && (errno == EAGAIN || errno == EINTR)) {
+                co_await loop_.writable(fd_);
+            } else {
+                stop();
+            }
+        }
+
+        LineBuffer lines;
+        char buffer[4096];
+        while (!stopped_) {
+            const ssize_t got = recv(fd_, buffer, sizeof buffer, 0);
+            if (got > 0) {
+                const uint64_t now = loopNowNs();
+                lines.feed(buffer, (size_t)got, [&](const char* line, size_t len) {
+                    Tick t;
+                    if (!parseTick(line, len, t)) return;
+                    ticks_++;
+                    TickSeen& seen = record_.ticks[t.id];
+                    seen.firstNs = min(seen.firstNs, now);
+                    seen.lastNs = max(seen.lastNs, now);
+                    seen.clients++;
+                    if (momentum_.onPrice(t.price)) loop_.spawn(react(t.id));
+                });
+                continue;
+            }
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                co_await loop_.readable(fd_);
+                continue;
+            }
+            break;
+        }
+        stop();
+    }
+
+    // Orders can overtake each other when reaction times vary, as they
+    // would with real traders.
+    Task react(int priceId) {
+        co_await loop_.sleepFor(chrono::nanoseconds(reaction_.sampleNs(rng_)));
+        if (!stopped_) orders_.push(priceId);
+    }
+
+    Task orderSender() {
+        char line[16];
+        while (auto id = co_await orders_.pop()) {
+            const int len = snprintf(line, sizeof line, "%d\n", *id);
+            const char* p = line;
+            size_t n = (size_t)len;
+            const uint64_t sendNs = loopNowNs();
+            while (!stopped_ && n > 0) {
+                const ssize_t w = send(fd_, p, n, MSG_NOSIGNAL);
+                if (w > 0) {
+                    p += w;
+                    n -= (size_t)w;
+                } else if (w < 0 && (errno == EAGAIN || errno == EINTR)) {
+                    co_await loop_.writable(fd_);
+                } else {
+                    stop();
+                }
+            }
+            if (n == 0) {
+                orders_sent_++;
+                record_.orders.push_back(SentOrder{index_, *id, sendNs});
+            }
+        }
+    }
+};
+
+// Setup ----------------------------------------------------------------------
+
+static int connectTo(const string& host, int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1 || connect(sock, (sockaddr*)&addr, sizeof addr) < 0) {
+        close(sock);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    return sock;
+}
+
+// Start hft_server quiet and journaling; its output goes to logPath.
+static pid_t spawnServer(const string& path, const vector<string>& args, const string& logPath) {
+    const pid_t pid = fork();
+    if (pid != 0) return pid;
+    const int log = open(logPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (log >= 0) {
+        dup2(log, STDOUT_FILENO);
+        dup2(log, STDERR_FILENO);
+        close(log);
+    }
+    vector<char*> argv;
+    argv.push_back((char*)path.c_str());
+    for (auto& a : args) argv.push_back((char*)a.c_str());
+    argv.push_back(nullptr);
+    execv(path.c_str(), argv.data());
+    perror("execv");
+    _exit(127);
+}
+
+// Report helpers -------------------------------------------------------------
+
+static double pct(vector<double>& v, double p) {
+    if (v.empty()) return 0;
+    sort(v.begin(), v.end());
+    const size_t i = min(v.size() - 1, (size_t)(p / 100.0 * (double)v.size()));
+    return v[i];
+}
+
+static void printDist(const char* label, vector<double> ns) {
+    if (ns.empty()) {
+        printf("  %-34s n/a\n", label);
+        return;
+    }
+    printf("  %-34s p50 %9.1f us  p99 %9.1f us  max %9.1f us  (n=%zu)\n", label, pct(ns, 50) / 1e3,
+           pct(ns, 99) / 1e3, pct(ns, 100) / 1e3, ns.size());
+}
+
+// Jain's index: 1 when every value is equal, 1/n when one takes everything.
+static double jain(const vector<double>& x) {
+    double sum = 0, sq = 0;
+    for (double v : x) {
+        sum += v;
+        sq += v * v;
+    }
+    return sq > 0 ? sum * sum / ((double)x.size() * sq) : 1.0;
+}
+
+static void printUsage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--host IP] [--port N] [--clients N] [--threads T] [--duration S] [--window W]\n"
+            "          [--reaction SPEC]... [--seed N] [--server PATH [--interval-us US] [--transport T]]\n"
+            "          [--journal FILE]\n"
+            "  --clients N        simulated clients, one connection each (default 100)\n"
+            "  --threads T        event-loop threads the clients are spread over (default 1)\n"
+            "  --duration S       seconds to run (default 10)\n"
+            "  --window W         momentum window, prices in a row (default 3)\n"
+            "  --reaction SPEC    reaction time: fixed:T, uniform:LO,HI, exp:MEAN or lognormal:MEDIAN,SIGMA,\n"
+            "                     times in ns/us/ms/s (default exp:500us). Repeat for several groups.\n"
+            "  --seed N           seed for the reaction times (default 1)\n"
+            "  --server PATH      start this hft_server with --quiet --journal, stop it at the end\n"
+            "  --interval-us US   tick interval for the started server (default 1000)\n"
+            "  --transport T      broadcast transport for the started server (default send)\n"
+            "  --journal FILE     journal to analyse (default swarm.journal with --server)\n",
+            argv0);
+}
+
+int main(int argc, char** argv) {
+    string host = "127.0.0.1", serverPath, journalPath, transport = "send";
+    int port = 12345, clientCount = 100, threadCount = 1, intervalUs = 1000, window = 3;
+    double durationS = 10;
+    uint64_t seed = 1;
+    vector<Reaction> groups;
+    for (int i = 1; i < argc; i++) {
+        const string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--host" && hasValue) host = argv[++i];
+        else if (arg == "--port" && hasValue) port = atoi(argv[++i]);
+        else if (arg == "--clients" && hasValue) clientCount = max(1, atoi(argv[++i]));
+        else if (arg == "--threads" && hasValue) threadCount = max(1, atoi(argv[++i]));
+        else if (arg == "--duration" && hasValue) durationS = max(0.1, atof(argv[++i]));
+        else if (arg == "--window" && hasValue) window = max(2, atoi(argv[++i]));
+        else if (arg == "--seed" && hasValue) seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--server" && hasValue) serverPath = argv[++i];
+        else if (arg == "--interval-us" && hasValue) intervalUs = max(1, atoi(argv[++i]));
+        else if (arg == "--transport" && hasValue) transport = argv[++i];
+        else if (arg == "--journal" && hasValue) journalPath = argv[++i];
+        else if (arg == "--reaction" && hasValue) {
+            Reaction r;
+            if (!Reaction::parse(argv[++i], r)) {
+                fprintf(stderr, "bad --reaction %s\n", argv[i]);
+                return 1;
+            }
+            groups.push_back(r);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (groups.empty()) Reaction::parse("exp:500us", groups.emplace_back());
+    threadCount = min(threadCount, clientCount);
+    const uint64_t durationNs = (uint64_t)(durationS * 1e9);
+    signal(SIGPIPE, SIG_IGN);
+
+    pid_t server = -1;
+    if (!serverPath.empty()) {
+        if (journalPath.empty()) journalPath = "swarm.journal";
+        server = spawnServer(serverPath,
+                             {"--quiet", "--interval-us", to_string(intervalUs), "--journal", journalPath,
+                              "--transport", transport},
+                             "swarm_server.log");
+        if (server < 0) {
+            perror("fork");
+            return 1;
+        }
+    }
+
+    // connect everyone first, so every client sees the run from the same tick
+    vector<int> fds;
+    for (int c = 0; c < clientCount; c++) {
+        int fd = -1;
+        for (int attempt = 0; fd < 0 && attempt < 200; attempt++) {
+            fd = connectTo(host, port);
+            if (fd < 0) this_thread::sleep_for(chrono::milliseconds(10));  // server still starting
+        }
+        if (fd < 0) {
+            fprintf(stderr, "could not connect client %d to %s:%d\n", c, host.c_str(), port);
+            if (server > 0) kill(server, SIGTERM);
+            return 1;
+        }
+        fds.push_back(fd);
+    }
+    printf("%d clients connected over %d thread(s), %zu reaction group(s), running %.1f s\n", clientCount, threadCount,
+           groups.size(), durationS);
+
+    // names fit the journal's 8-byte name field, so the journal maps back
+    vector<LoopRecord> records(threadCount);
+    vector<uint64_t> ticksPerClient(clientCount), ordersPerClient(clientCount);
+    vector<thread> loops;
+    const uint64_t runStart = loopNowNs();
+    for (int t = 0; t < threadCount; t++) {
+        loops.emplace_back([&, t] {
+            EventLoop loop;
+            vector<unique_ptr<SwarmClient>> mine;
+            for (int c = t; c < clientCount; c += threadCount) {
+                mine.push_back(make_unique<SwarmClient>(loop, fds[c], c, "sw" + to_string(c), groups[c % groups.size()],
+                                                        window, records[t], seed * 1000003 + (uint64_t)c));
+                if (!mine.back()->start()) fprintf(stderr, "could not start client %d\n", c);
+            }
+            loop.spawn([](EventLoop& l, vector<unique_ptr<SwarmClient>>& cs, uint64_t ns) -> Task {
+                co_await l.sleepFor(chrono::nanoseconds(ns));
+                for (auto& c : cs) c->stop();
+                l.stop();
+            }(loop, mine, durationNs));
+            loop.run();
+            for (int i = 0; i < (int)mine.size(); i++) {
+                const int c = t + i * threadCount;
+                ticksPerClient[c] = mine[i]->ticks();
+                ordersPerClient[c] = mine[i]->orders();
+            }
+        });
+    }
+    for (auto& th : loops) th.join();
+    const double elapsedS = (double)(loopNowNs() - runStart) / 1e9;
+
+    if (server > 0) {
+        kill(server, SIGTERM);  // the server flushes its journal on SIGTERM
+        waitpid(server, nullptr, 0);
+    }
+
+    // --- client side ---------------------------------------------------------
+    unordered_map<int, TickSeen> ticks;
+    vector<SentOrder> orders;
+    for (auto& r : records) {
+        for (auto& [id, seen] : r.ticks) {
+            TickSeen& all = ticks[id];
+            all.firstNs = min(all.firstNs, seen.firstNs);
+            all.lastNs = max(all.lastNs, seen.lastNs);
+            all.clients += seen.clients;
+        }
+        orders.insert(orders.end(), r.orders.begin(), r.orders.end());
+    }
+    uint64_t tickTotal = 0, orderTotal = 0;
+    for (int c = 0; c < clientCount; c++) {
+        tickTotal += ticksPerClient[c];
+        orderTotal += ordersPerClient[c];
+    }
+    vector<double> skew;
+    for (auto& [id, seen] : ticks) {
+        if (seen.clients == clientCount) skew.push_back((double)(seen.lastNs - seen.firstNs));
+    }
+
+    printf("\nclients\n");
+    printf("  ticks received                     %llu (%.0f per client, %.0f/s per client)\n",
+           (unsigned long long)tickTotal, (double)tickTotal / clientCount, (double)tickTotal / clientCount / elapsedS);
+    printf("  distinct ticks                     %zu, %zu seen by every client\n", ticks.size(), skew.size());
+    printf("  orders sent                        %llu (%.0f/s)\n", (unsigned long long)orderTotal,
+           (double)orderTotal / elapsedS);
+    printDist("fan-out skew (first..last client)", skew);
+
+    if (journalPath.empty()) return 0;
+
+    // --- server side, from the journal --------------------------------------
+    JournalReader journal;
+    if (!journal.load(journalPath)) return 1;
+
+    // journal client IDs -> swarm client index, through the registered names
+    unordered_map<string, int> byName;
+    for (int c = 0; c < clientCount; c++) byName["sw" + to_string(c)] = c;
+    unordered_map<int, int> swarmIndex;
+    unordered_map<int, uint64_t> tickSentNs;
+    uint64_t serverTicks = 0, firstTickNs = 0, lastTickNs = 0;
+    uint64_t firstOrderNs = 0, lastOrderNs = 0, results[3] = {};
+    unordered_map<uint64_t, uint64_t> serverOrderNs;  // (client, price) -> journal time
+    unordered_map<int, int> winner;                   // price -> swarm client
+    auto key = [](int client, int priceId) { return ((uint64_t)(uint32_t)client << 32) | (uint32_t)priceId; };
+
+    for (const JournalRecord& r : journal.records) {
+        if (r.type == JournalType::Hello) {
+            auto it = byName.find(string(r.name, strnlen(r.name, sizeof r.name)));
+            if (it != byName.end()) swarmIndex[r.client] = it->second;
+        } else if (r.type == JournalType::Tick) {
+            serverTicks++;
+            if (!firstTickNs) firstTickNs = r.tsNs;
+            lastTickNs = r.tsNs;
+            tickSentNs[r.priceId] = r.tsNs;
+        } else if (r.type == JournalType::Order) {
+            auto it = swarmIndex.find(r.client);
+            if (it == swarmIndex.end()) continue;  // not one of ours
+            if (!firstOrderNs) firstOrderNs = r.tsNs;
+            lastOrderNs = r.tsNs;
+            if (r.flags < 3) results[r.flags]++;
+            serverOrderNs.emplace(key(it->second, r.priceId), r.tsNs);
+            if (r.flags == (uint16_t)OrderResult::Hit) winner[r.priceId] = it->second;
+        }
+    }
+
+    // both sides read the same steady clock, so the times compare directly
+    vector<double> firstLatency, lastLatency, orderLatency;
+    for (auto& [id, seen] : ticks) {
+        auto it = tickSentNs.find(id);
+        if (it == tickSentNs.end() || seen.clients != clientCount) continue;
+        firstLatency.push_back((double)seen.firstNs - (double)it->second);
+        lastLatency.push_back((double)seen.lastNs - (double)it->second);
+    }
+
+    // who sent first for each price, against who the server gave the hit to
+    unordered_map<int, vector<const SentOrder*>> contenders;
+    for (const SentOrder& o : orders) {
+        contenders[o.priceId].push_back(&o);
+        auto it = serverOrderNs.find(key(o.client, o.priceId));
+        if (it != serverOrderNs.end()) orderLatency.push_back((double)it->second - (double)o.sendNs);
+    }
+    uint64_t races = 0, firstWon = 0;
+    vector<double> inversionGap;
+    for (auto& [priceId, sent] : contenders) {
+        auto w = winner.find(priceId);
+        if (sent.size() < 2 || w == winner.end()) continue;
+        races++;
+        const SentOrder* first = *min_element(sent.begin(), sent.end(),
+                                              [](const SentOrder* a, const SentOrder* b) { return a->sendNs < b->sendNs; });
+        if (first->client == w->second) {
+            firstWon++;
+            continue;
+        }
+        for (const SentOrder* o : sent) {
+            if (o->client == w->second) inversionGap.push_back((double)(o->sendNs - first->sendNs));
+        }
+    }
+
+    const double tickSpanS = (double)(lastTickNs - firstTickNs) / 1e9;
+    const double orderSpanS = (double)(lastOrderNs - firstOrderNs) / 1e9;
+    printf("\nserver (%s)\n", journalPath.c_str());
+    printf("  ticks sent                         %llu (%.0f/s)\n", (unsigned long long)serverTicks,
+           tickSpanS > 0 ? (double)(serverTicks - 1) / tickSpanS : 0.0);
+    printf("  orders handled                     %llu (%.0f/s): %llu hit, %llu already hit, %llu unknown\n",
+           (unsigned long long)(results[0] + results[1] + results[2]),
+           orderSpanS > 0 ? (double)(results[0] + results[1] + results[2]) / orderSpanS : 0.0,
+           (unsigned long long)results[0], (unsigned long long)results[1], (unsigned long long)results[2]);
+    printDist("tick -> first client", firstLatency);
+    printDist("tick -> last client", lastLatency);
+    printDist("order send -> server arbitration", orderLatency);
+
+    printf("\nfirst-hit arbitration\n");
+    printf("  contested prices                   %llu, earliest sender won %llu (%.1f%%)\n",
+           (unsigned long long)races, (unsigned long long)firstWon, races ? 100.0 * (double)firstWon / (double)races : 0.0);
+    printDist("winner sent later by", inversionGap);
+
+    // hits per group, and how evenly hits spread inside a group: clients in
+    // one group are statistically identical, so a fair server gives them
+    // equal shares. With few hits each, even a fair lottery scores below 1:
+    // Poisson hits with mean m give a Jain index of about m / (m + 1).
+    vector<double> hits(clientCount);
+    for (auto& [priceId, c] : winner) hits[c]++;
+    printf("  %-28s %8s %9s %9s %9s %7s %7s\n", "group", "clients", "orders", "hits", "hit/order", "jain", "fair");
+    for (size_t g = 0; g < groups.size(); g++) {
+        vector<double> groupHits;
+        uint64_t groupOrders = 0;
+        double groupHitTotal = 0;
+        for (int c = (int)g; c < clientCount; c += (int)groups.size()) {
+            groupHits.push_back(hits[c]);
+            groupOrders += ordersPerClient[c];
+            groupHitTotal += hits[c];
+        }
+        const double meanHits = groupHitTotal / (double)groupHits.size();
+        printf("  %-28s %8zu %9llu %9.0f %9.3f %7.3f %7.3f\n", groups[g].spec.c_str(), groupHits.size(),
+               (unsigned long long)groupOrders, groupHitTotal, groupOrders ? groupHitTotal / (double)groupOrders : 0.0,
+               jain(groupHits), meanHits > 0 ? meanHits / (meanHits + 1) : 1.0);
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+// Coroutine runtime overhead and tick-to-order latency, coroutine client
+// versus the blocking client.
+//
+//   ./coro_bench [ticks per sample] [connections,...]
+//
+// switch: two coroutines hand an int back and forth through Channels (two
+// switches per round trip), and one coroutine yields to itself.
+//
+// tick_rtt: the benchmark plays the server over socketpairs. Per round it
+// writes one tick to every connection and waits for every order to come
+// back. Prices only go up, so every tick after the first two triggers the
+// momentum rule. The blocking client runs one thread per connection; the
+// coroutine client runs all connections on one thread. Each order must
+// name the tick it answers, or the run fails.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "async_client.hpp"
+#include "bench_harness.hpp"
+#include "coro_runtime.hpp"
+
+using namespace std;
+
+// "1,2,4" -> {1, 2, 4}
+static vector<int> parseList(const char* s) {
+    vector<int> out;
+    while (*s) {
+        char* end = nullptr;
+        long v = strtol(s, &end, 10);
+        if (end == s) break;
+        if (v > 0) out.push_back((int)v);
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return out;
+}
+
+static Task pingPong(Channel<int>& in, Channel<int>& out, int rounds, bool starts) {
+    if (starts) out.push(0);
+    for (int i = 0; i < rounds; i++) {
+        auto v = co_await in.pop();
+        if (!v) break;
+        if (starts && i == rounds - 1) break;
+        out.push(*v + 1);
+    }
+}
+
+static Task yielder(EventLoop& loop, int n) {
+    for (int i = 0; i < n; i++) co_await loop.yield();
+}
+
+// The exchange side of one connection: send ticks, read orders back.
+struct ExchangeEnd {
+    int fd;
+    string pending;
+
+    bool sendTick(int id) {
+        char line[48];
+        const int n = snprintf(line, sizeof line, "%d,%d.000000\n", id, id);
+        return sendAllBlocking(fd, line, (size_t)n);
+    }
+
+    // Blocks until one full order line arrives. -1 on EOF or garbage.
+    int readOrder() {
+        char buf[256];
+        while (true) {
+            const size_t nl = pending.find('\n');
+            if (nl != string::npos) {
+                const int id = atoi(pending.c_str());
+                pending.erase(0, nl + 1);
+                return id;
+            }
+            const ssize_t got = recv(fd, buf, sizeof buf, 0);
+            if (got <= 0) return -1;
+            pending.append(buf, (size_t)got);
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    int ticks = 2000;
+    vector<int> connectionCounts = {1, 16};
+    if (argc > 1) ticks = max(1, atoi(argv[1]));
+    if (argc > 2) connectionCounts = parseList(argv[2]);
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+    int failures = 0;
+
+    auto report = [](const bench::CaseResult& r, const char* unit) {
+        bench::Runner::print_case(stdout, r);
+        printf("    %-40s %9.1f ns/%s\n", (r.name + " [" + r.params_str() + "]").c_str(), r.ns_per_op(), unit);
+    };
+
+    // --- coroutine switches -------------------------------------------------
+    constexpr int ROUNDS = 1 << 16;
+    report(runner.run("switch", {{"kind", "channel"}}, 2 * ROUNDS, [&] {
+        EventLoop loop;
+        Channel<int> a(loop), b(loop);
+        loop.spawn(pingPong(a, b, ROUNDS, true));
+        loop.spawn(pingPong(b, a, ROUNDS, false));
+        loop.run();
+    }), "switch");
+    report(runner.run("switch", {{"kind", "yield"}}, ROUNDS, [&] {
+        EventLoop loop;
+        loop.spawn(yielder(loop, ROUNDS));
+        loop.run();
+    }), "switch");
+
+    // --- tick to order ------------------------------------------------------
+    ClientConfig cfg;
+    cfg.verbose = false;
+    cfg.heartbeatMs = 0;
+    cfg.orderDelayMinMs = 0;
+    cfg.orderDelayMaxMs = 0;
+    cfg.strategies = 1;
+
+    for (int conns : connectionCounts) {
+        for (int coroutine = 0; coroutine <= 1; coroutine++) {
+            vector<ExchangeEnd> ends;
+            vector<int> clientFds;
+            for (int c = 0; c < conns; c++) {
+                int sv[2];
+                if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+                    perror("socketpair");
+                    return 1;
+                }
+                ends.push_back(ExchangeEnd{sv[0], {}});
+                clientFds.push_back(sv[1]);
+            }
+
+            vector<thread> clients;
+            if (coroutine) {
+                clients.emplace_back([&] {
+                    EventLoop loop;
+                    vector<unique_ptr<AsyncConnection>> async;
+                    for (int c = 0; c < conns; c++) {
+                        async.push_back(make_unique<AsyncConnection>(loop, clientFds[c], cfg, c));
+                        async.back()->start();
+                    }
+                    loop.run();
+                });
+            } else {
+                for (int c = 0; c < conns; c++) {
+                    clients.emplace_back([&, c] { runBlockingClient(clientFds[c], cfg); });
+                }
+            }
+
+            // two rising prices so the third completes the pattern
+            int nextId = 1;
+            for (int w = 0; w < 2; w++, nextId++) {
+                for (auto& e : ends) e.sendTick(nextId);
+            }
+
+            int wrong = 0;
+            vector<double> roundNs;
+            roundNs.reserve(ticks);
+            const char* kind = coroutine ? "coroutine" : "blocking";
+            const bench::CaseResult& r = runner.run(
+                "tick_rtt", {{"client", kind}, {"connections", to_string(conns)}}, (uint64_t)ticks * conns, [&] {
+                    for (int t = 0; t < ticks; t++, nextId++) {
+                        const auto t0 = chrono::steady_clock::now();
+                        for (auto& e : ends) e.sendTick(nextId);
+                        for (auto& e : ends) wrong += e.readOrder() != nextId;
+                        const auto t1 = chrono::steady_clock::now();
+                        roundNs.push_back(chrono::duration<double, nano>(t1 - t0).count());
+                    }
+                });
+            report(r, "tick");
+
+            sort(roundNs.begin(), roundNs.end());
+            const bench::Stats s = bench::Stats::from(roundNs);
+            printf("    round trip (all %d connections): p50 %.1f us  p99 %.1f us  max %.1f us\n", conns,
+                   s.median / 1e3, s.p99 / 1e3, s.max / 1e3);
+
+            for (auto& e : ends) close(e.fd);
+            for (auto& th : clients) th.join();
+            if (wrong) {
+                failures++;
+                fprintf(stderr, "tick_rtt %s x%d: %d orders did not match their tick\n", kind, conns, wrong);
+            }
+        }
+    }
+
+    runner.write_reports();
+    return failures == 0 ? 0 : 1;
+}
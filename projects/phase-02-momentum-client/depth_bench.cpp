@@ -0,0 +1,298 @@
+// Level-2 depth feed (include/depth_feed.hpp): replica checks, then the cost
+// of producing and applying deltas and the bandwidth at depth update rates.
+//
+//   ./depth_bench [updates per sample] [levels,...]
+//
+// Checks, for each book depth: a replica fed every delta matches the
+// server's book after each one and at every snapshot; a replica that joins
+// mid-stream ignores deltas until a snapshot and then matches; a replica
+// that misses one delta reports the gap and matches again after the next
+// snapshot. Any failure makes the program exit with status 1.
+//
+// Timed, per delta: the server side (generate and format a delta line), and
+// the client side (parse and apply a line) into the ring replica and into a
+// std::map book like the server's. The byte counts give the bandwidth of the
+// feed at 10k, 100k and 1M updates per second with a snapshot every second.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "bench_harness.hpp"
+#include "depth_feed.hpp"
+
+using namespace std;
+
+static bench::Checks checks;
+
+// "1,2,4" -> {1, 2, 4}
+static vector<int> parseList(const char* s) {
+    vector<int> out;
+    while (*s) {
+        char* end = nullptr;
+        long v = strtol(s, &end, 10);
+        if (end == s) break;
+        if (v > 0) out.push_back((int)v);
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return out;
+}
+
+// A recorded feed: delta lines, with a snapshot line once every
+// `snapshotEvery` deltas, and the server's book at the end. Snapshots go
+// between market changes, never inside one, as the server sends them.
+struct Stream {
+    vector<string> lines;
+    vector<bool> snapshot;
+    size_t deltaBytes = 0;
+    size_t deltas = 0;
+    size_t snapshotBytes = 0;
+    size_t snapshots = 0;
+    DepthBook book;
+};
+
+static void record(Stream& s, int levels, size_t updates, size_t snapshotEvery) {
+    DepthGenerator generator(s.book, levels, 10000, 7);
+    vector<DepthDelta> deltas;
+    char line[64];
+    string snap;
+    s.book.snapshotLine(snap);
+    s.lines.push_back(snap.substr(0, snap.size() - 1));
+    s.snapshot.push_back(true);
+    size_t nextSnapshot = snapshotEvery;
+    while (s.deltas < updates) {
+        deltas.clear();
+        generator.step(deltas);
+        for (const DepthDelta& d : deltas) {
+            const int len = formatDelta(d, line, sizeof line);
+            s.lines.emplace_back(line, (size_t)len - 1);
+            s.snapshot.push_back(false);
+            s.deltaBytes += (size_t)len;
+            s.deltas++;
+        }
+        if (s.deltas >= nextSnapshot || s.deltas >= updates) {
+            s.book.snapshotLine(snap);
+            s.lines.push_back(snap.substr(0, snap.size() - 1));
+            s.snapshot.push_back(true);
+            s.snapshotBytes += snap.size();
+            s.snapshots++;
+            nextSnapshot += snapshotEvery;
+        }
+    }
+}
+
+// Every level of the replica equals the book's, and nothing else is in it.
+static bool sameBook(const ReplicaBook& r, const DepthBook& b) {
+    if (r.levels('B') != (int)b.bids().size() || r.levels('A') != (int)b.asks().size()) return false;
+    for (const auto& [price, qty] : b.bids()) {
+        if (r.quantity('B', price) != qty) return false;
+    }
+    for (const auto& [price, qty] : b.asks()) {
+        if (r.quantity('A', price) != qty) return false;
+    }
+    return b.bids().empty() || r.best('B') == b.bids().begin()->first;
+}
+
+static void runChecks(int levels) {
+    printf("depth checks, %d levels\n", levels);
+
+    // lockstep: apply each delta as it is made and compare the tops
+    {
+        DepthBook book;
+        DepthGenerator generator(book, levels, 10000, 11);
+        ReplicaBook replica;
+        string snap;
+        book.snapshotLine(snap);
+        bool ok = replica.onLine(snap.data(), snap.size() - 1) == ApplyResult::Snapshot && sameBook(replica, book);
+        vector<DepthDelta> deltas;
+        char line[64];
+        for (int i = 0; i < 200000 && ok; i++) {
+            deltas.clear();
+            generator.step(deltas);
+            for (const DepthDelta& d : deltas) {
+                const int len = formatDelta(d, line, sizeof line);
+                ok = ok && replica.onLine(line, (size_t)len - 1) == ApplyResult::Applied;
+            }
+            const bool twoSided = !book.bids().empty() && !book.asks().empty();
+            ok = ok && (!twoSided || (replica.best('B') == book.bids().begin()->first &&
+                                      replica.best('A') == book.asks().begin()->first &&
+                                      replica.quantity('B', replica.best('B')) == book.bids().begin()->second));
+            if (i % 10000 == 0) ok = ok && sameBook(replica, book);
+        }
+        ok = ok && sameBook(replica, book);
+        int32_t prices[8], qtys[8];
+        const int n = replica.topLevels('A', prices, qtys, 8);
+        auto it = book.asks().begin();
+        for (int i = 0; i < n; i++, ++it) ok = ok && prices[i] == it->first && qtys[i] == it->second;
+        checks.expect("replica equals the book after every delta", ok && n == min<int>(8, (int)book.asks().size()));
+    }
+
+    Stream s;
+    record(s, levels, 100000, 1000);
+
+    // from the start, every snapshot must match what the deltas built
+    {
+        ReplicaBook replica;
+        for (const string& l : s.lines) replica.onLine(l.data(), l.size());
+        const ReplicaStats& st = replica.stats();
+        checks.expect("every snapshot matches the replica built from deltas",
+                      st.verified == s.snapshots && st.mismatches == 0 && st.gaps == 0 && st.inconsistent == 0);
+        checks.expect("the replica ends equal to the book", replica.synced() && sameBook(replica, s.book));
+    }
+
+    // a late joiner: starts mid-stream, between two snapshots
+    {
+        ReplicaBook replica;
+        size_t first = s.lines.size() / 2 + 17;
+        while (s.snapshot[first]) first++;
+        size_t ignored = 0;
+        bool before = true;
+        for (size_t i = first; i < s.lines.size(); i++) {
+            const ApplyResult r = replica.onLine(s.lines[i].data(), s.lines[i].size());
+            if (before && r == ApplyResult::Unsynced) ignored++;
+            if (r == ApplyResult::Snapshot) before = false;
+        }
+        printf("       late joiner ignored %zu deltas before its first snapshot\n", ignored);
+        checks.expect("a late joiner syncs at the next snapshot", ignored > 0 && sameBook(replica, s.book));
+    }
+
+    // a lost delta: reported as a gap, fixed by the next snapshot
+    {
+        ReplicaBook replica;
+        const size_t lost = s.lines.size() / 3;
+        size_t dropped = lost;
+        while (s.snapshot[dropped]) dropped++;
+        bool gap = false, resynced = false;
+        for (size_t i = 0; i < s.lines.size(); i++) {
+            if (i == dropped) continue;
+            const ApplyResult r = replica.onLine(s.lines[i].data(), s.lines[i].size());
+            if (r == ApplyResult::Gap) gap = true;
+            if (gap && r == ApplyResult::Snapshot) resynced = true;
+        }
+        checks.expect("a missed delta is a gap, and the next snapshot resyncs",
+                      gap && resynced && replica.stats().gaps == 1 && sameBook(replica, s.book));
+    }
+
+    // a ring too small for the book must not pass for in sync
+    {
+        ReplicaBook replica(16);
+        for (const string& l : s.lines) replica.onLine(l.data(), l.size());
+        checks.expect("a book wider than the ring is never taken as synced",
+                      levels <= 16 || (!replica.synced() && replica.stats().inconsistent > 0));
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv) {
+    size_t updates = 100000;
+    vector<int> depths = {10, 100, 1000};
+    if (argc > 1) updates = (size_t)max(1, atoi(argv[1]));
+    if (argc > 2) depths = parseList(argv[2]);
+
+    for (int levels : depths) runChecks(levels);
+    printf("%s\n\n", checks.passed() ? "all depth checks passed" : "DEPTH CHECKS FAILED");
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+    struct Row {
+        int levels;
+        double bytesPerDelta, snapshotBytes, encodeNs, parseNs, ringNs, mapNs, snapshotNs;
+    };
+    vector<Row> rows;
+
+    for (int levels : depths) {
+        Stream s;
+        record(s, levels, updates, updates);  // one snapshot, at the end
+        vector<const string*> deltas, snapshots;
+        for (size_t i = 0; i < s.lines.size(); i++) (s.snapshot[i] ? snapshots : deltas).push_back(&s.lines[i]);
+        const string levelsStr = to_string(levels);
+        Row row{levels, (double)s.deltaBytes / s.deltas, (double)s.snapshotBytes, 0, 0, 0, 0, 0};
+
+        // server: one market change into the book, and its lines
+        row.encodeNs = runner.run("encode", {{"levels", levelsStr}}, (double)updates, [&](bench::Timing& t) {
+            DepthBook book;
+            DepthGenerator generator(book, levels, 10000, 7);
+            vector<DepthDelta> out;
+            char line[64];
+            size_t made = 0, bytes = 0;
+            t.start();
+            while (made < updates) {
+                out.clear();
+                generator.step(out);
+                for (const DepthDelta& d : out) bytes += (size_t)formatDelta(d, line, sizeof line);
+                made += out.size();
+            }
+            t.stop();
+            bench::do_not_optimize(bytes);
+        }).ns_per_op();
+
+        row.parseNs = runner.run("parse", {{"levels", levelsStr}}, (double)deltas.size(), [&](bench::Timing& t) {
+            DepthDelta d{};
+            int64_t sum = 0;
+            t.start();
+            for (const string* l : deltas) {
+                ReplicaBook::parseDelta(l->data(), l->size(), d);
+                sum += d.qty;
+            }
+            t.stop();
+            bench::do_not_optimize(sum);
+        }).ns_per_op();
+
+        // the replicas start from the first snapshot, outside the timing
+        row.ringNs = runner.run("apply", {{"book", "ring"}, {"levels", levelsStr}}, (double)deltas.size(),
+                                [&](bench::Timing& t) {
+            ReplicaBook replica;
+            replica.onLine(snapshots[0]->data(), snapshots[0]->size());
+            t.start();
+            for (const string* l : deltas) replica.onLine(l->data(), l->size());
+            t.stop();
+            if (replica.stats().deltas != deltas.size()) checks.fail();
+        }).ns_per_op();
+
+        row.mapNs = runner.run("apply", {{"book", "map"}, {"levels", levelsStr}}, (double)deltas.size(),
+                               [&](bench::Timing& t) {
+            DepthBook book;
+            DepthGenerator seedBook(book, levels, 10000, 7);  // the same starting levels
+            DepthDelta d{}, out;
+            t.start();
+            for (const string* l : deltas) {
+                ReplicaBook::parseDelta(l->data(), l->size(), d);
+                book.set(d.side, d.price, d.qty, out);
+            }
+            t.stop();
+            if (book.bids() != s.book.bids() || book.asks() != s.book.asks()) checks.fail();
+        }).ns_per_op();
+
+        const string& last = *snapshots.back();
+        row.snapshotNs = runner.run("snapshot", {{"levels", levelsStr}}, 1.0, [&](bench::Timing& t) {
+            ReplicaBook replica;
+            t.start();
+            replica.onLine(last.data(), last.size());
+            t.stop();
+        }).ns_per_op();
+        row.snapshotBytes = (double)last.size() + 1;
+        rows.push_back(row);
+    }
+
+    printf("\nper delta: server (generate + format), client parse, and parse + apply into the ring replica\n"
+           "and into a std::map book\n");
+    printf("levels  bytes  server ns  parse ns  ring ns  map ns  snapshot bytes  snapshot load us\n");
+    for (const Row& r : rows) {
+        printf("%6d  %5.1f  %9.1f  %8.1f  %7.1f  %6.1f  %14.0f  %16.1f\n", r.levels, r.bytesPerDelta, r.encodeNs,
+               r.parseNs, r.ringNs, r.mapNs, r.snapshotBytes, r.snapshotNs / 1000.0);
+    }
+    printf("\nbandwidth per client and client apply time, one snapshot a second\n");
+    printf("levels  updates/s      MB/s  apply CPU %%\n");
+    for (const Row& r : rows) {
+        for (double rate : {1e4, 1e5, 1e6}) {
+            const double bytes = rate * r.bytesPerDelta + r.snapshotBytes;
+            const double cpu = (rate * r.ringNs + r.snapshotNs) / 1e9;
+            printf("%6d  %9.0f  %8.2f  %11.2f\n", r.levels, rate, bytes / 1e6, 100.0 * cpu);
+        }
+    }
+
+    runner.write_reports();
+    return checks.passed() ? 0 : 1;
+}
@@ -3,99 +3,165 @@
 #include <chrono>
 #include <cstring>
 #include <cstdlib>
-#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
 #include <unistd.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 
-using namespace std;
-
-#define SERVER_IP "127.0.0.1"
-#define SERVER_PORT 12345
-#define BUFFER_SIZE 1024
-
-void receiveAndRespond(int socketFd, const string& name) {
-    char buffer[BUFFER_SIZE];
-    deque<float> priceHistory;
-    // Send client name
-    send(socketFd, name.c_str(), name.size(), 0);
-
-    while (true) {
-        memset(buffer, 0, BUFFER_SIZE);
-        int bytesReceived = recv(socketFd, buffer, BUFFER_SIZE - 1, 0);
-        if (bytesReceived <= 0) {
-            cerr << "Server closed connection or error occurred." << endl;
-            break;
-        }
-
-        string data(buffer);
-        size_t commaPos = data.find(',');
-        if (commaPos == string::npos) {
-            cerr << "Invalid price format received: " << data << endl;
-            continue;
-        }
-
-        int priceId = stoi(data.substr(0, commaPos));
-        float price = stof(data.substr(commaPos + 1));
-
-        if (priceHistory.size() >= 3)
-            priceHistory.pop_front();
-        priceHistory.push_back(price);
-
-        cout << "📥 Received price ID: " << priceId << ", Value: " << price << endl;
-
-        if (priceHistory.size() == 3)
-        {
-            float a = priceHistory[0];
-            float b = priceHistory[1];
-            float c = priceHistory[2];
-
-            cout << "a: " << a << ", b: " << b << ", c: " << c << endl;
+#include "async_client.hpp"
+#include "coro_runtime.hpp"
+#include "timestamping.hpp"
 
-            bool up   = (a < b) && (b < c);
-            bool down = (a > b) && (b > c);
-
-            if (up || down)
-            {
-                string order = to_string(priceId);
-                send(socketFd, order.c_str(), order.length(), 0);
-                this_thread::sleep_for(chrono::milliseconds(10 + rand() % 50));
-                cout << "Found momentum!! Sending order for priceID: " << priceId << endl;
-            }
-            else
-            {
-                cout << "No momentum!! Ignoring priceID: " << priceId << endl;
-            }
-        }
-    }
+using namespace std;
 
-    close(socketFd);
+void printUsage(const char* argv0) {
+    cerr << "usage: " << argv0 << " [--host IP] [--port N] [--name NAME] [--connections N] [--strategies K]\n"
+         << "       " << "          [--heartbeat-ms MS] [--order-delay-ms MIN,MAX] [--cpu C] [--quiet] [--blocking]\n"
+         << "       " << "          [--timestamps]\n"
+         << "  --host IP              server address (default 127.0.0.1)\n"
+         << "  --port N               server port (default 12345)\n"
+         << "  --name NAME            client name; asked for on stdin when not given\n"
+         << "  --connections N        connections to open, named NAME-0, NAME-1, ... when N > 1 (default 1)\n"
+         << "  --strategies K         momentum strategies per connection, windows 3..K+2 (default 1)\n"
+         << "  --heartbeat-ms MS      heartbeat period, 0 = off (default 1000)\n"
+         << "  --order-delay-ms A,B   pause A..B ms after each order (default 10,59)\n"
+         << "  --cpu C                pin the client thread to CPU C\n"
+         << "  --quiet                no per-tick output\n"
+         << "  --blocking             the original blocking loop (one connection, one strategy)\n"
+         << "  --timestamps           kernel receive/transmit stamps; print where each tick's time went at the end"
+         << endl;
 }
 
-int main() {
-    srand(time(nullptr));
-
-    string name;
-    cout << "Enter your client name: ";
-    getline(cin, name);
-
+int connectTo(const ClientConfig& cfg) {
     int sock = socket(AF_INET, SOCK_STREAM, 0);
     if (sock < 0) {
         cerr << "Socket creation failed!" << endl;
-        return 1;
+        return -1;
     }
 
     sockaddr_in serverAddr{};
     serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(SERVER_PORT);
-    inet_pton(AF_INET, SERVER_IP, &serverAddr.sin_addr);
+    serverAddr.sin_port = htons(cfg.port);
+    if (inet_pton(AF_INET, cfg.host.c_str(), &serverAddr.sin_addr) != 1) {
+        cerr << "Invalid server address: " << cfg.host << endl;
+        close(sock);
+        return -1;
+    }
 
     if (connect(sock, (sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
         cerr << "Connection to server failed!" << endl;
+        close(sock);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    // before the name goes out, so transmit stamp IDs count from the first byte
+    if (cfg.timestamps) {
+        const Timestamping mode = enableTimestamping(sock);
+        if (mode != Timestamping::RxTx) cerr << "⚠️ Kernel timestamps: " << timestampingName(mode) << endl;
+    }
+    return sock;
+}
+
+int main(int argc, char** argv) {
+    srand(time(nullptr));
+
+    ClientConfig cfg;
+    bool blocking = false;
+    int cpu = -1;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--host" && hasValue) cfg.host = argv[++i];
+        else if (arg == "--port" && hasValue) cfg.port = atoi(argv[++i]);
+        else if (arg == "--name" && hasValue) cfg.name = argv[++i];
+        else if (arg == "--connections" && hasValue) cfg.connections = max(1, atoi(argv[++i]));
+        else if (arg == "--strategies" && hasValue) cfg.strategies = max(1, atoi(argv[++i]));
+        else if (arg == "--heartbeat-ms" && hasValue) cfg.heartbeatMs = max(0, atoi(argv[++i]));
+        else if (arg == "--order-delay-ms" && hasValue) {
+            if (sscanf(argv[++i], "%d,%d", &cfg.orderDelayMinMs, &cfg.orderDelayMaxMs) != 2) {
+                cfg.orderDelayMaxMs = cfg.orderDelayMinMs;
+            }
+        }
+        else if (arg == "--cpu" && hasValue) cpu = atoi(argv[++i]);
+        else if (arg == "--quiet") cfg.verbose = false;
+        else if (arg == "--blocking") blocking = true;
+        else if (arg == "--timestamps") cfg.timestamps = true;
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (cfg.name.empty()) {
+        cout << "Enter your client name: ";
+        getline(cin, cfg.name);
+    }
+    if (cpu >= 0 && !pinThisThread(cpu)) cerr << "⚠️ Could not pin to CPU " << cpu << endl;
+
+    if (blocking) {
+        int sock = connectTo(cfg);
+        if (sock < 0) return 1;
+        cout << "✅ Connected to server at " << cfg.host << ":" << cfg.port << endl;
+        LatencyReport latency;
+        runBlockingClient(sock, cfg, nullptr, &latency);
+        if (cfg.timestamps) latency.print(cout);
+        return 0;
+    }
+
+    EventLoop loop;
+    if (!loop.ok()) {
+        perror("epoll_create1");
         return 1;
     }
 
-    cout << "✅ Connected to server at " << SERVER_IP << ":" << SERVER_PORT << endl;
-    receiveAndRespond(sock, name);
+    // each connection registers under its own name
+    vector<ClientConfig> configs(cfg.connections, cfg);
+    vector<unique_ptr<AsyncConnection>> connections;
+    for (int c = 0; c < cfg.connections; c++) {
+        if (cfg.connections > 1) configs[c].name = cfg.name + "-" + to_string(c);
+        int sock = connectTo(configs[c]);
+        if (sock < 0) return 1;
+        connections.push_back(make_unique<AsyncConnection>(loop, sock, configs[c], c));
+        if (!connections.back()->start()) {
+            cerr << "Could not register connection " << c << endl;
+            return 1;
+        }
+    }
+    cout << "✅ Connected to server at " << cfg.host << ":" << cfg.port << " with " << cfg.connections
+         << " connection(s), " << cfg.strategies << " strateg" << (cfg.strategies == 1 ? "y" : "ies")
+         << " each, on one thread" << endl;
+
+    loop.run();
+
+    ClientStats total;
+    for (auto& c : connections) {
+        total.ticks += c->stats().ticks;
+        total.orders += c->stats().orders;
+        total.heartbeats += c->stats().heartbeats;
+    }
+    cout << "Done: " << total.ticks << " ticks, " << total.orders << " orders, " << total.heartbeats
+         << " heartbeats" << endl;
+    ReplicaStats depth;
+    for (auto& c : connections) {
+        const ReplicaStats& s = c->book().stats();
+        depth.deltas += s.deltas;
+        depth.snapshots += s.snapshots;
+        depth.gaps += s.gaps + s.inconsistent;
+        depth.verified += s.verified;
+        depth.mismatches += s.mismatches;
+    }
+    if (cfg.timestamps) {
+        LatencyReport latency;
+        for (auto& c : connections) latency.merge(c->latency());
+        latency.print(cout);
+    }
+    if (depth.snapshots > 0) {
+        cout << "Depth: " << depth.deltas << " deltas, " << depth.snapshots << " snapshots (" << depth.verified
+             << " matched the replica, " << depth.mismatches << " did not), " << depth.gaps << " resyncs" << endl;
+    }
     return 0;
 }
@@ -11,7 +11,15 @@
 #include <unistd.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <csignal>
 #include <utility>
+#include <string>
+
+#include "broadcast.hpp"
+#include "depth_feed.hpp"
+#include "journal.hpp"
+#include "line_buffer.hpp"
+#include "timestamping.hpp"
 
 using namespace std;
 using namespace std::chrono;
@@ -21,42 +29,227 @@ using namespace std::chrono;
 
 struct ClientInfo {
     int socket;
+    int id;
     string name;
     thread clientThread;
+    bool dropped = false;       // out of the fan-out, socket closed; guarded by clientsMutex
+};
+
+// Command line options, see printUsage()
+struct ServerOptions {
+    unsigned seed = 1;          // what rand() uses when never seeded
+    int intervalUs = 5000000;   // --interval-ms or --interval-us
+    string journalPath;
+    string replayPath;
+    double speed = 1.0;         // replay pace multiplier, 0 = as fast as possible
+    int waitClients = 1;        // replay starts once this many clients registered
+    Transport transport = Transport::Send;
+    bool quiet = false;
+    int depthRate = 0;          // depth deltas per second, 0 = no depth feed
+    int depthLevels = 10;       // levels per side
+    int snapshotMs = 1000;      // time between full book snapshots
+    bool timestamps = false;    // kernel stamps on client sockets
 };
 
 vector<unique_ptr<ClientInfo>> clients;
 mutex clientsMutex;
+unique_ptr<Broadcaster> broadcaster;  // guarded by clientsMutex
 
 unordered_map<int, steady_clock::time_point> priceTimestamps;
 unordered_set<int> priceAlreadyHit;
 mutex priceMutex;
 
 atomic<int> priceId{0};
+atomic<int> nextClientId{0};
+atomic<int> registeredClients{0};
+
+// Session journal, null unless --journal was given
+unique_ptr<JournalWriter> journal;
+
+// --quiet: no line per tick and per hit, for load tests
+bool verbose = true;
+
+// --timestamps: kernel software stamps on every client socket
+// (include/timestamping.hpp), shown on the tick and hit lines
+bool timestamps = false;
+
+// Under clientsMutex, right after a broadcast that started at startNs: read
+// every client's transmit stamps. Each send() on loopback is stamped before
+// it returns, so the newest stamp is this broadcast's (with the io_uring
+// transports it may not be there yet). Returns how many clients had one,
+// and the earliest and latest stamp relative to startNs.
+int readTxStamps(int64_t startNs, int64_t& firstNs, int64_t& lastNs) {
+    int stamped = 0;
+    for (auto& c : clients) {
+        if (c->dropped) continue;
+        int64_t newest = 0;
+        drainTxTimestamps(c->socket, [&](uint64_t, int64_t ns) { newest = ns; });
+        if (!newest) continue;
+        firstNs = stamped ? min(firstNs, newest - startNs) : newest - startNs;
+        lastNs = stamped ? max(lastNs, newest - startNs) : newest - startNs;
+        stamped++;
+    }
+    return stamped;
+}
+
+// Send one price to every client, newline-terminated so back-to-back ticks
+// can be told apart when they arrive in one read
+void sendTick(int id, float price) {
+    string message = to_string(id) + "," + to_string(price) + "\n";
+
+    {
+        lock_guard<mutex> lock(priceMutex);
+        priceTimestamps[id] = steady_clock::now();
+    }
+
+    // journaled before the fan-out, so the record's time is when the tick
+    // left the server, not when the last client got it
+    if (journal) journal->append(JournalType::Tick, -1, id, price);
+
+    {
+        lock_guard<mutex> lock(clientsMutex);
+        const int64_t startNs = timestamps ? realtimeNs() : 0;
+        broadcaster->broadcast(message.c_str(), message.size());
+        int64_t firstNs = 0, lastNs = 0;
+        const int stamped = timestamps ? readTxStamps(startNs, firstNs, lastNs) : 0;
+        if (verbose && stamped > 0) {
+            cout << "⏱️ Price ID " << id << " handed to the kernel for " << stamped << " client(s) after "
+                 << firstNs / 1000.0 << " to " << lastNs / 1000.0 << " us" << endl;
+        }
+    }
+}
 
-// Send new price every 5 seconds
-void broadcastPrices() {
+// Send bytes to every client, in pieces when the transport takes shorter
+// messages. Clients reassemble lines, and holding clientsMutex across the
+// pieces keeps a tick from landing between them.
+void broadcastAll(const string& message) {
+    lock_guard<mutex> lock(clientsMutex);
+    const size_t piece = broadcaster->maxMessage();
+    for (size_t off = 0; off < message.size(); off += piece) {
+        broadcaster->broadcast(message.data() + off, min(piece, message.size() - off));
+    }
+    int64_t firstNs, lastNs;
+    if (timestamps) readTxStamps(0, firstNs, lastNs);  // keep the error queues short
+}
+
+// Level-2 depth feed (include/depth_feed.hpp): `rate` book changes per
+// second, sent as delta lines in 1 ms batches, with the whole book every
+// snapshotMs for clients that joined late or missed a delta
+void publishDepth(int rate, int levels, int snapshotMs, unsigned seed) {
+    DepthBook book;
+    DepthGenerator generator(book, levels, 10000, seed);
+    vector<DepthDelta> deltas;
+    string message, snapshot;
+    char line[64];
+    double owed = 0.0;
+    steady_clock::time_point next = steady_clock::now();
+    steady_clock::time_point nextSnapshot = next;
+    while (true) {
+        message.clear();
+        for (owed += rate / 1000.0; owed >= 1.0; owed -= 1.0) {
+            deltas.clear();
+            generator.step(deltas);
+            for (const DepthDelta& d : deltas) message.append(line, formatDelta(d, line, sizeof line));
+        }
+        if (steady_clock::now() >= nextSnapshot) {
+            book.snapshotLine(snapshot);
+            message += snapshot;
+            nextSnapshot += milliseconds(snapshotMs);
+            if (verbose && !book.bids().empty() && !book.asks().empty()) {
+                cout << "📚 Depth seq " << book.seq() << ": " << book.bids().size() << " bids, " << book.asks().size()
+                     << " asks, best " << book.bids().begin()->first * DEPTH_TICK << " / "
+                     << book.asks().begin()->first * DEPTH_TICK << endl;
+            }
+        }
+        if (!message.empty()) broadcastAll(message);
+        next += milliseconds(1);
+        this_thread::sleep_until(next);
+    }
+}
+
+// Send new price every intervalUs (5 seconds by default). Ticks are paced
+// from the start time, so the rate holds even when a fan-out runs long.
+void broadcastPrices(int intervalUs) {
+    steady_clock::time_point next = steady_clock::now();
     while (true) {
         int id = priceId++;
         float price = 100.0f + (rand() % 1000) / 10.0f;
 
-        string message = to_string(id) + "," + to_string(price);
+        sendTick(id, price);
 
-        {
-            lock_guard<mutex> lock(priceMutex);
-            priceTimestamps[id] = steady_clock::now();
+        if (verbose) cout << "📢 Sent price ID " << id << " with value " << price << endl;
+        next += microseconds(intervalUs);
+        this_thread::sleep_until(next);
+    }
+}
+
+// Re-send the ticks of a recorded session with the original gaps divided by
+// `speed`, then compare the prices hit now with the ones hit in the recording
+void replayPrices(JournalReader reader, double speed, int waitClients) {
+    cout << "⏪ Replay: waiting for " << waitClients << " client(s)" << endl;
+    while (registeredClients.load() < waitClients) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    // Ticks sent before the first client registered were seen by nobody;
+    // skip them so the replayed client starts from the same history.
+    size_t first = 0;
+    for (size_t i = 0; i < reader.records.size(); i++) {
+        if (reader.records[i].type == JournalType::Hello) {
+            first = i;
+            break;
         }
+    }
 
-        {
-            lock_guard<mutex> lock(clientsMutex);
-            for (auto& client : clients) {
-                send(client->socket, message.c_str(), message.size(), 0);
-            }
+    unordered_set<int> recordedHits;
+    int ticks = 0;
+    for (size_t i = first; i < reader.records.size(); i++) {
+        const auto& r = reader.records[i];
+        if (r.type == JournalType::Order && r.flags == (uint16_t)OrderResult::Hit) recordedHits.insert(r.priceId);
+        if (r.type == JournalType::Tick) ticks++;
+    }
+    cout << "⏪ Replaying " << ticks << " ticks at " << (speed > 0 ? to_string(speed) + "x" : string("full speed"))
+         << " (seed " << reader.header.seed << ")" << endl;
+
+    const steady_clock::time_point start = steady_clock::now();
+    uint64_t firstTs = 0;
+    for (size_t i = first; i < reader.records.size(); i++) {
+        const auto& r = reader.records[i];
+        if (r.type != JournalType::Tick) continue;
+        if (firstTs == 0) firstTs = r.tsNs;
+        if (speed > 0) {
+            auto offset = nanoseconds((int64_t)((double)(r.tsNs - firstTs) / speed));
+            this_thread::sleep_until(start + offset);
         }
+        sendTick(r.priceId, r.price);
+        if (verbose) cout << "📢 Replayed price ID " << r.priceId << " with value " << r.price << endl;
+    }
+
+    // give the clients time to answer the last ticks
+    this_thread::sleep_for(chrono::seconds(1));
 
-        cout << "📢 Sent price ID " << id << " with value " << price << endl;
-        this_thread::sleep_for(chrono::seconds(5));
+    int reproduced = 0, extra = 0;
+    {
+        lock_guard<mutex> lock(priceMutex);
+        for (int id : priceAlreadyHit) {
+            if (recordedHits.count(id)) reproduced++;
+            else extra++;
+        }
     }
+    cout << "⏪ Replay done: " << reproduced << "/" << recordedHits.size() << " recorded hits reproduced, "
+         << extra << " new" << endl;
+    if (journal) journal->close();
+    exit(EXIT_SUCCESS);
+}
+
+// Stop sending ticks to a client, then close its socket
+void dropClient(ClientInfo* client) {
+    {
+        lock_guard<mutex> lock(clientsMutex);
+        broadcaster->removeClient(client->socket);
+        client->dropped = true;
+    }
+    close(client->socket);
 }
 
 // Handle a client connection
@@ -68,49 +261,91 @@ void handleClient(ClientInfo* client) {
     int bytesReceived = recv(client->socket, buffer, BUFFER_SIZE - 1, 0);
     if (bytesReceived <= 0) {
         cerr << "❌ Failed to receive client name." << endl;
-        close(client->socket);
+        dropClient(client);
         return;
     }
 
     client->name = string(buffer);
     cout << "👤 Registered client: " << client->name << endl;
+    if (journal) journal->append(JournalType::Hello, client->id, -1, 0.0f, 0, client->name.c_str());
+    registeredClients++;
 
-    // Receive orders
+    // Receive orders, one per line. A line split across reads waits in
+    // `lines` for the rest of it.
+    LineBuffer lines;
     while (true) {
-        memset(buffer, 0, BUFFER_SIZE);
-        bytesReceived = recv(client->socket, buffer, BUFFER_SIZE - 1, 0);
+        int64_t kernelNs = 0;
+        bytesReceived = recvStamped(client->socket, buffer, BUFFER_SIZE, 0, kernelNs);
         if (bytesReceived <= 0) {
             cerr << "❌ Client " << client->name << " disconnected." << endl;
             break;
         }
+        // time the orders sat in the stack and the socket buffer
+        const int64_t queuedNs = kernelNs ? realtimeNs() - kernelNs : -1;
 
-        int receivedPriceId = atoi(buffer);
-        steady_clock::time_point now = steady_clock::now();
+        lines.feed(buffer, (size_t)bytesReceived, [&](const char* data, size_t len) {
+            const string line(data, len);
+            if (line.empty()) return;
+            if (line == "HB") return;  // client heartbeat
+            int receivedPriceId = atoi(line.c_str());
+            steady_clock::time_point now = steady_clock::now();
 
-        {
             lock_guard<mutex> lock(priceMutex);
             if (priceAlreadyHit.count(receivedPriceId)) {
                 // Already hit by another client
-                continue;
+                if (journal) journal->append(JournalType::Order, client->id, receivedPriceId, 0.0f,
+                                             (uint16_t)OrderResult::AlreadyHit);
+                return;
             }
 
             if (priceTimestamps.find(receivedPriceId) == priceTimestamps.end()) {
+                if (journal) journal->append(JournalType::Order, client->id, receivedPriceId, 0.0f,
+                                             (uint16_t)OrderResult::UnknownPrice);
                 cerr << "⚠️ Unknown price ID: " << receivedPriceId << endl;
-                continue;
+                return;
             }
 
             priceAlreadyHit.insert(receivedPriceId);
+            if (journal) journal->append(JournalType::Order, client->id, receivedPriceId, 0.0f,
+                                         (uint16_t)OrderResult::Hit);
             auto latency = duration_cast<milliseconds>(now - priceTimestamps[receivedPriceId]).count();
-            cout << "🎯 " << client->name << " hit price ID " << receivedPriceId
-                 << " after " << latency << " ms" << endl;
-        }
+            if (verbose) {
+                cout << "🎯 " << client->name << " hit price ID " << receivedPriceId << " after " << latency << " ms";
+                if (queuedNs >= 0) cout << " (" << queuedNs / 1000.0 << " us of it in the kernel)";
+                cout << endl;
+            }
+        });
     }
 
-    close(client->socket);
+    dropClient(client);
+}
+
+// Open the session journal and make Ctrl-C / kill flush it before exiting.
+// Called after bind() succeeds, so a second server that fails to start never
+// truncates a running server's journal, and before any other thread exists,
+// so that only the sigwait thread receives the blocked signals.
+bool openJournal(const ServerOptions& options) {
+    journal = make_unique<JournalWriter>(options.journalPath, options.seed);
+    if (!journal->ok()) return false;
+    cout << "📝 Journaling to " << options.journalPath << endl;
+
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+    thread([stopSignals] {
+        int sig = 0;
+        sigwait(&stopSignals, &sig);
+        journal->close();
+        cout << "📝 Journal closed" << endl;
+        exit(EXIT_SUCCESS);
+    }).detach();
+    return true;
 }
 
 // Start the server
-void startServer() {
+void startServer(const ServerOptions& options) {
     int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
     if (serverSocket < 0) {
         perror("Socket creation failed");
@@ -131,7 +366,8 @@ void startServer() {
         exit(EXIT_FAILURE);
     }
 
-    if (listen(serverSocket, 5) < 0) {
+    // room for a whole swarm of clients connecting at once
+    if (listen(serverSocket, SOMAXCONN) < 0) {
         perror("Listen failed");
         close(serverSocket);
         exit(EXIT_FAILURE);
@@ -139,9 +375,38 @@ void startServer() {
 
     cout << "🚀 Server is listening on 127.0.0.1:" << PORT << endl;
 
-    thread priceThread(broadcastPrices);
+    string fallbackReason;
+    broadcaster = makeBroadcaster(options.transport, &fallbackReason);
+    if (broadcaster->transport() != options.transport) {
+        cerr << "⚠️ " << transportName(options.transport) << " transport unavailable (" << fallbackReason
+             << "), using " << transportName(broadcaster->transport()) << endl;
+    }
+    cout << "📡 Broadcasting with " << transportName(broadcaster->transport()) << endl;
+
+    if (!options.journalPath.empty() && !openJournal(options)) {
+        close(serverSocket);
+        exit(EXIT_FAILURE);
+    }
+
+    thread priceThread;
+    if (!options.replayPath.empty()) {
+        JournalReader reader;
+        if (!reader.load(options.replayPath)) {
+            close(serverSocket);
+            exit(EXIT_FAILURE);
+        }
+        priceThread = thread(replayPrices, std::move(reader), options.speed, options.waitClients);
+    } else {
+        priceThread = thread(broadcastPrices, options.intervalUs);
+    }
     priceThread.detach();
 
+    if (options.depthRate > 0) {
+        cout << "📚 Publishing depth: " << options.depthRate << " updates/s, " << options.depthLevels
+             << " levels, snapshot every " << options.snapshotMs << " ms" << endl;
+        thread(publishDepth, options.depthRate, options.depthLevels, options.snapshotMs, options.seed).detach();
+    }
+
     while (true) {
         sockaddr_in clientAddr{};
         socklen_t clientLen = sizeof(clientAddr);
@@ -154,14 +419,26 @@ void startServer() {
         cout << "📡 Client connected: " << inet_ntoa(clientAddr.sin_addr) << endl;
 
         // Create a new client object on the heap
+        if (options.timestamps) {
+            const Timestamping mode = enableTimestamping(clientSocket);
+            if (mode != Timestamping::RxTx) cerr << "⚠️ Kernel timestamps: " << timestampingName(mode) << endl;
+        }
+
         auto client = make_unique<ClientInfo>();
         client->socket = clientSocket;
+        client->id = nextClientId++;
 
         // Store a pointer before moving ownership
         ClientInfo* clientPtr = client.get();
 
         {
             lock_guard<mutex> lock(clientsMutex);
+            if (!broadcaster->addClient(clientSocket)) {
+                cerr << "❌ Too many clients for the " << transportName(broadcaster->transport())
+                     << " transport, closing connection." << endl;
+                close(clientSocket);
+                continue;
+            }
             clients.push_back(std::move(client));
         }
 
@@ -174,7 +451,56 @@ void startServer() {
     close(serverSocket);
 }
 
-int main() {
-    startServer();
+void printUsage(const char* argv0) {
+    cerr << "usage: " << argv0 << " [--seed N] [--interval-ms MS | --interval-us US] [--journal FILE] [--transport T]\n"
+         << "       " << "         [--depth N [--depth-levels L] [--snapshot-ms MS]] [--timestamps] [--quiet]\n"
+         << "       " << argv0 << " --replay FILE [--speed X] [--wait-clients N] [--journal FILE] [--transport T] [--quiet]\n"
+         << "  --seed N          seed for the price generator (default 1)\n"
+         << "  --interval-ms MS  time between prices (default 5000)\n"
+         << "  --interval-us US  the same in microseconds, for high tick rates\n"
+         << "  --journal FILE    record every tick, client and order to FILE\n"
+         << "  --replay FILE     send the ticks recorded in FILE instead of new prices\n"
+         << "  --speed X         replay pace, 1 = original, 10 = ten times faster, 0 = no waits (default 1)\n"
+         << "  --wait-clients N  start the replay once N clients have registered (default 1)\n"
+         << "  --transport T     tick fan-out: send, uring or uring-sqpoll (default send);\n"
+         << "                    falls back to send when io_uring is unavailable\n"
+         << "  --depth N         also publish a level-2 book: N depth updates per second (default off)\n"
+         << "  --depth-levels L  levels per side of that book (default 10)\n"
+         << "  --snapshot-ms MS  time between full book snapshots (default 1000)\n"
+         << "  --timestamps      kernel receive/transmit stamps on client sockets, shown per tick and per hit\n"
+         << "  --quiet           no line per tick and per hit" << endl;
+}
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--seed" && hasValue) options.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--interval-ms" && hasValue) options.intervalUs = atoi(argv[++i]) * 1000;
+        else if (arg == "--interval-us" && hasValue) options.intervalUs = atoi(argv[++i]);
+        else if (arg == "--journal" && hasValue) options.journalPath = argv[++i];
+        else if (arg == "--replay" && hasValue) options.replayPath = argv[++i];
+        else if (arg == "--speed" && hasValue) options.speed = atof(argv[++i]);
+        else if (arg == "--wait-clients" && hasValue) options.waitClients = atoi(argv[++i]);
+        else if (arg == "--transport" && hasValue && parseTransport(argv[i + 1], options.transport)) i++;
+        else if (arg == "--depth" && hasValue) options.depthRate = max(0, atoi(argv[++i]));
+        else if (arg == "--depth-levels" && hasValue) options.depthLevels = max(1, atoi(argv[++i]));
+        else if (arg == "--snapshot-ms" && hasValue) options.snapshotMs = max(1, atoi(argv[++i]));
+        else if (arg == "--timestamps") options.timestamps = true;
+        else if (arg == "--quiet") options.quiet = true;
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    srand(options.seed);
+    verbose = !options.quiet;
+    timestamps = options.timestamps;
+    // a client that disconnects mid-write must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    startServer(options);
     return 0;
 }
\ No newline at end of file
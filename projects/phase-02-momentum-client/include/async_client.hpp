@@ -0,0 +1,411 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "coro_runtime.hpp"
+#include "depth_feed.hpp"
+#include "line_buffer.hpp"
+#include "timestamping.hpp"
+
+// The momentum client's pieces, shared by hft_client and coro_bench.
+//
+// Per connection there are four kinds of coroutine, all on one EventLoop:
+//   marketData  reads ticks, splits lines, fans each tick out to the strategies
+//   strategy    one per strategy: runs the momentum rule, queues orders
+//   orderSender writes queued orders and heartbeats, waiting out the order
+//               delay after each order
+//   heartbeat   queues "HB" every heartbeatMs so the server sees a live client
+// marketData also applies depth lines, when the server sends them, to the
+// connection's replica book (depth_feed.hpp). With cfg.timestamps each stage
+// of a tick's path is timed against the kernel's stamps (timestamping.hpp).
+// They talk through Channels, so a slow strategy or a full socket buffer
+// never blocks the others.
+
+struct ClientConfig {
+    std::string host = "127.0.0.1";
+    int port = 12345;
+    std::string name;
+    int connections = 1;
+    int strategies = 1;         // per connection; strategy i looks at 3 + i prices
+    int heartbeatMs = 1000;     // 0 = no heartbeat
+    int orderDelayMinMs = 10;   // pause after each order, as the blocking client does
+    int orderDelayMaxMs = 59;
+    bool verbose = true;
+    bool timestamps = false;    // time each stage of a tick; the socket must have stamps enabled
+};
+
+struct Tick {
+    int id;
+    float price;
+    int64_t kernelNs = 0;       // receive stamp of the read it came in, 0 if none
+};
+
+// "id,price" -> Tick. Returns false for anything else.
+inline bool parseTick(const char* line, size_t len, Tick& out) {
+    char buf[64];
+    if (len == 0 || len >= sizeof buf) return false;
+    std::memcpy(buf, line, len);
+    buf[len] = '\0';
+    char* end = nullptr;
+    const long id = std::strtol(buf, &end, 10);
+    if (end == buf || *end != ',') return false;
+    char* p = end + 1;
+    const float price = std::strtof(p, &end);
+    if (end == p) return false;
+    out = Tick{(int)id, price};
+    return true;
+}
+
+// Order when the last `window` prices move strictly up or strictly down
+// (window 3 is the rule in strategy.md).
+class MomentumStrategy {
+public:
+    explicit MomentumStrategy(int window = 3) : window_(window < 2 ? 2 : window) {}
+
+    bool onPrice(float price) {
+        if ((int)history_.size() >= window_) history_.pop_front();
+        history_.push_back(price);
+        if ((int)history_.size() < window_) return false;
+        bool up = true, down = true;
+        for (size_t i = 1; i < history_.size(); i++) {
+            up = up && history_[i - 1] < history_[i];
+            down = down && history_[i - 1] > history_[i];
+        }
+        return up || down;
+    }
+
+    const std::deque<float>& history() const { return history_; }
+
+private:
+    int window_;
+    std::deque<float> history_;
+};
+
+struct ClientStats {
+    uint64_t ticks = 0;
+    uint64_t orders = 0;
+    uint64_t heartbeats = 0;
+};
+
+// One depth line into a replica, with a line when it syncs or loses sync.
+inline void applyDepthLine(ReplicaBook& book, const char* line, size_t len, bool verbose, int index) {
+    const bool wasSynced = book.synced();
+    const ApplyResult r = book.onLine(line, len);
+    if (!verbose) return;
+    if (r == ApplyResult::Snapshot && !wasSynced && book.levels('B') > 0 && book.levels('A') > 0) {
+        std::cout << "📚 [" << index << "] Book synced at seq " << book.seq() << ": "
+                  << book.best('B') * DEPTH_TICK << " x " << book.quantity('B', book.best('B')) << " / "
+                  << book.best('A') * DEPTH_TICK << " x " << book.quantity('A', book.best('A')) << std::endl;
+    } else if (r == ApplyResult::Gap || r == ApplyResult::Inconsistent) {
+        std::cerr << "⚠️ [" << index << "] Depth " << (r == ApplyResult::Gap ? "gap" : "mismatch") << " after seq "
+                  << book.seq() << ", waiting for a snapshot" << std::endl;
+    } else if (r == ApplyResult::Malformed) {
+        std::cerr << "Invalid depth line received: " << std::string(line, len) << std::endl;
+    }
+}
+
+inline bool isDepthLine(const char* line, size_t len) {
+    return len > 0 && (line[0] == 'D' || line[0] == 'S');
+}
+
+// Send all of `data`, waiting for the socket to drain when needed.
+// Returns false if the connection failed.
+inline bool sendAllBlocking(int fd, const char* data, size_t n) {
+    while (n > 0) {
+        const ssize_t w = send(fd, data, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        data += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
+
+// The original one-connection, one-strategy loop: recv, parse, decide,
+// send, sleep. Kept for --blocking and as the benchmark baseline.
+// With cfg.timestamps and a report, every stage goes into the report.
+inline void runBlockingClient(int fd, const ClientConfig& cfg, ClientStats* stats = nullptr,
+                              LatencyReport* latency = nullptr) {
+    using namespace std;
+    if (!cfg.timestamps) latency = nullptr;
+    TxTimestamps txStamps;
+    if (!cfg.name.empty()) {
+        sendAllBlocking(fd, cfg.name.c_str(), cfg.name.size());
+        txStamps.sent(cfg.name.size(), 0, false);
+    }
+
+    MomentumStrategy momentum(3);
+    ReplicaBook book;
+    LineBuffer lines;
+    char buffer[1024];
+    while (true) {
+        int64_t kernelNs = 0;
+        const ssize_t got = recvStamped(fd, buffer, sizeof buffer, 0, kernelNs);
+        if (got <= 0) {
+            if (cfg.verbose) cerr << "Server closed connection or error occurred." << endl;
+            break;
+        }
+        if (latency && kernelNs) latency->kernel.push_back(realtimeNs() - kernelNs);
+        bool alive = true;
+        lines.feed(buffer, (size_t)got, [&](const char* line, size_t len) {
+            Tick t;
+            if (!alive || len == 0) return;
+            if (isDepthLine(line, len)) {
+                applyDepthLine(book, line, len, cfg.verbose, 0);
+                return;
+            }
+            const int64_t parseStart = latency ? realtimeNs() : 0;
+            if (!parseTick(line, len, t)) {
+                if (cfg.verbose) cerr << "Invalid price format received: " << string(line, len) << endl;
+                return;
+            }
+            const int64_t parsed = latency ? realtimeNs() : 0;
+            if (stats) stats->ticks++;
+            const bool fire = momentum.onPrice(t.price);
+            if (latency) {
+                const int64_t decided = realtimeNs();
+                latency->parse.push_back(parsed - parseStart);
+                latency->strategy.push_back(decided - parsed);
+                if (kernelNs) latency->decision.push_back(decided - kernelNs);
+            }
+            if (cfg.verbose) cout << "📥 Received price ID: " << t.id << ", Value: " << t.price << endl;
+            if (!fire) {
+                if (cfg.verbose && momentum.history().size() == 3) {
+                    cout << "No momentum!! Ignoring priceID: " << t.id << endl;
+                }
+                return;
+            }
+            const string order = to_string(t.id) + "\n";
+            const int64_t sendStart = latency ? realtimeNs() : 0;
+            alive = sendAllBlocking(fd, order.c_str(), order.size());
+            if (!alive) return;
+            if (latency) {
+                latency->send.push_back(realtimeNs() - sendStart);
+                txStamps.sent(order.size(), sendStart, true);
+                txStamps.drain(fd, [&](int64_t start, int64_t ns) { latency->tx.push_back(ns - start); });
+            }
+            if (stats) stats->orders++;
+            if (cfg.orderDelayMaxMs > 0) {
+                const int span = cfg.orderDelayMaxMs - cfg.orderDelayMinMs + 1;
+                this_thread::sleep_for(chrono::milliseconds(cfg.orderDelayMinMs + (span > 0 ? rand() % span : 0)));
+            }
+            if (cfg.verbose) cout << "Found momentum!! Sending order for priceID: " << t.id << endl;
+        });
+        if (!alive) break;
+    }
+    close(fd);
+}
+
+// One server connection driven by coroutines. Owns the fd once started.
+class AsyncConnection {
+public:
+    AsyncConnection(EventLoop& loop, int fd, const ClientConfig& cfg, int index)
+        : loop_(loop), fd_(fd), cfg_(cfg), index_(index), orders_(loop) {
+        for (int s = 0; s < cfg.strategies; s++) {
+            inboxes_.push_back(std::make_unique<Channel<Tick>>(loop));
+        }
+    }
+
+    // Make the fd non-blocking, register it and spawn the coroutines.
+    bool start() {
+        const int flags = fcntl(fd_, F_GETFL, 0);
+        if (flags < 0 || fcntl(fd_, F_SETFL, flags | O_NONBLOCK) < 0) return false;
+        if (!loop_.watch(fd_)) return false;
+        pendingCoroutines_ = 2 + cfg_.strategies + (cfg_.heartbeatMs > 0 ? 1 : 0);
+        loop_.spawn(marketData());
+        for (int s = 0; s < cfg_.strategies; s++) loop_.spawn(strategy(s));
+        loop_.spawn(orderSender());
+        if (cfg_.heartbeatMs > 0) loop_.spawn(heartbeat());
+        return true;
+    }
+
+    const ClientStats& stats() const { return stats_; }
+    const ReplicaBook& book() const { return book_; }
+    const LatencyReport& latency() const { return latency_; }
+    bool closed() const { return closed_; }
+
+private:
+    EventLoop& loop_;
+    int fd_;
+    const ClientConfig& cfg_;
+    int index_;
+    ClientStats stats_;
+    ReplicaBook book_;
+    LatencyReport latency_;
+    TxTimestamps txStamps_;
+    std::vector<std::unique_ptr<Channel<Tick>>> inboxes_;
+    Channel<int> orders_;      // price IDs to order; HEARTBEAT for a heartbeat
+    bool closed_ = false;
+    int pendingCoroutines_ = 0;
+
+    static constexpr int HEARTBEAT = -1;
+
+    // Send as much as the socket takes now. Returns false when the
+    // connection is gone; n > 0 afterwards means wait for writable.
+    // startNs != 0 asks for the transmit stamp of the message's last byte.
+    bool trySend(const char*& data, size_t& n, int64_t startNs = 0) {
+        while (n > 0) {
+            const ssize_t w = send(fd_, data, n, MSG_NOSIGNAL);
+            if (w > 0) {
+                data += w;
+                n -= (size_t)w;
+                txStamps_.sent((size_t)w, startNs, startNs != 0 && n == 0);
+                continue;
+            }
+            if (w < 0 && errno == EINTR) continue;
+            if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+            return false;
+        }
+        return true;
+    }
+
+    void shutdown() {
+        if (closed_) return;
+        closed_ = true;
+        for (auto& in : inboxes_) in->close();
+        orders_.close();
+        loop_.unwatch(fd_);
+        ::shutdown(fd_, SHUT_RDWR);
+    }
+
+    void drainTxStamps() {
+        if (!cfg_.timestamps) return;
+        txStamps_.drain(fd_, [&](int64_t start, int64_t ns) { latency_.tx.push_back(ns - start); });
+    }
+
+    void release() {
+        // the last coroutine out closes the fd
+        if (--pendingCoroutines_ == 0) close(fd_);
+    }
+
+    Task marketData() {
+        if (!cfg_.name.empty()) {
+            const char* p = cfg_.name.c_str();
+            size_t n = cfg_.name.size();
+            while (!closed_ && trySend(p, n) && n > 0) co_await loop_.writable(fd_);
+        }
+
+        LineBuffer lines;
+        char buffer[4096];
+        while (!closed_) {
+            int64_t kernelNs = 0;
+            const ssize_t got = recvStamped(fd_, buffer, sizeof buffer, 0, kernelNs);
+            if (got > 0) {
+                if (cfg_.timestamps && kernelNs) latency_.kernel.push_back(realtimeNs() - kernelNs);
+                lines.feed(buffer, (size_t)got, [&](const char* line, size_t len) {
+                    Tick t;
+                    if (len == 0) return;
+                    if (isDepthLine(line, len)) {
+                        applyDepthLine(book_, line, len, cfg_.verbose, index_);
+                        return;
+                    }
+                    const int64_t parseStart = cfg_.timestamps ? realtimeNs() : 0;
+                    if (!parseTick(line, len, t)) {
+                        if (cfg_.verbose) std::cerr << "Invalid price format received: " << std::string(line, len) << std::endl;
+                        return;
+                    }
+                    if (cfg_.timestamps) {
+                        latency_.parse.push_back(realtimeNs() - parseStart);
+                        t.kernelNs = kernelNs;
+                    }
+                    stats_.ticks++;
+                    if (cfg_.verbose) {
+                        std::cout << "📥 [" << index_ << "] Received price ID: " << t.id << ", Value: " << t.price << std::endl;
+                    }
+                    for (auto& in : inboxes_) in->push(t);
+                });
+                continue;
+            }
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                co_await loop_.readable(fd_);
+                drainTxStamps();  // transmit stamps wake this reader too
+                continue;
+            }
+            if (cfg_.verbose) std::cerr << "Server closed connection or error occurred." << std::endl;
+            break;
+        }
+        shutdown();
+        release();
+    }
+
+    Task strategy(int s) {
+        MomentumStrategy momentum(3 + s);
+        Channel<Tick>& inbox = *inboxes_[s];
+        while (auto tick = co_await inbox.pop()) {
+            const int64_t start = cfg_.timestamps ? realtimeNs() : 0;
+            const bool fire = momentum.onPrice(tick->price);
+            if (cfg_.timestamps) {
+                const int64_t decided = realtimeNs();
+                latency_.strategy.push_back(decided - start);
+                if (tick->kernelNs) latency_.decision.push_back(decided - tick->kernelNs);
+            }
+            if (fire) {
+                orders_.push(tick->id);
+                if (cfg_.verbose) {
+                    std::cout << "Found momentum!! [" << index_ << "/" << s << "] Sending order for priceID: "
+                              << tick->id << std::endl;
+                }
+            }
+        }
+        release();
+    }
+
+    // The only writer on the socket after the name, so orders and
+    // heartbeats never interleave mid-line. Once the connection closes, the
+    // orders still queued are dropped, and an order counts only once its
+    // whole line is sent.
+    Task orderSender() {
+        char line[16];
+        while (auto id = co_await orders_.pop()) {
+            if (closed_) break;
+            const int len = *id == HEARTBEAT ? std::snprintf(line, sizeof line, "HB\n")
+                                             : std::snprintf(line, sizeof line, "%d\n", *id);
+            const char* p = line;
+            size_t n = (size_t)len;
+            bool ok = true;
+            const int64_t sendStart = cfg_.timestamps && *id != HEARTBEAT ? realtimeNs() : 0;
+            while (!closed_ && (ok = trySend(p, n, sendStart)) && n > 0) co_await loop_.writable(fd_);
+            if (!ok) {
+                shutdown();
+                break;
+            }
+            if (n > 0) break;  // closed while waiting to write the rest
+            if (sendStart) {
+                latency_.send.push_back(realtimeNs() - sendStart);
+                drainTxStamps();
+            }
+            if (*id == HEARTBEAT) {
+                stats_.heartbeats++;
+                continue;
+            }
+            stats_.orders++;
+            if (cfg_.orderDelayMaxMs > 0) {
+                const int span = cfg_.orderDelayMaxMs - cfg_.orderDelayMinMs + 1;
+                co_await loop_.sleepFor(std::chrono::milliseconds(cfg_.orderDelayMinMs + (span > 0 ? rand() % span : 0)));
+            }
+        }
+        release();
+    }
+
+    // Exits at the first wake-up after the connection closes.
+    Task heartbeat() {
+        while (!closed_) {
+            co_await loop_.sleepFor(std::chrono::milliseconds(cfg_.heartbeatMs));
+            if (!closed_) orders_.push(HEARTBEAT);
+        }
+        release();
+    }
+};
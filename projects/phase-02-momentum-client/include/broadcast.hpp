@@ -0,0 +1,553 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// How hft_server fans one tick out to every client.
+//
+//   send          one send() per client per tick, the original path
+//   uring         every client's write for a tick goes into one io_uring
+//                 submission: one io_uring_enter per tick, whatever the
+//                 client count
+//   uring-sqpoll  the same, with a kernel thread polling the submission
+//                 queue, so the publisher makes no syscall at all while
+//                 that thread is awake
+//
+// The io_uring backends write from a registered buffer (no per-write page
+// pinning) to registered ("fixed") file slots (no per-write fd lookup).
+// liburing is not needed: the ring is set up with the raw syscalls. A
+// client's messages go out as chains of linked writes, one chain in flight
+// at a time, so they reach the socket whole and in order as with send(): a
+// short write cuts its chain and is resubmitted from where it stopped, and a
+// failed one drops the client.
+//
+// Broadcasters are not thread-safe; hft_server calls them under clientsMutex.
+
+enum class Transport { Send, Uring, UringSqpoll };
+
+inline const char* transportName(Transport t) {
+    switch (t) {
+        case Transport::Send: return "send";
+        case Transport::Uring: return "uring";
+        case Transport::UringSqpoll: return "uring-sqpoll";
+    }
+    return "?";
+}
+
+inline bool parseTransport(const std::string& s, Transport& out) {
+    for (Transport t : {Transport::Send, Transport::Uring, Transport::UringSqpoll}) {
+        if (s == transportName(t)) {
+            out = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+class Broadcaster {
+public:
+    virtual ~Broadcaster() = default;
+
+    virtual Transport transport() const = 0;
+    // False when the client cannot be added (io_uring file table full).
+    virtual bool addClient(int fd) = 0;
+    // Call before closing the fd.
+    virtual void removeClient(int fd) = 0;
+    // Send msg to every client. Returns the number of clients it went to.
+    virtual int broadcast(const char* msg, size_t len) = 0;
+    // Longest msg broadcast() takes; longer ones have to go in pieces.
+    virtual size_t maxMessage() const { return SIZE_MAX; }
+    // Wait until every write queued so far has completed.
+    virtual void flush() {}
+
+    uint64_t syscalls() const { return syscalls_; }
+    // Messages not fully written (a client that went away, a full socket
+    // buffer on the send path)
+    uint64_t errors() const { return errors_; }
+
+protected:
+    uint64_t syscalls_ = 0;
+    uint64_t errors_ = 0;
+};
+
+class SendBroadcaster : public Broadcaster {
+public:
+    Transport transport() const override { return Transport::Send; }
+
+    bool addClient(int fd) override {
+        fds_.push_back(fd);
+        return true;
+    }
+
+    void removeClient(int fd) override {
+        for (size_t i = 0; i < fds_.size(); i++) {
+            if (fds_[i] != fd) continue;
+            fds_[i] = fds_.back();
+            fds_.pop_back();
+            return;
+        }
+    }
+
+    int broadcast(const char* msg, size_t len) override {
+        for (int fd : fds_) {
+            const ssize_t w = send(fd, msg, len, MSG_NOSIGNAL);
+            syscalls_++;
+            if (w != (ssize_t)len) errors_++;
+        }
+        return (int)fds_.size();
+    }
+
+private:
+    std::vector<int> fds_;
+};
+
+class UringBroadcaster : public Broadcaster {
+public:
+    static constexpr unsigned MAX_CLIENTS = 1024;  // fixed-file slots and SQ entries
+    static constexpr unsigned SLOTS = 64;          // ticks that can be in flight at once
+    static constexpr size_t SLOT_BYTES = 64;       // longest message
+    static constexpr unsigned MAX_CHAIN = 16;      // linked writes in flight per client
+
+    explicit UringBroadcaster(bool sqpoll) : sqpoll_(sqpoll), files_(MAX_CLIENTS, -1), queues_(MAX_CLIENTS) {
+        io_uring_params p{};
+        p.flags = IORING_SETUP_CQSIZE | (sqpoll ? IORING_SETUP_SQPOLL : 0);
+        p.cq_entries = MAX_CHAIN * MAX_CLIENTS;  // room for every client's chain
+        p.sq_thread_idle = 1000;  // ms without work before the poller sleeps
+        ringFd_ = (int)syscall(__NR_io_uring_setup, MAX_CLIENTS, &p);
+        if (ringFd_ < 0) {
+            fail("io_uring_setup");
+            return;
+        }
+        if (!mapRings(p)) return;
+
+        buffer_ = (char*)aligned_alloc(4096, SLOTS * SLOT_BYTES);
+        if (!buffer_) {
+            fail("aligned_alloc");
+            return;
+        }
+        iovec iov{buffer_, SLOTS * SLOT_BYTES};
+        if (syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_BUFFERS, &iov, 1) < 0) {
+            fail("IORING_REGISTER_BUFFERS");
+            return;
+        }
+        // all slots start empty (-1) and are filled in as clients connect
+        if (syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_FILES, files_.data(), MAX_CLIENTS) < 0) {
+            fail("IORING_REGISTER_FILES");
+            return;
+        }
+        for (unsigned i = MAX_CLIENTS; i-- > 0;) freeSlots_.push_back(i);
+        ok_ = true;
+    }
+
+    ~UringBroadcaster() override {
+        if (ok_) flush();
+        if (sqes_) munmap(sqes_, sqesSize_);
+        if (cqRing_ && cqRing_ != sqRing_) munmap(cqRing_, cqRingSize_);
+        if (sqRing_) munmap(sqRing_, sqRingSize_);
+        if (ringFd_ >= 0) close(ringFd_);  // drops the registered files and buffer
+        free(buffer_);
+    }
+
+    UringBroadcaster(const UringBroadcaster&) = delete;
+    UringBroadcaster& operator=(const UringBroadcaster&) = delete;
+
+    bool ok() const { return ok_; }
+    // What failed when !ok()
+    const std::string& error() const { return error_; }
+
+    Transport transport() const override { return sqpoll_ ? Transport::UringSqpoll : Transport::Uring; }
+
+    bool addClient(int fd) override {
+        if (freeSlots_.empty()) return false;
+        const unsigned slot = freeSlots_.back();
+        if (!updateFile(slot, fd)) return false;
+        freeSlots_.pop_back();
+        files_[slot] = fd;
+        slotOf_[fd] = slot;
+        active_.push_back(slot);
+        return true;
+    }
+
+    void removeClient(int fd) override {
+        auto it = slotOf_.find(fd);
+        if (it == slotOf_.end()) return;
+        const unsigned slot = it->second;
+        slotOf_.erase(it);
+        deactivate(slot);
+        ClientQueue& q = queues_[slot];
+        // messages not yet submitted are dropped; a chain in flight keeps its
+        // buffers and the slot until its last completion
+        while (q.writes.size() > q.chain) {
+            finish(q.writes.back().tick);
+            q.writes.pop_back();
+        }
+        updateFile(slot, -1);
+        files_[slot] = -1;
+        q.state = SlotState::Retired;
+        if (q.pending == 0) freeSlot(slot);
+    }
+
+    size_t maxMessage() const override { return SLOT_BYTES; }
+
+    int broadcast(const char* msg, size_t len) override {
+        if (len > SLOT_BYTES) {
+            errors_ += active_.size();
+            return 0;
+        }
+        reap();
+        if (active_.empty()) return 0;
+
+        // the buffer slot this tick goes out of must not still be in flight
+        const unsigned tick = nextTick_;
+        nextTick_ = (nextTick_ + 1) % SLOTS;
+        while (inflight_[tick] > 0) waitCompletions();
+        // the completion queue cannot overflow: a client has one chain of at
+        // most MAX_CHAIN writes in flight, and its slot is not reused until
+        // that chain is done
+
+        std::memcpy(buffer_ + tick * SLOT_BYTES, msg, len);
+        const int clients = (int)active_.size();
+        inflight_[tick] += (unsigned)clients;
+        for (unsigned slot : active_) queues_[slot].writes.push_back(Write{tick, 0, (unsigned)len});
+        // queueChain() may drain completions, and a failed write then takes
+        // its client out of active_, so walk a copy. A client with a chain in
+        // flight is skipped; reap() sends its message after that chain.
+        sending_.assign(active_.begin(), active_.end());
+        for (unsigned slot : sending_) queueChain(slot);
+        submitQueued();
+        return clients;
+    }
+
+    // A client's queue only moves on completions, so while it holds
+    // messages one of its chains is in flight.
+    void flush() override {
+        while (inflightTotal_ > 0) waitCompletions();
+    }
+
+private:
+    bool sqpoll_;
+    bool ok_ = false;
+    std::string error_;
+    int ringFd_ = -1;
+
+    void* sqRing_ = nullptr;
+    void* cqRing_ = nullptr;
+    size_t sqRingSize_ = 0;
+    size_t cqRingSize_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqesSize_ = 0;
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned* sqFlags_ = nullptr;
+    unsigned* sqArray_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned cqMask_ = 0;
+    unsigned cqEntries_ = 0;
+
+    // One message to one client; `offset` bytes of it are written.
+    struct Write {
+        unsigned tick;
+        unsigned offset;
+        unsigned len;
+    };
+    enum class SlotState { Live, Failed, Retired };
+    struct ClientQueue {
+        SlotState state = SlotState::Live;     // Failed: a write failed; Retired: client removed
+        std::deque<Write> writes;              // the first `chain` are in flight
+        unsigned chain = 0;                    // writes in the chain in flight
+        unsigned pending = 0;                  // of those, the ones not completed yet
+        unsigned at = 0;                       // the write the next completion is for
+    };
+
+    char* buffer_ = nullptr;
+    unsigned nextTick_ = 0;
+    unsigned inflight_[SLOTS] = {};            // per tick, writes not yet done
+    size_t inflightTotal_ = 0;                 // SQEs the kernel has not completed
+    unsigned unsubmitted_ = 0;                 // SQEs in the ring not yet submitted
+
+    std::vector<int> files_;                   // fd per fixed-file slot, -1 = free
+    std::vector<ClientQueue> queues_;          // per fixed-file slot
+    std::vector<unsigned> ready_;              // slots whose chain is done and that have more to send
+    std::vector<unsigned> freeSlots_;
+    std::vector<unsigned> active_;             // slots with a client, in no order
+    std::vector<unsigned> sending_;            // broadcast()'s copy of active_
+    std::unordered_map<int, unsigned> slotOf_;
+
+    static unsigned acquire(const unsigned* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+    static void release(unsigned* p, unsigned v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+    void fail(const char* what) {
+        error_ = std::string(what) + ": " + std::strerror(errno);
+    }
+
+    bool mapRings(const io_uring_params& p) {
+        sqRingSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cqRingSize_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+
+        sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_,
+                       IORING_OFF_SQ_RING);
+        if (sqRing_ == MAP_FAILED) {
+            sqRing_ = nullptr;
+            fail("mmap SQ ring");
+            return false;
+        }
+        if (single) {
+            cqRing_ = sqRing_;
+        } else {
+            cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_,
+                           IORING_OFF_CQ_RING);
+            if (cqRing_ == MAP_FAILED) {
+                cqRing_ = nullptr;
+                fail("mmap CQ ring");
+                return false;
+            }
+        }
+        sqesSize_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_,
+                          IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            fail("mmap SQEs");
+            return false;
+        }
+        sqes_ = (io_uring_sqe*)sqes;
+
+        char* sq = (char*)sqRing_;
+        sqHead_ = (unsigned*)(sq + p.sq_off.head);
+        sqTail_ = (unsigned*)(sq + p.sq_off.tail);
+        sqFlags_ = (unsigned*)(sq + p.sq_off.flags);
+        sqArray_ = (unsigned*)(sq + p.sq_off.array);
+        sqMask_ = *(unsigned*)(sq + p.sq_off.ring_mask);
+        sqEntries_ = *(unsigned*)(sq + p.sq_off.ring_entries);
+        char* cq = (char*)cqRing_;
+        cqHead_ = (unsigned*)(cq + p.cq_off.head);
+        cqTail_ = (unsigned*)(cq + p.cq_off.tail);
+        cqes_ = (io_uring_cqe*)(cq + p.cq_off.cqes);
+        cqMask_ = *(unsigned*)(cq + p.cq_off.ring_mask);
+        cqEntries_ = *(unsigned*)(cq + p.cq_off.ring_entries);
+        return true;
+    }
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        syscalls_++;
+        return (int)syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, nullptr, 0);
+    }
+
+    bool updateFile(unsigned slot, int fd) {
+        io_uring_files_update update{};
+        update.offset = slot;
+        update.fds = (uint64_t)(uintptr_t)&fd;
+        syscalls_++;
+        return syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_FILES_UPDATE, &update, 1) == 1;
+    }
+
+    void deactivate(unsigned slot) {
+        for (size_t i = 0; i < active_.size(); i++) {
+            if (active_[i] != slot) continue;
+            active_[i] = active_.back();
+            active_.pop_back();
+            return;
+        }
+    }
+
+    void finish(unsigned tick) {
+        if (tick < SLOTS && inflight_[tick] > 0) inflight_[tick]--;
+    }
+
+    void freeSlot(unsigned slot) {
+        queues_[slot] = ClientQueue{};
+        freeSlots_.push_back(slot);
+    }
+
+    // Put the slot's next messages in the ring as one linked chain, for
+    // submitQueued() to hand to the kernel. The tail is published once, after
+    // the whole chain, so SQPOLL never picks up half of it. Nothing is
+    // queued while the slot's previous chain is still in flight.
+    void queueChain(unsigned slot) {
+        ClientQueue& q = queues_[slot];
+        if (q.pending > 0 || q.state != SlotState::Live) return;
+        const unsigned n = (unsigned)std::min<size_t>(q.writes.size(), MAX_CHAIN);
+        if (n == 0) return;
+        while (sqEntries_ - (*sqTail_ - acquire(sqHead_)) < n) {
+            submitQueued();
+            // SQPOLL only: the poller has not caught up yet
+            if (sqEntries_ - (*sqTail_ - acquire(sqHead_)) < n) waitSqSpace();
+        }
+        unsigned tail = *sqTail_;
+        for (unsigned i = 0; i < n; i++) {
+            const Write& w = q.writes[i];
+            io_uring_sqe* sqe = &sqes_[tail & sqMask_];
+            std::memset(sqe, 0, sizeof *sqe);
+            sqe->opcode = IORING_OP_WRITE_FIXED;
+            sqe->flags = IOSQE_FIXED_FILE | (i + 1 < n ? IOSQE_IO_LINK : 0);
+            sqe->fd = (int)slot;
+            sqe->addr = (uint64_t)(uintptr_t)(buffer_ + w.tick * SLOT_BYTES + w.offset);
+            sqe->len = w.len - w.offset;
+            sqe->buf_index = 0;
+            sqe->user_data = slot;
+            sqArray_[tail & sqMask_] = tail & sqMask_;
+            tail++;
+        }
+        q.chain = q.pending = n;
+        q.at = 0;
+        // counted before publishing: with SQPOLL some may complete right away
+        inflightTotal_ += n;
+        unsubmitted_ += n;
+        release(sqTail_, tail);
+    }
+
+    // Hand the SQEs already published in the tail to the kernel.
+    void submitQueued() {
+        if (unsubmitted_ == 0) return;
+        if (sqpoll_) {
+            unsubmitted_ = 0;
+            // the poller only needs a syscall if it went to sleep
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (__atomic_load_n(sqFlags_, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+                enter(0, 0, IORING_ENTER_SQ_WAKEUP);
+            }
+            return;
+        }
+        while (unsubmitted_ > 0) {
+            const int r = enter(unsubmitted_, 0, 0);
+            if (r > 0) {
+                unsubmitted_ -= (unsigned)r;
+            } else if (r < 0 && errno == EINTR) {
+                continue;
+            } else if (r < 0 && (errno == EAGAIN || errno == EBUSY)) {
+                enter(0, 1, IORING_ENTER_GETEVENTS);
+                drainCompletions();
+            } else {
+                abandonInflight();
+                return;
+            }
+        }
+    }
+
+    void waitSqSpace() { enter(0, 0, IORING_ENTER_SQ_WAIT); }
+
+    void waitCompletions() {
+        const int r = enter(0, 1, IORING_ENTER_GETEVENTS);
+        if (r < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            abandonInflight();
+            return;
+        }
+        reap();
+    }
+
+    // The ring is unusable: forget what is in flight rather than wait forever.
+    void abandonInflight() {
+        for (unsigned slot = 0; slot < MAX_CLIENTS; slot++) {
+            ClientQueue& q = queues_[slot];
+            errors_ += q.writes.size();
+            q.writes.clear();
+            q.chain = q.pending = q.at = 0;
+            if (q.state == SlotState::Retired) freeSlot(slot);
+        }
+        inflightTotal_ = 0;
+        unsubmitted_ = 0;
+        ready_.clear();
+        std::memset(inflight_, 0, sizeof inflight_);
+    }
+
+    // A write failed, so the client's stream would end mid-message: stop
+    // writing to it and shut the socket down. The server's reader for the
+    // client then sees it go and removes it.
+    void dropWrites(unsigned slot) {
+        ClientQueue& q = queues_[slot];
+        for (const Write& w : q.writes) {
+            if (w.offset < w.len) errors_++;
+        }
+        while (q.writes.size() > q.chain) {
+            finish(q.writes.back().tick);
+            q.writes.pop_back();
+        }
+        q.state = SlotState::Failed;
+        deactivate(slot);
+        if (files_[slot] >= 0) ::shutdown(files_[slot], SHUT_RDWR);
+    }
+
+    // The slot's chain has completed: written messages leave the queue, and
+    // a short one and the cancelled ones behind it wait for the next chain.
+    void chainDone(unsigned slot) {
+        ClientQueue& q = queues_[slot];
+        const bool live = q.state == SlotState::Live;
+        while (q.chain > 0 && (!live || q.writes.front().offset == q.writes.front().len)) {
+            finish(q.writes.front().tick);
+            q.writes.pop_front();
+            q.chain--;
+        }
+        q.chain = 0;
+        q.at = 0;
+        if (q.state == SlotState::Retired) {
+            freeSlot(slot);
+        } else if (live && !q.writes.empty()) {
+            ready_.push_back(slot);
+        }
+    }
+
+    // Only records what completed; reap() submits the chains that follow.
+    void drainCompletions() {
+        unsigned head = *cqHead_;
+        const unsigned tail = acquire(cqTail_);
+        for (; head != tail; head++) {
+            const io_uring_cqe& cqe = cqes_[head & cqMask_];
+            if (inflightTotal_ > 0) inflightTotal_--;
+            const unsigned slot = (unsigned)cqe.user_data;
+            if (slot >= MAX_CLIENTS || queues_[slot].pending == 0) continue;
+            ClientQueue& q = queues_[slot];
+            q.pending--;
+            if (q.state == SlotState::Live) {
+                if (cqe.res > 0) {
+                    q.writes[q.at].offset += (unsigned)cqe.res;
+                } else if (cqe.res != -ECANCELED) {
+                    dropWrites(slot);
+                }
+                q.at++;
+            }
+            if (q.pending == 0) chainDone(slot);
+        }
+        release(cqHead_, head);
+    }
+
+    void reap() {
+        drainCompletions();
+        // queueChain() may submit, and so drain, and so add to ready_; a
+        // slot listed twice, or already sent by broadcast(), has a chain in
+        // flight and is skipped
+        for (size_t i = 0; i < ready_.size(); i++) {
+            if (queues_[ready_[i]].pending == 0) queueChain(ready_[i]);
+        }
+        ready_.clear();
+        submitQueued();
+    }
+};
+
+// The requested transport, or the send path when io_uring cannot be set up
+// here (old kernel, io_uring disabled, seccomp); `note` then says why.
+inline std::unique_ptr<Broadcaster> makeBroadcaster(Transport t, std::string* note = nullptr) {
+    if (t != Transport::Send) {
+        auto uring = std::make_unique<UringBroadcaster>(t == Transport::UringSqpoll);
+        if (uring->ok()) return uring;
+        if (note) *note = uring->error();
+    }
+    return std::make_unique<SendBroadcaster>();
+}
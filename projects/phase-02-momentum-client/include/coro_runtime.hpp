@@ -0,0 +1,280 @@
+#pragma once
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+// Single-threaded C++20 coroutine runtime over epoll.
+//
+// Coroutines are fire-and-forget Tasks handed to EventLoop::spawn. They
+// suspend on socket readiness (readable / writable), on timers (sleepFor),
+// on yield(), or on a Channel, and the loop resumes them from one thread:
+// resuming a coroutine is a function call, no thread switch, no lock.
+//
+// Sockets use edge-triggered epoll and the usual try-first pattern: do the
+// non-blocking recv/send, and only co_await readable/writable after
+// EAGAIN. Each fd is registered once, with at most one reader and one
+// writer waiting on it.
+
+class EventLoop;
+
+// Fire-and-forget coroutine. It starts suspended, runs once spawned, and
+// its frame frees itself when the body returns.
+struct Task {
+    struct promise_type {
+        EventLoop* loop = nullptr;
+
+        Task get_return_object() { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+        ~promise_type();
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+inline uint64_t loopNowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Pin the calling thread to one CPU. Returns false if that is not allowed.
+inline bool pinThisThread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+}
+
+class EventLoop {
+public:
+    EventLoop() : epollFd_(epoll_create1(EPOLL_CLOEXEC)) {}
+    ~EventLoop() {
+        if (epollFd_ >= 0) close(epollFd_);
+    }
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    bool ok() const { return epollFd_ >= 0; }
+
+    void spawn(Task task) {
+        task.handle.promise().loop = this;
+        live_++;
+        ready_.push_back(task.handle);
+    }
+
+    // Watch a non-blocking fd. Call once per fd before awaiting on it.
+    bool watch(int fd) {
+        FdWaiters& w = fds_[fd];
+        w = FdWaiters{};
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        return epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) == 0;
+    }
+
+    // Stop watching before closing the fd; a waiting coroutine is resumed so
+    // its next recv/send sees the error.
+    void unwatch(int fd) {
+        auto it = fds_.find(fd);
+        if (it == fds_.end()) return;
+        epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+        if (it->second.reader) ready_.push_back(it->second.reader);
+        if (it->second.writer) ready_.push_back(it->second.writer);
+        fds_.erase(it);
+    }
+
+    // Run until every spawned Task has finished or stop() is called.
+    void run() {
+        epoll_event events[64];
+        while (live_ > 0 && !stopping_) {
+            runReady();
+            if (live_ == 0 || stopping_) break;
+
+            // epoll_pwait2 takes a timespec, so sub-millisecond sleeps are
+            // not rounded up to a whole millisecond
+            timespec timeout{};
+            timespec* wait = nullptr;
+            if (!ready_.empty()) {
+                wait = &timeout;
+            } else if (!timers_.empty()) {
+                const uint64_t now = loopNowNs();
+                const uint64_t due = timers_.top().dueNs;
+                const uint64_t left = due <= now ? 0 : due - now;
+                timeout.tv_sec = (time_t)(left / 1000000000);
+                timeout.tv_nsec = (long)(left % 1000000000);
+                wait = &timeout;
+            }
+            const int n = epoll_pwait2(epollFd_, events, 64, wait, nullptr);
+            if (n < 0 && errno != EINTR) {
+                perror("epoll_pwait2");
+                break;
+            }
+            for (int i = 0; i < n; i++) {
+                auto it = fds_.find(events[i].data.fd);
+                if (it == fds_.end()) continue;
+                FdWaiters& w = it->second;
+                const uint32_t e = events[i].events;
+                if ((e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && w.reader) {
+                    ready_.push_back(std::exchange(w.reader, nullptr));
+                }
+                if ((e & (EPOLLOUT | EPOLLHUP | EPOLLERR)) && w.writer) {
+                    ready_.push_back(std::exchange(w.writer, nullptr));
+                }
+            }
+            fireTimers();
+        }
+    }
+
+    void stop() { stopping_ = true; }
+    int liveTasks() const { return live_; }
+
+    // Awaitables -----------------------------------------------------------
+
+    struct FdAwait {
+        EventLoop& loop;
+        int fd;
+        bool write;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            auto it = loop.fds_.find(fd);
+            if (it == loop.fds_.end()) {
+                loop.ready_.push_back(h);  // not watched: let the caller see the error
+                return;
+            }
+            (write ? it->second.writer : it->second.reader) = h;
+        }
+        void await_resume() const noexcept {}
+    };
+    FdAwait readable(int fd) { return FdAwait{*this, fd, false}; }
+    FdAwait writable(int fd) { return FdAwait{*this, fd, true}; }
+
+    struct SleepAwait {
+        EventLoop& loop;
+        uint64_t dueNs;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { loop.timers_.push(Timer{dueNs, loop.timerSeq_++, h}); }
+        void await_resume() const noexcept {}
+    };
+    template <class Rep, class Period>
+    SleepAwait sleepFor(std::chrono::duration<Rep, Period> d) {
+        return SleepAwait{*this, loopNowNs() + (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()};
+    }
+
+    // Let every other ready coroutine run once before this one continues.
+    struct YieldAwait {
+        EventLoop& loop;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { loop.ready_.push_back(h); }
+        void await_resume() const noexcept {}
+    };
+    YieldAwait yield() { return YieldAwait{*this}; }
+
+    // Queue a suspended coroutine to be resumed by the loop.
+    void schedule(std::coroutine_handle<> h) { ready_.push_back(h); }
+
+private:
+    friend struct Task::promise_type;
+
+    struct FdWaiters {
+        std::coroutine_handle<> reader;
+        std::coroutine_handle<> writer;
+    };
+    struct Timer {
+        uint64_t dueNs;
+        uint64_t seq;  // FIFO among equal deadlines
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer& o) const { return dueNs != o.dueNs ? dueNs > o.dueNs : seq > o.seq; }
+    };
+
+    int epollFd_;
+    int live_ = 0;
+    bool stopping_ = false;
+    uint64_t timerSeq_ = 0;
+    std::deque<std::coroutine_handle<>> ready_;
+    std::unordered_map<int, FdWaiters> fds_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+
+    void runReady() {
+        // up to a batch of resumes, then back to epoll, so coroutines that
+        // keep each other busy cannot starve I/O and timers
+        for (int n = 0; n < 1024 && !ready_.empty() && !stopping_; n++) {
+            std::coroutine_handle<> h = ready_.front();
+            ready_.pop_front();
+            h.resume();
+        }
+    }
+
+    void fireTimers() {
+        if (timers_.empty()) return;
+        const uint64_t now = loopNowNs();
+        while (!timers_.empty() && timers_.top().dueNs <= now) {
+            ready_.push_back(timers_.top().handle);
+            timers_.pop();
+        }
+    }
+};
+
+inline Task::promise_type::~promise_type() {
+    if (loop) loop->live_--;
+}
+
+// Single-consumer queue between coroutines on the same loop. push never
+// suspends; pop suspends while the channel is empty and returns nullopt once
+// it is closed and drained.
+template <class T>
+class Channel {
+public:
+    explicit Channel(EventLoop& loop) : loop_(loop) {}
+
+    void push(T value) {
+        items_.push_back(std::move(value));
+        wake();
+    }
+
+    void close() {
+        closed_ = true;
+        wake();
+    }
+
+    bool closed() const { return closed_; }
+    size_t size() const { return items_.size(); }
+
+    struct PopAwait {
+        Channel& ch;
+        bool await_ready() const noexcept { return !ch.items_.empty() || ch.closed_; }
+        void await_suspend(std::coroutine_handle<> h) { ch.waiter_ = h; }
+        std::optional<T> await_resume() {
+            if (ch.items_.empty()) return std::nullopt;
+            T v = std::move(ch.items_.front());
+            ch.items_.pop_front();
+            return v;
+        }
+    };
+    PopAwait pop() { return PopAwait{*this}; }
+
+private:
+    EventLoop& loop_;
+    std::deque<T> items_;
+    std::coroutine_handle<> waiter_;
+    bool closed_ = false;
+
+    void wake() {
+        if (waiter_) loop_.schedule(std::exchange(waiter_, nullptr));
+    }
+};
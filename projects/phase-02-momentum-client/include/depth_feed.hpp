@@ -0,0 +1,420 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// Level-2 depth feed: hft_server keeps a price-level book and publishes every
+// change to it; each client keeps a replica of the book.
+//
+//   D,seq,side,action,price,qty   one level change. side is B or A, action is
+//                                 N (new level), U (new quantity) or X (level
+//                                 gone, qty 0)
+//   S,seq,bids,asks,p:q,...       the whole book as of delta seq: `bids` bid
+//                                 levels best first, then `asks` ask levels
+//
+// Prices are integer ticks of DEPTH_TICK. Deltas are numbered 1, 2, 3, ...
+// The server sends a snapshot every so often. A client that joins late, or
+// sees a gap in the numbers, drops its book and waits for the next snapshot,
+// then applies the deltas after it. The lines are newline-terminated like
+// the ticks, so both share the connection and LineBuffer.
+//
+// DepthBook is the server's book: one std::map per side, as MarketSnapshot
+// keeps it in phase-03, because snapshots need the levels in order.
+// ReplicaBook is the client's: a ring of slots indexed by price modulo its
+// span. A delta is one slot write. The best price moves on an add in front
+// of it; only deleting the best level walks to the next one, which in a
+// dense book is the adjacent tick. The live book must span fewer ticks than
+// the ring; a level that would land on an occupied slot desyncs the replica
+// until the next snapshot.
+
+constexpr double DEPTH_TICK = 0.01;
+
+enum class DepthAction : char { New = 'N', Update = 'U', Delete = 'X' };
+
+struct DepthDelta {
+    uint64_t seq;
+    char side;           // 'B' or 'A'
+    DepthAction action;
+    int32_t price;       // ticks
+    int32_t qty;         // 0 for Delete
+};
+
+// "D,seq,side,action,price,qty\n". Returns the length written.
+inline int formatDelta(const DepthDelta& d, char* buf, size_t cap) {
+    return std::snprintf(buf, cap, "D,%llu,%c,%c,%d,%d\n", (unsigned long long)d.seq, d.side, (char)d.action,
+                         d.price, d.qty);
+}
+
+class DepthBook {
+public:
+    // Set a level's quantity, 0 removes it. Fills `out` with the delta and
+    // returns true, or returns false when nothing changed.
+    bool set(char side, int32_t price, int32_t qty, DepthDelta& out) {
+        return side == 'B' ? setLevel(bids_, side, price, qty, out) : setLevel(asks_, side, price, qty, out);
+    }
+
+    uint64_t seq() const { return seq_; }
+    const std::map<int32_t, int32_t, std::greater<>>& bids() const { return bids_; }
+    const std::map<int32_t, int32_t>& asks() const { return asks_; }
+
+    // The snapshot line for the current book, newline included.
+    void snapshotLine(std::string& out) const {
+        char buf[32];
+        out.clear();
+        std::snprintf(buf, sizeof buf, "S,%llu,%zu,%zu", (unsigned long long)seq_, bids_.size(), asks_.size());
+        out += buf;
+        for (const auto& [price, qty] : bids_) {
+            std::snprintf(buf, sizeof buf, ",%d:%d", price, qty);
+            out += buf;
+        }
+        for (const auto& [price, qty] : asks_) {
+            std::snprintf(buf, sizeof buf, ",%d:%d", price, qty);
+            out += buf;
+        }
+        out += '\n';
+    }
+
+private:
+    std::map<int32_t, int32_t, std::greater<>> bids_;  // best (highest) first
+    std::map<int32_t, int32_t> asks_;                  // best (lowest) first
+    uint64_t seq_ = 0;
+
+    template <class Levels>
+    bool setLevel(Levels& levels, char side, int32_t price, int32_t qty, DepthDelta& out) {
+        auto it = levels.find(price);
+        DepthAction action;
+        if (it == levels.end()) {
+            if (qty <= 0) return false;
+            levels.emplace(price, qty);
+            action = DepthAction::New;
+        } else if (qty <= 0) {
+            levels.erase(it);
+            action = DepthAction::Delete;
+            qty = 0;
+        } else {
+            if (it->second == qty) return false;
+            it->second = qty;
+            action = DepthAction::Update;
+        }
+        out = DepthDelta{++seq_, side, action, price, qty};
+        return true;
+    }
+};
+
+// Synthetic depth activity around a mid that random-walks a tick at a time.
+// Bids live in the `levels` ticks below the mid and asks in the `levels`
+// above it. Most changes are new quantities near the top, some levels go and
+// come back, and when the mid moves the levels that left the band go too.
+class DepthGenerator {
+public:
+    DepthGenerator(DepthBook& book, int levels, int32_t mid = 10000, uint64_t seed = 1)
+        : book_(book), levels_(std::max(1, levels)), mid_(mid), rng_(seed) {
+        DepthDelta d;
+        for (int k = 0; k < levels_; k++) {
+            book_.set('B', mid_ - 1 - k, randomQty(), d);
+            book_.set('A', mid_ + 1 + k, randomQty(), d);
+        }
+    }
+
+    // One market change; appends the deltas it caused (one, or a few when
+    // the mid moves).
+    void step(std::vector<DepthDelta>& out) {
+        DepthDelta d;
+        if (rng_() % 64 == 0) {
+            mid_ += rng_() % 2 ? 1 : -1;
+            trim(book_.bids(), 'B', mid_ - levels_, mid_ - 1, out);
+            trim(book_.asks(), 'A', mid_ + 1, mid_ + levels_, out);
+            return;
+        }
+        const char side = rng_() % 2 ? 'B' : 'A';
+        // geometric depth: half the changes hit the best level or the next
+        int k = 0;
+        while (k < levels_ - 1 && rng_() % 3 != 0) k++;
+        const int32_t price = side == 'B' ? mid_ - 1 - k : mid_ + 1 + k;
+        const bool present = side == 'B' ? book_.bids().count(price) : book_.asks().count(price);
+        const int32_t qty = present && rng_() % 4 == 0 ? 0 : randomQty();
+        if (book_.set(side, price, qty, d)) out.push_back(d);
+    }
+
+private:
+    DepthBook& book_;
+    int levels_;
+    int32_t mid_;
+    std::mt19937_64 rng_;
+
+    int32_t randomQty() { return 1 + (int32_t)(rng_() % 100); }
+
+    template <class Levels>
+    void trim(const Levels& levels, char side, int32_t lo, int32_t hi, std::vector<DepthDelta>& out) {
+        std::vector<int32_t> gone;
+        for (const auto& level : levels) {
+            if (level.first < lo || level.first > hi) gone.push_back(level.first);
+        }
+        DepthDelta d;
+        for (int32_t price : gone) {
+            if (book_.set(side, price, 0, d)) out.push_back(d);
+        }
+    }
+};
+
+// What a depth line did to a replica
+enum class ApplyResult {
+    Applied,       // a delta, applied
+    Snapshot,      // a snapshot, loaded
+    Stale,         // a delta or snapshot older than the book
+    Unsynced,      // a delta while waiting for a snapshot, ignored
+    Gap,           // a delta was missed; waiting for a snapshot
+    Inconsistent,  // a delta did not fit the book (or the ring); waiting for a snapshot
+    Malformed,     // not a depth line
+};
+
+struct ReplicaStats {
+    uint64_t deltas = 0;
+    uint64_t snapshots = 0;
+    uint64_t skipped = 0;     // stale or unsynced
+    uint64_t gaps = 0;
+    uint64_t inconsistent = 0;
+    uint64_t verified = 0;    // snapshots the replica already matched
+    uint64_t mismatches = 0;  // snapshots it did not, while in sync
+};
+
+class ReplicaBook {
+public:
+    // spanTicks is rounded up to a power of two.
+    explicit ReplicaBook(int spanTicks = 4096) {
+        size_t span = 1;
+        while (span < (size_t)std::max(2, spanTicks)) span <<= 1;
+        mask_ = (int32_t)(span - 1);
+        bids_.slots.assign(span, Slot{});
+        bids_.bid = true;
+        asks_.slots.assign(span, Slot{});
+    }
+
+    // A "D,..." or "S,..." line, without the newline.
+    ApplyResult onLine(const char* line, size_t len) {
+        if (len > 2 && line[0] == 'D' && line[1] == ',') {
+            DepthDelta d;
+            if (!parseDelta(line, len, d)) return ApplyResult::Malformed;
+            return apply(d);
+        }
+        if (len > 2 && line[0] == 'S' && line[1] == ',') return loadSnapshot(line, len);
+        return ApplyResult::Malformed;
+    }
+
+    ApplyResult apply(const DepthDelta& d) {
+        if (!synced_) {
+            stats_.skipped++;
+            return ApplyResult::Unsynced;
+        }
+        if (d.seq <= seq_) {
+            stats_.skipped++;
+            return ApplyResult::Stale;
+        }
+        if (d.seq != seq_ + 1) {
+            synced_ = false;
+            stats_.gaps++;
+            return ApplyResult::Gap;
+        }
+        if (!applyLevel(d.side == 'B' ? bids_ : asks_, d.action, d.price, d.qty)) {
+            synced_ = false;
+            stats_.inconsistent++;
+            return ApplyResult::Inconsistent;
+        }
+        seq_ = d.seq;
+        stats_.deltas++;
+        return ApplyResult::Applied;
+    }
+
+    // "S,seq,bids,asks,p:q,..." line. While in sync at the same seq, checks
+    // the replica against it first.
+    ApplyResult loadSnapshot(const char* line, size_t len) {
+        const char* p = line + 2;
+        const char* end = line + len;
+        uint64_t seq;
+        int64_t nb, na;
+        if (!parseUnsigned(p, end, seq) || !skip(p, end, ',') || !parseSigned(p, end, nb) || !skip(p, end, ',') ||
+            !parseSigned(p, end, na) || nb < 0 || na < 0) {
+            return ApplyResult::Malformed;
+        }
+        if (synced_ && seq < seq_) {
+            stats_.skipped++;
+            return ApplyResult::Stale;
+        }
+        const bool check = synced_ && seq == seq_;
+        bool matched = check && bids_.count == nb && asks_.count == na;
+
+        std::vector<Slot> levels((size_t)(nb + na));
+        for (Slot& s : levels) {
+            int64_t price, qty;
+            if (!skip(p, end, ',') || !parseSigned(p, end, price) || !skip(p, end, ':') ||
+                !parseSigned(p, end, qty) || qty <= 0) {
+                return ApplyResult::Malformed;
+            }
+            s = Slot{(int32_t)price, (int32_t)qty};
+        }
+        if (check) {
+            for (size_t i = 0; matched && i < levels.size(); i++) {
+                const Side& side = i < (size_t)nb ? bids_ : asks_;
+                const Slot& slot = side.slots[levels[i].price & mask_];
+                matched = slot.price == levels[i].price && slot.qty == levels[i].qty;
+            }
+            if (matched) stats_.verified++;
+            else stats_.mismatches++;
+        }
+
+        clear(bids_);
+        clear(asks_);
+        bool fits = true;
+        for (size_t i = 0; i < levels.size(); i++) {
+            fits = fits && applyLevel(i < (size_t)nb ? bids_ : asks_, DepthAction::New, levels[i].price,
+                                      levels[i].qty);
+        }
+        if (!fits) {
+            synced_ = false;
+            stats_.inconsistent++;
+            return ApplyResult::Inconsistent;
+        }
+        seq_ = seq;
+        synced_ = true;
+        stats_.snapshots++;
+        return ApplyResult::Snapshot;
+    }
+
+    bool synced() const { return synced_; }
+    uint64_t seq() const { return seq_; }
+    const ReplicaStats& stats() const { return stats_; }
+
+    int levels(char side) const { return (side == 'B' ? bids_ : asks_).count; }
+    // Best price in ticks, or 0 when the side is empty.
+    int32_t best(char side) const {
+        const Side& s = side == 'B' ? bids_ : asks_;
+        return s.count > 0 ? s.best : 0;
+    }
+    // Quantity at a price, 0 when there is no level.
+    int32_t quantity(char side, int32_t price) const {
+        const Slot& slot = (side == 'B' ? bids_ : asks_).slots[price & mask_];
+        return slot.price == price ? slot.qty : 0;
+    }
+
+    // Up to n levels of a side, best first, as (price, qty) pairs. Returns
+    // how many. Walks the ring from the best, so it costs the ticks crossed.
+    int topLevels(char side, int32_t* prices, int32_t* qtys, int n) const {
+        const Side& s = side == 'B' ? bids_ : asks_;
+        const int32_t step = s.bid ? -1 : 1;
+        int found = 0;
+        for (int32_t price = s.best, left = s.count; found < n && left > 0; price += step) {
+            const Slot& slot = s.slots[price & mask_];
+            if (slot.price != price || slot.qty == 0) continue;
+            prices[found] = price;
+            qtys[found] = slot.qty;
+            found++;
+            left--;
+        }
+        return found;
+    }
+
+    // "D,seq,side,action,price,qty" -> DepthDelta
+    static bool parseDelta(const char* line, size_t len, DepthDelta& d) {
+        const char* p = line + 2;
+        const char* end = line + len;
+        int64_t price, qty;
+        if (!parseUnsigned(p, end, d.seq) || !skip(p, end, ',') || end - p < 4) return false;
+        d.side = p[0];
+        const char action = p[2];
+        if ((d.side != 'B' && d.side != 'A') || p[1] != ',' || p[3] != ',') return false;
+        if (action != 'N' && action != 'U' && action != 'X') return false;
+        d.action = (DepthAction)action;
+        p += 4;
+        if (!parseSigned(p, end, price) || !skip(p, end, ',') || !parseSigned(p, end, qty) || p != end) return false;
+        d.price = (int32_t)price;
+        d.qty = (int32_t)qty;
+        return true;
+    }
+
+private:
+    struct Slot {
+        int32_t price = 0;
+        int32_t qty = 0;   // 0 = no level
+    };
+
+    struct Side {
+        std::vector<Slot> slots;
+        int32_t best = 0;
+        int count = 0;
+        bool bid = false;
+    };
+
+    Side bids_, asks_;
+    int32_t mask_;
+    uint64_t seq_ = 0;
+    bool synced_ = false;
+    ReplicaStats stats_;
+
+    bool applyLevel(Side& s, DepthAction action, int32_t price, int32_t qty) {
+        Slot& slot = s.slots[price & mask_];
+        const bool present = slot.qty > 0 && slot.price == price;
+        switch (action) {
+            case DepthAction::New:
+                // an occupied slot is the same level again or a level a whole
+                // ring away; either way the replica is off
+                if (slot.qty > 0 || qty <= 0) return false;
+                slot = Slot{price, qty};
+                if (s.count++ == 0 || (s.bid ? price > s.best : price < s.best)) s.best = price;
+                return true;
+            case DepthAction::Update:
+                if (!present || qty <= 0) return false;
+                slot.qty = qty;
+                return true;
+            case DepthAction::Delete:
+                if (!present) return false;
+                slot.qty = 0;
+                if (--s.count > 0 && price == s.best) {
+                    // the next level is within the ring, or the book did not fit
+                    const int32_t step = s.bid ? -1 : 1;
+                    int32_t p = price + step;
+                    for (int32_t n = 0; n <= mask_; n++, p += step) {
+                        const Slot& next = s.slots[p & mask_];
+                        if (next.price == p && next.qty > 0) break;
+                    }
+                    s.best = p;
+                }
+                return true;
+        }
+        return false;
+    }
+
+    void clear(Side& s) {
+        std::fill(s.slots.begin(), s.slots.end(), Slot{});
+        s.best = 0;
+        s.count = 0;
+    }
+
+    static bool skip(const char*& p, const char* end, char c) {
+        if (p == end || *p != c) return false;
+        p++;
+        return true;
+    }
+
+    static bool parseUnsigned(const char*& p, const char* end, uint64_t& out) {
+        const char* start = p;
+        uint64_t v = 0;
+        while (p != end && *p >= '0' && *p <= '9') v = v * 10 + (uint64_t)(*p++ - '0');
+        out = v;
+        return p != start;
+    }
+
+    static bool parseSigned(const char*& p, const char* end, int64_t& out) {
+        const bool negative = p != end && *p == '-';
+        if (negative) p++;
+        uint64_t v;
+        if (!parseUnsigned(p, end, v)) return false;
+        out = negative ? -(int64_t)v : (int64_t)v;
+        return true;
+    }
+};
@@ -0,0 +1,216 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Binary session journal: one fixed-size record per outbound tick, client
+// registration and inbound order, so a session can be replayed exactly.
+//
+// File layout: a 64-byte JournalHeader followed by JournalRecords, append
+// only. Timestamps are steady_clock nanoseconds; the header also holds the
+// wall-clock time the journal was opened and the price seed.
+//
+// Producers (the broadcast thread and every client thread) claim a slot in a
+// preallocated ring with one fetch_add, copy the record in and publish it.
+// A background thread writes runs of published records straight from the
+// ring with a single write() per batch, into file space reserved ahead in
+// large chunks. Nothing on the producer side allocates, locks or does I/O;
+// if the writer falls a whole ring behind, producers wait for it.
+
+enum class JournalType : uint16_t {
+    Tick = 1,   // price broadcast: priceId, price
+    Hello = 2,  // client registered: client, name (first 8 bytes)
+    Order = 3,  // order received: client, priceId, flags = OrderResult
+};
+
+enum class OrderResult : uint16_t {
+    Hit = 0,
+    AlreadyHit = 1,
+    UnknownPrice = 2,
+};
+
+struct JournalRecord {
+    uint64_t tsNs;     // steady_clock, ns
+    JournalType type;
+    uint16_t flags;
+    int32_t client;    // -1 for ticks
+    int32_t priceId;
+    float price;
+    char name[8];
+};
+static_assert(sizeof(JournalRecord) == 32, "journal record layout changed");
+
+struct JournalHeader {
+    char magic[8];        // "HFTJRNL1"
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t seed;
+    int64_t openedRealtimeNs;
+    uint64_t openedSteadyNs;
+    char reserved[24];
+};
+static_assert(sizeof(JournalHeader) == 64, "journal header layout changed");
+
+inline uint64_t journalNowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class JournalWriter {
+public:
+    // ringRecords must be a power of two.
+    JournalWriter(const std::string& path, uint64_t seed, size_t ringRecords = 1 << 16)
+        : ring_(ringRecords), seq_(new std::atomic<uint64_t>[ringRecords]), mask_(ringRecords - 1) {
+        for (size_t i = 0; i < ringRecords; i++) seq_[i].store(0, std::memory_order_relaxed);
+
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) {
+            perror("journal open");
+            return;
+        }
+        JournalHeader h{};
+        std::memcpy(h.magic, "HFTJRNL1", 8);
+        h.version = 1;
+        h.recordSize = sizeof(JournalRecord);
+        h.seed = seed;
+        h.openedRealtimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        h.openedSteadyNs = journalNowNs();
+        writeAll(&h, sizeof(h));
+        reserve();
+        writer_ = std::thread([this] { run(); });
+    }
+
+    ~JournalWriter() { close(); }
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    bool ok() const { return fd_ >= 0; }
+
+    void append(JournalType type, int client, int priceId, float price = 0.0f,
+                uint16_t flags = 0, const char* name = nullptr) noexcept {
+        if (fd_ < 0) return;
+        const uint64_t pos = head_.fetch_add(1, std::memory_order_relaxed);
+        while (pos - tail_.load(std::memory_order_acquire) >= ring_.size()) std::this_thread::yield();
+
+        JournalRecord& r = ring_[pos & mask_];
+        r.tsNs = journalNowNs();
+        r.type = type;
+        r.flags = flags;
+        r.client = client;
+        r.priceId = priceId;
+        r.price = price;
+        std::memset(r.name, 0, sizeof(r.name));
+        if (name) std::memcpy(r.name, name, strnlen(name, sizeof(r.name)));
+        seq_[pos & mask_].store(pos + 1, std::memory_order_release);
+    }
+
+    // Drain everything appended so far, trim the reserved tail and close.
+    void close() {
+        if (writer_.joinable()) {
+            stop_.store(true, std::memory_order_release);
+            writer_.join();
+        }
+        if (fd_ >= 0) {
+            if (ftruncate(fd_, (off_t)written_) != 0) perror("journal truncate");
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    uint64_t records() const { return tail_.load(std::memory_order_acquire); }
+    uint64_t bytesWritten() const { return written_; }
+
+private:
+    static constexpr size_t BATCH_RECORDS = 4096;     // 128 KB per write()
+    static constexpr uint64_t RESERVE_BYTES = 64u << 20;
+
+    std::vector<JournalRecord> ring_;
+    std::unique_ptr<std::atomic<uint64_t>[]> seq_;
+    size_t mask_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    std::atomic<bool> stop_{false};
+    std::thread writer_;
+    int fd_ = -1;
+    uint64_t written_ = 0;
+    uint64_t reserved_ = 0;
+
+    void run() {
+        while (true) {
+            const uint64_t tail = tail_.load(std::memory_order_relaxed);
+            // contiguous published run, not wrapping the end of the ring
+            size_t n = 0;
+            const size_t limit = std::min(BATCH_RECORDS, ring_.size() - (size_t)(tail & mask_));
+            while (n < limit && seq_[(tail + n) & mask_].load(std::memory_order_acquire) == tail + n + 1) n++;
+
+            if (n > 0) {
+                writeAll(&ring_[tail & mask_], n * sizeof(JournalRecord));
+                tail_.store(tail + n, std::memory_order_release);
+                continue;
+            }
+            if (stop_.load(std::memory_order_acquire) && head_.load(std::memory_order_acquire) == tail) break;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+
+    void writeAll(const void* data, size_t bytes) {
+        if (fd_ < 0) return;
+        if (written_ + bytes > reserved_) reserve();
+        const char* p = static_cast<const char*>(data);
+        while (bytes > 0) {
+            const ssize_t w = ::write(fd_, p, bytes);
+            if (w < 0) {
+                perror("journal write");
+                return;
+            }
+            p += w;
+            bytes -= (size_t)w;
+            written_ += (uint64_t)w;
+        }
+    }
+
+    // Reserve the next chunk of disk up front so appends don't allocate blocks.
+    void reserve() {
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+        // best effort: where the filesystem can't, plain appends still work
+        (void)fallocate(fd_, FALLOC_FL_KEEP_SIZE, (off_t)reserved_, (off_t)RESERVE_BYTES);
+#endif
+        reserved_ += RESERVE_BYTES;
+    }
+};
+
+// Whole journal in memory, for replay and inspection.
+struct JournalReader {
+    JournalHeader header{};
+    std::vector<JournalRecord> records;
+
+    bool load(const std::string& path) {
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) {
+            perror("journal open");
+            return false;
+        }
+        bool good = std::fread(&header, sizeof(header), 1, f) == 1 &&
+                    std::memcmp(header.magic, "HFTJRNL1", 8) == 0 &&
+                    header.recordSize == sizeof(JournalRecord);
+        if (good) {
+            JournalRecord r;
+            while (std::fread(&r, sizeof(r), 1, f) == 1) records.push_back(r);
+        } else {
+            std::fprintf(stderr, "%s: not a journal file\n", path.c_str());
+        }
+        std::fclose(f);
+        return good;
+    }
+};
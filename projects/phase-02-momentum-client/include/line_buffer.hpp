@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Splits a byte stream into lines, keeping a partial line for the next read.
+class LineBuffer {
+public:
+    // Append bytes and call f(line, len) for every complete line.
+    template <class F>
+    void feed(const char* data, size_t n, F&& f) {
+        size_t start = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (data[i] != '\n') continue;
+            if (partial_.empty()) {
+                f(data + start, i - start);
+            } else {
+                partial_.append(data + start, i - start);
+                f(partial_.data(), partial_.size());
+                partial_.clear();
+            }
+            start = i + 1;
+        }
+        if (start < n) partial_.append(data + start, n - start);
+    }
+
+private:
+    std::string partial_;
+};
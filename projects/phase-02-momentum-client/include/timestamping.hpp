@@ -0,0 +1,196 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <errno.h>
+#include <time.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+// Kernel software timestamps on TCP sockets (SO_TIMESTAMPING), for latency
+// numbers that include the time a message spends inside the kernel.
+//
+//   receive   the kernel stamps each segment as the network stack gets it.
+//             recvStamped() is recv() through recvmsg() and returns the
+//             stamp of the newest segment in what it read. Read time minus
+//             stamp is the time spent in the stack and the socket buffer.
+//   transmit  the kernel stamps a send() when it hands the data to the
+//             device and queues the stamp on the socket's error queue, keyed
+//             by the offset of the send's last byte. TxTimestamps matches
+//             those back to the sends it was told about.
+//
+// When SO_TIMESTAMPING is refused, SO_TIMESTAMPNS still gives receive
+// stamps. All stamps are CLOCK_REALTIME, so they are compared with
+// realtimeNs() and not with steady_clock.
+//
+// The error queue makes epoll report EPOLLERR; with the event loop's
+// edge-triggered registration that is one wake-up per stamp, so readers
+// drain it whenever they wake.
+
+enum class Timestamping { Off, RxOnly, RxTx };
+
+inline const char* timestampingName(Timestamping t) {
+    switch (t) {
+        case Timestamping::Off: return "off";
+        case Timestamping::RxOnly: return "receive only (SO_TIMESTAMPNS)";
+        case Timestamping::RxTx: return "receive and transmit (SO_TIMESTAMPING)";
+    }
+    return "?";
+}
+
+inline int64_t realtimeNs() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Turn on software receive and transmit stamps, or receive stamps alone.
+// Transmit IDs count bytes from here on, so call it before the first send.
+inline Timestamping enableTimestamping(int fd) {
+    const int flags = SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_TX_SOFTWARE |
+                      SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof flags) == 0) return Timestamping::RxTx;
+    const int one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof one) == 0) return Timestamping::RxOnly;
+    return Timestamping::Off;
+}
+
+// The software stamp in a message's control data, 0 if there is none.
+inline int64_t controlTimestamp(msghdr& msg) {
+    for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET) continue;
+        timespec ts{};
+        if (c->cmsg_type == SCM_TIMESTAMPING) {
+            scm_timestamping stamps;
+            std::memcpy(&stamps, CMSG_DATA(c), sizeof stamps);
+            ts = stamps.ts[0];  // [0] software, [2] hardware
+        } else if (c->cmsg_type == SCM_TIMESTAMPNS) {
+            std::memcpy(&ts, CMSG_DATA(c), sizeof ts);
+        } else {
+            continue;
+        }
+        if (ts.tv_sec || ts.tv_nsec) return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    }
+    return 0;
+}
+
+// recv() that also returns the kernel receive stamp of what it read (0 when
+// stamps are off).
+inline ssize_t recvStamped(int fd, char* buf, size_t n, int flags, int64_t& kernelNs) {
+    iovec iov{buf, n};
+    alignas(cmsghdr) char control[256];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+    const ssize_t got = recvmsg(fd, &msg, flags);
+    kernelNs = got > 0 ? controlTimestamp(msg) : 0;
+    return got;
+}
+
+// Read every transmit stamp waiting on fd's error queue; f(id, kernelNs) for
+// each. Returns how many there were.
+template <class F>
+int drainTxTimestamps(int fd, F&& f) {
+    int n = 0;
+    while (true) {
+        alignas(cmsghdr) char control[256];
+        msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) break;
+        const int64_t ns = controlTimestamp(msg);
+        for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+            const bool recvErr = (c->cmsg_level == SOL_IP && c->cmsg_type == IP_RECVERR) ||
+                                 (c->cmsg_level == SOL_IPV6 && c->cmsg_type == IPV6_RECVERR);
+            if (!recvErr) continue;
+            sock_extended_err err;
+            std::memcpy(&err, CMSG_DATA(c), sizeof err);
+            if (err.ee_errno == ENOMSG && err.ee_origin == SO_EE_ORIGIN_TIMESTAMPING && ns) {
+                f((uint64_t)err.ee_data, ns);
+                n++;
+            }
+        }
+    }
+    return n;
+}
+
+// Matches transmit stamps to sends. Call sent() after every successful
+// send() on the socket, tracked or not, so the byte count stays right.
+class TxTimestamps {
+public:
+    void sent(size_t bytes, int64_t startNs, bool track) {
+        bytes_ += bytes;
+        if (track) pending_.emplace_back((uint32_t)(bytes_ - 1), startNs);
+    }
+
+    // f(startNs, kernelNs) for every tracked send whose stamp has arrived.
+    template <class F>
+    void drain(int fd, F&& f) {
+        drainTxTimestamps(fd, [&](uint64_t id, int64_t ns) {
+            // older sends whose stamps never came are dropped
+            while (!pending_.empty() && (int32_t)(pending_.front().first - (uint32_t)id) < 0) pending_.pop_front();
+            if (!pending_.empty() && pending_.front().first == (uint32_t)id) {
+                f(pending_.front().second, ns);
+                pending_.pop_front();
+            }
+        });
+    }
+
+private:
+    uint64_t bytes_ = 0;
+    std::deque<std::pair<uint32_t, int64_t>> pending_;  // (id of the last byte, send start)
+};
+
+// Where a tick's time goes on the client, in ns:
+//   kernel    receive stamp to recv() returning: network stack and socket buffer
+//   parse     splitting and parsing the tick
+//   strategy  the momentum rule
+//   decision  receive stamp to the strategy's answer, all of the above plus
+//             any queueing between them
+//   send      the order's send() call
+//   tx        order send() start to the kernel's transmit stamp
+struct LatencyReport {
+    std::vector<int64_t> kernel, parse, strategy, decision, send, tx;
+
+    void merge(const LatencyReport& o) {
+        for (auto [to, from] : {std::pair{&kernel, &o.kernel}, std::pair{&parse, &o.parse},
+                                std::pair{&strategy, &o.strategy}, std::pair{&decision, &o.decision},
+                                std::pair{&send, &o.send}, std::pair{&tx, &o.tx}}) {
+            to->insert(to->end(), from->begin(), from->end());
+        }
+    }
+
+    void print(std::ostream& out) const {
+        char line[128];
+        std::snprintf(line, sizeof line, "%-10s %9s %10s %10s %10s\n", "stage", "count", "p50 us", "p99 us",
+                      "max us");
+        out << line;
+        const std::pair<const char*, const std::vector<int64_t>*> rows[] = {
+            {"kernel", &kernel}, {"parse", &parse}, {"strategy", &strategy},
+            {"decision", &decision}, {"send", &send}, {"tx", &tx}};
+        for (const auto& [name, values] : rows) {
+            if (values->empty()) {
+                std::snprintf(line, sizeof line, "%-10s %9d %10s %10s %10s\n", name, 0, "-", "-", "-");
+            } else {
+                std::vector<int64_t> v = *values;
+                std::sort(v.begin(), v.end());
+                auto at = [&](double q) {
+                    return (double)v[std::min(v.size() - 1, (size_t)(q * (double)v.size()))] / 1e3;
+                };
+                std::snprintf(line, sizeof line, "%-10s %9zu %10.2f %10.2f %10.2f\n", name, v.size(), at(0.5),
+                              at(0.99), (double)v.back() / 1e3);
+            }
+            out << line;
+        }
+    }
+};
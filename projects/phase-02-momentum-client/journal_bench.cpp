@@ -0,0 +1,160 @@
+// Cost of JournalWriter::append on the server's hot paths.
+//
+//   ./journal_bench [messages per sample] [threads,...] [journal file]
+//
+// Each case appends `messages` tick-sized records split across `threads`
+// producers while the background writer drains them to the file, the same
+// setup as the broadcast thread plus client threads in hft_server. The file
+// is read back afterwards to check that every record arrived, in per-thread
+// order.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_harness.hpp"
+#include "journal.hpp"
+
+using namespace std;
+
+// "1,2,4" -> {1, 2, 4}
+static vector<int> parseList(const char* s) {
+    vector<int> out;
+    while (*s) {
+        char* end = nullptr;
+        long v = strtol(s, &end, 10);
+        if (end == s) break;
+        if (v > 0) out.push_back((int)v);
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return out;
+}
+
+// Every record of thread t has client = t and priceId counting up from 0.
+static bool verify(const string& path, int threads, const vector<int>& appended) {
+    JournalReader reader;
+    if (!reader.load(path)) return false;
+    vector<int> next(threads, 0);
+    for (const auto& r : reader.records) {
+        if (r.client < 0 || r.client >= threads || r.priceId != next[r.client]) {
+            fprintf(stderr, "out of order record: client %d priceId %d\n", r.client, r.priceId);
+            return false;
+        }
+        next[r.client]++;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (next[t] != appended[t]) {
+            fprintf(stderr, "thread %d: %d records in file, %d appended\n", t, next[t], appended[t]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int messages = 100000;
+    vector<int> threadCounts = {1, 2, 4};
+    string path = "journal_bench.bin";
+    if (argc > 1) messages = max(1, atoi(argv[1]));
+    if (argc > 2) threadCounts = parseList(argv[2]);
+    if (argc > 3) path = argv[3];
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+    printf("# %d records of %zu bytes per sample, journal %s\n", messages, sizeof(JournalRecord), path.c_str());
+
+    int failures = 0;
+
+    auto report = [](const bench::CaseResult& r) {
+        bench::Runner::print_case(stdout, r);
+        printf("    %-22s %8.1f ns/message\n", (r.name + " [" + r.params_str() + "]").c_str(), r.ns_per_op());
+    };
+    // the clock read inside append, on its own
+    report(runner.run("steady_clock", {{"threads", "1"}}, messages, [&] {
+        uint64_t sum = 0;
+        for (int i = 0; i < messages; i++) sum += journalNowNs();
+        bench::do_not_optimize(sum);
+    }));
+
+    for (int threads : threadCounts) {
+        vector<int> appended(threads, 0);
+        double seconds = 0.0;
+        uint64_t bytes = 0;
+        {
+            JournalWriter journal(path, 0);
+            if (!journal.ok()) return 1;
+
+            atomic<int> go{0};
+            atomic<int> done{0};
+            atomic<bool> quit{false};
+            int round = 0;
+            vector<thread> pool;
+            for (int t = 0; t < threads; t++) {
+                pool.emplace_back([&, t] {
+                    int seen = 0;
+                    while (true) {
+                        while (go.load(memory_order_acquire) == seen && !quit.load(memory_order_acquire)) {
+                            this_thread::yield();
+                        }
+                        if (quit.load(memory_order_acquire)) return;
+                        seen++;
+                        const int share = messages / threads + (t < messages % threads ? 1 : 0);
+                        for (int i = 0; i < share; i++) {
+                            journal.append(JournalType::Tick, t, appended[t]++, 100.0f);
+                        }
+                        done.fetch_add(1, memory_order_acq_rel);
+                    }
+                });
+            }
+
+            const auto t0 = chrono::steady_clock::now();
+            report(runner.run("append", {{"threads", to_string(threads)}}, messages, [&](bench::Timing& tm) {
+                done.store(0, memory_order_relaxed);
+                tm.start();
+                go.store(++round, memory_order_release);
+                while (done.load(memory_order_acquire) < threads) this_thread::yield();
+                tm.stop();
+            }));
+
+            quit.store(true, memory_order_release);
+            for (auto& th : pool) th.join();
+            journal.close();
+            seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+            bytes = journal.bytesWritten();
+        }
+        printf("    writer: %.1f MB in %.2f s including drain (%.0f MB/s)\n",
+               bytes / 1e6, seconds, bytes / 1e6 / seconds);
+
+        if (!verify(path, threads, appended)) {
+            failures++;
+            fprintf(stderr, "journal check failed for %d thread(s)\n", threads);
+        }
+    }
+
+    // Distribution of single appends from one thread (clock cost included).
+    {
+        JournalWriter journal(path, 0);
+        vector<double> ns;
+        ns.reserve(messages);
+        for (int i = 0; i < messages; i++) {
+            const auto t0 = chrono::steady_clock::now();
+            journal.append(JournalType::Order, 0, i, 0.0f, (uint16_t)OrderResult::Hit);
+            const auto t1 = chrono::steady_clock::now();
+            ns.push_back(chrono::duration<double, nano>(t1 - t0).count());
+        }
+        journal.close();
+        sort(ns.begin(), ns.end());
+        const bench::Stats s = bench::Stats::from(ns);
+        printf("single append: p50 %.0f ns  p99 %.0f ns  p99.9 %.0f ns  max %.0f ns\n",
+               s.median, s.p99, bench::percentile_sorted(ns, 0.999), s.max);
+    }
+
+    remove(path.c_str());
+    runner.write_reports();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+#include "backtest.h"
+
+#include "feed_reader.h"
+#include "market_snapshot.h"
+#include "order_manager.h"
+#include "position_keeper.h"
+#include "risk_gateway.h"
+
+#include "market_data.hpp"    // session-04: Quote and its accessors
+#include "strategy_crtp.hpp"  // session-04: SignalStrategyCRTP
+
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Fills into the position keeper, as the driver's FillsToPositions does.
+class Fills : public OrderListener
+{
+public:
+    Fills(PositionKeeper& positions, int symbol) : positions_(positions), symbol_(symbol) {}
+
+    void on_order_event(const OrderEvent& ev) override
+    {
+        if (ev.last_fill_qty > 0) positions_.on_fill(symbol_, ev.side, ev.price, ev.last_fill_qty);
+    }
+
+private:
+    PositionKeeper& positions_;
+    int symbol_;
+};
+
+constexpr uint64_t TEXT_GAP_NS = 1000;
+constexpr int TEXT_DECIMALS = 4;
+
+} // namespace
+
+BacktestFeed::BacktestFeed(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    FeedHeader h;
+    if (fstat(fd, &st) == 0 && (std::size_t)st.st_size >= sizeof h && ::pread(fd, &h, sizeof h, 0) == sizeof h &&
+        std::memcmp(h.magic, FEED_MAGIC, sizeof h.magic) == 0 && h.record_size == sizeof(FeedRecord)) {
+        const std::size_t size = (std::size_t)st.st_size;
+        void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) return;
+        madvise(map, size, MADV_WILLNEED);
+        map_ = map;
+        map_bytes_ = size;
+        records_ = reinterpret_cast<const FeedRecord*>(static_cast<const char*>(map) + sizeof h);
+        count_ = (size - sizeof h) / sizeof(FeedRecord);
+        tick_ = std::pow(10.0, -(double)h.decimals);
+        return;
+    }
+    ::close(fd);
+
+    FeedReader in(path, TEXT_DECIMALS);
+    FeedEvent ev;
+    while (in.next(ev)) {
+        parsed_.push_back(FeedRecord{(uint32_t)TEXT_GAP_NS, ev.type, 0, ev.symbol, ev.price_ticks, ev.qty});
+    }
+    records_ = parsed_.data();
+    count_ = parsed_.size();
+    tick_ = in.tick();
+}
+
+BacktestFeed::~BacktestFeed()
+{
+    if (map_) munmap(map_, map_bytes_);
+}
+
+BacktestResult run_backtest(const BacktestFeed& feed, const BacktestParams& params)
+{
+    // one symbol, as in the driver
+    const int symbol = 0;
+    MarketSnapshot snapshot;
+    OrderManager om;
+    om.set_log(nullptr);
+    RiskGateway gateway(om);
+    gateway.set_limits(symbol, RiskLimits{});
+    PositionKeeper positions(MarkSource::Mid);
+    Fills fills(positions, symbol);
+    om.add_listener(&fills);
+    const SignalStrategyCRTP strategy(params.alpha1, params.alpha2);
+    const bool gated = params.alpha1 != 0.0 || params.alpha2 != 0.0 || params.min_signal > 0.0;
+
+    BacktestResult r;
+    const FeedRecord* rec = feed.records();
+    const double tick = feed.tick();
+    uint64_t clock_ns = 0;
+    for (std::size_t i = 0; i < feed.size(); i++) {
+        const FeedRecord& e = rec[i];
+        clock_ns += e.delta_ns;
+        switch (e.type) {
+        case FeedType::Bid:
+            snapshot.update_bid(e.price_ticks * tick, e.qty);
+            gateway.on_market(symbol, snapshot);
+            positions.on_market(symbol, snapshot);
+            break;
+        case FeedType::Ask:
+            snapshot.update_ask(e.price_ticks * tick, e.qty);
+            gateway.on_market(symbol, snapshot);
+            positions.on_market(symbol, snapshot);
+            break;
+        case FeedType::Execution:
+            if (e.qty > 0) gateway.handle_fill(e.price_ticks, e.qty);
+            break;
+        }
+
+        const PriceLevel* bid = snapshot.get_best_bid();
+        const PriceLevel* ask = snapshot.get_best_ask();
+        if (!bid || !ask || !(ask->price - bid->price < params.max_spread)) continue;
+        if (gated) {
+            const Quote q{bid->price, ask->price, (double)bid->quantity, (double)ask->quantity};
+            if (!(strategy.on_tick(q) >= params.min_signal)) continue;
+        }
+        r.signals++;
+        if (gateway.place_order(symbol, Side::Buy, bid->price, params.order_qty, clock_ns) >= 0) r.orders++;
+        else r.rejected++;
+    }
+
+    const PositionView& p = positions.position(symbol);
+    r.events = feed.size();
+    r.fills = p.fills;
+    r.filled_qty = p.traded_qty;
+    r.position = p.position;
+    r.avg_price = p.avg_price;
+    r.realized_pnl = p.realized_pnl;
+    r.unrealized_pnl = p.unrealized_pnl;
+    om.remove_listener(&fills);
+    return r;
+}
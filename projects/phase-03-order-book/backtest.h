@@ -0,0 +1,77 @@
+#ifndef BACKTEST_H
+#define BACKTEST_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "feed_format.h"
+
+// The driver's trading loop as a function of its parameters, for sweeping
+// them over one feed.
+//
+// The feed is mapped once and shared read-only. Each backtest owns its own
+// MarketSnapshot, OrderManager, RiskGateway and PositionKeeper, so any
+// number of them run side by side without sharing anything they write.
+//
+// The rule is the driver's should_trade, with its spread threshold as a
+// parameter, gated by session-04's SignalStrategyCRTP: after every event,
+// buy order_qty at the best bid if the spread is below max_spread and the
+// strategy's signal (alpha1 * (microprice - mid) + alpha2 * imbalance) is at
+// least min_signal. With the defaults (alphas 0, min_signal 0) that is the
+// driver's rule exactly.
+//
+// The risk throttle runs on feed time rather than the wall clock, so a
+// backtest gives the same result on any machine and thread count. Binary
+// feeds carry their time; a text feed's events are taken as 1 us apart.
+
+class BacktestFeed
+{
+public:
+    // A feed_gen binary feed is mapped and used in place; a text feed is
+    // parsed into records once, with prices in ticks of 10^-4.
+    explicit BacktestFeed(const std::string& path);
+    ~BacktestFeed();
+
+    BacktestFeed(const BacktestFeed&) = delete;
+    BacktestFeed& operator=(const BacktestFeed&) = delete;
+
+    bool ok() const { return records_ != nullptr; }
+    bool binary() const { return map_ != nullptr; }
+    const FeedRecord* records() const { return records_; }
+    std::size_t size() const { return count_; }
+    double tick() const { return tick_; }
+
+private:
+    void* map_ = nullptr;
+    std::size_t map_bytes_ = 0;
+    std::vector<FeedRecord> parsed_;  // text feeds
+    const FeedRecord* records_ = nullptr;
+    std::size_t count_ = 0;
+    double tick_ = 1.0;
+};
+
+struct BacktestParams {
+    double max_spread = 0.05;  // should_trade: trade while ask - bid is below this
+    double alpha1 = 0.0;       // SignalStrategyCRTP
+    double alpha2 = 0.0;
+    double min_signal = 0.0;
+    int order_qty = 10;
+};
+
+struct BacktestResult {
+    uint64_t events = 0;
+    uint64_t signals = 0;      // events after which the rule said buy
+    uint64_t orders = 0;       // accepted by the risk gateway
+    uint64_t rejected = 0;
+    uint64_t fills = 0;
+    int64_t filled_qty = 0;
+    int position = 0;
+    double avg_price = 0.0;
+    double realized_pnl = 0.0;
+    double unrealized_pnl = 0.0;
+};
+
+BacktestResult run_backtest(const BacktestFeed& feed, const BacktestParams& params);
+
+#endif //BACKTEST_H
@@ -0,0 +1,212 @@
+// Parameter sweep: runs the driver's trading rule for every point of a grid
+// of parameters over one feed, in parallel, and writes one CSV row per point.
+//
+//   ./backtest_sweep FEED [--threads N] [--out sweep.csv] [--scaling]
+//                    [--spread LIST] [--alpha1 LIST] [--alpha2 LIST] [--min-signal LIST] [--qty LIST]
+//
+// LIST is comma-separated; the grid is every combination. The feed is mapped
+// once; each backtest has its own book and order state (backtest.h). Points
+// are scheduled on a WorkStealingPool. Rows come out in grid order whatever
+// the thread count, with the worker that ran each and its time.
+//
+// --scaling runs the grid again on 1, 2, 4, ... threads up to --threads,
+// prints the wall time, speedup and efficiency (speedup / threads) of each,
+// and checks that every run gives the same results as one thread. A
+// mismatch makes the program exit with status 1.
+
+#include "backtest.h"
+#include "work_stealing.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: backtest_sweep FEED [--threads N] [--out FILE] [--scaling]\n"
+                 "                      [--spread LIST] [--alpha1 LIST] [--alpha2 LIST] [--min-signal LIST]\n"
+                 "                      [--qty LIST]\n"
+                 "  LIST is comma-separated, e.g. --spread 0.01,0.02,0.05; the grid is every combination\n"
+                 "  --threads N   worker threads (default: hardware threads)\n"
+                 "  --out FILE    results CSV (default sweep.csv)\n"
+                 "  --scaling     also run on 1, 2, 4, ... threads and report the scaling\n");
+}
+
+std::vector<double> parse_list(const char* s)
+{
+    std::vector<double> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) out.push_back(std::atof(item.c_str()));
+    }
+    return out;
+}
+
+double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Point {
+    BacktestParams params;
+    BacktestResult result;
+    int worker = -1;
+    double ms = 0.0;
+};
+
+struct Sweep {
+    double wall_ms = 0.0;
+    uint64_t steals = 0;
+};
+
+Sweep run_grid(const BacktestFeed& feed, std::vector<Point>& points, int threads)
+{
+    WorkStealingPool pool(threads);
+    const double t0 = now_ms();
+    pool.run(points.size(), [&](std::size_t i, int worker) {
+        const double start = now_ms();
+        points[i].result = run_backtest(feed, points[i].params);
+        points[i].ms = now_ms() - start;
+        points[i].worker = worker;
+    });
+    return Sweep{now_ms() - t0, pool.steals()};
+}
+
+bool same_result(const BacktestResult& a, const BacktestResult& b)
+{
+    return a.events == b.events && a.signals == b.signals && a.orders == b.orders && a.rejected == b.rejected &&
+           a.fills == b.fills && a.filled_qty == b.filled_qty && a.position == b.position &&
+           a.avg_price == b.avg_price && a.realized_pnl == b.realized_pnl && a.unrealized_pnl == b.unrealized_pnl;
+}
+
+bool write_csv(const std::string& path, const std::vector<Point>& points)
+{
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::fprintf(f, "max_spread,alpha1,alpha2,min_signal,order_qty,events,signals,orders,rejected,fills,filled_qty,"
+                    "position,avg_price,realized_pnl,unrealized_pnl,total_pnl,worker,ms\n");
+    for (const Point& p : points) {
+        const BacktestParams& a = p.params;
+        const BacktestResult& r = p.result;
+        std::fprintf(f, "%g,%g,%g,%g,%d,%llu,%llu,%llu,%llu,%llu,%lld,%d,%.6f,%.6f,%.6f,%.6f,%d,%.3f\n",
+                     a.max_spread, a.alpha1, a.alpha2, a.min_signal, a.order_qty, (unsigned long long)r.events,
+                     (unsigned long long)r.signals, (unsigned long long)r.orders, (unsigned long long)r.rejected,
+                     (unsigned long long)r.fills, (long long)r.filled_qty, r.position, r.avg_price, r.realized_pnl,
+                     r.unrealized_pnl, r.realized_pnl + r.unrealized_pnl, p.worker, p.ms);
+    }
+    return std::fclose(f) == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> positional;
+    std::string out = "sweep.csv";
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    bool scaling = false;
+    std::vector<double> spread = {0.01, 0.02, 0.05, 0.1}, alpha1 = {0.0, 1.0, 2.0}, alpha2 = {0.0, 0.5, 1.0};
+    std::vector<double> min_signal = {0.0}, qty = {10};
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a == "--scaling") {
+            scaling = true;
+            continue;
+        }
+        if (a.rfind("--", 0) != 0) {
+            positional.push_back(a);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage();
+            return 2;
+        }
+        const char* v = argv[++i];
+        if (a == "--threads") threads = std::max(1, std::atoi(v));
+        else if (a == "--out") out = v;
+        else if (a == "--spread") spread = parse_list(v);
+        else if (a == "--alpha1") alpha1 = parse_list(v);
+        else if (a == "--alpha2") alpha2 = parse_list(v);
+        else if (a == "--min-signal") min_signal = parse_list(v);
+        else if (a == "--qty") qty = parse_list(v);
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (positional.size() != 1) {
+        usage();
+        return 2;
+    }
+
+    const BacktestFeed feed(positional[0]);
+    if (!feed.ok()) {
+        std::fprintf(stderr, "backtest_sweep: cannot read %s\n", positional[0].c_str());
+        return 1;
+    }
+
+    std::vector<Point> grid;
+    for (double s : spread)
+        for (double a1 : alpha1)
+            for (double a2 : alpha2)
+                for (double m : min_signal)
+                    for (double q : qty) grid.push_back(Point{BacktestParams{s, a1, a2, m, (int)q}, {}, -1, 0.0});
+    if (grid.empty()) {
+        std::fprintf(stderr, "backtest_sweep: empty grid\n");
+        return 2;
+    }
+    std::printf("%zu parameter sets over %zu events (%s feed), %d threads (%u hardware)\n", grid.size(), feed.size(),
+                feed.binary() ? "binary, mapped" : "text, parsed", threads, std::thread::hardware_concurrency());
+
+    std::vector<Point> points = grid;
+    const Sweep sweep = run_grid(feed, points, threads);
+    double busy_ms = 0.0;
+    for (const Point& p : points) busy_ms += p.ms;
+    std::printf("done in %.1f ms wall, %.1f ms in backtests (%.1f ms each), %llu steals\n", sweep.wall_ms, busy_ms,
+                busy_ms / (double)points.size(), (unsigned long long)sweep.steals);
+
+    const Point* best = &points[0];
+    for (const Point& p : points) {
+        if (p.result.realized_pnl + p.result.unrealized_pnl > best->result.realized_pnl + best->result.unrealized_pnl) {
+            best = &p;
+        }
+    }
+    std::printf("best total PnL %.2f at spread %g, alpha1 %g, alpha2 %g, min signal %g, qty %d\n",
+                best->result.realized_pnl + best->result.unrealized_pnl, best->params.max_spread,
+                best->params.alpha1, best->params.alpha2, best->params.min_signal, best->params.order_qty);
+    if (!write_csv(out, points)) {
+        std::fprintf(stderr, "backtest_sweep: could not write %s\n", out.c_str());
+        return 1;
+    }
+    std::printf("wrote %s\n", out.c_str());
+    if (!scaling) return 0;
+
+    std::printf("\nthreads  wall ms   speedup  efficiency  steals  same results\n");
+    int failures = 0;
+    double base_ms = 0.0;
+    std::vector<Point> reference;
+    for (int t = 1;; t = std::min(threads, t * 2)) {
+        std::vector<Point> run = grid;
+        const Sweep s = run_grid(feed, run, t);
+        if (t == 1) {
+            base_ms = s.wall_ms;
+            reference = run;
+        }
+        bool same = true;
+        for (std::size_t i = 0; i < run.size(); i++) same = same && same_result(run[i].result, reference[i].result);
+        if (!same) ++failures;
+        const double speedup = base_ms / s.wall_ms;
+        std::printf("%7d  %8.1f  %7.2f  %9.0f%%  %6llu  %s\n", t, s.wall_ms, speedup, 100.0 * speedup / t,
+                    (unsigned long long)s.steals, same ? "yes" : "NO");
+        if (t == threads) break;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,278 @@
+// Streaming bars: checks, then the cost per event of building bars during
+// the replay versus a second pass over the stored events afterwards.
+//
+//   ./bar_bench [events]
+//
+// The checks run a hand-worked sequence through BarStage, then compare a
+// random four-symbol stream against a straightforward second pass that
+// groups the same events into bars. The bars read back from the columnar
+// file must equal the reference, and a truncated file must be refused.
+// Any failure makes the program exit with status 1.
+
+#include "bar_stage.h"
+
+#include "bench_harness.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+bench::Checks checks;
+
+bool near(double a, double b) { return std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(b)); }
+
+struct Tick {
+    uint64_t ts_ns;
+    int symbol;
+    bool trade;
+    int qty;
+    double a;  // bid, or the trade price
+    double b;  // ask
+};
+
+void feed(BarStage& stage, const Tick& t)
+{
+    if (t.trade) stage.on_trade(t.symbol, t.ts_ns, t.a, t.qty);
+    else stage.on_quote(t.symbol, t.ts_ns, t.a, t.b);
+}
+
+// Quotes around a random walk per symbol, one event in ten a trade, gaps of
+// 0-2 us.
+std::vector<Tick> make_ticks(std::size_t n, int symbols, uint64_t seed)
+{
+    std::vector<Tick> ticks;
+    ticks.reserve(n);
+    uint64_t s = seed;
+    auto next = [&s] {
+        s ^= s << 13;
+        s ^= s >> 7;
+        s ^= s << 17;
+        return s;
+    };
+    std::vector<long> mid(symbols, 10000);  // cents
+    uint64_t ts = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        const uint64_t r = next();
+        ts += r % 2000;
+        const int sym = (int)((r >> 16) % symbols);
+        if ((r >> 24) % 20 == 0) mid[sym] += (r >> 32) % 2 ? 1 : -1;
+        const int half = 1 + (int)((r >> 36) % 3);
+        if ((r >> 40) % 10 == 0) {
+            const double px = (mid[sym] + ((r >> 44) % 2 ? half : -half)) / 100.0;
+            ticks.push_back(Tick{ts, sym, true, 1 + (int)((r >> 48) % 50), px, 0.0});
+        } else {
+            ticks.push_back(Tick{ts, sym, false, 0, (mid[sym] - half) / 100.0, (mid[sym] + half) / 100.0});
+        }
+    }
+    return ticks;
+}
+
+// The second pass: bars as a post-processing script builds them, from all
+// the stored events at once.
+struct RefBar {
+    Bar bar;
+    double notional = 0.0;
+    double spread_sum = 0.0;
+    bool priced = false;
+};
+
+std::vector<Bar> reference_bars(const std::vector<Tick>& ticks, const BarConfig& c)
+{
+    std::map<std::tuple<int, int, uint64_t>, RefBar> bars;  // symbol, kind, sequence
+    std::map<int, double> last_mid;
+    std::map<int, uint64_t> volume_seq;
+    std::map<int, int64_t> volume_open;
+    for (const Tick& t : ticks) {
+        const uint64_t bucket = t.ts_ns / c.bar_ns;
+        const bool has_mid = last_mid.count(t.symbol) > 0;
+        RefBar* both[2] = {&bars[{t.symbol, 0, bucket}], &bars[{t.symbol, 1, volume_seq[t.symbol]}]};
+        for (int k = 0; k < 2; k++) {
+            RefBar& r = *both[k];
+            if (r.bar.quotes + r.bar.trades == 0) {
+                r.bar.symbol = (uint32_t)t.symbol;
+                r.bar.kind = (BarKind)k;
+                r.bar.start_ns = k == 0 ? bucket * c.bar_ns : t.ts_ns;
+                r.bar.end_ns = k == 0 ? (bucket + 1) * c.bar_ns : t.ts_ns;
+                r.priced = has_mid;
+                if (has_mid) r.bar.open = r.bar.high = r.bar.low = r.bar.close = last_mid[t.symbol];
+            }
+            if (k == 1) r.bar.end_ns = t.ts_ns;
+            if (t.trade) {
+                r.bar.trades++;
+                r.bar.volume += t.qty;
+                r.notional += t.a * t.qty;
+                continue;
+            }
+            const double mid = (t.a + t.b) * 0.5, spread = t.b - t.a;
+            if (!r.priced) {
+                r.bar.open = r.bar.high = r.bar.low = mid;
+                r.priced = true;
+            }
+            r.bar.high = std::max(r.bar.high, mid);
+            r.bar.low = std::min(r.bar.low, mid);
+            r.bar.close = mid;
+            r.bar.spread_min = r.bar.quotes ? std::min(r.bar.spread_min, spread) : spread;
+            r.bar.spread_max = r.bar.quotes ? std::max(r.bar.spread_max, spread) : spread;
+            r.spread_sum += spread;
+            r.bar.quotes++;
+        }
+        if (t.trade && (volume_open[t.symbol] += t.qty) >= c.bar_volume) {
+            volume_open[t.symbol] = 0;
+            volume_seq[t.symbol]++;
+        }
+        if (!t.trade) last_mid[t.symbol] = (t.a + t.b) * 0.5;
+    }
+
+    std::vector<Bar> out;
+    out.reserve(bars.size());
+    for (auto& [key, r] : bars) {
+        r.bar.vwap = r.bar.volume ? r.notional / (double)r.bar.volume : 0.0;
+        r.bar.spread_mean = r.bar.quotes ? r.spread_sum / (double)r.bar.quotes : 0.0;
+        out.push_back(r.bar);
+    }
+    return out;
+}
+
+bool same_bar(const Bar& x, const Bar& y)
+{
+    return x.symbol == y.symbol && x.kind == y.kind && x.start_ns == y.start_ns && x.end_ns == y.end_ns &&
+           x.quotes == y.quotes && x.trades == y.trades && x.volume == y.volume && x.open == y.open &&
+           x.high == y.high && x.low == y.low && x.close == y.close && near(x.vwap, y.vwap) &&
+           near(x.spread_mean, y.spread_mean) && x.spread_min == y.spread_min && x.spread_max == y.spread_max;
+}
+
+const char* FILE_A = "bar_bench_a.bars";
+const char* FILE_B = "bar_bench_b.bars";
+
+void run_checks()
+{
+    std::printf("bar checks\n");
+    {
+        // hand-worked: 100 ns time bars, 25-lot volume bars
+        const BarConfig c{100, 25};
+        BarStage stage(c, nullptr);
+        std::vector<Bar> bars;
+        {
+            BarWriter w(FILE_A, c, 1);
+            BarStage s(c, &w);
+            for (BarStage* st : {&stage, &s}) {
+                st->on_quote(0, 5, 99.0, 101.0);     // mid 100, spread 2
+                st->on_quote(0, 50, 101.5, 102.5);   // mid 102, spread 1
+                st->on_trade(0, 60, 101.0, 10);
+                st->on_trade(0, 60, 103.0, 30);      // volume bar reaches 40
+                st->on_quote(7, 70, 1.0, 3.0);       // another symbol
+                st->on_quote(0, 250, 96.0, 100.0);   // mid 98, spread 4: next interval
+                st->finish();
+            }
+        }
+        checks.expect("hand-worked bars read back", read_bars(FILE_A, bars) && bars.size() == 6);
+        if (bars.size() == 6) {
+            // in closing order: volume 0 at t=60, time 0 at t=250, then finish(): time 0, volume 0, time 7, volume 7
+            const Bar& v = bars[0];
+            checks.expect("volume bar closes on the trade that fills it",
+                          v.kind == BarKind::Volume && v.volume == 40 && v.trades == 2 && v.start_ns == 5 &&
+                              v.end_ns == 60);
+            const Bar& t = bars[1];
+            checks.expect("time bar [0,100): OHLC of the mid",
+                          t.kind == BarKind::Time && t.start_ns == 0 && t.end_ns == 100 && t.open == 100.0 &&
+                              t.high == 102.0 && t.low == 100.0 && t.close == 102.0);
+            checks.expect("time bar [0,100): VWAP and spreads",
+                          t.vwap == 102.5 && t.quotes == 2 && t.spread_mean == 1.5 && t.spread_min == 1.0 &&
+                              t.spread_max == 2.0);
+            const Bar& t2 = bars[2];
+            checks.expect("the next bar opens at the last mid",
+                          t2.start_ns == 200 && t2.open == 102.0 && t2.low == 98.0 && t2.close == 98.0 &&
+                              t2.trades == 0);
+        }
+        const BarTotals& tot = stage.totals(0);
+        checks.expect("session totals",
+                      tot.quotes == 3 && tot.trades == 2 && tot.volume == 40 && tot.vwap() == 102.5 &&
+                          tot.time_bars == 2 && tot.volume_bars == 2 && tot.spread_max == 4.0);
+        checks.expect("symbols do not mix", stage.totals(7).quotes == 1 && stage.totals(7).trades == 0);
+    }
+
+    // a random stream against the second pass
+    const BarConfig c{50000, 500};
+    const std::vector<Tick> ticks = make_ticks(300000, 4, 11);
+    uint64_t batches = 0;
+    {
+        BarWriter w(FILE_B, c, 64);
+        BarStage stage(c, &w);
+        for (const Tick& t : ticks) feed(stage, t);
+        stage.finish();
+        batches = w.batches();
+    }
+    std::vector<Bar> got;
+    BarConfig read_config;
+    const bool read = read_bars(FILE_B, got, &read_config);
+    std::vector<Bar> ref = reference_bars(ticks, c);
+    // same order as the reference: by symbol, kind, then time
+    std::sort(got.begin(), got.end(), [](const Bar& x, const Bar& y) {
+        return std::tie(x.symbol, x.kind, x.start_ns) < std::tie(y.symbol, y.kind, y.start_ns);
+    });
+    bool all = read && got.size() == ref.size();
+    for (std::size_t i = 0; all && i < got.size(); i++) all = same_bar(got[i], ref[i]);
+    checks.expect("streamed bars equal the second pass, read back from the file", all);
+    checks.expect("written in batches, config in the header",
+                  batches > 1 && read_config.bar_ns == c.bar_ns && read_config.bar_volume == c.bar_volume);
+
+    {
+        std::FILE* f = std::fopen(FILE_B, "r+b");
+        std::fseek(f, 0, SEEK_END);
+        const long size = std::ftell(f);
+        std::fclose(f);
+        std::vector<Bar> cut;
+        checks.expect("a truncated file is refused", truncate(FILE_B, size - 12) == 0 && !read_bars(FILE_B, cut));
+    }
+    std::printf("%s\n\n", checks.passed() ? "all bar checks passed" : "BAR CHECKS FAILED");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+
+    run_checks();
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+    const std::vector<Tick> ticks = make_ticks(n, 4, 5);
+    const BarConfig c{100000000, 1000};
+    const std::string events = std::to_string(n);
+
+    for (bool to_file : {false, true}) {
+        uint64_t bars = 0;
+        const auto& r = runner.run("stream", {{"events", events}, {"output", to_file ? "file" : "none"}}, (double)n,
+                                   [&](bench::Timing& t) {
+                                       BarWriter w(FILE_A, c);
+                                       BarStage stage(c, to_file ? &w : nullptr);
+                                       t.start();
+                                       for (const Tick& tick : ticks) feed(stage, tick);
+                                       stage.finish();
+                                       t.stop();
+                                       bars = stage.bars();
+                                   });
+        bench::Runner::print_case(stdout, r);
+        std::printf("    %llu bars, %.1f ns per event\n", (unsigned long long)bars, r.ns_per_op());
+    }
+
+    const auto& r = runner.run("second_pass", {{"events", events}}, (double)n, [&] {
+        bench::do_not_optimize(reference_bars(ticks, c).size());
+    });
+    bench::Runner::print_case(stdout, r);
+    std::printf("    %.1f ns per event, on events already stored\n", r.ns_per_op());
+
+    std::remove(FILE_A);
+    std::remove(FILE_B);
+    runner.write_reports();
+    return checks.passed() ? 0 : 1;
+}
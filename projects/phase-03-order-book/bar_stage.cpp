@@ -0,0 +1,246 @@
+#include "bar_stage.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+std::size_t pad8(std::size_t n) { return (n + 7) & ~(std::size_t)7; }
+
+template <class T>
+void write_column(std::ofstream& out, const std::vector<T>& column)
+{
+    static const char zeros[8] = {};
+    const std::size_t bytes = column.size() * sizeof(T);
+    out.write(reinterpret_cast<const char*>(column.data()), (std::streamsize)bytes);
+    out.write(zeros, (std::streamsize)(pad8(bytes) - bytes));
+}
+
+template <class T>
+bool read_column(std::ifstream& in, std::vector<T>& column, uint32_t rows)
+{
+    column.resize(rows);
+    const std::size_t bytes = rows * sizeof(T);
+    in.read(reinterpret_cast<char*>(column.data()), (std::streamsize)bytes);
+    in.ignore((std::streamsize)(pad8(bytes) - bytes));
+    return (bool)in;
+}
+
+} // namespace
+
+BarWriter::BarWriter(const std::string& path, const BarConfig& config, std::size_t batch_rows)
+    : out_(path, std::ios::binary | std::ios::trunc), batch_rows_(std::max<std::size_t>(1, batch_rows))
+{
+    BarFileHeader h{};
+    std::memcpy(h.magic, BAR_MAGIC, sizeof h.magic);
+    h.version = BAR_VERSION;
+    h.columns = BAR_COLUMNS;
+    h.bar_ns = config.bar_ns;
+    h.bar_volume = config.bar_volume;
+    out_.write(reinterpret_cast<const char*>(&h), sizeof h);
+
+    for (auto* c : {&start_ns_, &end_ns_, &quotes_, &trades_}) c->reserve(batch_rows_);
+    for (auto* c : {&open_, &high_, &low_, &close_, &vwap_, &spread_mean_, &spread_min_, &spread_max_}) {
+        c->reserve(batch_rows_);
+    }
+    symbol_.reserve(batch_rows_);
+    kind_.reserve(batch_rows_);
+    volume_.reserve(batch_rows_);
+}
+
+BarWriter::~BarWriter()
+{
+    flush();
+}
+
+void BarWriter::add(const Bar& bar)
+{
+    symbol_.push_back(bar.symbol);
+    kind_.push_back((uint8_t)bar.kind);
+    start_ns_.push_back(bar.start_ns);
+    end_ns_.push_back(bar.end_ns);
+    quotes_.push_back(bar.quotes);
+    trades_.push_back(bar.trades);
+    volume_.push_back(bar.volume);
+    open_.push_back(bar.open);
+    high_.push_back(bar.high);
+    low_.push_back(bar.low);
+    close_.push_back(bar.close);
+    vwap_.push_back(bar.vwap);
+    spread_mean_.push_back(bar.spread_mean);
+    spread_min_.push_back(bar.spread_min);
+    spread_max_.push_back(bar.spread_max);
+    rows_++;
+    if (symbol_.size() == batch_rows_) flush();
+}
+
+void BarWriter::flush()
+{
+    if (symbol_.empty()) return;
+    const BarBatchHeader b{(uint32_t)symbol_.size(), 0};
+    out_.write(reinterpret_cast<const char*>(&b), sizeof b);
+    write_column(out_, symbol_);
+    write_column(out_, kind_);
+    for (auto* c : {&start_ns_, &end_ns_, &quotes_, &trades_}) write_column(out_, *c);
+    write_column(out_, volume_);
+    for (auto* c : {&open_, &high_, &low_, &close_, &vwap_, &spread_mean_, &spread_min_, &spread_max_}) {
+        write_column(out_, *c);
+    }
+    out_.flush();
+    batches_++;
+
+    symbol_.clear();
+    kind_.clear();
+    for (auto* c : {&start_ns_, &end_ns_, &quotes_, &trades_}) c->clear();
+    volume_.clear();
+    for (auto* c : {&open_, &high_, &low_, &close_, &vwap_, &spread_mean_, &spread_min_, &spread_max_}) c->clear();
+}
+
+bool read_bars(const std::string& path, std::vector<Bar>& out, BarConfig* config)
+{
+    std::ifstream in(path, std::ios::binary);
+    BarFileHeader h;
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof h) || std::memcmp(h.magic, BAR_MAGIC, sizeof h.magic) != 0 ||
+        h.version != BAR_VERSION || h.columns != BAR_COLUMNS) {
+        return false;
+    }
+    if (config) *config = BarConfig{h.bar_ns, h.bar_volume};
+
+    std::vector<uint32_t> symbol;
+    std::vector<uint8_t> kind;
+    std::vector<uint64_t> u64[4];
+    std::vector<int64_t> volume;
+    std::vector<double> f64[8];
+    BarBatchHeader b;
+    while (in.read(reinterpret_cast<char*>(&b), sizeof b)) {
+        bool ok = read_column(in, symbol, b.rows) && read_column(in, kind, b.rows);
+        for (auto& c : u64) ok = ok && read_column(in, c, b.rows);
+        ok = ok && read_column(in, volume, b.rows);
+        for (auto& c : f64) ok = ok && read_column(in, c, b.rows);
+        if (!ok) return false;
+
+        for (uint32_t i = 0; i < b.rows; i++) {
+            out.push_back(Bar{symbol[i], (BarKind)kind[i], u64[0][i], u64[1][i], u64[2][i], u64[3][i], volume[i],
+                              f64[0][i], f64[1][i], f64[2][i], f64[3][i], f64[4][i], f64[5][i], f64[6][i],
+                              f64[7][i]});
+        }
+    }
+    // a clean end falls exactly on a batch boundary
+    return in.eof() && in.gcount() == 0;
+}
+
+BarStage::BarStage(const BarConfig& config, BarWriter* out) : config_(config), out_(out)
+{
+    config_.bar_ns = std::max<uint64_t>(1, config_.bar_ns);
+    config_.bar_volume = std::max<int64_t>(1, config_.bar_volume);
+}
+
+void BarStage::on_quote(int symbol, uint64_t ts_ns, double bid, double ask)
+{
+    if (symbol < 0 || symbol >= MAX_SYMBOLS) return;
+    SymbolState& s = symbols_[symbol];
+    const double mid = (bid + ask) * 0.5;
+    const double spread = ask - bid;
+    add_quote(time_bar(symbol, ts_ns), mid, spread);
+    add_quote(volume_bar(symbol, ts_ns), mid, spread);
+    s.has_mid = true;
+    s.last_mid = mid;
+
+    BarTotals& t = s.totals;
+    t.spread_min = t.quotes ? std::min(t.spread_min, spread) : spread;
+    t.spread_max = t.quotes ? std::max(t.spread_max, spread) : spread;
+    t.spread_sum += spread;
+    t.quotes++;
+}
+
+void BarStage::on_trade(int symbol, uint64_t ts_ns, double price, int qty)
+{
+    if (symbol < 0 || symbol >= MAX_SYMBOLS || qty <= 0) return;
+    OpenBar& v = volume_bar(symbol, ts_ns);
+    for (OpenBar* b : {&time_bar(symbol, ts_ns), &v}) {
+        b->bar.trades++;
+        b->bar.volume += qty;
+        b->notional += price * qty;
+    }
+    if (v.bar.volume >= config_.bar_volume) close(v, symbol);
+
+    BarTotals& t = symbols_[symbol].totals;
+    t.trades++;
+    t.volume += qty;
+    t.notional += price * qty;
+}
+
+void BarStage::finish()
+{
+    for (int s = 0; s < MAX_SYMBOLS; s++) {
+        if (symbols_[s].time.open) close(symbols_[s].time, s);
+        if (symbols_[s].volume.open) close(symbols_[s].volume, s);
+    }
+    if (out_) out_->flush();
+}
+
+const BarTotals& BarStage::totals(int symbol) const
+{
+    static const BarTotals none;
+    return (symbol >= 0 && symbol < MAX_SYMBOLS) ? symbols_[symbol].totals : none;
+}
+
+BarStage::OpenBar& BarStage::time_bar(int symbol, uint64_t ts_ns)
+{
+    OpenBar& b = symbols_[symbol].time;
+    if (b.open && ts_ns >= b.bar.end_ns) close(b, symbol);
+    if (!b.open) {
+        start(b, symbol, BarKind::Time, ts_ns - ts_ns % config_.bar_ns);
+        b.bar.end_ns = b.bar.start_ns + config_.bar_ns;
+    }
+    return b;
+}
+
+BarStage::OpenBar& BarStage::volume_bar(int symbol, uint64_t ts_ns)
+{
+    OpenBar& b = symbols_[symbol].volume;
+    if (!b.open) start(b, symbol, BarKind::Volume, ts_ns);
+    b.bar.end_ns = ts_ns;
+    return b;
+}
+
+void BarStage::start(OpenBar& b, int symbol, BarKind kind, uint64_t start_ns)
+{
+    const SymbolState& s = symbols_[symbol];
+    b = OpenBar{};
+    b.open = true;
+    b.priced = s.has_mid;
+    b.bar.symbol = (uint32_t)symbol;
+    b.bar.kind = kind;
+    b.bar.start_ns = start_ns;
+    b.bar.open = b.bar.high = b.bar.low = b.bar.close = s.last_mid;
+}
+
+void BarStage::add_quote(OpenBar& b, double mid, double spread)
+{
+    Bar& bar = b.bar;
+    if (!b.priced) {
+        bar.open = bar.high = bar.low = mid;
+        b.priced = true;
+    }
+    bar.high = std::max(bar.high, mid);
+    bar.low = std::min(bar.low, mid);
+    bar.close = mid;
+
+    bar.spread_min = bar.quotes ? std::min(bar.spread_min, spread) : spread;
+    bar.spread_max = bar.quotes ? std::max(bar.spread_max, spread) : spread;
+    b.spread_sum += spread;
+    bar.quotes++;
+}
+
+void BarStage::close(OpenBar& b, int symbol)
+{
+    Bar& bar = b.bar;
+    bar.vwap = bar.volume ? b.notional / (double)bar.volume : 0.0;
+    bar.spread_mean = bar.quotes ? b.spread_sum / (double)bar.quotes : 0.0;
+    BarTotals& t = symbols_[symbol].totals;
+    (bar.kind == BarKind::Time ? t.time_bars : t.volume_bars)++;
+    bars_++;
+    if (out_) out_->add(bar);
+    b.open = false;
+}
@@ -0,0 +1,171 @@
+#ifndef BAR_STAGE_H
+#define BAR_STAGE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Streaming bars: OHLC, VWAP, spread statistics and trade counts, built
+// while the driver replays the feed instead of in a second pass over it.
+//
+// Two kinds of bar run side by side for every symbol:
+//
+//   time bars    aligned intervals of bar_ns feed time; a bar closes at the
+//                first event past its end (intervals with no events have no
+//                bar)
+//   volume bars  close on the trade that brings their volume to bar_volume
+//
+// Each bar has the mid's open/high/low/close, the mean/min/max spread over
+// its quote updates, and its trades, volume and VWAP. A bar opens at the
+// last mid seen, so a bar without quotes still has prices. Per symbol the
+// stage keeps the two open bars and the running totals in fixed arrays;
+// nothing grows with the feed. Closed bars go to a BarWriter.
+
+enum class BarKind : uint8_t { Time, Volume };
+
+struct Bar {
+    uint32_t symbol = 0;
+    BarKind kind = BarKind::Time;
+    uint64_t start_ns = 0;      // time bars: the interval; volume bars: first and last event
+    uint64_t end_ns = 0;
+    uint64_t quotes = 0;
+    uint64_t trades = 0;
+    int64_t volume = 0;
+    double open = 0.0;          // mid
+    double high = 0.0;
+    double low = 0.0;
+    double close = 0.0;
+    double vwap = 0.0;          // 0 without trades
+    double spread_mean = 0.0;   // per quote update, 0 without quotes
+    double spread_min = 0.0;
+    double spread_max = 0.0;
+};
+
+struct BarConfig {
+    uint64_t bar_ns = 100000000;  // 100 ms
+    int64_t bar_volume = 1000;
+};
+
+// The whole session so far, per symbol.
+struct BarTotals {
+    uint64_t quotes = 0;
+    uint64_t trades = 0;
+    int64_t volume = 0;
+    double notional = 0.0;
+    double spread_sum = 0.0;
+    double spread_min = 0.0;
+    double spread_max = 0.0;
+    uint64_t time_bars = 0;
+    uint64_t volume_bars = 0;
+
+    double vwap() const { return volume ? notional / (double)volume : 0.0; }
+    double spread_mean() const { return quotes ? spread_sum / (double)quotes : 0.0; }
+};
+
+// Bar file: a 64-byte BarFileHeader, then batches. A batch is a
+// BarBatchHeader and one array per column, in the order of the Bar fields
+// (kind as one byte), each array padded to 8 bytes. A reader takes only
+// the columns it needs by skipping the others' arrays.
+constexpr char BAR_MAGIC[8] = {'H', 'F', 'T', 'B', 'A', 'R', 'S', '1'};
+constexpr uint32_t BAR_VERSION = 1;
+constexpr uint32_t BAR_COLUMNS = 15;
+
+struct BarFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t columns;
+    uint64_t bar_ns;
+    int64_t bar_volume;
+    uint8_t reserved[32];
+};
+static_assert(sizeof(BarFileHeader) == 64, "BarFileHeader must stay 64 bytes");
+
+struct BarBatchHeader {
+    uint32_t rows;
+    uint32_t reserved;
+};
+
+class BarWriter
+{
+public:
+    BarWriter(const std::string& path, const BarConfig& config, std::size_t batch_rows = 4096);
+    // Writes the last, partial batch.
+    ~BarWriter();
+
+    BarWriter(const BarWriter&) = delete;
+    BarWriter& operator=(const BarWriter&) = delete;
+
+    bool ok() const { return out_.good(); }
+    void add(const Bar& bar);
+    void flush();
+
+    uint64_t rows() const { return rows_; }
+    uint64_t batches() const { return batches_; }
+
+private:
+    std::ofstream out_;
+    std::size_t batch_rows_;
+    uint64_t rows_ = 0;
+    uint64_t batches_ = 0;
+
+    // the batch being filled, one vector per column
+    std::vector<uint32_t> symbol_;
+    std::vector<uint8_t> kind_;
+    std::vector<uint64_t> start_ns_, end_ns_, quotes_, trades_;
+    std::vector<int64_t> volume_;
+    std::vector<double> open_, high_, low_, close_, vwap_, spread_mean_, spread_min_, spread_max_;
+};
+
+// Every bar in a bar file, in the order written. Returns false if the file
+// is missing, truncated or not a bar file.
+bool read_bars(const std::string& path, std::vector<Bar>& out, BarConfig* config = nullptr);
+
+class BarStage
+{
+public:
+    static constexpr int MAX_SYMBOLS = 64;
+
+    // out may be null, for totals only. It must outlive the stage.
+    BarStage(const BarConfig& config, BarWriter* out);
+
+    // Feed time must not go backwards. Symbols outside [0, MAX_SYMBOLS)
+    // are ignored.
+    void on_quote(int symbol, uint64_t ts_ns, double bid, double ask);
+    void on_trade(int symbol, uint64_t ts_ns, double price, int qty);
+    // Close every open bar, at the end of the feed.
+    void finish();
+
+    const BarTotals& totals(int symbol) const;
+    uint64_t bars() const { return bars_; }
+
+private:
+    struct OpenBar {
+        Bar bar;
+        bool open = false;
+        bool priced = false;  // has a mid: opened after the first quote, or had one since
+        double notional = 0.0;
+        double spread_sum = 0.0;
+    };
+
+    struct SymbolState {
+        OpenBar time;
+        OpenBar volume;
+        bool has_mid = false;
+        double last_mid = 0.0;
+        BarTotals totals;
+    };
+
+    BarConfig config_;
+    BarWriter* out_;
+    uint64_t bars_ = 0;
+    SymbolState symbols_[MAX_SYMBOLS];
+
+    OpenBar& time_bar(int symbol, uint64_t ts_ns);
+    OpenBar& volume_bar(int symbol, uint64_t ts_ns);
+    void start(OpenBar& b, int symbol, BarKind kind, uint64_t start_ns);
+    void add_quote(OpenBar& b, double mid, double spread);
+    void close(OpenBar& b, int symbol);
+};
+
+#endif //BAR_STAGE_H
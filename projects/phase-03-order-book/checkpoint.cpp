@@ -0,0 +1,447 @@
+#include "checkpoint.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+struct LevelRecord {
+    double price;
+    int32_t quantity;
+    int32_t reserved;
+};
+
+struct OrderRecord {
+    int32_t id;
+    int32_t quantity;
+    int32_t filled;
+    uint8_t side;
+    uint8_t status;
+    uint8_t reserved[2];
+    double price;
+};
+
+// RiskGateway::OrderRef, without its padding
+struct RefRecord {
+    int32_t symbol;
+    int32_t remaining;
+    uint8_t side;
+    uint8_t reserved[7];
+    double price;
+};
+
+uint64_t steady_ns()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::size_t pad8(std::size_t n) { return (n + 7) & ~(std::size_t)7; }
+
+template <class T>
+void append(std::vector<char>& out, const T* items, std::size_t n)
+{
+    const std::size_t at = out.size();
+    out.resize(at + pad8(n * sizeof(T)), 0);
+    if (n) std::memcpy(out.data() + at, items, n * sizeof(T));
+}
+
+} // namespace
+
+// Friend of the four classes: the only code that sees their internals.
+struct CheckpointAccess {
+    using SymbolRisk = RiskGateway::SymbolRisk;
+    using OrderRef = RiskGateway::OrderRef;
+
+    static std::size_t risk_symbols_bytes() { return pad8(sizeof(SymbolRisk) * RiskGateway::MAX_SYMBOLS); }
+    static std::size_t positions_bytes()
+    {
+        return pad8(sizeof(PositionView) * PositionKeeper::MAX_SYMBOLS) + pad8(sizeof(PortfolioView));
+    }
+
+    static void capture(std::vector<char>& image, std::vector<ClosedOrder>& archive,
+                        const MarketSnapshot& snapshot, const OrderManager& om, const RiskGateway& gateway,
+                        const PositionKeeper& positions, uint64_t feed_offset, uint64_t events, uint64_t now_ns)
+    {
+        CheckpointHeader h{};
+        std::memcpy(h.magic, CHECKPOINT_MAGIC, sizeof h.magic);
+        h.version = CHECKPOINT_VERSION;
+        h.header_size = sizeof(CheckpointHeader);
+        h.feed_offset = feed_offset;
+        h.events = events;
+
+        image.clear();
+        image.resize(sizeof h);
+
+        std::vector<LevelRecord> levels;
+        levels.reserve(std::max(snapshot.bids.size(), snapshot.asks.size()));
+        for (const auto& [price, level] : snapshot.bids) levels.push_back(LevelRecord{price, level->quantity, 0});
+        append(image, levels.data(), levels.size());
+        h.bid_levels = (uint32_t)levels.size();
+        levels.clear();
+        for (const auto& [price, level] : snapshot.asks) levels.push_back(LevelRecord{price, level->quantity, 0});
+        append(image, levels.data(), levels.size());
+        h.ask_levels = (uint32_t)levels.size();
+
+        // placement order, so the restored active list walks the same way
+        std::vector<OrderRecord> active;
+        active.reserve(om.active_count());
+        for (const MyOrder* o = om.first_active(); o; o = o->next_active) {
+            active.push_back(OrderRecord{o->id, o->quantity, o->filled, (uint8_t)o->side, (uint8_t)o->status,
+                                         {0, 0}, o->price});
+        }
+        append(image, active.data(), active.size());
+        h.active_orders = (uint32_t)active.size();
+        h.next_order_id = om.next_id_;
+
+        // the gateway's refs of closed orders have nothing left to release,
+        // so only the active orders' refs are kept, in the same order
+        std::vector<RefRecord> refs;
+        refs.reserve(active.size());
+        for (const OrderRecord& r : active) {
+            const OrderRef& slot = gateway.orders_[r.id & (RiskGateway::MAX_OPEN_ORDERS - 1)];
+            const OrderRef ref = slot.id == r.id ? slot : OrderRef{};
+            refs.push_back(RefRecord{ref.symbol, ref.remaining, (uint8_t)ref.side, {}, ref.price});
+        }
+        append(image, gateway.symbols_, RiskGateway::MAX_SYMBOLS);
+        append(image, refs.data(), refs.size());
+        h.risk_symbols = RiskGateway::MAX_SYMBOLS;
+        h.risk_orders = (uint32_t)refs.size();
+        h.throttle_credit_ns = (int64_t)gateway.throttle_tat_ns_ - (int64_t)now_ns;
+        h.throttle_interval_ns = gateway.throttle_interval_ns_;
+        h.throttle_tolerance_ns = gateway.throttle_tolerance_ns_;
+
+        append(image, positions.symbols_, PositionKeeper::MAX_SYMBOLS);
+        append(image, &positions.total_, 1);
+        h.position_symbols = PositionKeeper::MAX_SYMBOLS;
+        h.mark_source = (uint32_t)positions.mark_source_;
+
+        // only what closed since this buffer's last capture is copied
+        const std::vector<ClosedOrder>& closed = om.archive();
+        if (archive.size() > closed.size()) archive.clear();
+        archive.insert(archive.end(), closed.begin() + (std::ptrdiff_t)archive.size(), closed.end());
+        h.archived_orders = archive.size();
+
+        h.payload_bytes = image.size() - sizeof h + archive.size() * sizeof(ClosedOrder);
+        std::memcpy(image.data(), &h, sizeof h);
+    }
+
+    static bool restore(const char* base, std::size_t size, MarketSnapshot& snapshot, OrderManager& om,
+                        RiskGateway& gateway, PositionKeeper& positions, uint64_t now_ns, CheckpointInfo* info)
+    {
+        if (size < sizeof(CheckpointHeader)) return false;
+        CheckpointHeader h;
+        std::memcpy(&h, base, sizeof h);
+        if (std::memcmp(h.magic, CHECKPOINT_MAGIC, sizeof h.magic) != 0 || h.version != CHECKPOINT_VERSION ||
+            h.header_size != sizeof h || h.payload_bytes != size - sizeof h) {
+            return false;
+        }
+        if (h.risk_symbols != RiskGateway::MAX_SYMBOLS || h.position_symbols != PositionKeeper::MAX_SYMBOLS ||
+            h.risk_orders != h.active_orders) {
+            return false;
+        }
+        const std::size_t expected = pad8(h.bid_levels * sizeof(LevelRecord)) +
+                                     pad8(h.ask_levels * sizeof(LevelRecord)) +
+                                     pad8(h.active_orders * sizeof(OrderRecord)) + risk_symbols_bytes() +
+                                     pad8(h.risk_orders * sizeof(RefRecord)) + positions_bytes() +
+                                     h.archived_orders * sizeof(ClosedOrder);
+        if (expected != h.payload_bytes) return false;
+        if (checkpoint_checksum(base + sizeof h, h.payload_bytes) != h.checksum) return false;
+
+        // the image is sound: from here on nothing can fail
+        const char* p = base + sizeof h;
+        auto take = [&p](std::size_t bytes) {
+            const char* at = p;
+            p += pad8(bytes);
+            return at;
+        };
+
+        const auto* bids = reinterpret_cast<const LevelRecord*>(take(h.bid_levels * sizeof(LevelRecord)));
+        const auto* asks = reinterpret_cast<const LevelRecord*>(take(h.ask_levels * sizeof(LevelRecord)));
+        snapshot.bids.clear();
+        snapshot.asks.clear();
+        // records are in map order, so every insert goes at the end
+        for (uint32_t i = 0; i < h.bid_levels; i++) {
+            snapshot.bids.emplace_hint(snapshot.bids.end(), bids[i].price,
+                                       std::make_unique<PriceLevel>(bids[i].price, bids[i].quantity));
+        }
+        for (uint32_t i = 0; i < h.ask_levels; i++) {
+            snapshot.asks.emplace_hint(snapshot.asks.end(), asks[i].price,
+                                       std::make_unique<PriceLevel>(asks[i].price, asks[i].quantity));
+        }
+
+        const char* active_at = take(h.active_orders * sizeof(OrderRecord));
+        om.orders.clear();
+        om.active_head_ = om.active_tail_ = nullptr;
+        for (uint32_t i = 0; i < h.active_orders; i++) {
+            OrderRecord r;
+            std::memcpy(&r, active_at + i * sizeof r, sizeof r);
+            auto it = om.orders.emplace(r.id, std::make_unique<MyOrder>(
+                MyOrder{r.id, (Side)r.side, r.price, r.quantity, r.filled, (OrderStatus)r.status})).first;
+            MyOrder* o = it->second.get();
+            o->prev_active = om.active_tail_;
+            if (om.active_tail_) om.active_tail_->next_active = o;
+            else om.active_head_ = o;
+            om.active_tail_ = o;
+        }
+        om.next_id_ = h.next_order_id;
+
+        std::memcpy(gateway.symbols_, take(risk_symbols_bytes()), sizeof(SymbolRisk) * RiskGateway::MAX_SYMBOLS);
+        const char* refs = take(h.risk_orders * sizeof(RefRecord));
+        gateway.orders_.assign(RiskGateway::MAX_OPEN_ORDERS, OrderRef{});
+        for (uint32_t i = 0; i < h.risk_orders; i++) {
+            OrderRecord r;
+            std::memcpy(&r, active_at + i * sizeof r, sizeof r);
+            if (r.id <= 0) continue;
+            RefRecord ref;
+            std::memcpy(&ref, refs + i * sizeof ref, sizeof ref);
+            // a ref with nothing left had already freed its slot
+            if (ref.symbol < 0 || ref.remaining <= 0) continue;
+            gateway.orders_[r.id & (RiskGateway::MAX_OPEN_ORDERS - 1)] =
+                OrderRef{r.id, ref.symbol, (Side)ref.side, ref.price, ref.remaining};
+        }
+        gateway.throttle_interval_ns_ = h.throttle_interval_ns;
+        gateway.throttle_tolerance_ns_ = h.throttle_tolerance_ns;
+        // the throttle clock is relative to the capture time, not to a
+        // steady clock that may have restarted since
+        const int64_t tat = (int64_t)now_ns + h.throttle_credit_ns;
+        gateway.throttle_tat_ns_ = tat > 0 ? (uint64_t)tat : 0;
+
+        std::memcpy(positions.symbols_, take(sizeof(PositionView) * PositionKeeper::MAX_SYMBOLS),
+                    sizeof(PositionView) * PositionKeeper::MAX_SYMBOLS);
+        std::memcpy(&positions.total_, take(sizeof(PortfolioView)), sizeof(PortfolioView));
+        positions.mark_source_ = (MarkSource)h.mark_source;
+        for (int s = 0; s < PositionKeeper::MAX_SYMBOLS; s++) positions.published_[s].store(positions.symbols_[s]);
+        positions.published_total_.store(positions.total_);
+
+        const auto* archive = reinterpret_cast<const ClosedOrder*>(p);
+        om.archive_.assign(archive, archive + h.archived_orders);
+
+        if (info) {
+            info->feed_offset = h.feed_offset;
+            info->events = h.events;
+            info->bytes = size;
+            info->active_orders = h.active_orders;
+            info->archived_orders = (std::size_t)h.archived_orders;
+        }
+        return true;
+    }
+};
+
+uint64_t checkpoint_checksum(const void* data, std::size_t bytes, uint64_t h)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (; bytes >= 8; p += 8, bytes -= 8) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        h = (h ^ w) * 0x9e3779b97f4a7c15ull;
+        h ^= h >> 31;
+    }
+    if (bytes) {
+        uint64_t w = 0;
+        std::memcpy(&w, p, bytes);
+        h = (h ^ w) * 0x9e3779b97f4a7c15ull;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+CheckpointWriter::CheckpointWriter(std::string path) : path_(std::move(path))
+{
+    thread_ = std::thread([this] { run(); });
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+bool CheckpointWriter::capture(const MarketSnapshot& snapshot, const OrderManager& om, const RiskGateway& gateway,
+                               const PositionKeeper& positions, uint64_t feed_offset, uint64_t events,
+                               uint64_t now_ns)
+{
+    const uint64_t t0 = steady_ns();
+    Buffer* b = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // a Free buffer, else one whose snapshot was not picked up yet
+        for (Buffer& c : buffers_) {
+            if (c.state == BufferState::Free) b = &c;
+        }
+        if (!b) {
+            for (Buffer& c : buffers_) {
+                if (c.state == BufferState::Ready) b = &c;
+            }
+        }
+        if (!b) {
+            skipped_++;
+            return false;
+        }
+        b->state = BufferState::Filling;
+    }
+
+    CheckpointAccess::capture(b->image, b->archive, snapshot, om, gateway, positions, feed_offset, events, now_ns);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // an older image still waiting would land on disk after this one
+        for (Buffer& c : buffers_) {
+            if (&c != b && c.state == BufferState::Ready) c.state = BufferState::Free;
+        }
+        b->state = BufferState::Ready;
+    }
+    // timed before the wake-up: on one core the writer may run right away
+    last_capture_ns_ = steady_ns() - t0;
+    cv_.notify_all();
+    return true;
+}
+
+void CheckpointWriter::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] {
+        for (const Buffer& b : buffers_) {
+            if (b.state != BufferState::Free) return false;
+        }
+        return true;
+    });
+}
+
+uint64_t CheckpointWriter::written() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return written_;
+}
+
+uint64_t CheckpointWriter::failed() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+}
+
+uint64_t CheckpointWriter::last_write_ns() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_write_ns_;
+}
+
+uint64_t CheckpointWriter::last_bytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_bytes_;
+}
+
+void CheckpointWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        Buffer* next = nullptr;
+        cv_.wait(lock, [&] {
+            next = nullptr;
+            for (Buffer& b : buffers_) {
+                if (b.state == BufferState::Ready) next = &b;
+            }
+            return next || stop_;
+        });
+        if (!next) return;  // stopping, nothing left to write
+
+        next->state = BufferState::Writing;
+        lock.unlock();
+        const uint64_t t0 = steady_ns();
+        const bool ok = write_image(*next);
+        const uint64_t took = steady_ns() - t0;
+        lock.lock();
+
+        if (ok) {
+            written_++;
+            last_write_ns_ = took;
+            last_bytes_ = next->image.size() + next->archive.size() * sizeof(ClosedOrder);
+        } else {
+            failed_++;
+        }
+        next->state = BufferState::Free;
+        cv_.notify_all();
+    }
+}
+
+bool CheckpointWriter::write_image(Buffer& b)
+{
+    CheckpointHeader h;
+    std::memcpy(&h, b.image.data(), sizeof h);
+    h.checksum = checkpoint_checksum(b.image.data() + sizeof h, b.image.size() - sizeof h);
+    h.checksum = checkpoint_checksum(b.archive.data(), b.archive.size() * sizeof(ClosedOrder), h.checksum);
+    std::memcpy(b.image.data(), &h, sizeof h);
+
+    const std::string tmp = path_ + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::perror("checkpoint open");
+        return false;
+    }
+
+    iovec parts[2] = {{b.image.data(), b.image.size()}, {b.archive.data(), b.archive.size() * sizeof(ClosedOrder)}};
+    std::size_t left = parts[0].iov_len + parts[1].iov_len;
+    int first = 0;
+    bool ok = true;
+    while (left > 0) {
+        const ssize_t w = ::writev(fd, parts + first, 2 - first);
+        if (w < 0) {
+            std::perror("checkpoint write");
+            ok = false;
+            break;
+        }
+        left -= (std::size_t)w;
+        // advance past what was written
+        std::size_t done = (std::size_t)w;
+        while (first < 2 && done >= parts[first].iov_len) done -= parts[first++].iov_len;
+        if (first < 2) {
+            parts[first].iov_base = static_cast<char*>(parts[first].iov_base) + done;
+            parts[first].iov_len -= done;
+        }
+    }
+    // on disk before it replaces the previous image
+    if (ok && ::fdatasync(fd) != 0) {
+        std::perror("checkpoint fdatasync");
+        ok = false;
+    }
+    ::close(fd);
+    if (ok && std::rename(tmp.c_str(), path_.c_str()) != 0) {
+        std::perror("checkpoint rename");
+        ok = false;
+    }
+    if (!ok) ::unlink(tmp.c_str());
+    return ok;
+}
+
+bool restore_checkpoint(const std::string& path, MarketSnapshot& snapshot, OrderManager& om,
+                        RiskGateway& gateway, PositionKeeper& positions, uint64_t now_ns, CheckpointInfo* info)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CheckpointHeader)) {
+        ::close(fd);
+        return false;
+    }
+    const std::size_t size = (std::size_t)st.st_size;
+    void* base = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) return false;
+
+    const bool ok = CheckpointAccess::restore(static_cast<const char*>(base), size, snapshot, om, gateway,
+                                              positions, now_ns, info);
+    ::munmap(base, size);
+    return ok;
+}
@@ -0,0 +1,139 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "market_snapshot.h"
+#include "order_manager.h"
+#include "position_keeper.h"
+#include "risk_gateway.h"
+
+// Checkpoint / restore of the driver's state, so a restart resumes the feed
+// from the last checkpoint instead of replaying it from the start.
+//
+// An image holds the book, the active orders and the archive, the risk
+// gateway and the position keeper, plus the feed offset of the next event.
+// It is a 128-byte header followed by flat sections of fixed-size records,
+// each 8-byte aligned, with the archive last:
+//
+//   bid levels | ask levels | active orders | risk symbols | risk order refs |
+//   positions + totals | archive
+//
+// The header carries a checksum of everything after it. Images are written
+// to FILE.tmp and renamed over FILE, so FILE is always a complete image.
+//
+// Taking a checkpoint (CheckpointWriter::capture) copies the state into one
+// of two buffers on the calling thread; a background thread writes it out.
+// The archive only grows, so each buffer keeps its copy and appends what
+// closed since its last capture. The caller never waits for the disk: if
+// the writer is still busy with one buffer, capture fills the other, and a
+// snapshot that was not picked up yet is replaced by the newer one.
+
+constexpr char CHECKPOINT_MAGIC[8] = {'H', 'F', 'T', 'C', 'K', 'P', 'T', '1'};
+constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t feed_offset;        // byte offset of the next event in the feed
+    uint64_t events;             // events processed before the checkpoint
+    uint64_t payload_bytes;      // everything after the header
+    uint64_t checksum;           // of the payload, see checkpoint_checksum
+    uint32_t bid_levels;
+    uint32_t ask_levels;
+    uint32_t active_orders;
+    uint32_t risk_symbols;       // RiskGateway::MAX_SYMBOLS when written
+    uint32_t risk_orders;        // one ref per active order
+    uint32_t position_symbols;   // PositionKeeper::MAX_SYMBOLS when written
+    uint64_t archived_orders;
+    int32_t next_order_id;
+    uint32_t mark_source;
+    int64_t throttle_credit_ns;  // throttle clock minus the capture time
+    uint64_t throttle_interval_ns;
+    uint64_t throttle_tolerance_ns;
+    uint8_t reserved[16];
+};
+static_assert(sizeof(CheckpointHeader) == 128, "CheckpointHeader must stay 128 bytes");
+
+struct CheckpointInfo {
+    uint64_t feed_offset = 0;
+    uint64_t events = 0;
+    uint64_t bytes = 0;
+    std::size_t active_orders = 0;
+    std::size_t archived_orders = 0;
+};
+
+// 64-bit multiply-xor hash over 8-byte words (a partial last word is
+// zero-padded). Pass the previous result as `h` to continue a hash over
+// several pieces, each a multiple of 8 bytes but the last.
+constexpr uint64_t CHECKPOINT_HASH_SEED = 0x243f6a8885a308d3ull;
+uint64_t checkpoint_checksum(const void* data, std::size_t bytes, uint64_t h = CHECKPOINT_HASH_SEED);
+
+class CheckpointWriter
+{
+public:
+    explicit CheckpointWriter(std::string path);
+    // Writes whatever is still queued, then stops the background thread.
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // Copy the state into a free buffer and queue it for writing. now_ns is
+    // the time base of the throttle. Returns false, and skips this
+    // checkpoint, only if both buffers are being written or copied.
+    bool capture(const MarketSnapshot& snapshot, const OrderManager& om, const RiskGateway& gateway,
+                 const PositionKeeper& positions, uint64_t feed_offset, uint64_t events, uint64_t now_ns);
+
+    // Block until every queued image is on disk.
+    void wait_idle();
+
+    uint64_t written() const;
+    uint64_t skipped() const { return skipped_; }
+    uint64_t failed() const;
+    uint64_t last_capture_ns() const { return last_capture_ns_; }
+    uint64_t last_write_ns() const;
+    uint64_t last_bytes() const;
+
+private:
+    enum class BufferState { Free, Filling, Ready, Writing };
+
+    struct Buffer {
+        BufferState state = BufferState::Free;
+        std::vector<char> image;             // header and every section but the archive
+        std::vector<ClosedOrder> archive;    // grows by what closed since this buffer's last capture
+    };
+
+    std::string path_;
+    Buffer buffers_[2];
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    uint64_t skipped_ = 0;
+    uint64_t written_ = 0;
+    uint64_t failed_ = 0;
+    uint64_t last_capture_ns_ = 0;
+    uint64_t last_write_ns_ = 0;
+    uint64_t last_bytes_ = 0;
+    std::thread thread_;
+
+    void run();
+    bool write_image(Buffer& b);
+};
+
+// Map the image at `path` and load it into the given objects, replacing
+// their state (listeners stay registered; no order events are emitted).
+// now_ns is the current time base of the throttle. Returns false, leaving
+// the objects untouched, if the file is missing, truncated, corrupt or was
+// written with different table sizes.
+bool restore_checkpoint(const std::string& path, MarketSnapshot& snapshot, OrderManager& om,
+                        RiskGateway& gateway, PositionKeeper& positions, uint64_t now_ns,
+                        CheckpointInfo* info = nullptr);
+
+#endif //CHECKPOINT_H
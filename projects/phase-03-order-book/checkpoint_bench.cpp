@@ -0,0 +1,312 @@
+// Checkpoint / restore: round-trip checks, then the cost of taking a
+// checkpoint, of restoring one, and of the replay a restore saves.
+//
+//   ./checkpoint_bench [events]
+//
+// A session is the driver's pipeline (book, risk gateway, order manager,
+// position keeper) fed a synthetic event stream with a fixed clock, so two
+// sessions given the same events end in the same state. The checks compare
+// states by their checkpoint images: restore an image into a fresh session,
+// checkpoint that, and the two files must be byte for byte the same, also
+// after both sessions have processed the rest of the stream. Corrupt,
+// truncated and foreign files must be refused without touching the target.
+// Any failure makes the program exit with status 1.
+
+#include "checkpoint.h"
+
+#include "bench_harness.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+bench::Checks checks;
+
+enum class Kind : uint8_t { Bid, Ask, Execution };
+
+struct Ev {
+    Kind kind;
+    int qty;
+    double price;  // order id offset for executions
+};
+
+// Levels around a random-walk mid, one execution in ten on a recent order.
+std::vector<Ev> make_events(std::size_t n, uint64_t seed)
+{
+    std::vector<Ev> evs;
+    evs.reserve(n);
+    uint64_t s = seed;
+    auto next = [&s] {
+        s ^= s << 13;
+        s ^= s >> 7;
+        s ^= s << 17;
+        return s;
+    };
+    long mid = 10000;  // in cents
+    for (std::size_t i = 0; i < n; ++i) {
+        const uint64_t r = next();
+        if (r % 50 == 0) mid += (r >> 8) % 2 ? 1 : -1;
+        const int qty = 1 + (int)((r >> 16) % 100);
+        const int depth = 1 + (int)((r >> 24) % 10);
+        switch ((r >> 32) % 10) {
+        case 0: evs.push_back(Ev{Kind::Execution, 1 + qty / 10, (double)((r >> 40) % 64)}); break;
+        case 1: case 2: case 3: case 4: evs.push_back(Ev{Kind::Bid, qty, (mid - depth) / 100.0}); break;
+        default: evs.push_back(Ev{Kind::Ask, qty, (mid + depth) / 100.0}); break;
+        }
+    }
+    return evs;
+}
+
+class Fills : public OrderListener
+{
+public:
+    explicit Fills(PositionKeeper& positions) : positions_(positions) {}
+    void on_order_event(const OrderEvent& ev) override
+    {
+        if (ev.last_fill_qty > 0) positions_.on_fill(0, ev.side, ev.price, ev.last_fill_qty);
+    }
+
+private:
+    PositionKeeper& positions_;
+};
+
+// The driver's loop with a clock of 1 us per event: an order every fourth
+// event, the oldest cancelled once more than four rest, plus replaces, so
+// the active list stays short and the archive grows, as in the driver.
+struct Session {
+    MarketSnapshot snapshot;
+    OrderManager om;
+    RiskGateway gateway{om, ThrottleLimits{1e6, 100}};
+    PositionKeeper positions;
+    Fills fills{positions};
+    int last_id = 0;
+
+    Session()
+    {
+        RiskLimits l;
+        l.max_order_qty = 1000;
+        l.max_order_notional = 1e9;
+        l.max_position = 1 << 30;
+        l.max_gross_notional = 1e15;
+        l.price_band = 0.05;
+        gateway.set_limits(0, l);
+        om.add_listener(&fills);
+    }
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    static uint64_t clock(uint64_t i) { return i * 1000; }
+
+    void apply(const Ev& e, uint64_t i)
+    {
+        switch (e.kind) {
+        case Kind::Bid:
+            snapshot.update_bid(e.price, e.qty);
+            gateway.on_market(0, snapshot);
+            positions.on_market(0, snapshot);
+            break;
+        case Kind::Ask:
+            snapshot.update_ask(e.price, e.qty);
+            gateway.on_market(0, snapshot);
+            positions.on_market(0, snapshot);
+            break;
+        case Kind::Execution:
+            if (last_id > 0) gateway.handle_fill(std::max(1, last_id - (int)e.price), e.qty);
+            break;
+        }
+
+        const PriceLevel* bid = snapshot.get_best_bid();
+        const PriceLevel* ask = snapshot.get_best_ask();
+        if (i % 4 == 0 && bid && ask && ask->price - bid->price < 0.05) {
+            const bool buy = i % 8 == 0;
+            const int id = gateway.place_order(0, buy ? Side::Buy : Side::Sell, buy ? bid->price : ask->price, 10,
+                                               clock(i));
+            if (id > 0) last_id = id;
+        }
+        if (i % 4 == 2 && om.active_count() > 4) gateway.cancel(om.first_active()->id);
+        if (i % 16 == 7 && om.first_active()) {
+            const MyOrder* o = om.first_active();
+            gateway.replace(o->id, o->price, o->quantity + 5, clock(i));
+        }
+    }
+
+    void run(const std::vector<Ev>& evs, std::size_t from, std::size_t to)
+    {
+        for (std::size_t i = from; i < to; ++i) apply(evs[i], i);
+    }
+
+    // Synchronous checkpoint, for the checks.
+    void save(const std::string& path, uint64_t events)
+    {
+        CheckpointWriter w(path);
+        w.capture(snapshot, om, gateway, positions, events * 16, events, clock(events));
+        w.wait_idle();
+    }
+};
+
+std::string slurp(const std::string& path)
+{
+    std::ifstream f(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+void spit(const std::string& path, const std::string& bytes)
+{
+    std::ofstream(path, std::ios::binary).write(bytes.data(), (std::streamsize)bytes.size());
+}
+
+const char* A = "checkpoint_bench_a.img";
+const char* B = "checkpoint_bench_b.img";
+const char* C = "checkpoint_bench_c.img";
+
+void run_checks()
+{
+    std::printf("checkpoint checks\n");
+    std::streambuf* out = std::cout.rdbuf(nullptr);  // OrderManager prints fills
+
+    const std::size_t N = 200000, K = 120000;
+    const std::vector<Ev> evs = make_events(N, 42);
+
+    Session a;
+    a.run(evs, 0, K);
+    a.save(A, K);
+
+    Session b;
+    CheckpointInfo info;
+    const bool restored = restore_checkpoint(A, b.snapshot, b.om, b.gateway, b.positions, Session::clock(K), &info);
+    checks.expect("restore of a fresh image", restored);
+    checks.expect("feed offset and event count come back", info.events == K && info.feed_offset == K * 16);
+    checks.expect("the session had active and closed orders", info.active_orders > 0 && info.archived_orders > 1000);
+    b.last_id = a.last_id;
+    b.save(B, K);
+    checks.expect("restored state checkpoints to the same bytes", slurp(A) == slurp(B));
+
+    a.run(evs, K, N);
+    b.run(evs, K, N);
+    a.save(A, N);
+    b.save(B, N);
+    checks.expect("same state after the rest of the stream", slurp(A) == slurp(B));
+    checks.expect("fills still reach the position keeper",
+                  b.positions.position(0).fills == a.positions.position(0).fills && b.positions.position(0).fills > 0);
+
+    // bad images leave the target alone
+    Session c;
+    c.run(evs, 0, 1000);
+    c.save(C, 1000);
+    const std::string before = slurp(C);
+    const std::string good = slurp(A);
+
+    std::string bad = good;
+    bad[bad.size() / 2] ^= 0x10;
+    spit(B, bad);
+    checks.expect("one flipped bit is refused", !restore_checkpoint(B, c.snapshot, c.om, c.gateway, c.positions, 0));
+    spit(B, good.substr(0, good.size() - 8));
+    checks.expect("a truncated image is refused", !restore_checkpoint(B, c.snapshot, c.om, c.gateway, c.positions, 0));
+    bad = good;
+    bad[0] = 'X';
+    spit(B, bad);
+    checks.expect("a foreign file is refused", !restore_checkpoint(B, c.snapshot, c.om, c.gateway, c.positions, 0));
+    checks.expect("a missing file is refused",
+                  !restore_checkpoint("no_such_checkpoint.img", c.snapshot, c.om, c.gateway, c.positions, 0));
+    c.save(C, 1000);
+    checks.expect("refused restores left the session unchanged", slurp(C) == before);
+
+    {
+        // back-to-back captures never block and the newest one wins
+        CheckpointWriter w(C);
+        bool all = true;
+        for (uint64_t e = 1; e <= 5; ++e) all &= w.capture(a.snapshot, a.om, a.gateway, a.positions, e, e, 0);
+        w.wait_idle();
+        checks.expect("five captures in a row are all taken", all && w.skipped() == 0);
+        Session d;
+        checks.expect("the last capture is the one on disk",
+                      restore_checkpoint(C, d.snapshot, d.om, d.gateway, d.positions, 0, &info) && info.events == 5);
+    }
+
+    std::cout.rdbuf(out);
+    std::printf("%s\n\n", checks.passed() ? "all checkpoint checks passed" : "CHECKPOINT CHECKS FAILED");
+}
+
+double ms_since(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::size_t N = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+
+    run_checks();
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+    auto report = [&](const bench::CaseResult& r) {
+        std::cout.rdbuf(out);
+        bench::Runner::print_case(stdout, r);
+        std::cout.rdbuf(nullptr);
+    };
+
+    const std::vector<Ev> evs = make_events(N, 7);
+    const std::string events = std::to_string(N);
+
+    // what a restart without a checkpoint has to redo (no parsing included)
+    double replay_ms = 0;
+    report(runner.run("replay", {{"events", events}}, (double)N, [&](bench::Timing& t) {
+        Session s;
+        t.start();
+        s.run(evs, 0, N);
+        t.stop();
+    }));
+    replay_ms = runner.results().back().stats.median / 1e6;
+
+    Session s;
+    s.run(evs, 0, N);
+    const std::size_t active = s.om.active_count(), closed = s.om.archive().size();
+
+    {
+        // the first capture copies the whole archive, later ones only the new part
+        CheckpointWriter w(A);
+        const auto t0 = std::chrono::steady_clock::now();
+        w.capture(s.snapshot, s.om, s.gateway, s.positions, N * 16, N, Session::clock(N));
+        const double first_ms = ms_since(t0);
+        w.wait_idle();
+
+        report(runner.run("capture", {{"events", events}, {"archive", "unchanged"}}, 1, [&](bench::Timing& t) {
+            t.start();
+            w.capture(s.snapshot, s.om, s.gateway, s.positions, N * 16, N, Session::clock(N));
+            t.stop();
+            w.wait_idle();
+        }));
+        std::cout.rdbuf(out);
+        std::printf("    state: %zu active orders, %zu closed, image %llu bytes\n", active, closed,
+                    (unsigned long long)w.last_bytes());
+        std::printf("    first capture (whole archive) %.3f ms; background write incl. fdatasync %.3f ms\n",
+                    first_ms, w.last_write_ns() / 1e6);
+        std::cout.rdbuf(nullptr);
+    }
+
+    Session r;
+    report(runner.run("restore", {{"events", events}}, 1, [&] {
+        if (!restore_checkpoint(A, r.snapshot, r.om, r.gateway, r.positions, Session::clock(N))) checks.fail();
+    }));
+    const double restore_ms = runner.results().back().stats.median / 1e6;
+
+    std::cout.rdbuf(out);
+    std::printf("\nrestart after %zu events: replay %.1f ms, restore %.3f ms (%.0fx)\n", N, replay_ms, restore_ms,
+                restore_ms > 0 ? replay_ms / restore_ms : 0.0);
+    std::remove(A);
+    std::remove(B);
+    std::remove(C);
+    runner.write_reports();
+    return checks.passed() ? 0 : 1;
+}
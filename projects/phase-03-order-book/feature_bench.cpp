@@ -0,0 +1,189 @@
+// Book features per second on a replayed feed: rebuilding the features from
+// the snapshot after every event (a Quote for the top, a walk of the best
+// levels for depth) versus FeatureEngine's incremental ones, each driving
+// session-04's CRTP strategies.
+//
+//   ./feature_bench [feed file]
+//
+// The feed is read into memory first (text or feed_gen binary, book updates
+// only), so the timings hold the book update, the features and the strategy,
+// not parsing. Every case starts from an empty book.
+//
+// Before timing, the engine is checked against the snapshot after every
+// event: its top-of-book features must equal the Quote formulas on the best
+// levels, its depth imbalance must match a sum over top_levels(), and the
+// strategy must give the same signal on both. Any failure makes the program
+// exit with status 1.
+
+#include "feature_engine.h"
+#include "feed_reader.h"
+
+#include "bench_harness.hpp"
+#include "market_data.hpp"    // session-04: Quote and its accessors
+#include "strategy_crtp.hpp"  // session-04: StrategyBase<>, SignalStrategyCRTP
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+bench::Checks checks;
+
+// The per-event rebuild FeatureEngine replaces.
+Quote quote_of(const MarketSnapshot& book)
+{
+    const PriceLevel* bid = book.get_best_bid();
+    const PriceLevel* ask = book.get_best_ask();
+    return Quote{bid ? bid->price : 0.0, ask ? ask->price : 0.0, bid ? (double)bid->quantity : 0.0,
+                 ask ? (double)ask->quantity : 0.0};
+}
+
+// SignalStrategyCRTP plus a term in the weighted depth imbalance, which a
+// Quote cannot provide.
+struct DepthStrategyCRTP : StrategyBase<DepthStrategyCRTP> {
+    SignalStrategyCRTP top;
+    double alpha3;
+
+    DepthStrategyCRTP(double a1, double a2, double a3) : top(a1, a2), alpha3(a3) {}
+
+    double on_tick_impl(const BookFeatures& f) const { return top.on_tick(f) + alpha3 * depth_imbalance(f); }
+};
+
+double brute_depth_imbalance(const MarketSnapshot& book, int levels, double decay)
+{
+    const PriceLevel* top[FeatureEngine::MAX_LEVELS];
+    double side[2] = {0.0, 0.0};
+    for (int s = 0; s < 2; s++) {
+        const int n = book.top_levels(s == 0 ? BookSide::Bid : BookSide::Ask, top, levels);
+        double w = 1.0;
+        for (int i = 0; i < n; i++, w *= decay) side[s] += w * top[i]->quantity;
+    }
+    return side[0] + side[1] > 0.0 ? (side[0] - side[1]) / (side[0] + side[1]) : 0.0;
+}
+
+// Everything FeatureEngine keeps, computed from the book from scratch.
+BookFeatures rebuild_features(const MarketSnapshot& book, int levels, double decay)
+{
+    const Quote q = quote_of(book);
+    BookFeatures f;
+    f.bid = q.bid;
+    f.ask = q.ask;
+    f.bid_qty = q.bid_qty;
+    f.ask_qty = q.ask_qty;
+    f.mid = mid(q);
+    f.microprice = microprice(q);
+    f.imbalance = imbalance(q);
+    f.depth_imbalance = brute_depth_imbalance(book, levels, decay);
+    return f;
+}
+
+void run_checks(const std::vector<BookUpdate>& evs)
+{
+    std::printf("feature checks\n");
+    const SignalStrategyCRTP signal(0.75, 0.25);
+    for (int levels : {1, 5, FeatureEngine::MAX_LEVELS}) {
+        for (double decay : {0.5, 0.8}) {
+            MarketSnapshot book;
+            FeatureEngine engine(levels, decay);
+            engine.attach(book);
+            std::size_t top_bad = 0, depth_bad = 0, signal_bad = 0;
+            for (std::size_t i = 0; i < evs.size(); i++) {
+                book.apply(evs[i]);
+                const Quote q = quote_of(book);
+                const BookFeatures& f = engine.features();
+                if (f.bid != q.bid || f.ask != q.ask || f.bid_qty != q.bid_qty || f.ask_qty != q.ask_qty ||
+                    f.mid != mid(q) || f.microprice != microprice(q) || f.imbalance != imbalance(q)) {
+                    top_bad++;
+                }
+                if (std::fabs(f.depth_imbalance - brute_depth_imbalance(book, levels, decay)) > 1e-9) depth_bad++;
+                if (signal.on_tick(f) != signal.on_tick(q)) signal_bad++;
+            }
+            std::string what = "levels=" + std::to_string(levels) + " decay=" + std::to_string(decay).substr(0, 3);
+            checks.expect((what + ": top of book matches the snapshot").c_str(), top_bad == 0);
+            checks.expect((what + ": depth imbalance matches top_levels()").c_str(), depth_bad == 0);
+            checks.expect((what + ": same signal as on a rebuilt Quote").c_str(), signal_bad == 0);
+
+            // a second engine seeded from the finished book agrees with the live one
+            FeatureEngine late(levels, decay);
+            late.reset(book);
+            checks.expect((what + ": reset() from the book gives the same features").c_str(),
+                          late.features().microprice == engine.features().microprice &&
+                              std::fabs(late.features().depth_imbalance - engine.features().depth_imbalance) < 1e-9);
+            book.remove_listener(&engine);
+        }
+    }
+    std::printf("%s\n\n", checks.passed() ? "all feature checks passed" : "FEATURE CHECKS FAILED");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : "sample_feed.txt";
+    std::vector<BookUpdate> evs;
+    if (!load_book_updates(path, evs) || evs.empty()) {
+        std::fprintf(stderr, "could not read book updates from %s\n", path);
+        return 1;
+    }
+    std::printf("%s: %zu book updates\n\n", path, evs.size());
+
+    run_checks(evs);
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+    const double n = (double)evs.size();
+    const std::string events = std::to_string(evs.size());
+    double sink = 0.0;
+
+    auto replay = [&](const char* name, const char* features, auto&& setup, auto&& per_event) {
+        const bench::CaseResult& r =
+            runner.run(name, {{"features", features}, {"events", events}}, n, [&](bench::Timing& t) {
+                auto book = std::make_unique<MarketSnapshot>();
+                auto state = setup(*book);
+                t.start();
+                for (const BookUpdate& e : evs) {
+                    book->apply(e);
+                    sink += per_event(*book, state);
+                }
+                t.stop();
+            });
+        bench::Runner::print_case(stdout, r);
+        std::printf("    %-48s %8.2f M features/s\n", "", 1e3 / r.ns_per_op());
+    };
+    auto no_setup = [](MarketSnapshot&) { return 0; };
+
+    replay("book_only", "none", no_setup, [](const MarketSnapshot&, int) { return 0.0; });
+
+    const SignalStrategyCRTP signal(0.75, 0.25);
+    replay("quote_rebuild", "top", no_setup,
+           [&](const MarketSnapshot& book, int) { return signal.on_tick(quote_of(book)); });
+
+    for (int levels : {1, 5, 10}) {
+        const std::string tag = levels == 1 ? "top" : "top+depth" + std::to_string(levels);
+        auto setup = [levels](MarketSnapshot& book) {
+            auto engine = std::make_unique<FeatureEngine>(levels, 0.5);
+            engine->attach(book);
+            return engine;
+        };
+        if (levels == 1) {
+            replay("engine", tag.c_str(), setup, [&](const MarketSnapshot&, const std::unique_ptr<FeatureEngine>& e) {
+                return signal.on_tick(e->features());
+            });
+            continue;
+        }
+        const DepthStrategyCRTP depth(0.75, 0.25, 0.1);
+        replay("rebuild", tag.c_str(), no_setup, [&](const MarketSnapshot& book, int) {
+            return depth.on_tick(rebuild_features(book, levels, 0.5));
+        });
+        replay("engine", tag.c_str(), setup, [&](const MarketSnapshot&, const std::unique_ptr<FeatureEngine>& e) {
+            return depth.on_tick(e->features());
+        });
+    }
+
+    bench::do_not_optimize(sink);
+    runner.write_reports();
+    return checks.passed() ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+#include "feature_engine.h"
+
+#include <algorithm>
+
+FeatureEngine::FeatureEngine(int levels, double decay) : levels_(std::clamp(levels, 1, MAX_LEVELS))
+{
+    double w = 1.0;
+    for (int i = 0; i < MAX_LEVELS; i++, w *= decay) weight_[i] = w;
+}
+
+void FeatureEngine::reset(const MarketSnapshot& snapshot)
+{
+    const PriceLevel* top[MAX_LEVELS];
+    for (BookSide side : {BookSide::Bid, BookSide::Ask})
+    {
+        Window& w = side == BookSide::Bid ? bids_ : asks_;
+        w.count = snapshot.top_levels(side, top, levels_);
+        for (int i = 0; i < w.count; i++) w.level[i] = Level{top[i]->price, (double)top[i]->quantity};
+        sum(w);
+    }
+    refresh_top();
+    refresh_depth();
+}
+
+void FeatureEngine::attach(MarketSnapshot& snapshot)
+{
+    reset(snapshot);
+    snapshot.add_listener(this);
+}
+
+void FeatureEngine::on_book_update(BookSide side, const PriceLevel& level)
+{
+    const bool bid = side == BookSide::Bid;
+    const int at = apply(bid ? bids_ : asks_, bid, level.price, (double)level.quantity);
+    if (at < 0) return;
+    if (at == 0) refresh_top();
+    refresh_depth();
+}
+
+int FeatureEngine::apply(Window& w, bool bid, double price, double qty)
+{
+    // first level at or behind `price`: bids descend, asks ascend
+    int i = 0;
+    while (i < w.count && (bid ? w.level[i].price > price : w.level[i].price < price)) i++;
+    if (i == levels_) return -1;
+
+    if (i < w.count && w.level[i].price == price)
+    {
+        w.weighted += weight_[i] * (qty - w.level[i].qty);
+        w.level[i].qty = qty;
+        return i;
+    }
+    const int last = std::min(w.count, levels_ - 1);
+    for (int j = last; j > i; j--) w.level[j] = w.level[j - 1];
+    w.level[i] = Level{price, qty};
+    w.count = last + 1;
+    sum(w);
+    return i;
+}
+
+void FeatureEngine::sum(Window& w) const
+{
+    w.weighted = 0.0;
+    for (int i = 0; i < w.count; i++) w.weighted += weight_[i] * w.level[i].qty;
+}
+
+void FeatureEngine::refresh_top()
+{
+    // same formulas as session-04's market_data.hpp, on the same inputs
+    f_.bid = bids_.count ? bids_.level[0].price : 0.0;
+    f_.bid_qty = bids_.count ? bids_.level[0].qty : 0.0;
+    f_.ask = asks_.count ? asks_.level[0].price : 0.0;
+    f_.ask_qty = asks_.count ? asks_.level[0].qty : 0.0;
+    f_.two_sided = bids_.count && asks_.count;
+
+    f_.mid = (f_.bid + f_.ask) * 0.5;
+    const double denom = f_.bid_qty + f_.ask_qty;
+    f_.microprice = denom > 0.0 ? (f_.bid * f_.ask_qty + f_.ask * f_.bid_qty) / denom : f_.mid;
+    f_.imbalance = denom > 0.0 ? (f_.bid_qty - f_.ask_qty) / denom : 0.0;
+}
+
+void FeatureEngine::refresh_depth()
+{
+    f_.version++;
+    if (levels_ == 1)
+    {
+        f_.depth_imbalance = f_.imbalance;  // the same sum, without a second division
+        return;
+    }
+    const double denom = bids_.weighted + asks_.weighted;
+    f_.depth_imbalance = denom > 0.0 ? (bids_.weighted - asks_.weighted) / denom : 0.0;
+}
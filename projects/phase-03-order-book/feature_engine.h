@@ -0,0 +1,84 @@
+#ifndef FEATURE_ENGINE_H
+#define FEATURE_ENGINE_H
+
+#include <cstdint>
+
+#include "market_snapshot.h"
+
+// Top-of-book features, kept current by FeatureEngine. The first four fields
+// are session-04's Quote; the others are derived from them once per book
+// change, so strategies read them instead of recomputing them every event.
+struct BookFeatures {
+    double bid = 0.0;
+    double ask = 0.0;
+    double bid_qty = 0.0;
+    double ask_qty = 0.0;
+    double mid = 0.0;
+    double microprice = 0.0;
+    double imbalance = 0.0;        // top level only
+    double depth_imbalance = 0.0;  // over the engine's levels, level i weighted decay^i
+    bool two_sided = false;
+    uint64_t version = 0;          // bumped whenever a feature may have changed
+};
+
+// The accessors session-04's strategies call on a Quote, with the same
+// fallbacks (mid for an empty top, 0 imbalance), so those strategies take
+// BookFeatures as they are.
+inline double mid(const BookFeatures& f) noexcept { return f.mid; }
+inline double microprice(const BookFeatures& f) noexcept { return f.microprice; }
+inline double imbalance(const BookFeatures& f) noexcept { return f.imbalance; }
+inline double depth_imbalance(const BookFeatures& f) noexcept { return f.depth_imbalance; }
+
+// Listens to a MarketSnapshot and keeps BookFeatures up to date.
+//
+// Each side keeps a copy of its best `levels` levels. An update below that
+// window costs one comparison and changes nothing. A size change inside it
+// adjusts the weighted depth sum by the difference, and only a change at the
+// top recomputes mid, microprice and imbalance. A new level inside the
+// window shifts the copy and recomputes the side's sum. MarketSnapshot never
+// removes a level, so a level pushed out of the window can never come back
+// into it.
+class FeatureEngine : public BookListener
+{
+public:
+    static constexpr int MAX_LEVELS = 16;
+
+    // levels is clamped to [1, MAX_LEVELS]; decay weights level i by decay^i.
+    explicit FeatureEngine(int levels = 5, double decay = 0.5);
+
+    // Rebuild from the snapshot's current book, e.g. after a restore.
+    void reset(const MarketSnapshot& snapshot);
+    // reset() and subscribe. Call snapshot.remove_listener(&engine) to stop.
+    void attach(MarketSnapshot& snapshot);
+
+    void on_book_update(BookSide side, const PriceLevel& level) override;
+
+    const BookFeatures& features() const { return f_; }
+    int levels() const { return levels_; }
+
+private:
+    struct Level {
+        double price;
+        double qty;
+    };
+
+    struct Window {
+        Level level[MAX_LEVELS];
+        int count = 0;
+        double weighted = 0.0;  // sum of weight[i] * qty
+    };
+
+    int levels_;
+    double weight_[MAX_LEVELS];
+    Window bids_;
+    Window asks_;
+    BookFeatures f_;
+
+    // Index of the level touched inside the window, or -1 if none.
+    int apply(Window& w, bool bid, double price, double qty);
+    void sum(Window& w) const;
+    void refresh_top();
+    void refresh_depth();
+};
+
+#endif //FEATURE_ENGINE_H
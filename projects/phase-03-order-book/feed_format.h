@@ -0,0 +1,40 @@
+#ifndef FEED_FORMAT_H
+#define FEED_FORMAT_H
+
+#include <cstdint>
+
+// Binary market-data feed written by feed_gen and read by the driver.
+//
+// A 64-byte header, then one 16-byte record per event. Prices are integer
+// ticks of 10^-decimals; an EXECUTION record carries the order id in the
+// price field. Sizes are absolute level sizes, 0 removes the level, the
+// same as the text format.
+
+constexpr char FEED_MAGIC[8] = {'H', 'F', 'T', 'F', 'E', 'E', 'D', '1'};
+constexpr uint32_t FEED_VERSION = 1;
+
+enum class FeedType : uint8_t { Bid = 1, Ask = 2, Execution = 3 };
+
+struct FeedHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t seed;
+    uint64_t events;      // filled in when the generator finishes (0 if it could not seek)
+    uint32_t symbols;
+    uint32_t decimals;    // price = ticks / 10^decimals
+    uint8_t reserved[24];
+};
+static_assert(sizeof(FeedHeader) == 64, "FeedHeader must stay 64 bytes");
+
+struct FeedRecord {
+    uint32_t delta_ns;    // time since the previous event
+    FeedType type;
+    uint8_t reserved;
+    uint16_t symbol;
+    int32_t price_ticks;  // order id for Execution
+    int32_t qty;
+};
+static_assert(sizeof(FeedRecord) == 16, "FeedRecord must stay 16 bytes");
+
+#endif //FEED_FORMAT_H
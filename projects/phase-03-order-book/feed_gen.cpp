@@ -0,0 +1,458 @@
+// Synthetic market-data feed generator.
+//
+//   ./feed_gen [options] > feed.txt
+//   ./feed_gen --format binary --out feed.bin [options]
+//
+// Emits BID / ASK / EXECUTION events in the driver's text format or in the
+// binary format of feed_format.h. Each symbol has a book of `depth` levels
+// per side around a mid that follows a one-tick random walk; level updates
+// set absolute sizes (0 removes a level) and favour the touch. Events come
+// in calm and burst regimes: in a burst the gaps between events shrink and
+// the mid moves more often by the burst factor.
+//
+// Output is streamed through a fixed buffer, so the event count is limited
+// only by disk space, and the same seed and options always give the same
+// bytes.
+
+#include "feed_format.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    uint64_t events = 1000000;
+    int symbols = 1;
+    int depth = 10;
+    double mix_bid = 45, mix_ask = 45, mix_exec = 10;
+    double walk = 0.02;           // chance per event that the mid moves one tick
+    double burst = 10.0;          // burst factor, 1 turns bursts off
+    double burst_enter = 0.001;   // per event, calm -> burst
+    double burst_exit = 0.02;     // per event, burst -> calm
+    double gap_ns = 1000.0;       // mean gap between events when calm
+    int mean_size = 100;
+    int order_ids = 1000;         // EXECUTION ids are drawn from 1..order_ids
+    int decimals = 2;
+    double start_price = 100.0;
+    uint64_t seed = 1;
+    bool binary = false;
+    std::string out = "-";
+};
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: feed_gen [--events N[k|m|g]] [--symbols S] [--depth D] [--mix BID,ASK,EXEC]\n"
+                 "                [--walk P] [--burst F] [--burst-enter P] [--burst-exit P] [--gap-ns NS]\n"
+                 "                [--size MEAN] [--order-ids N] [--decimals D] [--start PRICE]\n"
+                 "                [--seed N] [--format text|binary] [--out FILE|-]\n");
+}
+
+uint64_t parse_count(const char* s)
+{
+    char* end = nullptr;
+    const double v = std::strtod(s, &end);
+    double mult = 1.0;
+    if (end && *end) {
+        switch (*end) {
+        case 'k': case 'K': mult = 1e3; break;
+        case 'm': case 'M': mult = 1e6; break;
+        case 'g': case 'G': case 'b': case 'B': mult = 1e9; break;
+        default: break;
+        }
+    }
+    return (uint64_t)std::llround(v * mult);
+}
+
+bool parse_args(int argc, char** argv, Options& o)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a == "-h" || a == "--help") return false;
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "missing value for %s\n", a.c_str());
+            return false;
+        }
+        const char* v = argv[++i];
+        if (a == "--events") o.events = parse_count(v);
+        else if (a == "--symbols") o.symbols = std::max(1, std::min(65535, std::atoi(v)));
+        else if (a == "--depth") o.depth = std::max(1, std::atoi(v));
+        else if (a == "--mix") {
+            if (std::sscanf(v, "%lf,%lf,%lf", &o.mix_bid, &o.mix_ask, &o.mix_exec) != 3) return false;
+        }
+        else if (a == "--walk") o.walk = std::atof(v);
+        else if (a == "--burst") o.burst = std::max(1.0, std::atof(v));
+        else if (a == "--burst-enter") o.burst_enter = std::atof(v);
+        else if (a == "--burst-exit") o.burst_exit = std::atof(v);
+        else if (a == "--gap-ns") o.gap_ns = std::atof(v);
+        else if (a == "--size") o.mean_size = std::max(1, std::atoi(v));
+        else if (a == "--order-ids") o.order_ids = std::max(1, std::atoi(v));
+        else if (a == "--decimals") o.decimals = std::max(0, std::min(8, std::atoi(v)));
+        else if (a == "--start") o.start_price = std::atof(v);
+        else if (a == "--seed") o.seed = std::strtoull(v, nullptr, 10);
+        else if (a == "--format") {
+            if (std::strcmp(v, "binary") == 0) o.binary = true;
+            else if (std::strcmp(v, "text") == 0) o.binary = false;
+            else return false;
+        }
+        else if (a == "--out") o.out = v;
+        else {
+            std::fprintf(stderr, "unknown option %s\n", a.c_str());
+            return false;
+        }
+    }
+    const double mix = o.mix_bid + o.mix_ask + o.mix_exec;
+    if (!(mix > 0.0) || o.mix_bid < 0 || o.mix_ask < 0 || o.mix_exec < 0) return false;
+    return true;
+}
+
+// xoshiro256** seeded through splitmix64: fast, and the same stream on
+// every platform (std:: distributions are not).
+class Rng
+{
+public:
+    explicit Rng(uint64_t seed)
+    {
+        for (auto& w : s_) {
+            seed += 0x9e3779b97f4a7c15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            w = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next()
+    {
+        const uint64_t r = rotl(s_[1] * 5, 7) * 9;
+        const uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = rotl(s_[3], 45);
+        return r;
+    }
+
+    double uniform() { return (double)(next() >> 11) * 0x1.0p-53; }  // [0, 1)
+    uint32_t below(uint32_t n) { return (uint32_t)(((next() >> 32) * (uint64_t)n) >> 32); }
+
+private:
+    uint64_t s_[4];
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+// Buffered writer for either format.
+class FeedWriter
+{
+public:
+    FeedWriter(FILE* f, const Options& o) : f_(f), binary_(o.binary), decimals_(o.decimals), multi_(o.symbols > 1)
+    {
+        scale_ = 1;
+        for (int i = 0; i < decimals_; ++i) scale_ *= 10;
+        buf_.resize(1 << 20);
+    }
+
+    void event(FeedType type, int symbol, int64_t price_ticks, int32_t qty, uint32_t delta_ns)
+    {
+        if (pos_ + 64 > buf_.size()) flush();
+        if (binary_) {
+            FeedRecord r{delta_ns, type, 0, (uint16_t)symbol, (int32_t)price_ticks, qty};
+            std::memcpy(&buf_[pos_], &r, sizeof r);
+            pos_ += sizeof r;
+        } else {
+            char* p = &buf_[pos_];
+            if (type == FeedType::Execution) {
+                std::memcpy(p, "EXECUTION ", 10);
+                p = put_uint(p + 10, (uint64_t)price_ticks);
+            } else {
+                std::memcpy(p, type == FeedType::Bid ? "BID " : "ASK ", 4);
+                p = put_price(p + 4, price_ticks);
+            }
+            *p++ = ' ';
+            p = put_uint(p, (uint64_t)qty);
+            if (multi_) {
+                *p++ = ' ';
+                p = put_uint(p, (uint64_t)symbol);
+            }
+            *p++ = '\n';
+            pos_ = p - buf_.data();
+        }
+        ++count_;
+    }
+
+    void raw(const void* data, size_t n)
+    {
+        flush();
+        if (std::fwrite(data, 1, n, f_) != n) ok_ = false;
+        bytes_ += n;
+    }
+
+    void flush()
+    {
+        if (pos_ && std::fwrite(buf_.data(), 1, pos_, f_) != pos_) ok_ = false;
+        bytes_ += pos_;
+        pos_ = 0;
+    }
+
+    bool ok() const { return ok_; }
+    uint64_t count() const { return count_; }
+    uint64_t bytes() const { return bytes_; }
+
+private:
+    FILE* f_;
+    bool binary_;
+    int decimals_;
+    bool multi_;
+    uint64_t scale_;
+    std::vector<char> buf_;
+    size_t pos_ = 0;
+    uint64_t count_ = 0;
+    uint64_t bytes_ = 0;
+    bool ok_ = true;
+
+    static char* put_uint(char* p, uint64_t v)
+    {
+        char tmp[20];
+        int n = 0;
+        do {
+            tmp[n++] = (char)('0' + v % 10);
+            v /= 10;
+        } while (v);
+        while (n) *p++ = tmp[--n];
+        return p;
+    }
+
+    char* put_price(char* p, int64_t ticks)
+    {
+        if (ticks < 0) {
+            *p++ = '-';
+            ticks = -ticks;
+        }
+        p = put_uint(p, (uint64_t)ticks / scale_);
+        if (decimals_ > 0) {
+            *p++ = '.';
+            uint64_t frac = (uint64_t)ticks % scale_;
+            for (int i = decimals_ - 1; i >= 0; --i) {
+                p[i] = (char)('0' + frac % 10);
+                frac /= 10;
+            }
+            p += decimals_;
+        }
+        return p;
+    }
+};
+
+// One symbol's book: sizes of `depth` levels per side, level 0 at the touch.
+struct Book {
+    int64_t best_bid = 0;
+    int64_t best_ask = 0;
+    std::vector<int32_t> bid;
+    std::vector<int32_t> ask;
+};
+
+class Generator
+{
+public:
+    explicit Generator(const Options& o, FeedWriter& w) : o_(o), w_(w), rng_(o.seed), books_(o.symbols)
+    {
+        const double mix = o.mix_bid + o.mix_ask + o.mix_exec;
+        p_bid_ = o.mix_bid / mix;
+        p_ask_ = (o.mix_bid + o.mix_ask) / mix;
+        double scale = 1.0;
+        for (int i = 0; i < o.decimals; ++i) scale *= 10.0;
+        const int64_t start = std::llround(o.start_price * scale);
+        for (int s = 0; s < o.symbols; ++s) {
+            Book& b = books_[s];
+            b.best_bid = start + 100 * s - 1;
+            b.best_ask = start + 100 * s + 1;
+            b.bid.assign(o.depth, 0);
+            b.ask.assign(o.depth, 0);
+        }
+    }
+
+    void run()
+    {
+        // opening snapshot, deepest level first so the touch arrives last
+        for (int s = 0; s < o_.symbols && !done(); ++s) {
+            Book& b = books_[s];
+            for (int i = o_.depth - 1; i >= 0 && !done(); --i) {
+                b.bid[i] = size();
+                emit(FeedType::Bid, s, b.best_bid - i, b.bid[i]);
+                if (done()) break;
+                b.ask[i] = size();
+                emit(FeedType::Ask, s, b.best_ask + i, b.ask[i]);
+            }
+        }
+
+        while (!done()) {
+            // regime switch
+            if (burst_) {
+                if (rng_.uniform() < o_.burst_exit) burst_ = false;
+            } else if (o_.burst > 1.0 && rng_.uniform() < o_.burst_enter) {
+                burst_ = true;
+            }
+            const int s = o_.symbols > 1 ? (int)rng_.below((uint32_t)o_.symbols) : 0;
+            const double walk = std::min(0.5, o_.walk * (burst_ ? o_.burst : 1.0));
+            if (rng_.uniform() < walk) {
+                move(s, rng_.next() & 1 ? 1 : -1);
+                continue;
+            }
+
+            const double u = rng_.uniform();
+            Book& b = books_[s];
+            if (u < p_ask_) {
+                const bool is_bid = u < p_bid_;
+                const int level = pick_level();
+                // one update in eight empties the level, the rest set a new size
+                const int32_t qty = rng_.below(8) == 0 ? 0 : size();
+                if (is_bid) {
+                    b.bid[level] = qty;
+                    emit(FeedType::Bid, s, b.best_bid - level, qty);
+                } else {
+                    b.ask[level] = qty;
+                    emit(FeedType::Ask, s, b.best_ask + level, qty);
+                }
+            } else {
+                const int64_t id = 1 + rng_.below((uint32_t)o_.order_ids);
+                emit(FeedType::Execution, s, id, 1 + (int32_t)rng_.below(10));
+            }
+        }
+    }
+
+private:
+    const Options& o_;
+    FeedWriter& w_;
+    Rng rng_;
+    std::vector<Book> books_;
+    double p_bid_ = 0.0, p_ask_ = 0.0;
+    bool burst_ = false;
+
+    bool done() const { return w_.count() >= o_.events; }
+
+    int32_t size() { return 1 + (int32_t)rng_.below((uint32_t)(2 * o_.mean_size)); }
+
+    // Geometric over levels, half the updates at the touch, capped at depth.
+    int pick_level()
+    {
+        int level = 0;
+        while (level + 1 < o_.depth && (rng_.next() & 1)) ++level;
+        return level;
+    }
+
+    uint32_t gap()
+    {
+        const double mean = burst_ ? o_.gap_ns / o_.burst : o_.gap_ns;
+        const double g = -std::log(1.0 - rng_.uniform()) * mean;
+        return (uint32_t)std::min(g, 4e9);
+    }
+
+    void emit(FeedType type, int symbol, int64_t price_ticks, int32_t qty)
+    {
+        w_.event(type, symbol, price_ticks, qty, gap());
+    }
+
+    // Shift the whole book one tick: the touch on the side the mid moves
+    // towards is taken out, a new touch appears on the other side, and the
+    // level that falls off the far end is removed.
+    void move(int s, int dir)
+    {
+        Book& b = books_[s];
+        const int d = o_.depth;
+        if (dir > 0) {
+            emit(FeedType::Ask, s, b.best_ask, 0);
+            std::rotate(b.ask.begin(), b.ask.begin() + 1, b.ask.end());
+            b.ask[d - 1] = size();
+            ++b.best_ask;
+            if (done()) return;
+            emit(FeedType::Ask, s, b.best_ask + d - 1, b.ask[d - 1]);
+            if (done()) return;
+            emit(FeedType::Bid, s, b.best_bid - (d - 1), 0);
+            std::rotate(b.bid.rbegin(), b.bid.rbegin() + 1, b.bid.rend());
+            b.bid[0] = size();
+            ++b.best_bid;
+            if (done()) return;
+            emit(FeedType::Bid, s, b.best_bid, b.bid[0]);
+        } else {
+            emit(FeedType::Bid, s, b.best_bid, 0);
+            std::rotate(b.bid.begin(), b.bid.begin() + 1, b.bid.end());
+            b.bid[d - 1] = size();
+            --b.best_bid;
+            if (done()) return;
+            emit(FeedType::Bid, s, b.best_bid - (d - 1), b.bid[d - 1]);
+            if (done()) return;
+            emit(FeedType::Ask, s, b.best_ask + (d - 1), 0);
+            std::rotate(b.ask.rbegin(), b.ask.rbegin() + 1, b.ask.rend());
+            b.ask[0] = size();
+            --b.best_ask;
+            if (done()) return;
+            emit(FeedType::Ask, s, b.best_ask, b.ask[0]);
+        }
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options o;
+    if (!parse_args(argc, argv, o)) {
+        usage();
+        return 2;
+    }
+
+    FILE* f = o.out == "-" ? stdout : std::fopen(o.out.c_str(), "wb");
+    if (!f) {
+        std::perror(o.out.c_str());
+        return 1;
+    }
+
+    FeedWriter w(f, o);
+    FeedHeader h{};
+    if (o.binary) {
+        std::memcpy(h.magic, FEED_MAGIC, sizeof h.magic);
+        h.version = FEED_VERSION;
+        h.record_size = sizeof(FeedRecord);
+        h.seed = o.seed;
+        h.symbols = (uint32_t)o.symbols;
+        h.decimals = (uint32_t)o.decimals;
+        w.raw(&h, sizeof h);
+    } else {
+        char line[256];
+        const int n = std::snprintf(line, sizeof line,
+                                    "# feed_gen seed=%llu events=%llu symbols=%d depth=%d mix=%g,%g,%g walk=%g burst=%g\n",
+                                    (unsigned long long)o.seed, (unsigned long long)o.events, o.symbols, o.depth,
+                                    o.mix_bid, o.mix_ask, o.mix_exec, o.walk, o.burst);
+        w.raw(line, (size_t)n);
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    Generator g(o, w);
+    g.run();
+    w.flush();
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    // patch the event count into the binary header when the output can seek
+    if (o.binary && std::fflush(f) == 0 && std::fseek(f, 0, SEEK_SET) == 0) {
+        h.events = w.count();
+        if (std::fwrite(&h, sizeof h, 1, f) != 1) std::perror("header");
+    }
+
+    const bool ok = w.ok() && std::fflush(f) == 0;
+    if (f != stdout && std::fclose(f) != 0) return 1;
+    if (!ok) {
+        std::fprintf(stderr, "feed_gen: write failed\n");
+        return 1;
+    }
+    std::fprintf(stderr, "feed_gen: %llu events, %.1f MB in %.2f s (%.1f M events/s)\n",
+                 (unsigned long long)w.count(), (double)w.bytes() / 1e6, secs, (double)w.count() / secs / 1e6);
+    return 0;
+}
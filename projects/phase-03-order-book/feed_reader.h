@@ -0,0 +1,134 @@
+#ifndef FEED_READER_H
+#define FEED_READER_H
+
+#include "feed_format.h"
+#include "market_snapshot.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Reads a feed one event at a time, for the driver, the tools and the
+// benches: a feed_gen binary feed when the file starts with FEED_MAGIC,
+// otherwise the text format.
+//
+// Text lines are "BID price qty", "ASK price qty" or "EXECUTION order_id
+// qty", each optionally followed by a symbol number. Lines starting with any
+// other word, such as '#' comments, are skipped. A BID, ASK or EXECUTION line
+// missing its fields ends the feed, as it always has in the driver.
+
+struct FeedEvent {
+    FeedType type;
+    uint16_t symbol;
+    int32_t price_ticks;  // order id for Execution; text prices rounded to the reader's text decimals
+    int32_t qty;
+    double price;         // as the feed gives it; 0 for Execution
+    uint64_t ts_ns;       // binary feeds: delta_ns summed since the reader opened or seeked; text: 0
+};
+
+class FeedReader
+{
+public:
+    explicit FeedReader(const std::string& path, uint32_t text_decimals = 4) : in_(path, std::ios::binary)
+    {
+        FeedHeader h;
+        if (in_.read(reinterpret_cast<char*>(&h), sizeof h) && std::memcmp(h.magic, FEED_MAGIC, sizeof h.magic) == 0 &&
+            h.record_size == sizeof(FeedRecord)) {
+            binary_ = true;
+            decimals_ = h.decimals;
+        } else {
+            in_.clear();
+            in_.seekg(0);
+            decimals_ = text_decimals;
+        }
+        scale_ = std::pow(10.0, (double)decimals_);
+        tick_ = 1.0 / scale_;
+    }
+
+    bool ok() const { return in_.is_open(); }
+    bool binary() const { return binary_; }
+    // Binary feeds: the header's. Text feeds: the text decimals asked for.
+    uint32_t decimals() const { return decimals_; }
+    double tick() const { return tick_; }
+
+    // False at the end of the feed.
+    bool next(FeedEvent& ev)
+    {
+        if (binary_) {
+            FeedRecord r;
+            if (!in_.read(reinterpret_cast<char*>(&r), sizeof r)) return false;
+            clock_ns_ += r.delta_ns;
+            switch (r.type) {
+            case FeedType::Bid:
+            case FeedType::Ask:
+                ev = FeedEvent{r.type, r.symbol, r.price_ticks, r.qty, r.price_ticks * tick_, clock_ns_};
+                return true;
+            case FeedType::Execution:
+                ev = FeedEvent{r.type, r.symbol, r.price_ticks, r.qty, 0.0, clock_ns_};
+                return true;
+            }
+            return false;
+        }
+        std::string line;
+        while (std::getline(in_, line)) {
+            char kind[16];
+            double px = 0;
+            int q = 0;
+            unsigned symbol = 0;
+            const int fields = std::sscanf(line.c_str(), "%15s %lf %d %u", kind, &px, &q, &symbol);
+            if (fields < 1) continue;
+            FeedType type;
+            if (!std::strcmp(kind, "BID")) type = FeedType::Bid;
+            else if (!std::strcmp(kind, "ASK")) type = FeedType::Ask;
+            else if (!std::strcmp(kind, "EXECUTION")) type = FeedType::Execution;
+            else continue;
+            if (fields < 3) return false;
+            if (type == FeedType::Execution) {
+                ev = FeedEvent{type, (uint16_t)symbol, (int32_t)px, q, 0.0, 0};
+            } else {
+                ev = FeedEvent{type, (uint16_t)symbol, (int32_t)std::llround(px * scale_), q, px, 0};
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Byte offset of the next event, and a jump back to one (for
+    // checkpoints). The binary feed clock starts again from 0 after a seek.
+    uint64_t offset() { return (uint64_t)in_.tellg(); }
+
+    bool seek(uint64_t offset)
+    {
+        in_.clear();
+        clock_ns_ = 0;
+        return (bool)in_.seekg((std::streamoff)offset);
+    }
+
+private:
+    std::ifstream in_;
+    bool binary_ = false;
+    uint32_t decimals_ = 0;
+    double scale_ = 1.0;
+    double tick_ = 1.0;
+    uint64_t clock_ns_ = 0;
+};
+
+// Every bid and ask update of a feed, in order, for the benches that replay
+// a feed from memory. False if the file cannot be opened.
+inline bool load_book_updates(const std::string& path, std::vector<BookUpdate>& out)
+{
+    FeedReader feed(path);
+    if (!feed.ok()) return false;
+    FeedEvent ev;
+    while (feed.next(ev)) {
+        if (ev.type == FeedType::Bid) out.push_back(BookUpdate{BookSide::Bid, ev.qty, ev.price});
+        if (ev.type == FeedType::Ask) out.push_back(BookUpdate{BookSide::Ask, ev.qty, ev.price});
+    }
+    return true;
+}
+
+#endif //FEED_READER_H
@@ -0,0 +1,127 @@
+#include "latency_probe.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <vector>
+
+const char* to_string(LatencyStage s)
+{
+    switch (s) {
+    case LatencyStage::Parse: return "parse";
+    case LatencyStage::UpdateBid: return "update_bid";
+    case LatencyStage::UpdateAsk: return "update_ask";
+    case LatencyStage::Fill: return "handle_fill";
+    case LatencyStage::ShouldTrade: return "should_trade";
+    case LatencyStage::PlaceOrder: return "place_order";
+    case LatencyStage::Count: break;
+    }
+    return "unknown";
+}
+
+double tsc_ns_per_cycle()
+{
+    static const double ns_per_cycle = [] {
+        // spin ~20 ms and compare the two clocks; take the best of three
+        // so a preemption during one window does not skew the rate
+        double best = 0.0;
+        for (int i = 0; i < 3; ++i) {
+            const auto t0 = std::chrono::steady_clock::now();
+            const uint64_t c0 = tsc_start();
+            auto t1 = t0;
+            while (t1 - t0 < std::chrono::milliseconds(20)) t1 = std::chrono::steady_clock::now();
+            const uint64_t c1 = tsc_stop();
+            const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+            const double rate = ns / (double)(c1 - c0);
+            if (best == 0.0 || rate < best) best = rate;
+        }
+        return best;
+    }();
+    return ns_per_cycle;
+}
+
+uint64_t CycleHistogram::bucket_low(int b)
+{
+    if (b < LINEAR) return (uint64_t)b;
+    const int k = b - LINEAR;
+    const int e = k / (1 << SUB_BITS) + SUB_BITS + 1;
+    const uint64_t m = (uint64_t)(k % (1 << SUB_BITS));
+    return ((1ull << SUB_BITS) + m) << (e - SUB_BITS);
+}
+
+uint64_t CycleHistogram::bucket_width(int b)
+{
+    if (b < LINEAR) return 1;
+    const int e = (b - LINEAR) / (1 << SUB_BITS) + SUB_BITS + 1;
+    return 1ull << (e - SUB_BITS);
+}
+
+double CycleHistogram::percentile(double q) const
+{
+    if (count_ == 0) return 0.0;
+    const uint64_t rank = std::min<uint64_t>(count_ - 1, (uint64_t)(q * (double)count_));
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; ++b) {
+        seen += buckets_[b];
+        if (seen > rank) {
+            const double mid = (double)bucket_low(b) + (double)(bucket_width(b) - 1) / 2.0;
+            return std::min(mid, (double)max_);
+        }
+    }
+    return (double)max_;
+}
+
+double LatencyRecorder::probe_overhead_cycles()
+{
+    static const double overhead = [] {
+        std::vector<uint64_t> v(10001);
+        for (auto& c : v) {
+            const uint64_t t0 = tsc_start();
+            c = tsc_stop() - t0;
+        }
+        std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        return (double)v[v.size() / 2];
+    }();
+    return overhead;
+}
+
+void LatencyRecorder::print_table(std::ostream& os) const
+{
+    const double ns = tsc_ns_per_cycle();
+    uint64_t total = 0;
+    for (const auto& h : stages_) total += h.sum();
+
+    os << "\nLatency breakdown (TSC " << std::fixed << std::setprecision(3) << 1.0 / ns << " GHz, empty probe "
+       << std::setprecision(1) << probe_overhead_cycles() * ns << " ns, included below)\n";
+    os << std::left << std::setw(14) << "stage" << std::right << std::setw(9) << "count" << std::setw(10) << "mean ns"
+       << std::setw(10) << "p50 ns" << std::setw(10) << "p90 ns" << std::setw(10) << "p99 ns" << std::setw(10)
+       << "p99.9 ns" << std::setw(12) << "max ns" << std::setw(9) << "share" << '\n';
+    for (int s = 0; s < (int)LatencyStage::Count; ++s) {
+        const CycleHistogram& h = stages_[s];
+        if (h.count() == 0) continue;
+        os << std::left << std::setw(14) << to_string((LatencyStage)s) << std::right << std::setw(9) << h.count()
+           << std::setprecision(1) << std::setw(10) << h.mean() * ns << std::setw(10) << h.percentile(0.50) * ns
+           << std::setw(10) << h.percentile(0.90) * ns << std::setw(10) << h.percentile(0.99) * ns << std::setw(10)
+           << h.percentile(0.999) * ns << std::setw(12) << (double)h.max() * ns << std::setw(8)
+           << (total ? 100.0 * (double)h.sum() / (double)total : 0.0) << "%\n";
+    }
+    os << std::defaultfloat;
+}
+
+bool LatencyRecorder::write_csv(const std::string& path) const
+{
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    const double ns = tsc_ns_per_cycle();
+    std::fprintf(f, "stage,count,mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,total_ns,ns_per_cycle\n");
+    for (int s = 0; s < (int)LatencyStage::Count; ++s) {
+        const CycleHistogram& h = stages_[s];
+        if (h.count() == 0) continue;
+        std::fprintf(f, "%s,%llu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.0f,%.6f\n", to_string((LatencyStage)s),
+                     (unsigned long long)h.count(), h.mean() * ns, h.percentile(0.50) * ns,
+                     h.percentile(0.90) * ns, h.percentile(0.99) * ns, h.percentile(0.999) * ns,
+                     (double)h.max() * ns, (double)h.sum() * ns, ns);
+    }
+    return std::fclose(f) == 0;
+}
@@ -0,0 +1,154 @@
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Per-stage latency probes for the driver, in TSC cycles.
+//
+// Build with -DLATENCY_PROBES to turn them on. Without it LATENCY_SCOPE and
+// LATENCY_REPORT generate no code, so the driver is the same as an
+// uninstrumented one. The recorder still compiles, so tools can use it
+// directly.
+//
+// Each stage keeps a log-linear histogram (8 buckets per power of two, so
+// a percentile is within about 6% of the real value) plus count, sum and
+// max. Cycles are converted to ns only when reporting, with a TSC rate
+// measured against steady_clock.
+
+enum class LatencyStage {
+    Parse,
+    UpdateBid,
+    UpdateAsk,
+    Fill,
+    ShouldTrade,
+    PlaceOrder,
+    Count
+};
+
+const char* to_string(LatencyStage s);
+
+// Start/stop stamps. lfence keeps rdtsc from running ahead of the code
+// before it; rdtscp waits for the timed code to finish.
+inline uint64_t tsc_start()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_lfence();
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+inline uint64_t tsc_stop()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned aux;
+    const uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+#else
+    return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// ns per TSC tick, measured once (about 20 ms) on first use.
+double tsc_ns_per_cycle();
+
+class CycleHistogram
+{
+public:
+    static constexpr int SUB_BITS = 3;
+    static constexpr int LINEAR = 2 << SUB_BITS;  // values below this get their own bucket
+    static constexpr int BUCKETS = LINEAR + (64 - SUB_BITS - 1) * (1 << SUB_BITS);
+
+    void record(uint64_t cycles)
+    {
+        ++buckets_[bucket_of(cycles)];
+        ++count_;
+        sum_ += cycles;
+        if (cycles > max_) max_ = cycles;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t sum() const { return sum_; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? (double)sum_ / count_ : 0.0; }
+    // Midpoint of the bucket holding quantile q, capped at max.
+    double percentile(double q) const;
+
+    static int bucket_of(uint64_t v)
+    {
+        if (v < (uint64_t)LINEAR) return (int)v;
+        const int e = 63 - __builtin_clzll(v);
+        const int m = (int)(v >> (e - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+        return LINEAR + (e - SUB_BITS - 1) * (1 << SUB_BITS) + m;
+    }
+    static uint64_t bucket_low(int b);
+    static uint64_t bucket_width(int b);
+
+private:
+    uint64_t buckets_[BUCKETS] = {};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+class LatencyRecorder
+{
+public:
+    void record(LatencyStage s, uint64_t cycles) { stages_[(int)s].record(cycles); }
+    const CycleHistogram& stage(LatencyStage s) const { return stages_[(int)s]; }
+
+    // Cost of an empty probe, in cycles (median of many), for reading the table.
+    static double probe_overhead_cycles();
+
+    // One row per stage that saw events: count, mean, p50/p90/p99/p99.9,
+    // max in ns and share of the total probed time.
+    void print_table(std::ostream& os) const;
+    bool write_csv(const std::string& path) const;
+
+private:
+    CycleHistogram stages_[(int)LatencyStage::Count];
+};
+
+// Records the cycles from construction to destruction into one stage.
+class LatencyScope
+{
+public:
+    LatencyScope(LatencyRecorder& rec, LatencyStage stage) : rec_(rec), stage_(stage), start_(tsc_start()) {}
+    ~LatencyScope() { rec_.record(stage_, tsc_stop() - start_); }
+
+    LatencyScope(const LatencyScope&) = delete;
+    LatencyScope& operator=(const LatencyScope&) = delete;
+
+private:
+    LatencyRecorder& rec_;
+    LatencyStage stage_;
+    uint64_t start_;
+};
+
+#define LATENCY_CAT2(a, b) a##b
+#define LATENCY_CAT(a, b) LATENCY_CAT2(a, b)
+
+#ifdef LATENCY_PROBES
+#define LATENCY_SCOPE(rec, stage) LatencyScope LATENCY_CAT(latency_scope_, __LINE__)((rec), (stage))
+#define LATENCY_REPORT(rec, os, csv_path)         \
+    do {                                          \
+        (rec).print_table(os);                    \
+        if ((rec).write_csv(csv_path))            \
+            (os) << "Latency CSV written to " << (csv_path) << '\n'; \
+    } while (0)
+#else
+#define LATENCY_SCOPE(rec, stage) ((void)(rec))
+#define LATENCY_REPORT(rec, os, csv_path) ((void)(rec))
+#endif
+
+#endif //LATENCY_PROBE_H
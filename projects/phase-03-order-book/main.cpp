@@ -1,103 +1,254 @@
+#include "bar_stage.h"
+#include "checkpoint.h"
+#include "feed_reader.h"
+#include "latency_probe.h"
 #include "market_snapshot.h"
 #include "order_manager.h"
+#include "position_keeper.h"
+#include "risk_gateway.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <vector>
 #include <string>
 
-enum class EventType { Bid, Ask, Execution };
-
-struct Event {
-    EventType type;
-    double price = 0.0;
-    int qty = 0;
-    int id = -1;
-};
+bool should_trade(const MarketSnapshot& snapshot)
+{
+    auto bid = snapshot.get_best_bid();
+    auto ask = snapshot.get_best_ask();
+    if (!bid || !ask) return false;
+    return (ask->price - bid->price) < 0.05;
+}
 
-std::vector<Event> load_feed(const std::string& filename)
+// Books every fill into the position keeper.
+class FillsToPositions : public OrderListener
 {
-    std::vector<Event> evs;
-    std::ifstream in(filename);
-    if (!in.is_open()) {
-        std::cerr << "Could not open feed file: " << filename << "\n";
-        return evs;
+public:
+    FillsToPositions(PositionKeeper& positions, int symbol) : positions_(positions), symbol_(symbol) {}
+
+    void on_order_event(const OrderEvent& ev) override
+    {
+        if (ev.last_fill_qty > 0) positions_.on_fill(symbol_, ev.side, ev.price, ev.last_fill_qty);
     }
 
-    std::string kind;
-    while (in >> kind) {
-        if (kind[0] == '#') { // comment line starts with '#'
-            std::string discard;
-            std::getline(in, discard);
-            continue;
-        }
+private:
+    PositionKeeper& positions_;
+    int symbol_;
+};
 
-        if (kind == "BID") {
-            double px; int q;
-            if (in >> px >> q) {
-                evs.push_back(Event{EventType::Bid, px, q, -1});
-            }
-        } else if (kind == "ASK") {
-            double px; int q;
-            if (in >> px >> q) {
-                evs.push_back(Event{EventType::Ask, px, q, -1});
-            }
-        } else if (kind == "EXECUTION") {
-            int order_id, q;
-            if (in >> order_id >> q) {
-                evs.push_back(Event{EventType::Execution, 0.0, q, order_id});
-            }
-        } else {
-            std::string discard;
-            std::getline(in, discard);
-        }
-    }
-    return evs;
+// The risk throttle runs on feed time, as in the backtester: a binary feed's
+// own clock, or this much per event of a text feed. Either way the clock
+// counts from where this run started reading, and a checkpoint keeps the
+// throttle's credit relative to it, so a restored run throttles exactly as
+// the uninterrupted one does.
+constexpr uint64_t TEXT_GAP_NS = 1000;
+
+uint64_t now_ns()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-bool should_trade(const MarketSnapshot& snapshot)
+void print_usage(const char* argv0)
 {
-    auto bid = snapshot.get_best_bid();
-    auto ask = snapshot.get_best_ask();
-    if (!bid || !ask) return false;
-    return (ask->price - bid->price) < 0.05;
+    std::cerr << "usage: " << argv0 << " [feed] [latency csv] [--checkpoint FILE] [--checkpoint-every N]\n"
+              << "       [--restore FILE] [--stop-after N] [--bars FILE] [--bar-ns N] [--bar-volume N]\n"
+              << "  --checkpoint FILE      write a checkpoint of the book and order state to FILE\n"
+              << "  --checkpoint-every N   every N events (default 100000)\n"
+              << "  --restore FILE         load the checkpoint in FILE and resume the feed where it left off\n"
+              << "  --stop-after N         stop after event N of the feed, as if the process died\n"
+              << "  --bars FILE            write time and volume bars to FILE (columnar, see bar_stage.h)\n"
+              << "  --bar-ns N             time bar length in feed ns (default 100000000)\n"
+              << "  --bar-volume N         volume bar size in filled quantity (default 1000)\n";
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    std::vector<std::string> positional;
+    std::string checkpoint_path, restore_path, bars_path;
+    BarConfig bar_config;
+    uint64_t checkpoint_every = 100000, stop_after = 0;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--checkpoint" && has_value) checkpoint_path = argv[++i];
+        else if (arg == "--checkpoint-every" && has_value) checkpoint_every = std::max(1ull, std::strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--restore" && has_value) restore_path = argv[++i];
+        else if (arg == "--stop-after" && has_value) stop_after = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--bars" && has_value) bars_path = argv[++i];
+        else if (arg == "--bar-ns" && has_value) bar_config.bar_ns = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--bar-volume" && has_value) bar_config.bar_volume = std::strtoll(argv[++i], nullptr, 10);
+        else if (arg.rfind("--", 0) == 0) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        else positional.push_back(arg);
+    }
+
     MarketSnapshot snapshot;
     OrderManager om;
 
-    const std::string feed_path = "sample_feed.txt";
+    // every order goes through the pre-trade checks; the feed is one symbol
+    const int symbol = 0;
+    RiskGateway gateway(om);
+    gateway.set_limits(symbol, RiskLimits{});
+    PositionKeeper positions(MarkSource::Mid);
+    FillsToPositions fills(positions, symbol);
+    om.add_listener(&fills);
+
+    const std::string feed_path = positional.size() > 0 ? positional[0] : "sample_feed.txt";
+    const std::string latency_csv = positional.size() > 1 ? positional[1] : "latency.csv";
+
+    FeedReader feed(feed_path);
+    if (!feed.ok()) {
+        std::cerr << "Could not open feed file: " << feed_path << "\n";
+    }
+
+    // events processed so far, counted from the start of the feed
+    uint64_t events = 0;
+    if (!restore_path.empty()) {
+        CheckpointInfo info;
+        const uint64_t t0 = now_ns();
+        if (restore_checkpoint(restore_path, snapshot, om, gateway, positions, 0, &info)) {
+            feed.seek(info.feed_offset);
+            events = info.events;
+            std::cout << "Restored " << restore_path << ": " << info.events << " events, "
+                      << info.active_orders << " active and " << info.archived_orders << " closed orders in "
+                      << (now_ns() - t0) / 1e6 << " ms, resuming at byte " << info.feed_offset << "\n";
+        } else {
+            std::cerr << "Could not restore " << restore_path << ", replaying the feed from the start\n";
+        }
+    }
+
+    std::unique_ptr<CheckpointWriter> checkpoints;
+    if (!checkpoint_path.empty()) checkpoints = std::make_unique<CheckpointWriter>(checkpoint_path);
+
+    // bars are built during the replay; off unless --bars is given
+    std::unique_ptr<BarWriter> bar_file;
+    std::unique_ptr<BarStage> bars;
+    if (!bars_path.empty()) {
+        bar_file = std::make_unique<BarWriter>(bars_path, bar_config);
+        if (!bar_file->ok()) std::cerr << "Could not open bar file: " << bars_path << "\n";
+        bars = std::make_unique<BarStage>(bar_config, bar_file.get());
+    }
+
+    // per-stage timings, only with -DLATENCY_PROBES
+    LatencyRecorder latency;
+
+    FeedEvent ev;
+    uint64_t feed_ns = 0;  // throttle clock, see TEXT_GAP_NS
+    for (;;) {
+        bool more;
+        {
+            LATENCY_SCOPE(latency, LatencyStage::Parse);
+            more = feed.next(ev);
+        }
+        if (!more) break;
+        feed_ns = feed.binary() ? ev.ts_ns : feed_ns + TEXT_GAP_NS;
 
-    for (const auto& ev : load_feed(feed_path)) {
         switch (ev.type) {
-            case EventType::Bid:
+            case FeedType::Bid: {
+                LATENCY_SCOPE(latency, LatencyStage::UpdateBid);
                 // Snapshot semantics: qty==0 removes the level; else set to absolute qty
                 snapshot.update_bid(ev.price, ev.qty);
+                gateway.on_market(symbol, snapshot);
+                positions.on_market(symbol, snapshot);
                 break;
+            }
 
-            case EventType::Ask:
+            case FeedType::Ask: {
+                LATENCY_SCOPE(latency, LatencyStage::UpdateAsk);
                 snapshot.update_ask(ev.price, ev.qty);
+                gateway.on_market(symbol, snapshot);
+                positions.on_market(symbol, snapshot);
                 break;
+            }
 
-            case EventType::Execution:
-                if (ev.id != -1 && ev.qty > 0) {
-                    om.handle_fill(ev.id, ev.qty);  // incremental fill
+            case FeedType::Execution:
+                // an execution's price field is the order id
+                if (ev.price_ticks != -1 && ev.qty > 0) {
+                    // the feed names the order, not the price: trade at the order's price
+                    const MyOrder* order = bars ? om.find(ev.price_ticks) : nullptr;
+                    const double price = order ? order->price : 0.0;
+                    int done;
+                    {
+                        LATENCY_SCOPE(latency, LatencyStage::Fill);
+                        done = gateway.handle_fill(ev.price_ticks, ev.qty);  // incremental fill
+                    }
+                    if (bars && done > 0) bars->on_trade(symbol, feed_ns, price, done);
                 }
                 break;
         }
 
-        if (should_trade(snapshot)) {
+        if (bars && ev.type != FeedType::Execution) {
+            const PriceLevel* bid = snapshot.get_best_bid();
+            const PriceLevel* ask = snapshot.get_best_ask();
+            if (bid && ask) bars->on_quote(symbol, feed_ns, bid->price, ask->price);
+        }
+
+        bool trade;
+        {
+            LATENCY_SCOPE(latency, LatencyStage::ShouldTrade);
+            trade = should_trade(snapshot);
+        }
+        if (trade) {
             auto bestBid = snapshot.get_best_bid();
             if (bestBid) {
-                int id = om.place_order(Side::Buy, bestBid->price, 10);
-                std::cout << "Placed BUY order at " << bestBid->price
-                          << " (id=" << id << ")\n";
+                RiskReject why;
+                int id;
+                {
+                    LATENCY_SCOPE(latency, LatencyStage::PlaceOrder);
+                    id = gateway.place_order(symbol, Side::Buy, bestBid->price, 10, feed_ns, &why);
+                }
+                if (id < 0) {
+                    std::cout << "Rejected BUY order at " << bestBid->price
+                              << " (" << to_string(why) << ")\n";
+                } else {
+                    std::cout << "Placed BUY order at " << bestBid->price
+                              << " (id=" << id << ")\n";
+                }
             }
         }
+
+        events++;
+        if (checkpoints && events % checkpoint_every == 0) {
+            checkpoints->capture(snapshot, om, gateway, positions, feed.offset(), events, feed_ns);
+        }
+        if (stop_after && events >= stop_after) {
+            std::cout << "Stopped after event " << events << "\n";
+            return 0;
+        }
     }
 
     std::cout << "\nFinal active orders:\n";
     om.print_active_orders();
+
+    const PositionView p = positions.read(symbol);
+    std::cout << "\nPosition: " << p.position << " @ " << p.avg_price
+              << " | Mark (" << to_string(positions.mark_source()) << "): " << p.mark
+              << " | Realized PnL: " << p.realized_pnl
+              << " | Unrealized PnL: " << p.unrealized_pnl << '\n';
+
+    if (bars) {
+        bars->finish();
+        const BarTotals& t = bars->totals(symbol);
+        std::cout << "\nBars: " << t.time_bars << " time and " << t.volume_bars << " volume bars in "
+                  << bar_file->batches() << " batches to " << bars_path << " | " << t.quotes << " quotes, spread mean "
+                  << t.spread_mean() << " min " << t.spread_min << " max " << t.spread_max << " | " << t.trades
+                  << " trades, volume " << t.volume << ", VWAP " << t.vwap() << "\n";
+    }
+
+    if (checkpoints) {
+        checkpoints->wait_idle();
+        std::cout << "\nCheckpoints: " << checkpoints->written() << " written, " << checkpoints->skipped()
+                  << " skipped, last " << checkpoints->last_bytes() << " bytes (copy "
+                  << checkpoints->last_capture_ns() / 1e3 << " us on this thread, write "
+                  << checkpoints->last_write_ns() / 1e6 << " ms in the background)\n";
+    }
+
+    LATENCY_REPORT(latency, std::cout, latency_csv);
 }
@@ -1,4 +1,7 @@
 #include "market_snapshot.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <memory>  // for std::make_unique
 
 // Define methods as belonging to MarketSnapshot (use the scope resolution operator ::)
@@ -7,11 +10,12 @@ void MarketSnapshot::update_bid(double price, int qty)
     auto it = bids.find(price);
     if (it == bids.end())
     {
-        bids.emplace(price, std::make_unique<PriceLevel>(price, qty));
+        it = bids.emplace(price, std::make_unique<PriceLevel>(price, qty)).first;
     } else
     {
         it->second->quantity += qty;
     }
+    if (!listeners_.empty()) notify(BookSide::Bid, *it->second);
 }
 
 void MarketSnapshot::update_ask(double price, int qty)
@@ -19,11 +23,18 @@ void MarketSnapshot::update_ask(double price, int qty)
     auto it = asks.find(price);
     if (it == asks.end())
     {
-        asks.emplace(price, std::make_unique<PriceLevel>(price, qty));
+        it = asks.emplace(price, std::make_unique<PriceLevel>(price, qty)).first;
     } else
     {
         it->second->quantity += qty;
     }
+    if (!listeners_.empty()) notify(BookSide::Ask, *it->second);
+}
+
+void MarketSnapshot::apply(const BookUpdate& update)
+{
+    if (update.side == BookSide::Bid) update_bid(update.price, update.qty);
+    else update_ask(update.price, update.qty);
 }
 
 // These are const because they don’t modify the object
@@ -38,3 +49,164 @@ const PriceLevel* MarketSnapshot::get_best_ask() const
     if (asks.empty()) return nullptr;
     return asks.begin()->second.get();
 }
+
+int MarketSnapshot::top_levels(BookSide side, const PriceLevel** out, int n) const
+{
+    int count = 0;
+    if (side == BookSide::Bid)
+    {
+        for (auto it = bids.begin(); it != bids.end() && count < n; ++it) out[count++] = it->second.get();
+    } else
+    {
+        for (auto it = asks.begin(); it != asks.end() && count < n; ++it) out[count++] = it->second.get();
+    }
+    return count;
+}
+
+namespace {
+
+// How far apply_batch() walks from the last level found before it falls
+// back to a full lookup.
+constexpr int WALK_STEPS = 4;
+
+struct BestLevel {
+    bool present;
+    double price;
+    int quantity;
+};
+
+BestLevel best_of(const PriceLevel* level)
+{
+    return level ? BestLevel{true, level->price, level->quantity} : BestLevel{false, 0.0, 0};
+}
+
+bool changed(const BestLevel& a, const BestLevel& b)
+{
+    return a.present != b.present || a.price != b.price || a.quantity != b.quantity;
+}
+
+} // namespace
+
+BatchResult MarketSnapshot::apply_batch(const BookUpdate* updates, std::size_t n)
+{
+    BatchResult r;
+    if (n == 0) return r;
+    const BestLevel bid_before = best_of(get_best_bid());
+    const BestLevel ask_before = best_of(get_best_ask());
+
+    coalesce(updates, n);
+    // bids in the bid map's order (descending), then asks ascending
+    std::sort(pending_.begin(), pending_.end(), [](const PendingUpdate& a, const PendingUpdate& b) {
+        if (a.side != b.side) return a.side == BookSide::Bid;
+        return a.side == BookSide::Bid ? a.price > b.price : a.price < b.price;
+    });
+
+    PendingUpdate* begin = pending_.data();
+    PendingUpdate* end = begin + pending_.size();
+    PendingUpdate* asks_begin =
+        std::find_if(begin, end, [](const PendingUpdate& p) { return p.side == BookSide::Ask; });
+    locate(bids, begin, asks_begin);
+    locate(asks, asks_begin, end);
+    r.new_levels = apply_pending(bids, begin, asks_begin) + apply_pending(asks, asks_begin, end);
+    r.levels = (int)pending_.size();
+
+    if (!listeners_.empty()) {
+        for (const PendingUpdate& p : pending_) notify(p.side, *p.level);
+    }
+    r.best_bid_changed = changed(bid_before, best_of(get_best_bid()));
+    r.best_ask_changed = changed(ask_before, best_of(get_best_ask()));
+    return r;
+}
+
+// One pending entry per level, in the order the levels were first touched.
+// Open addressing over at least twice as many slots as updates; a new stamp
+// per batch empties the table without clearing it.
+void MarketSnapshot::coalesce(const BookUpdate* updates, std::size_t n)
+{
+    std::size_t size = 16;
+    while (size < 2 * n) size *= 2;
+    if (slots_.size() < size || ++stamp_ == 0) {
+        slots_.assign(std::max(size, slots_.size()), PendingSlot{0, 0});
+        stamp_ = 1;
+    }
+    const std::size_t mask = size - 1;
+
+    pending_.clear();
+    for (std::size_t i = 0; i < n; i++) {
+        const BookUpdate& u = updates[i];
+        // 0.0 and -0.0 are one level, as they are to the maps
+        const double key = u.price == 0.0 ? 0.0 : u.price;
+        uint64_t bits;
+        std::memcpy(&bits, &key, sizeof bits);
+        bits = (bits ^ (uint64_t)u.side) * 0x9e3779b97f4a7c15ull;
+        std::size_t at = (std::size_t)(bits >> 40) & mask;
+        while (slots_[at].stamp == stamp_) {
+            PendingUpdate& p = pending_[slots_[at].index];
+            if (p.side == u.side && p.price == u.price) break;
+            at = (at + 1) & mask;
+        }
+        if (slots_[at].stamp == stamp_) {
+            pending_[slots_[at].index].qty += u.qty;
+        } else {
+            slots_[at] = PendingSlot{stamp_, (uint32_t)pending_.size()};
+            pending_.push_back(PendingUpdate{u.side, u.qty, u.price, nullptr});
+        }
+    }
+}
+
+// Finds each pending level, in book order: the next one is usually at or
+// just past the last, so walk a few nodes before a full lookup. Prefetches
+// the PriceLevel for apply_pending() and the node the next walk starts on.
+template <class Levels>
+void MarketSnapshot::locate(Levels& levels, PendingUpdate* p, PendingUpdate* end)
+{
+    if (p == end) return;
+    const auto before = levels.key_comp();
+    auto it = levels.lower_bound(p->price);
+    for (bool first = true; p != end; ++p, first = false) {
+        if (!first) {
+            for (int steps = 0; steps < WALK_STEPS && it != levels.end() && before(it->first, p->price); steps++) ++it;
+            if (it != levels.end() && before(it->first, p->price)) it = levels.lower_bound(p->price);
+        }
+        if (it == levels.end()) {
+            p->level = nullptr;
+            continue;
+        }
+        p->level = before(p->price, it->first) ? nullptr : it->second.get();
+        if (p->level) __builtin_prefetch(p->level, 1);
+        const auto next = std::next(it);
+        if (next != levels.end()) __builtin_prefetch(&*next);
+    }
+}
+
+// Adds the summed quantities; creates the levels locate() did not find.
+// Returns how many it created.
+template <class Levels>
+int MarketSnapshot::apply_pending(Levels& levels, PendingUpdate* p, PendingUpdate* end)
+{
+    int created = 0;
+    for (; p != end; ++p) {
+        if (p->level) {
+            p->level->quantity += p->qty;
+            continue;
+        }
+        p->level = levels.emplace(p->price, std::make_unique<PriceLevel>(p->price, p->qty)).first->second.get();
+        created++;
+    }
+    return created;
+}
+
+void MarketSnapshot::add_listener(BookListener* listener)
+{
+    if (listener) listeners_.push_back(listener);
+}
+
+void MarketSnapshot::remove_listener(BookListener* listener)
+{
+    listeners_.erase(std::remove(listeners_.begin(), listeners_.end(), listener), listeners_.end());
+}
+
+void MarketSnapshot::notify(BookSide side, const PriceLevel& level) const
+{
+    for (BookListener* l : listeners_) l->on_book_update(side, level);
+}
@@ -1,8 +1,11 @@
 #ifndef MARKET_SNAPSHOT_H
 #define MARKET_SNAPSHOT_H
 
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <vector>
 
 struct PriceLevel {
     double price;
@@ -11,15 +14,87 @@ struct PriceLevel {
     PriceLevel(double p, int q) : price(p), quantity(q) {}
 };
 
+enum class BookSide { Bid, Ask };
+
+// Told about every level change, with the level as it is after the update.
+class BookListener
+{
+public:
+    virtual ~BookListener() = default;
+    virtual void on_book_update(BookSide side, const PriceLevel& level) = 0;
+};
+
+// One book update: what update_bid or update_ask would be called with.
+struct BookUpdate {
+    BookSide side;
+    int qty;
+    double price;
+};
+
+// What a batch changed, worked out once at the end of it.
+struct BatchResult {
+    int levels = 0;                 // distinct levels the batch touched
+    int new_levels = 0;             // of those, the ones it created
+    bool best_bid_changed = false;  // price or quantity of the best level
+    bool best_ask_changed = false;
+};
+
+// Single-threaded: the pointers it hands out point into its maps. Other
+// threads read the top of book through TopOfBookPublisher (top_of_book.h).
 class MarketSnapshot
 {
 public:
     void update_bid(double price, int qty);
     void update_ask(double price, int qty);
+    // update_bid or update_ask, by the update's side.
+    void apply(const BookUpdate& update);
     const PriceLevel* get_best_bid() const;
     const PriceLevel* get_best_ask() const;
+    // Up to n best levels of one side, best first. Returns how many.
+    int top_levels(BookSide side, const PriceLevel** out, int n) const;
+
+    // Leaves the same book as calling update_bid / update_ask for each of
+    // updates[0..n) in order. Updates to one level are summed first (in a
+    // small hash table), and the levels are looked up once each in book
+    // order, prefetching each level's quantity and the next node ahead of
+    // use. Listeners are told once per level touched, with its state after
+    // the batch: bids best first, then asks.
+    BatchResult apply_batch(const BookUpdate* updates, std::size_t n);
+
+    // Same rules as OrderManager's listeners: called synchronously in
+    // registration order, must outlive the snapshot or be removed first.
+    void add_listener(BookListener* listener);
+    void remove_listener(BookListener* listener);
 
 private:
+    friend struct CheckpointAccess;  // checkpoint.cpp
+
+    std::vector<BookListener*> listeners_;
+
+    void notify(BookSide side, const PriceLevel& level) const;
+
+    struct PendingUpdate {
+        BookSide side;
+        int qty;            // summed over the batch
+        double price;       // as in the level's first update, which creates it
+        PriceLevel* level;  // set by locate(), null for a level the batch creates
+    };
+    struct PendingSlot {
+        uint32_t stamp;     // batch that filled the slot; older ones are empty
+        uint32_t index;     // into pending_
+    };
+    // apply_batch() scratch, kept between batches
+    std::vector<PendingUpdate> pending_;
+    std::vector<PendingSlot> slots_;
+    uint32_t stamp_ = 0;
+
+    void coalesce(const BookUpdate* updates, std::size_t n);
+
+    template <class Levels>
+    static void locate(Levels& levels, PendingUpdate* p, PendingUpdate* end);
+    template <class Levels>
+    static int apply_pending(Levels& levels, PendingUpdate* p, PendingUpdate* end);
+
     std::map<double, std::unique_ptr<PriceLevel>, std::greater<>> bids; // sorted descending
     std::map<double, std::unique_ptr<PriceLevel>> asks; // sorted ascending
 };
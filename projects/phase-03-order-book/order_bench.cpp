@@ -0,0 +1,202 @@
+// Order lifecycle: event and archive checks, then lifecycle latency.
+//
+// The checks drive orders through place / partial fill / replace / fill /
+// cancel and compare the events listeners receive, the active list and the
+// archive with the expected ones, including cancel/replace through the risk
+// gateway. Any mismatch makes the program exit with status 1. The timed
+// cases measure each lifecycle step and walking the active orders with a
+// long closed history behind them.
+
+#include "order_manager.h"
+#include "risk_gateway.h"
+
+#include "bench_harness.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+bench::Checks checks;
+
+// Records every event as "Type id price qty filled fill".
+class Recorder : public OrderListener
+{
+public:
+    std::vector<std::string> events;
+
+    void on_order_event(const OrderEvent& ev) override
+    {
+        std::ostringstream s;
+        s << to_string(ev.type) << ' ' << ev.id << ' ' << ev.price << ' ' << ev.quantity << ' ' << ev.filled
+          << ' ' << ev.last_fill_qty;
+        if (ev.type == OrderEventType::Replaced) s << " was " << ev.old_price << ' ' << ev.old_quantity;
+        events.push_back(s.str());
+    }
+};
+
+class Counter : public OrderListener
+{
+public:
+    long n = 0;
+    void on_order_event(const OrderEvent&) override { ++n; }
+};
+
+std::vector<int> active_ids(const OrderManager& om)
+{
+    std::vector<int> ids;
+    for (const MyOrder* o = om.first_active(); o; o = o->next_active) ids.push_back(o->id);
+    return ids;
+}
+
+void run_checks()
+{
+    std::printf("lifecycle checks\n");
+
+    // OrderManager prints fills; keep the check output readable
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+
+    {
+        OrderManager om;
+        Recorder rec;
+        om.add_listener(&rec);
+        const int a = om.place_order(Side::Buy, 100.0, 10);
+        const int b = om.place_order(Side::Sell, 101.0, 5);
+        const int c = om.place_order(Side::Buy, 99.0, 7);
+        om.handle_fill(a, 4);
+        checks.expect("replace below the filled qty is refused", !om.replace(a, 100.0, 4));
+        checks.expect("replace to 6 @ 100.5", om.replace(a, 100.5, 6));
+        om.handle_fill(a, 5);
+        checks.expect("cancel of an active order", om.cancel(b));
+        checks.expect("cancel of a closed order is refused", !om.cancel(b));
+        checks.expect("replace of a closed order is refused", !om.replace(a, 100.0, 20));
+        checks.expect("fill on a closed order applies nothing", om.handle_fill(a, 1) == 0);
+
+        const std::vector<std::string> want = {
+            "New 1 100 10 0 0",
+            "New 2 101 5 0 0",
+            "New 3 99 7 0 0",
+            "PartiallyFilled 1 100 10 4 4",
+            "Replaced 1 100.5 6 4 0 was 100 10",
+            "Filled 1 100.5 6 6 2",
+            "Cancelled 2 101 5 0 0",
+        };
+        checks.expect("event sequence", rec.events == want);
+        if (rec.events != want) {
+            for (const auto& e : rec.events) std::printf("       got: %s\n", e.c_str());
+        }
+        checks.expect("only order 3 is active", active_ids(om) == std::vector<int>{c} && om.active_count() == 1);
+        checks.expect("find() sees active orders only", om.find(c) && !om.find(a) && !om.find(b));
+
+        const auto& arch = om.archive();
+        checks.expect("archive holds 1 filled then 2 cancelled",
+                      arch.size() == 2 && arch[0].id == a && arch[0].status == OrderStatus::Filled &&
+                      arch[0].filled == 6 && arch[0].price == 100.5 && arch[1].id == b &&
+                      arch[1].status == OrderStatus::Cancelled && arch[1].filled == 0);
+
+        om.remove_listener(&rec);
+        om.cancel(c);
+        checks.expect("no events after remove_listener", rec.events.size() == want.size());
+        checks.expect("active list empty", om.first_active() == nullptr && om.active_count() == 0);
+    }
+
+    {
+        // unlinking from the head, middle and tail keeps placement order
+        OrderManager om;
+        for (int i = 0; i < 6; ++i) om.place_order(Side::Buy, 100.0, 1);
+        om.cancel(1);
+        om.cancel(4);
+        om.handle_fill(6, 1);
+        checks.expect("active list after head/middle/tail removal", active_ids(om) == (std::vector<int>{2, 3, 5}));
+    }
+
+    {
+        MarketSnapshot book;
+        book.update_bid(99.95, 500);
+        book.update_ask(100.05, 500);
+        OrderManager om;
+        RiskGateway gw(om, ThrottleLimits{1e9, 1});
+        RiskLimits l;
+        l.max_position = 30;
+        gw.set_limits(0, l);
+        gw.on_market(0, book);
+
+        const int a = gw.place_order(0, Side::Buy, 100.0, 20, 0);
+        gw.handle_fill(a, 5);
+        checks.expect("gateway replace to 40 breaches max_position 30",
+                      gw.replace(a, 100.0, 40, 1) == RiskReject::PositionLimit);
+        checks.expect("order unchanged after the rejected replace", om.find(a)->quantity == 20);
+        checks.expect("exposure restored: buy 10 more fits",
+                      gw.check_order(0, Side::Buy, 100.0, 10, 2) == RiskReject::None);
+        checks.expect("exposure restored: buy 11 more does not",
+                      gw.check_order(0, Side::Buy, 100.0, 11, 3) == RiskReject::PositionLimit);
+        checks.expect("gateway replace outside the band", gw.replace(a, 102.0, 20, 4) == RiskReject::PriceBand);
+        checks.expect("gateway replace to 10 @ 99.99", gw.replace(a, 99.99, 10, 5) == RiskReject::None);
+        checks.expect("exposure shrank: buy 20 more fits",
+                      gw.check_order(0, Side::Buy, 100.0, 20, 6) == RiskReject::None);
+        checks.expect("open notional is 5 @ 99.99", std::abs(gw.open_notional(0) - 5 * 99.99) < 1e-9);
+        checks.expect("gateway replace at the filled qty", gw.replace(a, 99.99, 5, 7) == RiskReject::BadOrder);
+        gw.cancel(a);
+        checks.expect("replace after cancel", gw.replace(a, 99.99, 10, 8) == RiskReject::BadOrder);
+        checks.expect("cancel releases everything", gw.open_notional(0) == 0.0 && gw.position(0) == 5);
+    }
+
+    std::cout.rdbuf(out);
+    std::printf("%s\n\n", checks.passed() ? "all lifecycle checks passed" : "LIFECYCLE CHECKS FAILED");
+}
+
+} // namespace
+
+int main()
+{
+    run_checks();
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+
+    auto report = [&](const bench::CaseResult& r, const char* unit) {
+        std::cout.rdbuf(out);
+        bench::Runner::print_case(stdout, r);
+        std::printf("    %-30s %8.2f ns/%s\n", (r.name + " [" + r.params_str() + "]").c_str(), r.ns_per_op(), unit);
+        std::cout.rdbuf(nullptr);
+    };
+
+    constexpr int N = 1 << 12;
+    {
+        OrderManager om;
+        Counter events;
+        om.add_listener(&events);
+        report(runner.run("place_cancel", {{"listeners", "1"}}, N, [&] {
+            for (int i = 0; i < N; ++i) om.cancel(om.place_order(Side::Buy, 100.0, 10));
+        }), "order");
+        report(runner.run("place_replace_cancel", {{"listeners", "1"}}, N, [&] {
+            for (int i = 0; i < N; ++i) {
+                const int id = om.place_order(Side::Buy, 100.0, 10);
+                om.replace(id, 100.01, 12);
+                om.cancel(id);
+            }
+        }), "order");
+        bench::do_not_optimize(events.n);
+    }
+
+    // 64 active orders behind 0, 10^4 or 10^6 closed ones
+    for (int closed : {0, 10000, 1000000}) {
+        OrderManager om;
+        for (int i = 0; i < closed; ++i) om.cancel(om.place_order(Side::Buy, 100.0, 10));
+        for (int i = 0; i < 64; ++i) om.place_order(Side::Buy, 100.0, 10);
+        report(runner.run("walk_active", {{"active", "64"}, {"closed", std::to_string(closed)}}, 64, [&] {
+            long qty = 0;
+            for (const MyOrder* o = om.first_active(); o; o = o->next_active) qty += o->quantity - o->filled;
+            bench::do_not_optimize(qty);
+        }), "order");
+    }
+
+    std::cout.rdbuf(out);
+    runner.write_reports();
+    return checks.passed() ? 0 : 1;
+}
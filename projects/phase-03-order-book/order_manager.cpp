@@ -1,30 +1,48 @@
 #include "order_manager.h"
+#include <algorithm>
 #include <iostream>
 #include <memory>
 
-int OrderManager::next_id_ = 1;
+const char* to_string(OrderEventType t)
+{
+    switch (t) {
+    case OrderEventType::New: return "New";
+    case OrderEventType::PartiallyFilled: return "PartiallyFilled";
+    case OrderEventType::Filled: return "Filled";
+    case OrderEventType::Replaced: return "Replaced";
+    case OrderEventType::Cancelled: return "Cancelled";
+    }
+    return "Unknown";
+}
+
+OrderManager::OrderManager() : log_(&std::cout) {}
 
 int OrderManager::place_order(Side side, double price, int qty)
 {
     int id = next_id_++;
-    orders.emplace_hint(
+    auto it = orders.emplace_hint(
         orders.end(),
         id,
         std::make_unique<MyOrder>(MyOrder{id, side, price, qty}));
 
+    // append to the active list
+    MyOrder* o = it->second.get();
+    o->prev_active = active_tail_;
+    if (active_tail_) active_tail_->next_active = o;
+    else active_head_ = o;
+    active_tail_ = o;
+
+    emit(OrderEventType::New, *o);
     return id;
 }
 
 void OrderManager::print_active_orders() const
 {
     std::cout << "Active orders:\n";
-    for (const auto& [id, orderPtr] : orders)
+    for (const MyOrder* p = active_head_; p; p = p->next_active)
     {
-        const MyOrder& o = *orderPtr;
-        if (o.status == OrderStatus::Filled || o.status == OrderStatus::Cancelled)
-            continue;
-
-        std::cout << "ID " << id
+        const MyOrder& o = *p;
+        std::cout << "ID " << o.id
                   << " | Side: " << (o.side == Side::Buy ? "Buy" : "Sell")
                   << " | Price: " << o.price
                   << " | Qty: " << o.quantity
@@ -42,30 +60,83 @@ void OrderManager::print_active_orders() const
     }
 }
 
-void OrderManager::cancel(int id)
+const MyOrder* OrderManager::find(int id) const
 {
-    if (orders.find(id) != orders.end())
-    {
-        orders.erase(id);
-    }
+    auto it = orders.find(id);
+    return it == orders.end() ? nullptr : it->second.get();
+}
+
+void OrderManager::add_listener(OrderListener* listener)
+{
+    if (listener) listeners_.push_back(listener);
+}
+
+void OrderManager::remove_listener(OrderListener* listener)
+{
+    listeners_.erase(std::remove(listeners_.begin(), listeners_.end(), listener), listeners_.end());
+}
+
+void OrderManager::emit(OrderEventType type, const MyOrder& o, int last_fill_qty,
+                        double old_price, int old_quantity) const
+{
+    if (listeners_.empty()) return;
+    const OrderEvent ev{type, o.id, o.side, o.price, o.quantity, o.filled,
+                        last_fill_qty, old_price, old_quantity};
+    for (OrderListener* l : listeners_) l->on_order_event(ev);
+}
+
+void OrderManager::close(std::map<int, std::unique_ptr<MyOrder>>::iterator it)
+{
+    MyOrder* o = it->second.get();
+    if (o->prev_active) o->prev_active->next_active = o->next_active;
+    else active_head_ = o->next_active;
+    if (o->next_active) o->next_active->prev_active = o->prev_active;
+    else active_tail_ = o->prev_active;
+
+    archive_.push_back(ClosedOrder{o->id, o->quantity, o->filled, o->side, o->status, 0, o->price});
+    orders.erase(it);
 }
 
-void OrderManager::handle_fill(int id, int filled_qty)
+bool OrderManager::cancel(int id)
 {
     auto it = orders.find(id);
-    if (it == orders.end()) {
-        std::cout << "Order " << id << " not found.\n";
-        return;
-    }
+    if (it == orders.end()) return false;
+
+    it->second->status = OrderStatus::Cancelled;
+    emit(OrderEventType::Cancelled, *it->second);
+    close(it);
+    return true;
+}
+
+bool OrderManager::replace(int id, double price, int qty)
+{
+    auto it = orders.find(id);
+    if (it == orders.end()) return false;
 
     MyOrder& order = *it->second;
+    if (!(price > 0.0) || qty <= order.filled) return false;
+
+    const double old_price = order.price;
+    const int old_quantity = order.quantity;
+    order.price = price;
+    order.quantity = qty;
+    emit(OrderEventType::Replaced, order, 0, old_price, old_quantity);
+    return true;
+}
 
-    if (order.status == OrderStatus::Filled || order.status == OrderStatus::Cancelled) {
-        std::cout << "Order " << id << " already closed.\n";
-        return;
+int OrderManager::handle_fill(int id, int filled_qty)
+{
+    auto it = orders.find(id);
+    if (it == orders.end()) {
+        // ids are handed out in order, so a lower one was placed and has closed
+        if (log_ && id > 0 && id < next_id_) *log_ << "Order " << id << " already closed.\n";
+        else if (log_) *log_ << "Order " << id << " not found.\n";
+        return 0;
     }
 
-    if (filled_qty <= 0) return;
+    MyOrder& order = *it->second;
+
+    if (filled_qty <= 0) return 0;
 
     int remaining = order.quantity - order.filled;
 
@@ -74,10 +145,15 @@ void OrderManager::handle_fill(int id, int filled_qty)
 
     if (order.filled >= order.quantity) {
         order.status = OrderStatus::Filled;
-        std::cout << "Order " << id << " fully filled (" << order.quantity << ").\n";
+        if (log_) *log_ << "Order " << id << " fully filled (" << order.quantity << ").\n";
+        emit(OrderEventType::Filled, order, delta);
+        close(it);
     } else {
         order.status = OrderStatus::PartiallyFilled;
-        std::cout << "Order " << id << " partially filled ("
-                  << order.filled << "/" << order.quantity << ").\n";
-    }}
-
+        if (log_) {
+            *log_ << "Order " << id << " partially filled (" << order.filled << "/" << order.quantity << ").\n";
+        }
+        emit(OrderEventType::PartiallyFilled, order, delta);
+    }
+    return delta;
+}
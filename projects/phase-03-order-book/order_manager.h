@@ -1,7 +1,10 @@
 #ifndef ORDER_MANAGER_H
 #define ORDER_MANAGER_H
+#include <cstdint>
+#include <iosfwd>
 #include <map>
 #include <memory>
+#include <vector>
 
 enum class Side { Buy, Sell };
 
@@ -14,18 +17,102 @@ struct MyOrder {
     int quantity;
     int filled = 0;
     OrderStatus status = OrderStatus::New;
+
+    // links in OrderManager's list of active orders, in placement order
+    MyOrder* prev_active = nullptr;
+    MyOrder* next_active = nullptr;
+};
+
+// A closed (filled or cancelled) order as kept in the archive.
+struct ClosedOrder {
+    int32_t id;
+    int32_t quantity;
+    int32_t filled;
+    Side side;
+    OrderStatus status;
+    int32_t reserved;  // zero; checkpoints copy the archive byte for byte
+    double price;
+};
+
+enum class OrderEventType { New, PartiallyFilled, Filled, Replaced, Cancelled };
+
+const char* to_string(OrderEventType t);
+
+// One state change of one order. The order fields are the values after the
+// change; for Replaced the old price and quantity are in old_price / old_quantity,
+// for fills the fill itself is last_fill_qty at the order price.
+struct OrderEvent {
+    OrderEventType type;
+    int id;
+    Side side;
+    double price;
+    int quantity;
+    int filled;
+    int last_fill_qty = 0;
+    double old_price = 0.0;
+    int old_quantity = 0;
+};
+
+class OrderListener
+{
+public:
+    virtual ~OrderListener() = default;
+    virtual void on_order_event(const OrderEvent& ev) = 0;
 };
 
+// Orders stay in `orders` (for lookup by id) and in an intrusive list (for
+// iteration) while they are active. When an order is filled or cancelled it
+// is appended to the archive and dropped from both, so walking the active
+// orders costs O(active) however long the session has run.
 class OrderManager
 {
 public:
+    OrderManager();
+
     int place_order(Side side, double price, int qty);
-    void cancel(int id);
-    void handle_fill(int id, int filled_qty);
+    // Returns false if the order is not active.
+    bool cancel(int id);
+    // Cancel/replace in place: new limit price and new total quantity. The
+    // quantity must stay above what has already filled. Returns false if the
+    // order is not active or the amend is invalid.
+    bool replace(int id, double price, int qty);
+    // Returns the quantity actually applied (0 if the order is unknown or closed).
+    int handle_fill(int id, int filled_qty);
+    // Active orders only.
+    const MyOrder* find(int id) const;
     void print_active_orders() const;
+
+    // Listeners are called synchronously, in registration order, for every
+    // state change. They must outlive the manager or be removed first, and
+    // must not add or remove listeners from inside the callback.
+    void add_listener(OrderListener* listener);
+    void remove_listener(OrderListener* listener);
+
+    // Where fill messages go (std::cout by default); nullptr silences them,
+    // e.g. for backtests running side by side.
+    void set_log(std::ostream* log) { log_ = log; }
+
+    // The id the next place_order will return.
+    int next_id() const { return next_id_; }
+    const MyOrder* first_active() const { return active_head_; }
+    std::size_t active_count() const { return orders.size(); }
+    const std::vector<ClosedOrder>& archive() const { return archive_; }
+
 private:
-    static int next_id_;
+    friend struct CheckpointAccess;  // checkpoint.cpp
+
+    int next_id_ = 1;
     std::map<int, std::unique_ptr<MyOrder>> orders;
+    MyOrder* active_head_ = nullptr;
+    MyOrder* active_tail_ = nullptr;
+    std::vector<ClosedOrder> archive_;
+    std::vector<OrderListener*> listeners_;
+    std::ostream* log_;
+
+    void emit(OrderEventType type, const MyOrder& o, int last_fill_qty = 0,
+              double old_price = 0.0, int old_quantity = 0) const;
+    // Unlink, archive and free a filled or cancelled order.
+    void close(std::map<int, std::unique_ptr<MyOrder>>::iterator it);
 };
 
-#endif
\ No newline at end of file
+#endif
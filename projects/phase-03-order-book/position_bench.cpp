@@ -0,0 +1,215 @@
+// Position keeper: PnL checks, torn-read check, then update and read latency.
+//
+// The PnL check drives random fills and marks over several symbols and
+// compares the incremental numbers with ones recomputed from scratch:
+// realized + unrealized must equal cash flow + position * mark, whatever the
+// cost method, and the totals must equal the sum over symbols. The reader
+// check runs a monitoring thread against a writer and verifies that every
+// snapshot it sees is internally consistent. Any failure makes the program
+// exit with status 1.
+
+#include "market_snapshot.h"
+#include "order_manager.h"
+#include "position_keeper.h"
+
+#include "bench_harness.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+bench::Checks checks;
+
+void expect_near(const char* what, double got, double want)
+{
+    const bool ok = std::abs(got - want) <= 1e-6 * std::max(1.0, std::abs(want));
+    if (!ok) checks.fail();
+    std::printf("  %-4s %-44s %.6f%s", ok ? "ok" : "FAIL", what, got, ok ? "\n" : "");
+    if (!ok) std::printf(", expected %.6f\n", want);
+}
+
+struct Fill {
+    int symbol;
+    Side side;
+    double price;
+    int qty;
+};
+
+std::vector<Fill> make_fills(int n, int symbols, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<Fill> v(n);
+    for (auto& f : v) {
+        f.symbol = (int)(rng() % symbols);
+        f.side = (rng() & 1) ? Side::Buy : Side::Sell;
+        f.price = 100.0 + (double)(rng() % 200) / 100.0;
+        f.qty = 1 + (int)(rng() % 50);
+    }
+    return v;
+}
+
+void run_checks()
+{
+    std::printf("pnl checks\n");
+    {
+        PositionKeeper k;
+        k.on_fill(0, Side::Buy, 100.0, 10);
+        k.on_fill(0, Side::Buy, 101.0, 10);
+        expect_near("avg after buy 10 @ 100, 10 @ 101", k.position(0).avg_price, 100.5);
+        k.on_fill(0, Side::Sell, 102.0, 5);
+        expect_near("realized after sell 5 @ 102", k.position(0).realized_pnl, 7.5);
+        expect_near("avg unchanged by a reduce", k.position(0).avg_price, 100.5);
+        k.on_fill(0, Side::Sell, 99.0, 25);
+        expect_near("realized after flip to -10 @ 99", k.position(0).realized_pnl, 7.5 - 22.5);
+        expect_near("avg of the flipped position", k.position(0).avg_price, 99.0);
+        k.on_mark(0, 98.0);
+        expect_near("unrealized of -10 marked at 98", k.position(0).unrealized_pnl, 10.0);
+        expect_near("gross exposure", k.portfolio().gross_exposure, 980.0);
+        expect_near("net exposure", k.portfolio().net_exposure, -980.0);
+    }
+    {
+        MarketSnapshot book;
+        book.update_bid(99.0, 300);
+        book.update_ask(101.0, 100);
+        PositionKeeper mid(MarkSource::Mid), micro(MarkSource::Microprice);
+        mid.on_market(0, book);
+        micro.on_market(0, book);
+        expect_near("mid of 99 x 300 / 101 x 100", mid.position(0).mark, 100.0);
+        expect_near("microprice leans to the thin ask", micro.position(0).mark, 100.5);
+    }
+    {
+        // incremental vs. recomputed over a random stream
+        constexpr int SYMBOLS = 8;
+        PositionKeeper k(MarkSource::Microprice);
+        std::mt19937 rng(11);
+        std::vector<double> cash(SYMBOLS, 0.0), mark(SYMBOLS, 0.0);
+        std::vector<int> pos(SYMBOLS, 0);
+        for (const Fill& f : make_fills(200000, SYMBOLS, 3)) {
+            k.on_fill(f.symbol, f.side, f.price, f.qty);
+            const int q = f.side == Side::Buy ? f.qty : -f.qty;
+            pos[f.symbol] += q;
+            cash[f.symbol] -= q * f.price;
+            if (mark[f.symbol] == 0.0) mark[f.symbol] = f.price;
+            if (rng() % 4 == 0) {
+                const int s = (int)(rng() % SYMBOLS);
+                mark[s] = 100.0 + (double)(rng() % 200) / 100.0;
+                k.on_mark(s, mark[s]);
+            }
+        }
+        double total = 0.0, gross = 0.0, realized = 0.0, unrealized = 0.0;
+        int bad = 0;
+        for (int s = 0; s < SYMBOLS; ++s) {
+            const PositionView& p = k.position(s);
+            const double want = cash[s] + pos[s] * mark[s];
+            bad += p.position != pos[s];
+            bad += std::abs(p.realized_pnl + p.unrealized_pnl - want) > 1e-6 * std::max(1.0, std::abs(want));
+            total += want;
+            gross += std::abs(pos[s]) * mark[s];
+            realized += p.realized_pnl;
+            unrealized += p.unrealized_pnl;
+        }
+        if (bad) {
+            checks.fail();
+            std::printf("  FAIL %d symbols disagree with cash + position * mark\n", bad);
+        } else {
+            std::printf("  ok   %-44s\n", "200000 fills: per-symbol pnl = cash + pos * mark");
+        }
+        const PortfolioView t = k.read_portfolio();
+        expect_near("total pnl", t.realized_pnl + t.unrealized_pnl, total);
+        expect_near("incremental realized total", t.realized_pnl, realized);
+        expect_near("incremental unrealized total", t.unrealized_pnl, unrealized);
+        expect_near("incremental gross exposure", t.gross_exposure, gross);
+    }
+
+    {
+        // a monitoring thread reading while the writer updates
+        PositionKeeper k;
+        const std::vector<Fill> fills = make_fills(1 << 16, 1, 5);
+        std::atomic<bool> stop{false};
+        long reads = 0, torn = 0;
+        std::thread monitor([&] {
+            while (!stop.load(std::memory_order_acquire)) {
+                const PositionView p = k.read(0);
+                // the writer computes both from the fields next to them, so
+                // a torn copy shows up as a mismatch
+                torn += p.unrealized_pnl != p.position * (p.mark - p.avg_price);
+                torn += p.exposure != std::abs(p.position) * p.mark;
+                ++reads;
+            }
+        });
+        for (int round = 0; round < 32; ++round) {
+            for (const Fill& f : fills) {
+                k.on_fill(0, f.side, f.price, f.qty);
+                k.on_mark(0, f.price + 0.01);
+            }
+        }
+        stop.store(true, std::memory_order_release);
+        monitor.join();
+        if (torn) checks.fail();
+        std::printf("  %-4s %-44s %ld reads, %ld torn\n", torn ? "FAIL" : "ok", "concurrent snapshot reads", reads, torn);
+    }
+
+    std::printf("%s\n\n", checks.passed() ? "all pnl checks passed" : "PNL CHECKS FAILED");
+}
+
+} // namespace
+
+int main()
+{
+    run_checks();
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+
+    constexpr int N = 1 << 12;
+    constexpr int SYMBOLS = 8;
+    const std::vector<Fill> fills = make_fills(N, SYMBOLS, 9);
+
+    auto report = [](const bench::CaseResult& r, const char* unit) {
+        bench::Runner::print_case(stdout, r);
+        std::printf("    %-22s %6.2f ns/%s\n", (r.name + " [" + r.params_str() + "]").c_str(), r.ns_per_op(), unit);
+    };
+
+    {
+        PositionKeeper k;
+        report(runner.run("on_fill", {{"symbols", std::to_string(SYMBOLS)}}, N, [&] {
+            for (const Fill& f : fills) k.on_fill(f.symbol, f.side, f.price, f.qty);
+        }), "fill");
+    }
+
+    // alternate between two books so every update moves the mark
+    for (MarkSource m : {MarkSource::Mid, MarkSource::Microprice}) {
+        MarketSnapshot a, b;
+        a.update_bid(99.95, 300);
+        a.update_ask(100.05, 100);
+        b.update_bid(99.96, 200);
+        b.update_ask(100.06, 400);
+        PositionKeeper k(m);
+        k.on_fill(0, Side::Buy, 100.0, 10);
+        report(runner.run("on_market", {{"mark", to_string(m)}}, N, [&] {
+            for (int i = 0; i < N; i += 2) {
+                k.on_market(0, a);
+                k.on_market(0, b);
+            }
+        }), "update");
+    }
+
+    {
+        PositionKeeper k;
+        k.on_fill(0, Side::Buy, 100.0, 10);
+        report(runner.run("read", {{"writer", "idle"}}, N, [&] {
+            double sum = 0.0;
+            for (int i = 0; i < N; ++i) sum += k.read(0).unrealized_pnl;
+            bench::do_not_optimize(sum);
+        }), "read");
+    }
+
+    runner.write_reports();
+    return checks.passed() ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+#include "position_keeper.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+const char* to_string(MarkSource m)
+{
+    switch (m) {
+    case MarkSource::Mid: return "mid";
+    case MarkSource::Microprice: return "microprice";
+    }
+    return "unknown";
+}
+
+PositionKeeper::PositionKeeper(MarkSource mark) : mark_source_(mark) {}
+
+const PositionView& PositionKeeper::position(int symbol) const
+{
+    static const PositionView none;
+    return (symbol >= 0 && symbol < MAX_SYMBOLS) ? symbols_[symbol] : none;
+}
+
+PositionView PositionKeeper::read(int symbol) const
+{
+    return (symbol >= 0 && symbol < MAX_SYMBOLS) ? published_[symbol].load() : PositionView{};
+}
+
+void PositionKeeper::remark(PositionView& p, double mark)
+{
+    const double unrealized = p.position * (mark - p.avg_price);
+    const double exposure = std::abs(p.position) * mark;
+
+    total_.unrealized_pnl += unrealized - p.unrealized_pnl;
+    total_.gross_exposure += exposure - p.exposure;
+    total_.net_exposure += p.position * mark - p.position * p.mark;
+
+    p.mark = mark;
+    p.unrealized_pnl = unrealized;
+    p.exposure = exposure;
+}
+
+void PositionKeeper::on_fill(int symbol, Side side, double price, int qty)
+{
+    if (symbol < 0 || symbol >= MAX_SYMBOLS || qty <= 0) return;
+    PositionView& p = symbols_[symbol];
+
+    // take the old position out of the totals at the old mark, change it,
+    // then put it back at the same mark
+    const double mark = p.mark > 0.0 ? p.mark : price;
+    total_.unrealized_pnl -= p.unrealized_pnl;
+    total_.gross_exposure -= p.exposure;
+    total_.net_exposure -= p.position * p.mark;
+    p.unrealized_pnl = 0.0;
+    p.exposure = 0.0;
+    p.mark = 0.0;
+
+    const int signed_qty = side == Side::Buy ? qty : -qty;
+    if (p.position == 0 || (p.position > 0) == (signed_qty > 0)) {
+        // opening or adding: blend the average cost
+        const int open = std::abs(p.position);
+        p.avg_price = (p.avg_price * open + price * qty) / (open + qty);
+        p.position += signed_qty;
+    } else {
+        // reducing, closing or flipping: realise against the average cost
+        const int closed = std::min(qty, std::abs(p.position));
+        const double pnl = closed * (price - p.avg_price) * (p.position > 0 ? 1 : -1);
+        p.realized_pnl += pnl;
+        total_.realized_pnl += pnl;
+        p.position += signed_qty;
+        if (p.position == 0) p.avg_price = 0.0;
+        else if (qty > closed) p.avg_price = price;  // flipped: the rest opens at the fill price
+    }
+
+    ++p.fills;
+    p.traded_qty += qty;
+    ++total_.fills;
+
+    remark(p, mark);
+    published_[symbol].store(p);
+    published_total_.store(total_);
+}
+
+void PositionKeeper::on_market(int symbol, const MarketSnapshot& snapshot)
+{
+    if (symbol < 0 || symbol >= MAX_SYMBOLS) return;
+    const PriceLevel* bid = snapshot.get_best_bid();
+    const PriceLevel* ask = snapshot.get_best_ask();
+    if (!bid || !ask) return;  // keep the last mark
+
+    double mark = 0.5 * (bid->price + ask->price);
+    if (mark_source_ == MarkSource::Microprice) {
+        const double size = (double)bid->quantity + ask->quantity;
+        if (size > 0.0) mark = (bid->price * ask->quantity + ask->price * bid->quantity) / size;
+    }
+    on_mark(symbol, mark);
+}
+
+void PositionKeeper::on_mark(int symbol, double mark)
+{
+    if (symbol < 0 || symbol >= MAX_SYMBOLS || !(mark > 0.0)) return;
+    PositionView& p = symbols_[symbol];
+    if (mark == p.mark) return;
+
+    remark(p, mark);
+    published_[symbol].store(p);
+    if (p.position != 0) published_total_.store(total_);
+}
@@ -0,0 +1,84 @@
+#ifndef POSITION_KEEPER_H
+#define POSITION_KEEPER_H
+
+#include <cstdint>
+
+#include "market_snapshot.h"
+#include "order_manager.h"
+#include "seqlock.h"
+
+// Inventory, average cost and PnL per symbol, kept up to date one event at a
+// time: a fill or a top-of-book change is O(1) and never walks the fill
+// history or the other symbols.
+//
+// One thread (the one handling the feed) calls on_fill / on_market. After
+// every change the affected symbol and the portfolio totals are published
+// through seqlocks, so a monitoring thread can read them at any time
+// without locks and without slowing the writer down.
+
+enum class MarkSource {
+    Mid,         // (bid + ask) / 2
+    Microprice,  // size-weighted: (bid * ask_qty + ask * bid_qty) / (bid_qty + ask_qty)
+};
+
+const char* to_string(MarkSource m);
+
+struct PositionView {
+    int position = 0;              // signed, + long / - short
+    double avg_price = 0.0;        // average cost of the open position, 0 when flat
+    double mark = 0.0;             // last mark price (the fill price until the book has both sides)
+    double realized_pnl = 0.0;
+    double unrealized_pnl = 0.0;   // position * (mark - avg_price)
+    double exposure = 0.0;         // |position| * mark
+    uint64_t fills = 0;
+    int64_t traded_qty = 0;
+};
+
+struct PortfolioView {
+    double realized_pnl = 0.0;
+    double unrealized_pnl = 0.0;
+    double gross_exposure = 0.0;   // sum of |position| * mark
+    double net_exposure = 0.0;     // sum of position * mark
+    uint64_t fills = 0;
+};
+
+class PositionKeeper
+{
+public:
+    static constexpr int MAX_SYMBOLS = 64;
+
+    explicit PositionKeeper(MarkSource mark = MarkSource::Mid);
+
+    // Writer thread.
+    void on_fill(int symbol, Side side, double price, int qty);
+    void on_market(int symbol, const MarketSnapshot& snapshot);
+    void on_mark(int symbol, double mark);
+
+    // Writer thread: the current state without going through the seqlock.
+    const PositionView& position(int symbol) const;
+    const PortfolioView& portfolio() const { return total_; }
+
+    // Any thread: a consistent copy of one symbol or of the totals. The two
+    // are published separately, so a symbol read and a totals read may be
+    // one update apart.
+    PositionView read(int symbol) const;
+    PortfolioView read_portfolio() const { return published_total_.load(); }
+
+    MarkSource mark_source() const { return mark_source_; }
+
+private:
+    friend struct CheckpointAccess;  // checkpoint.cpp
+
+    MarkSource mark_source_;
+    PositionView symbols_[MAX_SYMBOLS];
+    PortfolioView total_;
+
+    SeqlockCell<PositionView> published_[MAX_SYMBOLS];
+    SeqlockCell<PortfolioView> published_total_;
+
+    // Re-mark one symbol and move its old contribution to the totals out
+    // and the new one in.
+    void remark(PositionView& p, double mark);
+};
+
+#endif //POSITION_KEEPER_H
@@ -0,0 +1,274 @@
+// Pre-trade risk gateway: rejection checks, then check latency.
+//
+// The checks place orders through a fresh RiskGateway for each scenario and
+// compare the verdict with the expected one; any mismatch makes the program
+// exit with status 1. The latency cases then time check_order on
+// precomputed orders for the accept path and for rejects at early, late and
+// throttle stages, plus place_order + cancel through OrderManager for scale.
+
+#include "market_snapshot.h"
+#include "order_manager.h"
+#include "risk_gateway.h"
+
+#include "bench_harness.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t MS = 1000000;
+
+bench::Checks checks;
+
+void expect(const char* what, RiskReject got, RiskReject want)
+{
+    const bool ok = got == want;
+    if (!ok) checks.fail();
+    std::printf("  %-4s %-52s %s%s%s\n", ok ? "ok" : "FAIL", what, to_string(got),
+                ok ? "" : ", expected ", ok ? "" : to_string(want));
+}
+
+// 99.95 / 100.05 book, mid 100
+void make_book(MarketSnapshot& snap)
+{
+    snap.update_bid(99.95, 500);
+    snap.update_ask(100.05, 500);
+}
+
+void run_checks()
+{
+    std::printf("rejection checks\n");
+    MarketSnapshot book;
+    make_book(book);
+
+    {
+        OrderManager om;
+        RiskGateway gw(om);
+        gw.on_market(0, book);
+        expect("symbol -1", gw.check_order(-1, Side::Buy, 100.0, 1, 0), RiskReject::UnknownSymbol);
+        expect("symbol MAX_SYMBOLS", gw.check_order(RiskGateway::MAX_SYMBOLS, Side::Buy, 100.0, 1, 0),
+               RiskReject::UnknownSymbol);
+        expect("qty 0", gw.check_order(0, Side::Buy, 100.0, 0, 0), RiskReject::BadOrder);
+        expect("negative qty", gw.check_order(0, Side::Sell, 100.0, -5, 0), RiskReject::BadOrder);
+        expect("price 0", gw.check_order(0, Side::Buy, 0.0, 1, 0), RiskReject::BadOrder);
+        expect("price NaN", gw.check_order(0, Side::Buy, std::nan(""), 1, 0), RiskReject::BadOrder);
+        expect("qty 101 > max_order_qty 100", gw.check_order(0, Side::Buy, 100.0, 101, 0), RiskReject::MaxOrderQty);
+        expect("100 @ 600 > max_order_notional 50000", gw.check_order(0, Side::Buy, 600.0, 100, 0),
+               RiskReject::MaxOrderNotional);
+        expect("buy 1% + 1 tick above mid", gw.check_order(0, Side::Buy, 101.01, 1, 0), RiskReject::PriceBand);
+        expect("sell 1% + 1 tick below mid", gw.check_order(0, Side::Sell, 98.99, 1, 0), RiskReject::PriceBand);
+        expect("buy at the band edge", gw.check_order(0, Side::Buy, 101.0, 1, 0), RiskReject::None);
+        expect("symbol 1 has no book yet", gw.check_order(1, Side::Buy, 100.0, 1, 0), RiskReject::NoReferencePrice);
+    }
+
+    {
+        MarketSnapshot one_sided;
+        one_sided.update_bid(99.95, 100);
+        OrderManager om;
+        RiskGateway gw(om);
+        gw.on_market(0, one_sided);
+        expect("one-sided book", gw.check_order(0, Side::Buy, 99.95, 1, 0), RiskReject::NoReferencePrice);
+    }
+
+    {
+        OrderManager om;
+        RiskGateway gw(om, ThrottleLimits{1e9, 1});
+        RiskLimits l;
+        l.max_position = 25;
+        gw.set_limits(0, l);
+        gw.on_market(0, book);
+        int a = gw.place_order(0, Side::Buy, 100.0, 10, 0);
+        int b = gw.place_order(0, Side::Buy, 100.0, 10, 1);
+        expect("buy 10 + 10 open, buy 10 more (max 25)", gw.check_order(0, Side::Buy, 100.0, 10, 2),
+               RiskReject::PositionLimit);
+        expect("buy 5 more fits exactly", gw.check_order(0, Side::Buy, 100.0, 5, 3), RiskReject::None);
+        gw.cancel(b);
+        expect("after cancelling one, buy 10 fits", gw.check_order(0, Side::Buy, 100.0, 10, 4), RiskReject::None);
+        gw.handle_fill(a, 10);
+        expect("fill keeps the exposure as position", gw.check_order(0, Side::Buy, 100.0, 20, 5),
+               RiskReject::PositionLimit);
+        expect("sell 36 from position 10 (max 25)", gw.check_order(0, Side::Sell, 100.0, 36, 6),
+               RiskReject::PositionLimit);
+        expect("sell 35 from position 10 fits exactly", gw.check_order(0, Side::Sell, 100.0, 35, 7),
+               RiskReject::None);
+        if (gw.position(0) != 10) {
+            checks.fail();
+            std::printf("  FAIL position %d, expected 10\n", gw.position(0));
+        }
+    }
+
+    {
+        OrderManager om;
+        RiskGateway gw(om, ThrottleLimits{1e9, 1});
+        RiskLimits l;
+        l.max_gross_notional = 2500.0;
+        gw.set_limits(0, l);
+        gw.on_market(0, book);
+        gw.place_order(0, Side::Buy, 100.0, 10, 0);
+        gw.place_order(0, Side::Sell, 100.0, 10, 1);
+        expect("2000 open + 1000 > max_gross_notional 2500", gw.check_order(0, Side::Buy, 100.0, 10, 2),
+               RiskReject::NotionalLimit);
+        expect("2000 open + 500 fits", gw.check_order(0, Side::Buy, 100.0, 5, 3), RiskReject::None);
+    }
+
+    {
+        OrderManager om;
+        RiskGateway gw(om, ThrottleLimits{1e9, 1 << 20});
+        RiskLimits l;
+        l.max_position = 1 << 30;
+        l.max_gross_notional = 1e12;
+        gw.set_limits(0, l);
+        gw.on_market(0, book);
+        int first = -1, placed = 0;
+        for (int i = 0; i < RiskGateway::MAX_OPEN_ORDERS; i++) {
+            const int id = gw.place_order(0, Side::Buy, 100.0, 1, 0);
+            if (first < 0) first = id;
+            placed += id > 0;
+        }
+        checks.expect("MAX_OPEN_ORDERS open orders are tracked", placed == RiskGateway::MAX_OPEN_ORDERS);
+        RiskReject why = RiskReject::None;
+        gw.place_order(0, Side::Buy, 100.0, 1, 0, &why);
+        expect("one more, with the order in its slot open", why, RiskReject::TooManyOrders);
+        gw.cancel(first);
+        gw.place_order(0, Side::Buy, 100.0, 1, 0, &why);
+        expect("after cancelling that order", why, RiskReject::None);
+        gw.place_order(0, Side::Buy, 100.0, 1, 0, &why);
+        expect("the next slot is still open", why, RiskReject::TooManyOrders);
+        gw.handle_fill(first + 1, 1);
+        gw.place_order(0, Side::Buy, 100.0, 1, 0, &why);
+        expect("after filling the order in it", why, RiskReject::None);
+        expect("replace of an order whose slot was reused", gw.replace(first, 100.0, 2, 0), RiskReject::BadOrder);
+    }
+
+    {
+        OrderManager om;
+        RiskGateway gw(om, ThrottleLimits{10.0, 3});  // 10/s, burst 3
+        gw.on_market(0, book);
+        expect("burst order 1 at t=0", gw.check_order(0, Side::Buy, 100.0, 1, 0), RiskReject::None);
+        expect("burst order 2 at t=0", gw.check_order(0, Side::Buy, 100.0, 1, 0), RiskReject::None);
+        expect("burst order 3 at t=0", gw.check_order(0, Side::Buy, 100.0, 1, 0), RiskReject::None);
+        expect("order 4 at t=0", gw.check_order(0, Side::Buy, 100.0, 1, 0), RiskReject::Throttled);
+        expect("order 4 at t=99ms", gw.check_order(0, Side::Buy, 100.0, 1, 99 * MS), RiskReject::Throttled);
+        expect("risk reject doesn't spend a token", gw.check_order(0, Side::Buy, 100.0, 1000, 100 * MS),
+               RiskReject::MaxOrderQty);
+        expect("order 4 at t=100ms", gw.check_order(0, Side::Buy, 100.0, 1, 100 * MS), RiskReject::None);
+        expect("order 5 at t=100ms", gw.check_order(0, Side::Buy, 100.0, 1, 100 * MS), RiskReject::Throttled);
+        expect("idle 1s refills to burst 3 only (1)", gw.check_order(0, Side::Buy, 100.0, 1, 1100 * MS), RiskReject::None);
+        expect("idle 1s refills to burst 3 only (2)", gw.check_order(0, Side::Buy, 100.0, 1, 1100 * MS), RiskReject::None);
+        expect("idle 1s refills to burst 3 only (3)", gw.check_order(0, Side::Buy, 100.0, 1, 1100 * MS), RiskReject::None);
+        expect("idle 1s refills to burst 3 only (4)", gw.check_order(0, Side::Buy, 100.0, 1, 1100 * MS),
+               RiskReject::Throttled);
+    }
+
+    std::printf("%s\n\n", checks.passed() ? "all rejection checks passed" : "REJECTION CHECKS FAILED");
+}
+
+struct Order {
+    Side side;
+    double price;
+    int qty;
+};
+
+} // namespace
+
+int main()
+{
+    run_checks();
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+
+    MarketSnapshot book;
+    make_book(book);
+
+    // 1024 orders cycled through each sample
+    constexpr int N = 1024;
+    constexpr int CHECKS = 1 << 16;
+    auto make_orders = [](double lo, double hi, int qty) {
+        std::vector<Order> v(N);
+        std::mt19937 rng(7);
+        for (int i = 0; i < N; ++i) {
+            v[i].side = (rng() & 1) ? Side::Buy : Side::Sell;
+            v[i].price = lo + (hi - lo) * (double)(rng() % 1000) / 1000.0;
+            v[i].qty = qty;
+        }
+        return v;
+    };
+
+    auto time_checks = [&](const char* name, const std::vector<Order>& orders, ThrottleLimits throttle,
+                           RiskReject expected) {
+        OrderManager om;
+        RiskGateway gw(om, throttle);
+        gw.on_market(0, book);
+        uint64_t now = 0;
+        int unexpected = 0;
+        const bench::CaseResult& r = runner.run(name, {{"orders", std::to_string(N)}}, CHECKS, [&] {
+            for (int i = 0; i < CHECKS; ++i) {
+                const Order& o = orders[i & (N - 1)];
+                unexpected += gw.check_order(0, o.side, o.price, o.qty, now += 1000) != expected;
+            }
+        });
+        bench::Runner::print_case(stdout, r);
+        std::printf("    %-18s %6.2f ns/check\n", name, r.ns_per_op());
+        if (unexpected) {
+            checks.fail();
+            std::fprintf(stderr, "%s: %d checks did not return '%s'\n", name, unexpected, to_string(expected));
+        }
+    };
+
+    // 1 us between orders: a 1e9/s throttle never binds, 10/s always does
+    const ThrottleLimits open{1e9, 1};
+    const ThrottleLimits tight{10.0, 1};
+    time_checks("check_accept", make_orders(99.5, 100.5, 10), open, RiskReject::None);
+    time_checks("check_reject_qty", make_orders(99.5, 100.5, 1000), open, RiskReject::MaxOrderQty);
+    time_checks("check_reject_band", make_orders(102.0, 103.0, 10), open, RiskReject::PriceBand);
+
+    {
+        // after the first order of the first sample every check is throttled
+        OrderManager om;
+        RiskGateway gw(om, tight);
+        gw.on_market(0, book);
+        gw.check_order(0, Side::Buy, 100.0, 1, 0);
+        const std::vector<Order> orders = make_orders(99.5, 100.5, 10);
+        uint64_t now = 0;
+        int unexpected = 0;
+        const bench::CaseResult& r = runner.run("check_throttled", {{"orders", std::to_string(N)}}, CHECKS, [&] {
+            for (int i = 0; i < CHECKS; ++i) {
+                const Order& o = orders[i & (N - 1)];
+                unexpected += gw.check_order(0, o.side, o.price, o.qty, now += 1) != RiskReject::Throttled;
+            }
+        });
+        bench::Runner::print_case(stdout, r);
+        std::printf("    %-18s %6.2f ns/check\n", "check_throttled", r.ns_per_op());
+        if (unexpected) {
+            checks.fail();
+            std::fprintf(stderr, "check_throttled: %d checks were not throttled\n", unexpected);
+        }
+    }
+
+    {
+        // the whole order path: checks, OrderManager insert, exposure booking, cancel
+        OrderManager om;
+        RiskGateway gw(om, open);
+        gw.on_market(0, book);
+        const std::vector<Order> orders = make_orders(99.5, 100.5, 10);
+        uint64_t now = 0;
+        constexpr int PLACES = 1 << 12;
+        const bench::CaseResult& r = runner.run("place_cancel", {{"orders", std::to_string(N)}}, PLACES, [&] {
+            for (int i = 0; i < PLACES; ++i) {
+                const Order& o = orders[i & (N - 1)];
+                int id = gw.place_order(0, o.side, o.price, o.qty, now += 1000);
+                gw.cancel(id);
+            }
+        });
+        bench::Runner::print_case(stdout, r);
+        std::printf("    %-18s %6.2f ns/order\n", "place_cancel", r.ns_per_op());
+    }
+
+    runner.write_reports();
+    return checks.passed() ? 0 : 1;
+}
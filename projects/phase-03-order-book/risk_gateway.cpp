@@ -0,0 +1,173 @@
+#include "risk_gateway.h"
+
+#include <algorithm>
+#include <cmath>
+
+const char* to_string(RiskReject r)
+{
+    switch (r) {
+    case RiskReject::None: return "accepted";
+    case RiskReject::UnknownSymbol: return "unknown symbol";
+    case RiskReject::BadOrder: return "bad order";
+    case RiskReject::MaxOrderQty: return "max order qty";
+    case RiskReject::MaxOrderNotional: return "max order notional";
+    case RiskReject::PositionLimit: return "position limit";
+    case RiskReject::NotionalLimit: return "notional limit";
+    case RiskReject::NoReferencePrice: return "no reference price";
+    case RiskReject::PriceBand: return "price band";
+    case RiskReject::Throttled: return "throttled";
+    case RiskReject::TooManyOrders: return "too many open orders";
+    }
+    return "unknown";
+}
+
+RiskGateway::RiskGateway(OrderManager& om, ThrottleLimits throttle) : om_(om)
+{
+    orders_.assign(MAX_OPEN_ORDERS, OrderRef{});
+    set_throttle(throttle);
+}
+
+void RiskGateway::set_limits(int symbol, const RiskLimits& limits)
+{
+    if (symbol < 0 || symbol >= MAX_SYMBOLS) return;
+    symbols_[symbol].limits = limits;
+    // re-derive the band from the stored mid
+    SymbolRisk& s = symbols_[symbol];
+    s.band_lo = s.mid * (1.0 - limits.price_band);
+    s.band_hi = s.mid * (1.0 + limits.price_band);
+}
+
+void RiskGateway::set_throttle(const ThrottleLimits& throttle)
+{
+    throttle_interval_ns_ = throttle.rate > 0.0 ? (uint64_t)std::llround(1e9 / throttle.rate) : 0;
+    throttle_tolerance_ns_ = throttle_interval_ns_ * (uint64_t)std::max(0, throttle.burst - 1);
+    throttle_tat_ns_ = 0;
+}
+
+void RiskGateway::on_market(int symbol, const MarketSnapshot& snapshot)
+{
+    if (symbol < 0 || symbol >= MAX_SYMBOLS) return;
+    SymbolRisk& s = symbols_[symbol];
+    const PriceLevel* bid = snapshot.get_best_bid();
+    const PriceLevel* ask = snapshot.get_best_ask();
+    s.has_ref = bid && ask;
+    if (!s.has_ref) return;
+    s.mid = 0.5 * (bid->price + ask->price);
+    s.band_lo = s.mid * (1.0 - s.limits.price_band);
+    s.band_hi = s.mid * (1.0 + s.limits.price_band);
+}
+
+RiskReject RiskGateway::check_order(int symbol, Side side, double price, int qty, uint64_t now_ns)
+{
+    if (symbol < 0 || symbol >= MAX_SYMBOLS) return RiskReject::UnknownSymbol;
+    const SymbolRisk& s = symbols_[symbol];
+    const RiskLimits& l = s.limits;
+
+    if (qty <= 0 || !(price > 0.0)) return RiskReject::BadOrder;
+    if (qty > l.max_order_qty) return RiskReject::MaxOrderQty;
+
+    const double notional = price * qty;
+    if (notional > l.max_order_notional) return RiskReject::MaxOrderNotional;
+
+    // worst case: every open order on this side fills, then this one
+    if (side == Side::Buy) {
+        if (s.position + s.open_buy_qty + qty > l.max_position) return RiskReject::PositionLimit;
+    } else {
+        if (s.position - s.open_sell_qty - qty < -l.max_position) return RiskReject::PositionLimit;
+    }
+
+    if (!s.has_ref) return RiskReject::NoReferencePrice;
+    if (s.open_notional + notional + std::abs(s.position) * s.mid > l.max_gross_notional)
+        return RiskReject::NotionalLimit;
+    if (price < s.band_lo || price > s.band_hi) return RiskReject::PriceBand;
+
+    // GCRA: the order conforms unless it arrives more than `tolerance` before
+    // its theoretical arrival time; conforming orders push that time out by
+    // one interval
+    if (throttle_tat_ns_ > now_ns + throttle_tolerance_ns_) return RiskReject::Throttled;
+    throttle_tat_ns_ = std::max(throttle_tat_ns_, now_ns) + throttle_interval_ns_;
+
+    return RiskReject::None;
+}
+
+int RiskGateway::place_order(int symbol, Side side, double price, int qty, uint64_t now_ns, RiskReject* reason)
+{
+    // checked first, so that a full table does not use up a throttle token
+    OrderRef& slot = orders_[om_.next_id() & (MAX_OPEN_ORDERS - 1)];
+    const RiskReject r = slot.id != 0 ? RiskReject::TooManyOrders : check_order(symbol, side, price, qty, now_ns);
+    if (reason) *reason = r;
+    if (r != RiskReject::None) return -1;
+
+    const int id = om_.place_order(side, price, qty);
+    slot = OrderRef{id, symbol, side, price, qty};
+
+    SymbolRisk& s = symbols_[symbol];
+    (side == Side::Buy ? s.open_buy_qty : s.open_sell_qty) += qty;
+    s.open_notional += price * qty;
+    return id;
+}
+
+RiskReject RiskGateway::replace(int id, double price, int qty, uint64_t now_ns)
+{
+    const MyOrder* order = om_.find(id);
+    OrderRef* found = find_ref(id);
+    if (!order || !found) return RiskReject::BadOrder;
+    if (qty <= order->filled) return RiskReject::BadOrder;
+
+    OrderRef& ref = *found;
+    const OrderRef before = ref;
+    const int remaining = qty - order->filled;
+    release(ref, ref.remaining, false);
+
+    const RiskReject r = check_order(ref.symbol, ref.side, price, remaining, now_ns);
+    SymbolRisk& s = symbols_[ref.symbol];
+    if (r == RiskReject::None && om_.replace(id, price, qty)) {
+        ref = OrderRef{id, before.symbol, before.side, price, remaining};
+    } else {
+        ref = before;
+    }
+    (ref.side == Side::Buy ? s.open_buy_qty : s.open_sell_qty) += ref.remaining;
+    s.open_notional += ref.price * ref.remaining;
+    return r;
+}
+
+RiskGateway::OrderRef* RiskGateway::find_ref(int id)
+{
+    OrderRef& ref = orders_[id & (MAX_OPEN_ORDERS - 1)];
+    return id > 0 && ref.id == id ? &ref : nullptr;
+}
+
+void RiskGateway::release(OrderRef& ref, int qty, bool filled)
+{
+    qty = std::min(qty, ref.remaining);
+    if (ref.symbol < 0 || qty <= 0) return;
+    SymbolRisk& s = symbols_[ref.symbol];
+    (ref.side == Side::Buy ? s.open_buy_qty : s.open_sell_qty) -= qty;
+    s.open_notional -= ref.price * qty;
+    if (filled) s.position += (ref.side == Side::Buy ? qty : -qty);
+    ref.remaining -= qty;
+    if (ref.remaining == 0) ref.id = 0;
+}
+
+int RiskGateway::handle_fill(int id, int filled_qty)
+{
+    const int done = om_.handle_fill(id, filled_qty);
+    if (OrderRef* ref = find_ref(id)) release(*ref, done, true);
+    return done;
+}
+
+void RiskGateway::cancel(int id)
+{
+    om_.cancel(id);
+    if (OrderRef* ref = find_ref(id)) release(*ref, ref->remaining, false);
+}
+
+int RiskGateway::position(int symbol) const
+{
+    return (symbol >= 0 && symbol < MAX_SYMBOLS) ? symbols_[symbol].position : 0;
+}
+
+double RiskGateway::open_notional(int symbol) const
+{
+    return (symbol >= 0 && symbol < MAX_SYMBOLS) ? symbols_[symbol].open_notional : 0.0;
+}
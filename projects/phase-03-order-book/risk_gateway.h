@@ -0,0 +1,130 @@
+#ifndef RISK_GATEWAY_H
+#define RISK_GATEWAY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "market_snapshot.h"
+#include "order_manager.h"
+
+// Pre-trade risk checks in front of OrderManager.
+//
+// Everything a check needs is kept up to date ahead of time: the fat-finger
+// band is recomputed when the book changes (on_market), and positions and
+// open exposure when orders are placed, filled or cancelled. check_order
+// itself is a few compares on one symbol's state plus the throttle, with no
+// allocation and no lookups in the book.
+
+enum class RiskReject {
+    None,
+    UnknownSymbol,
+    BadOrder,          // qty <= 0 or price <= 0
+    MaxOrderQty,
+    MaxOrderNotional,
+    PositionLimit,     // position + open orders on that side would exceed max_position
+    NotionalLimit,     // open order notional + |position| * mid would exceed max_gross_notional
+    NoReferencePrice,  // one side of the book is empty, so there is no mid to band against
+    PriceBand,         // price too far from mid (fat finger)
+    Throttled,         // order rate above the token bucket
+    TooManyOrders,     // the new order's slot in the gateway's table still holds an open order
+};
+
+const char* to_string(RiskReject r);
+
+struct RiskLimits {
+    int max_order_qty = 100;
+    double max_order_notional = 50000.0;
+    int max_position = 500;
+    double max_gross_notional = 250000.0;
+    double price_band = 0.01;  // fraction of mid, 0.01 = 1%
+};
+
+// Session-wide order rate limit: `rate` orders per second on average with
+// bursts of up to `burst`. Kept as a GCRA (virtual scheduling) clock, which
+// is the same token bucket with one integer instead of a token count.
+struct ThrottleLimits {
+    double rate = 100.0;
+    int burst = 10;
+};
+
+class RiskGateway
+{
+public:
+    static constexpr int MAX_SYMBOLS = 64;
+    // Open orders the gateway tracks, in a fixed table indexed by id modulo
+    // its size. An order whose slot is still held by an open one, i.e. one
+    // placed MAX_OPEN_ORDERS ids earlier, is rejected as TooManyOrders.
+    static constexpr int MAX_OPEN_ORDERS = 4096;
+    static_assert((MAX_OPEN_ORDERS & (MAX_OPEN_ORDERS - 1)) == 0, "MAX_OPEN_ORDERS must be a power of two");
+
+    explicit RiskGateway(OrderManager& om, ThrottleLimits throttle = {});
+
+    void set_limits(int symbol, const RiskLimits& limits);
+    void set_throttle(const ThrottleLimits& throttle);
+
+    // Refresh the reference mid and price band of `symbol` from the book.
+    void on_market(int symbol, const MarketSnapshot& snapshot);
+
+    // All checks for a new order at time now_ns. An accepted order uses up
+    // a throttle token; a rejected one does not.
+    RiskReject check_order(int symbol, Side side, double price, int qty, uint64_t now_ns);
+
+    // check_order, then OrderManager::place_order and book the order's
+    // exposure. Returns the order id, or -1 with *reason set.
+    int place_order(int symbol, Side side, double price, int qty, uint64_t now_ns,
+                    RiskReject* reason = nullptr);
+
+    // Cancel/replace through the checks: the order's current exposure is
+    // released, the amended remainder (qty - filled) is checked as a new
+    // order, and the old exposure is restored if that fails. BadOrder if
+    // the order is not active or qty is not above the filled quantity.
+    RiskReject replace(int id, double price, int qty, uint64_t now_ns);
+
+    // Pass-throughs to OrderManager that also move exposure into position
+    // (fill) or release it (cancel). handle_fill returns the quantity
+    // OrderManager applied.
+    int handle_fill(int id, int filled_qty);
+    void cancel(int id);
+
+    int position(int symbol) const;
+    double open_notional(int symbol) const;
+
+private:
+    friend struct CheckpointAccess;  // checkpoint.cpp
+
+    struct SymbolRisk {
+        RiskLimits limits;
+        bool has_ref = false;
+        double mid = 0.0;
+        double band_lo = 0.0;
+        double band_hi = 0.0;
+        int position = 0;
+        int open_buy_qty = 0;
+        int open_sell_qty = 0;
+        double open_notional = 0.0;
+    };
+
+    // What the gateway needs to know about an open order it placed. The
+    // slot is free again (id 0) once nothing of the order remains.
+    struct OrderRef {
+        int id = 0;
+        int symbol = -1;
+        Side side = Side::Buy;
+        double price = 0.0;
+        int remaining = 0;
+    };
+
+    OrderManager& om_;
+    SymbolRisk symbols_[MAX_SYMBOLS];
+    std::vector<OrderRef> orders_;  // MAX_OPEN_ORDERS slots, by id & (MAX_OPEN_ORDERS - 1)
+
+    uint64_t throttle_interval_ns_ = 0;
+    uint64_t throttle_tolerance_ns_ = 0;
+    uint64_t throttle_tat_ns_ = 0;  // theoretical arrival time of the next order
+
+    // The open order's ref, nullptr if the gateway holds none for it.
+    OrderRef* find_ref(int id);
+    void release(OrderRef& ref, int qty, bool filled);
+};
+
+#endif //RISK_GATEWAY_H
@@ -0,0 +1,64 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer, many-reader sequence lock around a small trivially copyable
+// value. The writer never waits; a reader copies the value and retries if a
+// write overlapped the copy (odd or changed sequence number).
+//
+// The payload is kept as relaxed atomic words rather than a plain T so the
+// reader's racing copy is not a data race; the fences give the usual
+// seqlock ordering (Boehm, "Can seqlocks get along with programming language
+// memory models?").
+template <class T>
+class alignas(64) SeqlockCell
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqlockCell needs a trivially copyable T");
+
+public:
+    SeqlockCell() { store(T{}); }
+
+    // Writer thread only.
+    void store(const T& value)
+    {
+        uint64_t w[WORDS] = {};
+        std::memcpy(w, &value, sizeof(T));
+        const uint32_t s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < WORDS; ++i) words_[i].store(w[i], std::memory_order_relaxed);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    // Any thread.
+    T load() const
+    {
+        uint64_t w[WORDS];
+        for (;;) {
+            const uint32_t s0 = seq_.load(std::memory_order_acquire);
+            if (s0 & 1) continue;
+            for (std::size_t i = 0; i < WORDS; ++i) w[i] = words_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == s0) break;
+        }
+        T value;
+        std::memcpy(&value, w, sizeof(T));
+        return value;
+    }
+
+    // Number of completed stores.
+    uint32_t version() const { return seq_.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr std::size_t WORDS = (sizeof(T) + 7) / 8;
+
+    std::atomic<uint32_t> seq_{0};
+    std::atomic<uint64_t> words_[WORDS];
+};
+
+#endif //SEQLOCK_H
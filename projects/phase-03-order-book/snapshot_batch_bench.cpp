@@ -0,0 +1,166 @@
+// MarketSnapshot::apply_batch() against one update_bid / update_ask call per
+// event, at batch sizes 1 to 1024.
+//
+//   ./snapshot_batch_bench [feed file]
+//
+// The feed's book updates are read into memory first (text or feed_gen
+// binary), as in feature_bench, and cut into consecutive batches. The checks
+// replay the feed both ways at every batch size and compare the whole book,
+// the best-changed flags of each batch, and the top of book a listener
+// ends up with. Any failure makes the program exit with status 1.
+//
+// Every timed case replays the whole feed into an empty book, so the book
+// grows as it would in the driver. Also printed per size: the levels a batch
+// touches on average, i.e. how much coalescing there was.
+
+
+#include "market_snapshot.h"
+#include "top_of_book.h"
+#include "feed_reader.h"
+
+#include "bench_harness.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+bench::Checks checks;
+
+// Every level of both sides, not only the top.
+bool same_book(const MarketSnapshot& a, const MarketSnapshot& b, std::size_t max_levels)
+{
+    std::vector<const PriceLevel*> x(max_levels), y(max_levels);
+    for (BookSide side : {BookSide::Bid, BookSide::Ask}) {
+        const int n = a.top_levels(side, x.data(), (int)max_levels);
+        if (n != b.top_levels(side, y.data(), (int)max_levels)) return false;
+        for (int i = 0; i < n; i++) {
+            if (x[i]->price != y[i]->price || x[i]->quantity != y[i]->quantity) return false;
+        }
+    }
+    return true;
+}
+
+bool same_best(const PriceLevel* a, const PriceLevel* b)
+{
+    return (a == nullptr) == (b == nullptr) && (!a || (a->price == b->price && a->quantity == b->quantity));
+}
+
+template <int N>
+bool same_levels(const TopOfBook<N>& a, const TopOfBook<N>& b)
+{
+    bool ok = a.bid_count == b.bid_count && a.ask_count == b.ask_count;
+    for (int i = 0; ok && i < a.bid_count; i++) {
+        ok = a.bid[i].price == b.bid[i].price && a.bid[i].quantity == b.bid[i].quantity;
+    }
+    for (int i = 0; ok && i < a.ask_count; i++) {
+        ok = a.ask[i].price == b.ask[i].price && a.ask[i].quantity == b.ask[i].quantity;
+    }
+    return ok;
+}
+
+void check_size(const std::vector<BookUpdate>& events, std::size_t batch, std::size_t max_levels)
+{
+    MarketSnapshot seq, bat;
+    TopOfBookPublisher<5> seq_top, bat_top;
+    seq_top.attach(seq);
+    bat_top.attach(bat);
+    bool flags = true;
+    for (std::size_t i = 0; i < events.size(); i += batch) {
+        const std::size_t n = std::min(batch, events.size() - i);
+        const PriceLevel* bid = seq.get_best_bid();
+        const PriceLevel* ask = seq.get_best_ask();
+        const PriceLevel before_bid = bid ? *bid : PriceLevel(0.0, 0);
+        const PriceLevel before_ask = ask ? *ask : PriceLevel(0.0, 0);
+        const bool had_bid = bid, had_ask = ask;
+        for (std::size_t j = i; j < i + n; j++) seq.apply(events[j]);
+        const BatchResult r = bat.apply_batch(&events[i], n);
+
+        const PriceLevel* b = seq.get_best_bid();
+        const PriceLevel* a = seq.get_best_ask();
+        const PriceLevel* before_b = had_bid ? &before_bid : nullptr;
+        const PriceLevel* before_a = had_ask ? &before_ask : nullptr;
+        flags = flags && r.best_bid_changed == !same_best(before_b, b) && r.best_ask_changed == !same_best(before_a, a);
+        flags = flags && same_best(b, bat.get_best_bid()) && same_best(a, bat.get_best_ask());
+    }
+    char what[96];
+    std::snprintf(what, sizeof what, "batches of %zu: same book, best-changed flags and listener top 5", batch);
+    checks.expect(what, flags && same_book(seq, bat, max_levels) && same_levels(seq_top.current(), bat_top.current()));
+    seq.remove_listener(&seq_top);
+    bat.remove_listener(&bat_top);
+}
+
+void run_checks(const std::vector<BookUpdate>& events, std::size_t max_levels)
+{
+    std::printf("batch apply checks\n");
+    for (std::size_t batch : {1, 2, 7, 64, 1024}) check_size(events, batch, max_levels);
+
+    // repeats within one batch, a level that goes to 0 and a new level
+    // created by its second update
+    const BookUpdate repeats[] = {{BookSide::Bid, 5, 10.0}, {BookSide::Ask, 3, 10.5}, {BookSide::Bid, -5, 10.0},
+                                  {BookSide::Bid, 2, 10.1}, {BookSide::Bid, 4, 10.1}, {BookSide::Ask, 1, 10.4},
+                                  {BookSide::Ask, 2, 10.5}};
+    MarketSnapshot seq, bat;
+    for (const BookUpdate& u : repeats) seq.apply(u);
+    const BatchResult r = bat.apply_batch(repeats, sizeof repeats / sizeof repeats[0]);
+    checks.expect("repeated levels are coalesced into one update each",
+                  r.levels == 4 && r.new_levels == 4 && same_book(seq, bat, 16));
+    std::printf("%s\n\n", checks.passed() ? "all batch apply checks passed" : "BATCH APPLY CHECKS FAILED");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : "sample_feed.txt";
+    std::vector<BookUpdate> events;
+    if (!load_book_updates(path, events) || events.empty()) {
+        std::fprintf(stderr, "snapshot_batch_bench: no book updates in %s\n", path);
+        return 1;
+    }
+    std::size_t max_levels;
+    {
+        MarketSnapshot full;
+        for (const BookUpdate& u : events) full.apply(u);
+        std::vector<const PriceLevel*> all(events.size());
+        max_levels = (std::size_t)std::max(full.top_levels(BookSide::Bid, all.data(), (int)all.size()),
+                                           full.top_levels(BookSide::Ask, all.data(), (int)all.size()));
+        std::printf("%zu book updates; the book ends with %zu levels on its longer side\n\n", events.size(),
+                    max_levels);
+    }
+
+    run_checks(events, max_levels);
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+    const double one_by_one = runner.run("update", {{"api", "update_bid/ask"}}, (double)events.size(),
+                                         [&](bench::Timing& t) {
+        MarketSnapshot book;
+        t.start();
+        for (const BookUpdate& u : events) book.apply(u);
+        t.stop();
+    }).ns_per_op();
+    std::printf("    %.1f ns per update, one call each\n", one_by_one);
+
+    std::printf("\n  batch  ns/update  vs one by one  levels/batch\n");
+    for (std::size_t batch = 1; batch <= 1024; batch *= 2) {
+        uint64_t levels = 0, batches = 0;
+        const double ns = runner.run("update", {{"api", "apply_batch"}, {"batch", std::to_string(batch)}},
+                                     (double)events.size(), [&](bench::Timing& t) {
+            MarketSnapshot book;
+            levels = 0;
+            batches = 0;
+            t.start();
+            for (std::size_t i = 0; i < events.size(); i += batch) {
+                levels += (uint64_t)book.apply_batch(&events[i], std::min(batch, events.size() - i)).levels;
+                batches++;
+            }
+            t.stop();
+        }).ns_per_op();
+        std::printf("  %5zu  %9.1f  %12.2fx  %12.1f\n", batch, ns, one_by_one / ns, (double)levels / (double)batches);
+    }
+
+    runner.write_reports();
+    return checks.passed() ? 0 : 1;
+}
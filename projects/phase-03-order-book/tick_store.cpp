@@ -0,0 +1,368 @@
+#include "tick_store.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+enum Col { TIME, TYPE, SYMBOL, PRICE, QTY };
+
+uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+int64_t unzigzag(uint64_t u) { return (int64_t)(u >> 1) ^ -(int64_t)(u & 1); }
+
+void put_varint(std::vector<uint8_t>& out, uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+// Most values fit one byte; the loop is the rare path.
+inline const uint8_t* get_varint(const uint8_t* p, uint64_t& v)
+{
+    if (*p < 0x80) {
+        v = *p;
+        return p + 1;
+    }
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        const uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (b < 0x80) break;
+    }
+    return p;
+}
+
+bool is_exec(uint8_t type) { return type == (uint8_t)FeedType::Execution; }
+
+} // namespace
+
+TickStoreWriter::TickStoreWriter(const std::string& path, uint32_t decimals, uint32_t block_rows)
+    : out_(std::fopen(path.c_str(), "wb")), block_rows_(std::max<uint32_t>(1, block_rows))
+{
+    time_.reserve(block_rows_);
+    type_.reserve(block_rows_);
+    symbol_.reserve(block_rows_);
+    price_.reserve(block_rows_);
+    qty_.reserve(block_rows_);
+
+    TickFileHeader h{};
+    std::memcpy(h.magic, TICK_MAGIC, sizeof h.magic);
+    h.version = TICK_VERSION;
+    h.decimals = decimals;
+    h.block_rows = block_rows_;
+    if (!out_) failed_ = true;
+    write(&h, sizeof h);
+}
+
+TickStoreWriter::~TickStoreWriter()
+{
+    close();
+}
+
+void TickStoreWriter::append(uint64_t time_ns, FeedType type, uint16_t symbol, int32_t price_ticks, int32_t qty)
+{
+    time_.push_back(time_ns);
+    type_.push_back((uint8_t)type);
+    symbol_.push_back(symbol);
+    price_.push_back(price_ticks);
+    qty_.push_back(qty);
+    rows_++;
+    if (time_.size() == block_rows_) flush_block();
+}
+
+bool TickStoreWriter::close()
+{
+    if (!out_) return !failed_;
+    flush_block();
+    TickFileFooter f{bytes_, index_.size(), rows_, {}};
+    std::memcpy(f.magic, TICK_MAGIC, sizeof f.magic);
+    write(index_.data(), index_.size() * sizeof(TickBlockIndex));
+    write(&f, sizeof f);
+    if (std::fclose(out_) != 0) failed_ = true;
+    out_ = nullptr;
+    return !failed_;
+}
+
+void TickStoreWriter::write(const void* data, std::size_t bytes)
+{
+    if (!out_ || !bytes) return;
+    if (std::fwrite(data, 1, bytes, out_) != bytes) failed_ = true;
+    bytes_ += bytes;
+}
+
+void TickStoreWriter::flush_block()
+{
+    const std::size_t n = time_.size();
+    if (n == 0) return;
+
+    TickBlockIndex b{};
+    b.offset = bytes_;
+    b.rows = (uint32_t)n;
+    b.time_first = time_[0];
+    b.time_min = *std::min_element(time_.begin(), time_.end());
+    b.time_max = *std::max_element(time_.begin(), time_.end());
+    b.price_min = std::numeric_limits<int32_t>::max();
+    b.price_max = std::numeric_limits<int32_t>::min();
+    bool book_seen = false, exec_seen = false;
+    for (std::size_t i = 0; i < n; i++) {
+        if (is_exec(type_[i])) {
+            if (!exec_seen) b.exec_first = price_[i];
+            exec_seen = true;
+            continue;
+        }
+        if (!book_seen) b.book_first = price_[i];
+        book_seen = true;
+        b.price_min = std::min(b.price_min, price_[i]);
+        b.price_max = std::max(b.price_max, price_[i]);
+    }
+
+    encoded_.clear();
+    std::size_t mark = 0;
+    auto end_column = [&](Col c) {
+        b.column_bytes[c] = (uint32_t)(encoded_.size() - mark);
+        mark = encoded_.size();
+    };
+
+    uint64_t prev_time = b.time_first;
+    for (std::size_t i = 0; i < n; i++) {
+        put_varint(encoded_, zigzag((int64_t)(time_[i] - prev_time)));
+        prev_time = time_[i];
+    }
+    end_column(TIME);
+
+    for (std::size_t i = 0; i < n; i += 4) {
+        uint8_t packed = 0;
+        for (std::size_t j = 0; j < 4 && i + j < n; j++) packed |= (uint8_t)((type_[i + j] & 3) << (2 * j));
+        encoded_.push_back(packed);
+    }
+    end_column(TYPE);
+
+    for (std::size_t i = 0; i < n; i++) put_varint(encoded_, symbol_[i]);
+    end_column(SYMBOL);
+
+    int32_t prev[2] = {b.book_first, b.exec_first};
+    for (std::size_t i = 0; i < n; i++) {
+        int32_t& p = prev[is_exec(type_[i])];
+        put_varint(encoded_, zigzag((int64_t)price_[i] - p));
+        p = price_[i];
+    }
+    end_column(PRICE);
+
+    for (std::size_t i = 0; i < n; i++) put_varint(encoded_, zigzag(qty_[i]));
+    end_column(QTY);
+
+    write(encoded_.data(), encoded_.size());
+    index_.push_back(b);
+    time_.clear();
+    type_.clear();
+    symbol_.clear();
+    price_.clear();
+    qty_.clear();
+}
+
+TickStoreReader::TickStoreReader(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (std::size_t)st.st_size < sizeof(TickFileHeader) + sizeof(TickFileFooter)) {
+        ::close(fd);
+        return;
+    }
+    const std::size_t size = (std::size_t)st.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return;
+    const char* base = static_cast<const char*>(map);
+
+    TickFileHeader h;
+    TickFileFooter f;
+    std::memcpy(&h, base, sizeof h);
+    std::memcpy(&f, base + size - sizeof f, sizeof f);
+    bool ok = std::memcmp(h.magic, TICK_MAGIC, sizeof h.magic) == 0 && h.version == TICK_VERSION &&
+              std::memcmp(f.magic, TICK_MAGIC, sizeof f.magic) == 0 && f.index_offset >= sizeof h &&
+              f.blocks <= size / sizeof(TickBlockIndex) &&
+              f.index_offset + f.blocks * sizeof(TickBlockIndex) + sizeof f == size;
+    if (ok) {
+        index_.resize(f.blocks);
+        std::memcpy(index_.data(), base + f.index_offset, f.blocks * sizeof(TickBlockIndex));
+        // every block's columns inside the data area, and the rows add up
+        uint64_t rows = 0;
+        for (const TickBlockIndex& b : index_) {
+            uint64_t bytes = 0;
+            for (uint32_t c : b.column_bytes) bytes += c;
+            ok = ok && b.offset >= sizeof h && b.offset + bytes <= f.index_offset &&
+                 b.column_bytes[TYPE] == (b.rows + 3) / 4;
+            rows += b.rows;
+        }
+        ok = ok && rows == f.rows;
+    }
+    if (!ok) {
+        munmap(map, size);
+        index_.clear();
+        return;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    base_ = base;
+    size_ = size;
+    blocks_ = index_.size();
+    rows_ = f.rows;
+    decimals_ = h.decimals;
+    tick_ = std::pow(10.0, -(double)h.decimals);
+}
+
+TickStoreReader::~TickStoreReader()
+{
+    if (base_) munmap(const_cast<char*>(base_), size_);
+}
+
+uint64_t TickStoreReader::scan(const TickQuery& q, const std::function<void(const TickBatch&)>& fn,
+                               TickScanStats* stats) const
+{
+    if (!base_) return 0;
+    const bool time_filter = q.from_ns > 0 || q.to_ns != std::numeric_limits<uint64_t>::max();
+    const bool price_filter = q.min_price != std::numeric_limits<int32_t>::min() ||
+                              q.max_price != std::numeric_limits<int32_t>::max();
+    const bool type_filter = (q.types & 0xe) != 0xe;
+
+    TickBatch batch;
+    std::vector<uint32_t> keep;
+    uint64_t delivered = 0;
+    for (const TickBlockIndex& b : index_) {
+        // block pruning on the index alone
+        if ((time_filter && (b.time_max < q.from_ns || b.time_min >= q.to_ns)) ||
+            (price_filter && (b.price_min > b.price_max || b.price_max < q.min_price || b.price_min > q.max_price))) {
+            if (stats) stats->blocks_skipped++;
+            continue;
+        }
+        const bool check_time = time_filter && !(b.time_min >= q.from_ns && b.time_max < q.to_ns);
+        const bool check_price = price_filter && !(b.price_min >= q.min_price && b.price_max <= q.max_price);
+        const bool check_type = type_filter || price_filter;  // a price range drops executions
+        uint32_t decode = q.columns;
+        if (check_time) decode |= TICK_TIME;
+        if (check_price) decode |= TICK_PRICE;
+        if (check_type) decode |= TICK_TYPE;
+        if (decode & TICK_PRICE) decode |= TICK_TYPE;  // the deltas run per kind
+
+        const std::size_t n = b.rows;
+        const uint8_t* col[TICK_COLUMNS];
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(base_ + b.offset);
+        for (int c = 0; c < TICK_COLUMNS; c++) {
+            col[c] = p;
+            p += b.column_bytes[c];
+        }
+        uint64_t bytes = 0;
+
+        if (decode & TICK_TIME) {
+            batch.time.resize(n);
+            const uint8_t* s = col[TIME];
+            uint64_t t = b.time_first, v;
+            for (std::size_t i = 0; i < n; i++) {
+                s = get_varint(s, v);
+                t += (uint64_t)unzigzag(v);
+                batch.time[i] = t;
+            }
+            bytes += b.column_bytes[TIME];
+        }
+        if (decode & TICK_TYPE) {
+            batch.type.resize(n);
+            const uint8_t* s = col[TYPE];
+            for (std::size_t i = 0; i < n; i++) batch.type[i] = (uint8_t)((s[i >> 2] >> (2 * (i & 3))) & 3);
+            bytes += b.column_bytes[TYPE];
+        }
+        if (decode & TICK_SYMBOL) {
+            batch.symbol.resize(n);
+            const uint8_t* s = col[SYMBOL];
+            uint64_t v;
+            for (std::size_t i = 0; i < n; i++) {
+                s = get_varint(s, v);
+                batch.symbol[i] = (uint16_t)v;
+            }
+            bytes += b.column_bytes[SYMBOL];
+        }
+        if (decode & TICK_PRICE) {
+            batch.price.resize(n);
+            const uint8_t* s = col[PRICE];
+            int64_t prev[2] = {b.book_first, b.exec_first};
+            uint64_t v;
+            for (std::size_t i = 0; i < n; i++) {
+                s = get_varint(s, v);
+                int64_t& last = prev[is_exec(batch.type[i])];
+                last += unzigzag(v);
+                batch.price[i] = (int32_t)last;
+            }
+            bytes += b.column_bytes[PRICE];
+        }
+        if (decode & TICK_QTY) {
+            batch.qty.resize(n);
+            const uint8_t* s = col[QTY];
+            uint64_t v;
+            for (std::size_t i = 0; i < n; i++) {
+                s = get_varint(s, v);
+                batch.qty[i] = (int32_t)unzigzag(v);
+            }
+            bytes += b.column_bytes[QTY];
+        }
+        batch.rows = n;
+        if (stats) {
+            stats->blocks_read++;
+            stats->bytes_decoded += bytes;
+        }
+
+        if (check_time || check_price || check_type) {
+            keep.clear();
+            for (uint32_t i = 0; i < n; i++) {
+                if (check_time && (batch.time[i] < q.from_ns || batch.time[i] >= q.to_ns)) continue;
+                if (check_type && !(q.types & (1u << batch.type[i]))) continue;
+                if (price_filter && (is_exec(batch.type[i]) ||
+                                     (check_price && (batch.price[i] < q.min_price || batch.price[i] > q.max_price)))) {
+                    continue;
+                }
+                keep.push_back(i);
+            }
+            auto gather = [&keep](auto& column) {
+                for (std::size_t k = 0; k < keep.size(); k++) column[k] = column[keep[k]];
+                column.resize(keep.size());
+            };
+            if (q.columns & TICK_TIME) gather(batch.time);
+            if (q.columns & TICK_TYPE) gather(batch.type);
+            if (q.columns & TICK_SYMBOL) gather(batch.symbol);
+            if (q.columns & TICK_PRICE) gather(batch.price);
+            if (q.columns & TICK_QTY) gather(batch.qty);
+            batch.rows = keep.size();
+        }
+        // decoded only to filter on
+        if (!(q.columns & TICK_TIME)) batch.time.clear();
+        if (!(q.columns & TICK_TYPE)) batch.type.clear();
+        if (!(q.columns & TICK_PRICE)) batch.price.clear();
+
+        if (batch.rows) {
+            fn(batch);
+            delivered += batch.rows;
+        }
+    }
+    return delivered;
+}
+
+uint64_t replay_into(const TickStoreReader& store, MarketSnapshot& snapshot, const TickQuery& q)
+{
+    TickQuery book = q;
+    book.columns = TICK_TYPE | TICK_PRICE | TICK_QTY;
+    book.types &= (1u << (int)FeedType::Bid) | (1u << (int)FeedType::Ask);
+    const double tick = store.tick();
+    return store.scan(book, [&](const TickBatch& b) {
+        for (std::size_t i = 0; i < b.rows; i++) {
+            // same arithmetic as the driver's binary reader
+            if (b.type[i] == (uint8_t)FeedType::Bid) snapshot.update_bid(b.price[i] * tick, b.qty[i]);
+            else snapshot.update_ask(b.price[i] * tick, b.qty[i]);
+        }
+    });
+}
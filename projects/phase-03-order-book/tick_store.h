@@ -0,0 +1,180 @@
+#ifndef TICK_STORE_H
+#define TICK_STORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "feed_format.h"
+#include "market_snapshot.h"
+
+// Columnar on-disk store for captured feeds, queried by time and price range.
+//
+// Rows are cut into blocks. Each block stores its columns one after another,
+// each encoded for what it holds:
+//
+//   time    zigzag LEB128 deltas from the previous row
+//   type    2 bits per row (FeedType)
+//   symbol  LEB128
+//   price   zigzag LEB128 deltas, in ticks; book rows and executions (whose
+//           price field is the order id, as in the binary feed) are delta
+//           coded against the previous row of their own kind
+//   qty     zigzag LEB128
+//
+// The block index at the end of the file holds, per block, where each column
+// starts, the first values the deltas start from, and the min/max time and
+// book price. A query skips blocks whose ranges miss it without touching
+// them, and decodes only the columns it returns or filters on. Blocks decode
+// independently. The reader maps the file.
+//
+//   header (64) | block 0 columns | block 1 columns | ... | index | footer (32)
+
+constexpr char TICK_MAGIC[8] = {'H', 'F', 'T', 'T', 'I', 'C', 'K', '1'};
+constexpr uint32_t TICK_VERSION = 1;
+constexpr int TICK_COLUMNS = 5;
+
+struct TickFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t decimals;     // price = ticks / 10^decimals
+    uint32_t block_rows;
+    uint8_t reserved[44];
+};
+static_assert(sizeof(TickFileHeader) == 64, "TickFileHeader must stay 64 bytes");
+
+struct TickBlockIndex {
+    uint64_t offset;                     // of the block's first column
+    uint32_t rows;
+    uint32_t column_bytes[TICK_COLUMNS];
+    uint64_t time_first;
+    uint64_t time_min;
+    uint64_t time_max;
+    int32_t price_min;                   // book rows only; min > max if the block has none
+    int32_t price_max;
+    int32_t book_first;                  // delta bases: first book price, first order id
+    int32_t exec_first;
+};
+static_assert(sizeof(TickBlockIndex) == 72, "TickBlockIndex must stay 72 bytes");
+
+struct TickFileFooter {
+    uint64_t index_offset;
+    uint64_t blocks;
+    uint64_t rows;
+    char magic[8];
+};
+static_assert(sizeof(TickFileFooter) == 32, "TickFileFooter must stay 32 bytes");
+
+enum TickColumn : uint32_t {
+    TICK_TIME = 1,
+    TICK_TYPE = 2,
+    TICK_SYMBOL = 4,
+    TICK_PRICE = 8,
+    TICK_QTY = 16,
+    TICK_ALL = 31,
+};
+
+struct TickQuery {
+    uint64_t from_ns = 0;                                   // [from_ns, to_ns)
+    uint64_t to_ns = std::numeric_limits<uint64_t>::max();
+    int32_t min_price = std::numeric_limits<int32_t>::min();  // ticks, inclusive; a price range
+    int32_t max_price = std::numeric_limits<int32_t>::max();  // keeps book rows only
+    uint32_t types = 0xe;                                   // bit 1 << FeedType
+    uint32_t columns = TICK_ALL;                            // what the batches carry
+};
+
+// Rows of one block that passed the query. Only the requested columns are
+// filled; the others are left empty.
+struct TickBatch {
+    std::size_t rows = 0;
+    std::vector<uint64_t> time;
+    std::vector<uint8_t> type;
+    std::vector<uint16_t> symbol;
+    std::vector<int32_t> price;
+    std::vector<int32_t> qty;
+};
+
+struct TickScanStats {
+    uint64_t blocks_read = 0;
+    uint64_t blocks_skipped = 0;
+    uint64_t bytes_decoded = 0;  // encoded column bytes actually decoded
+};
+
+class TickStoreWriter
+{
+public:
+    TickStoreWriter(const std::string& path, uint32_t decimals, uint32_t block_rows = 8192);
+    // close(), if not called yet.
+    ~TickStoreWriter();
+
+    TickStoreWriter(const TickStoreWriter&) = delete;
+    TickStoreWriter& operator=(const TickStoreWriter&) = delete;
+
+    void append(uint64_t time_ns, FeedType type, uint16_t symbol, int32_t price_ticks, int32_t qty);
+    // Write the last block, the index and the footer. Returns false if any
+    // write failed.
+    bool close();
+
+    uint64_t rows() const { return rows_; }
+    uint64_t bytes() const { return bytes_; }
+
+private:
+    std::FILE* out_;
+    uint32_t block_rows_;
+    uint64_t rows_ = 0;
+    uint64_t bytes_ = 0;
+    bool failed_ = false;
+
+    std::vector<uint64_t> time_;
+    std::vector<uint8_t> type_;
+    std::vector<uint16_t> symbol_;
+    std::vector<int32_t> price_;
+    std::vector<int32_t> qty_;
+    std::vector<uint8_t> encoded_;
+    std::vector<TickBlockIndex> index_;
+
+    void write(const void* data, std::size_t bytes);
+    void flush_block();
+};
+
+class TickStoreReader
+{
+public:
+    explicit TickStoreReader(const std::string& path);
+    ~TickStoreReader();
+
+    TickStoreReader(const TickStoreReader&) = delete;
+    TickStoreReader& operator=(const TickStoreReader&) = delete;
+
+    // False if the file is missing, truncated or not a tick store.
+    bool ok() const { return base_ != nullptr; }
+    uint64_t rows() const { return rows_; }
+    std::size_t blocks() const { return blocks_; }
+    uint64_t file_bytes() const { return size_; }
+    uint32_t decimals() const { return decimals_; }
+    double tick() const { return tick_; }
+    const TickBlockIndex& block(std::size_t i) const { return index_[i]; }
+
+    // Calls fn with the rows of each block that pass the query, in file
+    // order (blocks with no such rows are not passed). Returns the rows
+    // delivered.
+    uint64_t scan(const TickQuery& q, const std::function<void(const TickBatch&)>& fn,
+                  TickScanStats* stats = nullptr) const;
+
+private:
+    const char* base_ = nullptr;
+    std::size_t size_ = 0;
+    std::vector<TickBlockIndex> index_;  // copied out: blocks leave it unaligned
+    std::size_t blocks_ = 0;
+    uint64_t rows_ = 0;
+    uint32_t decimals_ = 0;
+    double tick_ = 1.0;
+};
+
+// Apply the book rows that pass q to the snapshot, in order. Returns the rows
+// applied.
+uint64_t replay_into(const TickStoreReader& store, MarketSnapshot& snapshot, const TickQuery& q = TickQuery{});
+
+#endif //TICK_STORE_H
@@ -0,0 +1,342 @@
+// Tick store: checks, then its size against the text and 16-byte binary
+// feeds and how fast it scans, queries and replays.
+//
+//   ./tick_store_bench [feed file]
+//
+// The feed (text or feed_gen binary; a text row's time is its event number)
+// is read into memory and packed. The checks then compare the store with
+// those rows: a full scan must give them back, time, price and type queries
+// must equal a plain filter over them and skip the blocks the index rules
+// out, replay_into must leave the same book as applying the feed directly,
+// and truncated or damaged files must be refused. Any failure makes the
+// program exit with status 1.
+//
+// Scan rates are given per row and in GB/s of the columns delivered, as
+// plain arrays (8-byte time, 1-byte type, 2-byte symbol, 4-byte price and
+// qty), and of the encoded bytes read.
+
+#include "tick_store.h"
+#include "feed_reader.h"
+
+#include "bench_harness.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+bench::Checks checks;
+
+struct Row {
+    uint64_t time;
+    uint8_t type;
+    uint16_t symbol;
+    int32_t price;
+    int32_t qty;
+};
+
+// Rows as tick_tool packs them. Sets the feed's tick size.
+bool load_feed(const char* path, std::vector<Row>& out, uint32_t& decimals)
+{
+    FeedReader feed(path, 2);
+    if (!feed.ok()) return false;
+    decimals = feed.decimals();
+    FeedEvent ev;
+    while (feed.next(ev)) {
+        out.push_back(Row{feed.binary() ? ev.ts_ns : out.size(), (uint8_t)ev.type, ev.symbol, ev.price_ticks, ev.qty});
+    }
+    return true;
+}
+
+// The feed's size as text, one line per row the way feed_gen writes it.
+uint64_t text_bytes(const std::vector<Row>& rows, uint32_t decimals)
+{
+    static const char* kinds[4] = {"", "BID", "ASK", "EXECUTION"};
+    const double tick = std::pow(10.0, -(double)decimals);
+    uint64_t bytes = 0;
+    char line[96];
+    for (const Row& r : rows) {
+        const int n = r.type == 3 ? std::snprintf(line, sizeof line, "%s %d %d\n", kinds[3], r.price, r.qty)
+                                  : std::snprintf(line, sizeof line, "%s %.*f %d\n", kinds[r.type & 3],
+                                                  (int)decimals, r.price * tick, r.qty);
+        bytes += (uint64_t)n;
+    }
+    return bytes;
+}
+
+bool pack(const std::vector<Row>& rows, const char* path, uint32_t decimals, uint32_t block_rows)
+{
+    TickStoreWriter w(path, decimals, block_rows);
+    for (const Row& r : rows) w.append(r.time, (FeedType)r.type, r.symbol, r.price, r.qty);
+    return w.close();
+}
+
+bool passes(const Row& r, const TickQuery& q)
+{
+    const bool price_filter = q.min_price != std::numeric_limits<int32_t>::min() ||
+                              q.max_price != std::numeric_limits<int32_t>::max();
+    if (r.time < q.from_ns || r.time >= q.to_ns || !(q.types & (1u << r.type))) return false;
+    return !price_filter || (r.type != 3 && r.price >= q.min_price && r.price <= q.max_price);
+}
+
+// The query's rows, back from the store, equal a filter over the source in
+// every column it asked for (and only those come back).
+bool same_rows(const TickStoreReader& store, const std::vector<Row>& rows, const TickQuery& q,
+               TickScanStats* stats = nullptr)
+{
+    std::vector<Row> want;
+    for (const Row& r : rows) {
+        if (passes(r, q)) want.push_back(r);
+    }
+    std::size_t k = 0;
+    bool ok = true;
+    store.scan(q, [&](const TickBatch& b) {
+        ok = ok && b.time.size() == (q.columns & TICK_TIME ? b.rows : 0) &&
+             b.type.size() == (q.columns & TICK_TYPE ? b.rows : 0) &&
+             b.symbol.size() == (q.columns & TICK_SYMBOL ? b.rows : 0) &&
+             b.price.size() == (q.columns & TICK_PRICE ? b.rows : 0) &&
+             b.qty.size() == (q.columns & TICK_QTY ? b.rows : 0);
+        for (std::size_t i = 0; ok && i < b.rows; i++, k++) {
+            ok = k < want.size();
+            if (!ok) break;
+            const Row& w = want[k];
+            ok = (b.time.empty() || b.time[i] == w.time) && (b.type.empty() || b.type[i] == w.type) &&
+                 (b.symbol.empty() || b.symbol[i] == w.symbol) && (b.price.empty() || b.price[i] == w.price) &&
+                 (b.qty.empty() || b.qty[i] == w.qty);
+        }
+    }, stats);
+    return ok && k == want.size();
+}
+
+bool same_book(const MarketSnapshot& a, const MarketSnapshot& b)
+{
+    for (BookSide side : {BookSide::Bid, BookSide::Ask}) {
+        const PriceLevel* x[16];
+        const PriceLevel* y[16];
+        const int n = a.top_levels(side, x, 16);
+        if (n != b.top_levels(side, y, 16)) return false;
+        for (int i = 0; i < n; i++) {
+            if (x[i]->price != y[i]->price || x[i]->quantity != y[i]->quantity) return false;
+        }
+    }
+    return true;
+}
+
+void apply(MarketSnapshot& book, const Row& r, double tick)
+{
+    if (r.type == 1) book.update_bid(r.price * tick, r.qty);
+    else if (r.type == 2) book.update_ask(r.price * tick, r.qty);
+}
+
+// 10% of the feed's time, starting at 40%.
+TickQuery time_window(const std::vector<Row>& rows)
+{
+    TickQuery q;
+    const uint64_t span = rows.back().time - rows.front().time;
+    q.from_ns = rows.front().time + span * 4 / 10;
+    q.to_ns = q.from_ns + span / 10;
+    return q;
+}
+
+// Book prices within a few ticks of the first one.
+TickQuery price_window(const std::vector<Row>& rows)
+{
+    TickQuery q;
+    for (const Row& r : rows) {
+        if (r.type != 3) {
+            q.min_price = r.price - 2;
+            q.max_price = r.price + 2;
+            break;
+        }
+    }
+    return q;
+}
+
+const char* STORE = "tick_store_bench.tick";
+const char* CUT = "tick_store_bench_cut.tick";
+
+bool copy_file(const char* from, const char* to, long drop_tail, long flip_at)
+{
+    std::ifstream in(from, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (drop_tail > 0) bytes.resize(bytes.size() - (std::size_t)drop_tail);
+    if (flip_at >= 0) bytes[(std::size_t)flip_at] ^= 0x5a;
+    std::ofstream out(to, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), (std::streamsize)bytes.size());
+    return (bool)out;
+}
+
+void run_checks(const std::vector<Row>& rows, uint32_t decimals)
+{
+    std::printf("tick store checks (%zu rows)\n", rows.size());
+    {
+        // small blocks, so that the pruning has something to do
+        const bool written = pack(rows, STORE, decimals, 1024);
+        const TickStoreReader store(STORE);
+        checks.expect("written and mapped back", written && store.ok() && store.rows() == rows.size() &&
+                                                     store.blocks() == (rows.size() + 1023) / 1024);
+        checks.expect("a full scan gives every row back", same_rows(store, rows, TickQuery{}));
+
+        TickQuery q = time_window(rows);
+        TickScanStats stats;
+        checks.expect("time range equals the filter", same_rows(store, rows, q, &stats));
+        checks.expect("time range reads about a tenth of the blocks", stats.blocks_read <= store.blocks() / 10 + 2 &&
+                                                                          stats.blocks_read + stats.blocks_skipped ==
+                                                                              store.blocks());
+
+        q = price_window(rows);
+        stats = TickScanStats{};
+        checks.expect("price range keeps book rows in the range", same_rows(store, rows, q, &stats));
+        std::printf("       price range: %llu of %zu blocks read\n", (unsigned long long)stats.blocks_read,
+                    store.blocks());
+
+        q = time_window(rows);
+        q.min_price = price_window(rows).min_price;
+        q.max_price = price_window(rows).max_price + 20;
+        q.columns = TICK_PRICE | TICK_QTY;
+        checks.expect("time and price together, price and qty columns only", same_rows(store, rows, q));
+
+        q = TickQuery{};
+        q.types = 1u << (int)FeedType::Execution;
+        q.columns = TICK_TIME | TICK_PRICE;
+        checks.expect("executions only, with their order ids", same_rows(store, rows, q));
+
+        q = TickQuery{};
+        q.from_ns = rows.back().time + 1;
+        stats = TickScanStats{};
+        checks.expect("a range past the end reads nothing",
+                      same_rows(store, rows, q, &stats) && stats.blocks_read == 0 && stats.bytes_decoded == 0);
+
+        const double tick = store.tick();
+        MarketSnapshot direct, replayed;
+        uint64_t book_rows = 0;
+        for (const Row& r : rows) {
+            apply(direct, r, tick);
+            book_rows += r.type != 3;
+        }
+        checks.expect("replay_into leaves the same book as the feed",
+                      replay_into(store, replayed) == book_rows && same_book(direct, replayed));
+
+        MarketSnapshot half_direct, half_replayed;
+        q = TickQuery{};
+        q.to_ns = time_window(rows).from_ns;
+        for (const Row& r : rows) {
+            if (r.time < q.to_ns) apply(half_direct, r, tick);
+        }
+        replay_into(store, half_replayed, q);
+        checks.expect("replay_into up to a time", same_book(half_direct, half_replayed));
+
+        const long size = (long)store.file_bytes();
+        checks.expect("a truncated file is refused", copy_file(STORE, CUT, 5, -1) && !TickStoreReader(CUT).ok());
+        checks.expect("a damaged footer is refused", copy_file(STORE, CUT, 0, size - 20) && !TickStoreReader(CUT).ok());
+        // the last index entry's row count
+        checks.expect("a damaged index is refused",
+                      copy_file(STORE, CUT, 0, size - 32 - 72 + 8) && !TickStoreReader(CUT).ok());
+        checks.expect("a missing file is refused", !TickStoreReader("no_such_file.tick").ok());
+    }
+    {
+        const bool written = pack({}, CUT, decimals, 1024);
+        const TickStoreReader empty(CUT);
+        checks.expect("an empty store", written && empty.ok() && empty.rows() == 0 && empty.blocks() == 0 &&
+                                            empty.scan(TickQuery{}, [](const TickBatch&) {}) == 0);
+    }
+    std::remove(CUT);
+    std::printf("%s\n\n", checks.passed() ? "all tick store checks passed" : "TICK STORE CHECKS FAILED");
+}
+
+// Bytes of the columns a query delivers, as plain arrays.
+double raw_row_bytes(uint32_t columns)
+{
+    return (columns & TICK_TIME ? 8 : 0) + (columns & TICK_TYPE ? 1 : 0) + (columns & TICK_SYMBOL ? 2 : 0) +
+           (columns & TICK_PRICE ? 4 : 0) + (columns & TICK_QTY ? 4 : 0);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : "sample_feed.txt";
+    std::vector<Row> rows;
+    uint32_t decimals = 2;
+    if (!load_feed(path, rows, decimals) || rows.empty()) {
+        std::fprintf(stderr, "tick_store_bench: no rows in %s\n", path);
+        return 1;
+    }
+
+    run_checks(rows, decimals);
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+    const std::string n = std::to_string(rows.size());
+
+    const auto& packed = runner.run("pack", {{"rows", n}}, (double)rows.size(), [&] {
+        bench::do_not_optimize(pack(rows, STORE, decimals, 8192));
+    });
+    bench::Runner::print_case(stdout, packed);
+
+    const TickStoreReader store(STORE);
+    const double text = (double)text_bytes(rows, decimals), binary = 16.0 * (double)rows.size() + 64.0;
+    const double disk = (double)store.file_bytes();
+    std::printf("    %.1f M rows/s; %.0f bytes on disk, %.2f per row: %.1fx smaller than the text feed (%.0f), "
+                "%.1fx than 16-byte records (%.0f)\n",
+                packed.ops_per_sec() / 1e6, disk, disk / (double)rows.size(), text / disk, text, binary / disk,
+                binary);
+
+    struct Case {
+        const char* name;
+        TickQuery q;
+    };
+    std::vector<Case> cases = {{"all_columns", TickQuery{}}, {"time", TickQuery{}}, {"price", TickQuery{}},
+                               {"price_qty", TickQuery{}}, {"time_range_10pct", time_window(rows)},
+                               {"price_range", price_window(rows)}};
+    cases[1].q.columns = TICK_TIME;
+    cases[2].q.columns = TICK_PRICE;
+    cases[3].q.columns = TICK_PRICE | TICK_QTY;
+    for (Case& c : cases) {
+        uint64_t delivered = 0;
+        TickScanStats stats;
+        const auto& r = runner.run("scan", {{"rows", n}, {"query", c.name}}, (double)rows.size(), [&] {
+            int64_t sum = 0;
+            stats = TickScanStats{};
+            delivered = store.scan(c.q, [&](const TickBatch& b) {
+                sum += (int64_t)b.rows;
+                if (!b.price.empty()) sum += b.price[b.rows - 1];
+            }, &stats);
+            bench::do_not_optimize(sum);
+        });
+        bench::Runner::print_case(stdout, r);
+        const double secs = r.stats.median / 1e9;
+        std::printf("    %llu rows delivered, %llu of %zu blocks read: %.2f ns per stored row, %.2f GB/s delivered, "
+                    "%.2f GB/s encoded\n",
+                    (unsigned long long)delivered, (unsigned long long)stats.blocks_read, store.blocks(),
+                    r.ns_per_op(), (double)delivered * raw_row_bytes(c.q.columns) / secs / 1e9,
+                    (double)stats.bytes_decoded / secs / 1e9);
+    }
+
+    // the replay from the store against the same rows already in memory
+    const double tick = store.tick();
+    const auto& from_store = runner.run("replay", {{"rows", n}, {"source", "tick_store"}}, (double)rows.size(),
+                                        [&] {
+                                            MarketSnapshot book;
+                                            bench::do_not_optimize(replay_into(store, book));
+                                        });
+    bench::Runner::print_case(stdout, from_store);
+    const double store_ns = from_store.ns_per_op();
+    const auto& from_memory = runner.run("replay", {{"rows", n}, {"source", "memory"}}, (double)rows.size(), [&] {
+        MarketSnapshot book;
+        for (const Row& r : rows) apply(book, r, tick);
+        bench::do_not_optimize(book.get_best_bid());
+    });
+    bench::Runner::print_case(stdout, from_memory);
+    std::printf("    replay_into %.1f ns per row, from rows in memory %.1f ns\n",
+                store_ns, from_memory.ns_per_op());
+
+    std::remove(STORE);
+    runner.write_reports();
+    return checks.passed() ? 0 : 1;
+}
@@ -0,0 +1,234 @@
+// Packs a feed into a tick store and queries it.
+//
+//   ./tick_tool pack FEED OUT [--block ROWS] [--decimals D]
+//   ./tick_tool info STORE
+//   ./tick_tool scan STORE [--from NS] [--to NS] [--min-price P] [--max-price P]
+//                          [--types bid,ask,exec] [--columns time,type,symbol,price,qty] [--print N]
+//   ./tick_tool replay STORE [--from NS] [--to NS]
+//
+// FEED is a text or feed_gen binary feed. A binary feed keeps its tick size
+// and its clock (the running sum of delta_ns). Text prices become ticks of
+// 10^-D (2 by default), and as text has no clock, a row's time is its event
+// number. Prices given to scan are in the feed's units, not ticks.
+
+#include "tick_store.h"
+#include "feed_reader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: tick_tool pack FEED OUT [--block ROWS] [--decimals D]\n"
+                 "       tick_tool info STORE\n"
+                 "       tick_tool scan STORE [--from NS] [--to NS] [--min-price P] [--max-price P]\n"
+                 "                            [--types bid,ask,exec] [--columns time,type,symbol,price,qty]\n"
+                 "                            [--print N]\n"
+                 "       tick_tool replay STORE [--from NS] [--to NS]\n");
+}
+
+double seconds_since(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Bit 1 << FeedType for each name in a comma-separated list; 0 if one is unknown.
+uint32_t parse_types(const std::string& s)
+{
+    uint32_t types = 0;
+    std::stringstream ss(s);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        if (name == "bid") types |= 1u << (int)FeedType::Bid;
+        else if (name == "ask") types |= 1u << (int)FeedType::Ask;
+        else if (name == "exec") types |= 1u << (int)FeedType::Execution;
+        else return 0;
+    }
+    return types;
+}
+
+uint32_t parse_columns(const std::string& s)
+{
+    uint32_t columns = 0;
+    std::stringstream ss(s);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        if (name == "time") columns |= TICK_TIME;
+        else if (name == "type") columns |= TICK_TYPE;
+        else if (name == "symbol") columns |= TICK_SYMBOL;
+        else if (name == "price") columns |= TICK_PRICE;
+        else if (name == "qty") columns |= TICK_QTY;
+        else return 0;
+    }
+    return columns;
+}
+
+int pack(const std::string& feed_path, const std::string& out_path, uint32_t block_rows, uint32_t text_decimals)
+{
+    FeedReader feed(feed_path, text_decimals);
+    if (!feed.ok()) {
+        std::fprintf(stderr, "tick_tool: cannot open %s\n", feed_path.c_str());
+        return 1;
+    }
+    const auto t0 = std::chrono::steady_clock::now();
+    TickStoreWriter w(out_path, feed.decimals(), block_rows);
+    FeedEvent ev;
+    for (uint64_t seq = 0; feed.next(ev); seq++) {
+        w.append(feed.binary() ? ev.ts_ns : seq, ev.type, ev.symbol, ev.price_ticks, ev.qty);
+    }
+    const uint64_t rows = w.rows();
+    if (!w.close()) {
+        std::fprintf(stderr, "tick_tool: write to %s failed\n", out_path.c_str());
+        return 1;
+    }
+    TickStoreReader r(out_path);
+    const double secs = seconds_since(t0);
+    std::printf("%llu rows in %zu blocks, %llu bytes (%.2f bytes per row, %.1fx smaller than 16-byte records), "
+                "%.2f s\n",
+                (unsigned long long)rows, r.blocks(), (unsigned long long)r.file_bytes(),
+                rows ? (double)r.file_bytes() / (double)rows : 0.0,
+                r.file_bytes() ? 16.0 * (double)rows / (double)r.file_bytes() : 0.0, secs);
+    return r.ok() ? 0 : 1;
+}
+
+int info(const TickStoreReader& r)
+{
+    static const char* names[TICK_COLUMNS] = {"time", "type", "symbol", "price", "qty"};
+    uint64_t column_bytes[TICK_COLUMNS] = {};
+    uint64_t time_min = ~0ull, time_max = 0;
+    for (std::size_t i = 0; i < r.blocks(); i++) {
+        const TickBlockIndex& b = r.block(i);
+        for (int c = 0; c < TICK_COLUMNS; c++) column_bytes[c] += b.column_bytes[c];
+        time_min = std::min(time_min, b.time_min);
+        time_max = std::max(time_max, b.time_max);
+    }
+    const double rows = r.rows() ? (double)r.rows() : 1.0;
+    std::printf("%llu rows in %zu blocks, %llu bytes, decimals %u\n", (unsigned long long)r.rows(), r.blocks(),
+                (unsigned long long)r.file_bytes(), r.decimals());
+    if (r.blocks()) std::printf("time %llu .. %llu ns\n", (unsigned long long)time_min, (unsigned long long)time_max);
+    for (int c = 0; c < TICK_COLUMNS; c++) {
+        std::printf("  %-7s %12llu bytes  %.2f per row\n", names[c], (unsigned long long)column_bytes[c],
+                    (double)column_bytes[c] / rows);
+    }
+    return 0;
+}
+
+int scan(const TickStoreReader& r, const TickQuery& q, uint64_t print)
+{
+    static const char* types[4] = {"?", "BID", "ASK", "EXECUTION"};
+    TickScanStats stats;
+    uint64_t printed = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    const uint64_t rows = r.scan(q, [&](const TickBatch& b) {
+        for (std::size_t i = 0; i < b.rows && printed < print; i++, printed++) {
+            if (!b.time.empty()) std::printf("%llu", (unsigned long long)b.time[i]);
+            if (!b.type.empty()) std::printf(" %s", types[b.type[i] & 3]);
+            if (!b.price.empty()) {
+                if (!b.type.empty() && b.type[i] == (uint8_t)FeedType::Execution) std::printf(" %d", b.price[i]);
+                else std::printf(" %.*f", (int)r.decimals(), b.price[i] * r.tick());
+            }
+            if (!b.qty.empty()) std::printf(" %d", b.qty[i]);
+            if (!b.symbol.empty()) std::printf(" %u", b.symbol[i]);
+            std::printf("\n");
+        }
+    }, &stats);
+    const double secs = seconds_since(t0);
+    std::printf("%llu rows; %llu blocks read, %llu skipped, %llu bytes decoded; %.3f s\n", (unsigned long long)rows,
+                (unsigned long long)stats.blocks_read, (unsigned long long)stats.blocks_skipped,
+                (unsigned long long)stats.bytes_decoded, secs);
+    return 0;
+}
+
+int replay(const TickStoreReader& r, const TickQuery& q)
+{
+    MarketSnapshot snapshot;
+    const auto t0 = std::chrono::steady_clock::now();
+    const uint64_t rows = replay_into(r, snapshot, q);
+    const double secs = seconds_since(t0);
+    const PriceLevel* bid = snapshot.get_best_bid();
+    const PriceLevel* ask = snapshot.get_best_ask();
+    std::printf("%llu book rows in %.3f s (%.1f M rows/s)\n", (unsigned long long)rows, secs,
+                secs > 0 ? rows / secs / 1e6 : 0.0);
+    if (bid) std::printf("best bid %.*f x %d\n", (int)r.decimals(), bid->price, bid->quantity);
+    if (ask) std::printf("best ask %.*f x %d\n", (int)r.decimals(), ask->price, ask->quantity);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        usage();
+        return 2;
+    }
+    const std::string cmd = argv[1];
+    std::vector<std::string> positional;
+    uint32_t block_rows = 8192, decimals = 2;
+    uint64_t print = 0;
+    TickQuery q;
+    // price bounds wait for the store's tick size
+    double min_price = -INFINITY, max_price = INFINITY;
+    for (int i = 2; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a.rfind("--", 0) != 0) {
+            positional.push_back(a);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "missing value for %s\n", a.c_str());
+            return 2;
+        }
+        const char* v = argv[++i];
+        if (a == "--block") block_rows = (uint32_t)std::strtoul(v, nullptr, 10);
+        else if (a == "--decimals") decimals = (uint32_t)std::strtoul(v, nullptr, 10);
+        else if (a == "--from") q.from_ns = std::strtoull(v, nullptr, 10);
+        else if (a == "--to") q.to_ns = std::strtoull(v, nullptr, 10);
+        else if (a == "--min-price") min_price = std::atof(v);
+        else if (a == "--max-price") max_price = std::atof(v);
+        else if (a == "--types") q.types = parse_types(v);
+        else if (a == "--columns") q.columns = parse_columns(v);
+        else if (a == "--print") print = std::strtoull(v, nullptr, 10);
+        else {
+            std::fprintf(stderr, "unknown option %s\n", a.c_str());
+            return 2;
+        }
+    }
+    if (q.types == 0 || q.columns == 0) {
+        std::fprintf(stderr, "unknown name in --types or --columns\n");
+        return 2;
+    }
+
+    if (cmd == "pack") {
+        if (positional.size() != 2) {
+            usage();
+            return 2;
+        }
+        return pack(positional[0], positional[1], block_rows, decimals);
+    }
+    if (positional.size() != 1 || (cmd != "info" && cmd != "scan" && cmd != "replay")) {
+        usage();
+        return 2;
+    }
+    TickStoreReader r(positional[0]);
+    if (!r.ok()) {
+        std::fprintf(stderr, "tick_tool: %s is missing, truncated or not a tick store\n", positional[0].c_str());
+        return 1;
+    }
+    const double scale = 1.0 / r.tick();
+    if (std::isfinite(min_price)) q.min_price = (int32_t)std::ceil(min_price * scale - 1e-6);
+    if (std::isfinite(max_price)) q.max_price = (int32_t)std::floor(max_price * scale + 1e-6);
+
+    if (cmd == "info") return info(r);
+    if (cmd == "scan") return scan(r, q, print);
+    return replay(r, q);
+}
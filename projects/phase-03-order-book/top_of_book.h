@@ -0,0 +1,109 @@
+#ifndef TOP_OF_BOOK_H
+#define TOP_OF_BOOK_H
+
+#include <cstdint>
+
+#include "market_snapshot.h"
+#include "seqlock.h"
+
+// The best N levels of each side, published from the book's writer thread
+// for strategy threads to read.
+//
+// MarketSnapshot is not thread-safe: its get_best_* pointers point into the
+// map and go stale, or dangle, on the writer's next update. A
+// TopOfBookPublisher listens to the snapshot on the writer thread and keeps
+// its own copy of the top N levels, the way FeatureEngine keeps its window.
+// When an update changes that copy, the publisher stores it into a
+// SeqlockCell. Any number of threads can then read() a consistent copy. A
+// reader never blocks the writer; it retries only if a store overlapped its
+// copy. Updates below the top N do not touch the cell. N = 1 is the best
+// bid/ask alone (48 bytes); each further level adds 32.
+
+struct BookLevel {
+    double price = 0.0;
+    int32_t quantity = 0;
+    int32_t reserved = 0;
+};
+
+template <int N>
+struct TopOfBook {
+    static_assert(N >= 1, "TopOfBook needs at least one level");
+
+    uint64_t version = 0;  // publications so far
+    int32_t bid_count = 0;
+    int32_t ask_count = 0;
+    BookLevel bid[N];      // best first; bid_count / ask_count are filled
+    BookLevel ask[N];
+
+    bool two_sided() const { return bid_count > 0 && ask_count > 0; }
+    double mid() const { return two_sided() ? (bid[0].price + ask[0].price) * 0.5 : 0.0; }
+    double spread() const { return two_sided() ? ask[0].price - bid[0].price : 0.0; }
+};
+
+// Cell is what publications go through: store(const TopOfBook<N>&) on the
+// writer, load() on readers. top_of_book_bench swaps in a mutex-guarded copy
+// to compare.
+template <int N, class Cell = SeqlockCell<TopOfBook<N>>>
+class TopOfBookPublisher : public BookListener
+{
+public:
+    // Rebuild from the snapshot's current book and publish. Writer thread.
+    void reset(const MarketSnapshot& snapshot)
+    {
+        const PriceLevel* levels[N];
+        top_.bid_count = snapshot.top_levels(BookSide::Bid, levels, N);
+        for (int i = 0; i < top_.bid_count; i++) top_.bid[i] = BookLevel{levels[i]->price, levels[i]->quantity, 0};
+        top_.ask_count = snapshot.top_levels(BookSide::Ask, levels, N);
+        for (int i = 0; i < top_.ask_count; i++) top_.ask[i] = BookLevel{levels[i]->price, levels[i]->quantity, 0};
+        publish();
+    }
+
+    // reset() and subscribe. Call snapshot.remove_listener(&publisher) to stop.
+    void attach(MarketSnapshot& snapshot)
+    {
+        reset(snapshot);
+        snapshot.add_listener(this);
+    }
+
+    void on_book_update(BookSide side, const PriceLevel& level) override
+    {
+        const bool bid = side == BookSide::Bid;
+        if (apply(bid ? top_.bid : top_.ask, bid ? top_.bid_count : top_.ask_count, bid, level)) publish();
+    }
+
+    // Any thread: a consistent copy of the last publication.
+    TopOfBook<N> read() const { return cell_.load(); }
+    // Writer thread: the same without going through the seqlock.
+    const TopOfBook<N>& current() const { return top_; }
+
+private:
+    TopOfBook<N> top_;
+    Cell cell_;
+
+    void publish()
+    {
+        top_.version++;
+        cell_.store(top_);
+    }
+
+    // Fold one level update into a side's copy. False if the level is
+    // behind the top N, which MarketSnapshot (never removing a level) can
+    // never bring back into it.
+    static bool apply(BookLevel* side, int32_t& count, bool bid, const PriceLevel& level)
+    {
+        int i = 0;
+        while (i < count && (bid ? side[i].price > level.price : side[i].price < level.price)) i++;
+        if (i == N) return false;
+        if (i < count && side[i].price == level.price) {
+            side[i].quantity = level.quantity;
+            return true;
+        }
+        const int last = count < N ? count : N - 1;
+        for (int j = last; j > i; j--) side[j] = side[j - 1];
+        side[i] = BookLevel{level.price, level.quantity, 0};
+        count = last + 1;
+        return true;
+    }
+};
+
+#endif //TOP_OF_BOOK_H
@@ -0,0 +1,255 @@
+// Seqlock-published top of book: checks, then the writer's cost per book
+// update and the readers' rate with 0 to R reader threads, against the same
+// publisher going through a mutex.
+//
+//   ./top_of_book_bench [feed file] [max readers]
+//
+// The feed's book updates are read into memory first (text or feed_gen
+// binary), as in feature_bench. The checks replay them and compare every
+// publication with the snapshot's own top levels. Then reader threads read
+// while the writer replays, and every copy they got must be exactly one of
+// the publications, never a mix of two, with versions that never go back.
+// Any failure makes the program exit with status 1.
+//
+// In the timed cases the writer replays the feed into a fresh book with the
+// publisher attached. Readers spin on read() until it is done and count
+// their reads and how many saw a new version.
+
+#include "top_of_book.h"
+#include "feed_reader.h"
+
+#include "bench_harness.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+bench::Checks checks;
+
+// The baseline: the same publications, copied under a lock.
+template <class T>
+class MutexCell
+{
+public:
+    void store(const T& value)
+    {
+        std::lock_guard<std::mutex> g(lock_);
+        value_ = value;
+    }
+
+    T load() const
+    {
+        std::lock_guard<std::mutex> g(lock_);
+        return value_;
+    }
+
+private:
+    mutable std::mutex lock_;
+    T value_;
+};
+
+template <int N>
+bool same_as_book(const TopOfBook<N>& t, const MarketSnapshot& book)
+{
+    const PriceLevel* levels[N];
+    const int bids = book.top_levels(BookSide::Bid, levels, N);
+    bool ok = t.bid_count == bids;
+    for (int i = 0; ok && i < bids; i++) {
+        ok = t.bid[i].price == levels[i]->price && t.bid[i].quantity == levels[i]->quantity;
+    }
+    const int asks = book.top_levels(BookSide::Ask, levels, N);
+    ok = ok && t.ask_count == asks;
+    for (int i = 0; ok && i < asks; i++) {
+        ok = t.ask[i].price == levels[i]->price && t.ask[i].quantity == levels[i]->quantity;
+    }
+    return ok;
+}
+
+template <int N>
+bool same_top(const TopOfBook<N>& a, const TopOfBook<N>& b)
+{
+    return std::memcmp(&a, &b, sizeof a) == 0;
+}
+
+template <int N>
+void check_replay(const std::vector<BookUpdate>& events, const char* what)
+{
+    MarketSnapshot book;
+    TopOfBookPublisher<N> pub;
+    pub.attach(book);
+    bool all = true;
+    for (const BookUpdate& e : events) {
+        book.apply(e);
+        all = all && same_as_book(pub.read(), book) && same_top(pub.read(), pub.current());
+    }
+    std::printf("       %s: %llu publications for %zu updates\n", what, (unsigned long long)pub.current().version,
+                events.size());
+    checks.expect(what, all && pub.current().version <= events.size() + 1);
+
+    TopOfBookPublisher<N> late;
+    late.reset(book);
+    checks.expect("reset() on a built book gives the same levels", same_as_book(late.read(), book));
+    book.remove_listener(&pub);
+}
+
+// Readers copy while the writer publishes; every copy must be one of the
+// publications.
+void check_concurrent(const std::vector<BookUpdate>& events, int readers)
+{
+    constexpr int N = 5;
+    const std::size_t n = std::min<std::size_t>(events.size(), 200000);
+    std::vector<TopOfBook<N>> history;
+    history.reserve(n + 2);
+
+    MarketSnapshot book;
+    TopOfBookPublisher<N> pub;
+    pub.attach(book);
+    history.push_back(pub.current());
+
+    std::atomic<bool> done{false};
+    std::vector<std::vector<TopOfBook<N>>> samples(readers);
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; r++) {
+        samples[r].reserve(50000);
+        threads.emplace_back([&, r] {
+            std::vector<TopOfBook<N>>& out = samples[r];
+            while (!done.load(std::memory_order_acquire)) {
+                const TopOfBook<N> t = pub.read();
+                if (out.size() < out.capacity()) out.push_back(t);
+            }
+        });
+    }
+    for (std::size_t i = 0; i < n; i++) {
+        book.apply(events[i]);
+        if (pub.current().version != history.back().version) history.push_back(pub.current());
+    }
+    done.store(true, std::memory_order_release);
+    for (std::thread& t : threads) t.join();
+
+    bool exact = true, ordered = true;
+    std::size_t total = 0;
+    for (const auto& s : samples) {
+        uint64_t last = 0;
+        for (const TopOfBook<N>& t : s) {
+            exact = exact && t.version >= 1 && t.version <= history.size() && same_top(t, history[t.version - 1]);
+            ordered = ordered && t.version >= last;
+            last = t.version;
+        }
+        total += s.size();
+    }
+    std::printf("       %d readers, %zu copies checked against %zu publications\n", readers, total, history.size());
+    checks.expect("every copy a reader got is a whole publication", exact && total > 0);
+    checks.expect("each reader sees versions in order", ordered);
+    book.remove_listener(&pub);
+}
+
+void run_checks(const std::vector<BookUpdate>& events)
+{
+    std::printf("top of book checks\n");
+    check_replay<1>(events, "best bid/ask equals the book after every update");
+    check_replay<5>(events, "top 5 levels equal the book after every update");
+    check_concurrent(events, 3);
+    std::printf("%s\n\n", checks.passed() ? "all top of book checks passed" : "TOP OF BOOK CHECKS FAILED");
+}
+
+struct ReaderCounts {
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> fresh{0};  // reads that saw a newer version than the reader's last
+};
+
+template <class Publisher>
+void time_case(bench::Runner& runner, const std::vector<BookUpdate>& events, const char* cell, int levels,
+               int readers)
+{
+    ReaderCounts counts;
+    double reader_secs = 0.0;
+    uint64_t publications = 0;
+    double runs = 0;
+    const auto& r = runner.run("publish", {{"cell", cell}, {"levels", std::to_string(levels)},
+                                           {"readers", std::to_string(readers)}},
+                               (double)events.size(), [&](bench::Timing& t) {
+        MarketSnapshot book;
+        Publisher pub;
+        pub.attach(book);
+        std::atomic<bool> done{false};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < readers; i++) {
+            threads.emplace_back([&] {
+                uint64_t reads = 0, fresh = 0, last = 0;
+                while (!done.load(std::memory_order_relaxed)) {
+                    const uint64_t v = pub.read().version;
+                    fresh += v != last;
+                    last = v;
+                    reads++;
+                }
+                counts.reads += reads;
+                counts.fresh += fresh;
+            });
+        }
+        const auto t0 = std::chrono::steady_clock::now();
+        t.start();
+        for (const BookUpdate& e : events) book.apply(e);
+        t.stop();
+        done.store(true, std::memory_order_relaxed);
+        for (std::thread& th : threads) th.join();
+        reader_secs += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        publications += pub.current().version;
+        runs++;
+        book.remove_listener(&pub);
+    });
+    bench::Runner::print_case(stdout, r);
+    if (readers > 0) {
+        std::printf("    writer %.1f ns per update; readers %.1f M reads/s in all, "
+                    "each saw %.0f of %.0f publications\n",
+                    r.ns_per_op(), (double)counts.reads / reader_secs / 1e6,
+                    (double)counts.fresh / (runs * readers), (double)publications / runs);
+    } else {
+        std::printf("    writer %.1f ns per update, no readers\n", r.ns_per_op());
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : "sample_feed.txt";
+    const int max_readers = argc > 2 ? std::max(1, std::atoi(argv[2])) : 4;
+    std::vector<BookUpdate> events;
+    if (!load_book_updates(path, events) || events.empty()) {
+        std::fprintf(stderr, "top_of_book_bench: no book updates in %s\n", path);
+        return 1;
+    }
+
+    run_checks(events);
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+    {
+        const auto& r = runner.run("book_only", {{"events", std::to_string(events.size())}}, (double)events.size(),
+                                   [&](bench::Timing& t) {
+                                       MarketSnapshot b;
+                                       t.start();
+                                       for (const BookUpdate& e : events) b.apply(e);
+                                       t.stop();
+                                   });
+        bench::Runner::print_case(stdout, r);
+        std::printf("    %.1f ns per update without a publisher\n", r.ns_per_op());
+    }
+    for (int readers = 0; readers <= max_readers; readers = readers ? readers * 2 : 1) {
+        time_case<TopOfBookPublisher<1>>(runner, events, "seqlock", 1, readers);
+        time_case<TopOfBookPublisher<5>>(runner, events, "seqlock", 5, readers);
+        time_case<TopOfBookPublisher<1, MutexCell<TopOfBook<1>>>>(runner, events, "mutex", 1, readers);
+        time_case<TopOfBookPublisher<5, MutexCell<TopOfBook<5>>>>(runner, events, "mutex", 5, readers);
+    }
+
+    runner.write_reports();
+    return checks.passed() ? 0 : 1;
+}
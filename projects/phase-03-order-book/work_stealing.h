@@ -0,0 +1,94 @@
+#ifndef WORK_STEALING_H
+#define WORK_STEALING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs a fixed set of independent tasks on a number of threads, each with
+// its own queue. The tasks are dealt out in contiguous runs, one per worker.
+// A worker takes from the back of its own queue; when that is empty it
+// steals from the front of another's, so workers whose tasks were cheap
+// take over the rest of the slow ones' runs instead of sitting idle. No
+// task adds tasks, so once every queue is empty there is nothing left and
+// the workers return.
+//
+// Tasks here are whole backtests, milliseconds to seconds each, so a queue
+// is a mutex around a deque: it is taken once per task, which costs nothing
+// next to the task. The calling thread is worker 0.
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(int threads) : threads_(threads < 1 ? 1 : threads) {}
+
+    int threads() const { return threads_; }
+
+    // Calls fn(task, worker) once for every task in [0, tasks) and returns
+    // when all have finished. fn must not throw.
+    void run(std::size_t tasks, const std::function<void(std::size_t task, int worker)>& fn)
+    {
+        std::vector<Queue> queues(threads_);
+        for (int w = 0; w < threads_; ++w) {
+            const std::size_t first = tasks * w / threads_, last = tasks * (w + 1) / threads_;
+            for (std::size_t t = first; t < last; ++t) queues[w].tasks.push_back(t);
+        }
+        steals_ = 0;
+        std::vector<std::thread> pool;
+        for (int w = 1; w < threads_; ++w) pool.emplace_back([&, w] { work(queues, w, fn); });
+        work(queues, 0, fn);
+        for (std::thread& t : pool) t.join();
+    }
+
+    // Tasks taken from another worker's queue during the last run().
+    uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Queue {
+        std::mutex lock;
+        std::deque<std::size_t> tasks;
+    };
+
+    int threads_;
+    std::atomic<uint64_t> steals_{0};
+
+    static bool pop_back(Queue& q, std::size_t& task)
+    {
+        std::lock_guard<std::mutex> g(q.lock);
+        if (q.tasks.empty()) return false;
+        task = q.tasks.back();
+        q.tasks.pop_back();
+        return true;
+    }
+
+    static bool pop_front(Queue& q, std::size_t& task)
+    {
+        std::lock_guard<std::mutex> g(q.lock);
+        if (q.tasks.empty()) return false;
+        task = q.tasks.front();
+        q.tasks.pop_front();
+        return true;
+    }
+
+    void work(std::vector<Queue>& queues, int self, const std::function<void(std::size_t, int)>& fn)
+    {
+        const int n = (int)queues.size();
+        for (;;) {
+            std::size_t task;
+            bool found = pop_back(queues[self], task);
+            // victims in turn from the next worker on, so thieves spread out
+            for (int i = 1; !found && i < n; ++i) {
+                found = pop_front(queues[(self + i) % n], task);
+                if (found) steals_.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (!found) return;
+            fn(task, self);
+        }
+    }
+};
+
+#endif //WORK_STEALING_H
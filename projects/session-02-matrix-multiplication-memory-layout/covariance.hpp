@@ -0,0 +1,182 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "matrix.hpp"
+
+// Exponentially weighted (RiskMetrics-style, zero-mean) covariance of
+// mid-price log returns across n instruments:
+//
+//   S_t = lambda * S_{t-1} + (1 - lambda) * r_t r_t^T
+//
+// Only the upper triangle is stored, packed row by row (n(n+1)/2 doubles,
+// half of the dense matrix). The decay is kept in a separate scale factor,
+// S = scale_ * P, so a tick is a single rank-1 pass P += c * r r^T with
+// unit-stride rows and no multiply-by-lambda sweep. P is renormalised once
+// the scale gets small.
+//
+// The last `window` returns are kept in a ring so the matrix can be rebuilt
+// from scratch (recompute) with the blocked, threaded GEMM, which resets any
+// rounding drift the incremental updates have accumulated. Weights older
+// than the window are dropped, an error of lambda^window relative.
+class EwmaCovariance
+{
+public:
+    EwmaCovariance(int n, double lambda, int window)
+        : n_(n), window_(window), lambda_(lambda),
+          packed_((size_t)n * (n + 1) / 2, 0.0), prevMid_(n, 0.0), ret_(n, 0.0),
+          history_((size_t)window * n, 0.0)
+    {
+    }
+
+    int size() const { return n_; }
+    long ticks() const { return ticks_; }
+
+    // Feed one snapshot of mid prices. The first call only records the mids.
+    void updateMids(const double* mid)
+    {
+        if (!primed_)
+        {
+            std::copy(mid, mid + n_, prevMid_.begin());
+            primed_ = true;
+            return;
+        }
+        for (int i = 0; i < n_; i ++)
+        {
+            ret_[i] = std::log(mid[i] / prevMid_[i]);
+            prevMid_[i] = mid[i];
+        }
+        updateReturns(ret_.data());
+    }
+
+    // Same, from anything with bid/ask members (session-04's Quote).
+    template <class Q>
+    void updateQuotes(const Q* quotes)
+    {
+        if (mids_.empty()) mids_.resize(n_);
+        for (int i = 0; i < n_; i ++) mids_[i] = (quotes[i].bid + quotes[i].ask) * 0.5;
+        updateMids(mids_.data());
+    }
+
+    // Rank-1 update with one vector of returns.
+    void updateReturns(const double* r)
+    {
+        std::copy(r, r + n_, history_.begin() + (size_t)(ticks_ % window_) * n_);
+        ticks_ ++;
+
+        scale_ *= lambda_;
+        if (scale_ < RENORM_BELOW) renormalise();
+        const double c = (1.0 - lambda_) / scale_;
+
+        double* row = packed_.data();
+        for (int i = 0; i < n_; i ++)
+        {
+            const double ci = c * r[i];
+            const double* rj = r + i;
+            const int len = n_ - i;
+            for (int j = 0; j < len; j ++) row[j] += ci * rj[j];
+            row += len;
+        }
+    }
+
+    // Rebuild the matrix from the returns in the window:
+    //   S = sum_a (1 - lambda) lambda^a r_{t-a} r_{t-a}^T = X^T X
+    // with the rows of X the returns scaled by sqrt of their weight. The
+    // product runs through Matrix::gemmParallel; it computes the full square
+    // (twice the symmetric work) but at packed-GEMM speed, which is still far
+    // ahead of a triangular loop.
+    void recompute(int threads = 1)
+    {
+        const int rows = (int)std::min<long>(ticks_, window_);
+        std::vector<double> X((size_t)rows * n_), Xt((size_t)n_ * rows), full((size_t)n_ * n_);
+        double w = 1.0 - lambda_;
+        for (int a = 0; a < rows; a ++)
+        {
+            const double* r = history_.data() + (size_t)((ticks_ - 1 - a) % window_) * n_;
+            const double s = std::sqrt(w);
+            for (int i = 0; i < n_; i ++)
+            {
+                X[(size_t)a * n_ + i] = s * r[i];
+                Xt[(size_t)i * rows + a] = s * r[i];
+            }
+            w *= lambda_;
+        }
+        if (rows > 0)
+        {
+            Matrix::gemmParallel(Xt.data(), X.data(), full.data(), n_, n_, rows, rows, n_, n_, threads);
+        }
+
+        double* row = packed_.data();
+        for (int i = 0; i < n_; i ++)
+        {
+            for (int j = i; j < n_; j ++) *row++ = full[(size_t)i * n_ + j];
+        }
+        scale_ = 1.0;
+    }
+
+    double covariance(int i, int j) const
+    {
+        if (i > j) std::swap(i, j);
+        return scale_ * packed_[rowOffset(i) + (j - i)];
+    }
+
+    double variance(int i) const { return covariance(i, i); }
+
+    double correlation(int i, int j) const
+    {
+        const double d = std::sqrt(variance(i) * variance(j));
+        return d > 0.0 ? covariance(i, j) / d : 0.0;
+    }
+
+    // w^T S w for a vector of position weights.
+    double portfolioVariance(const double* w) const
+    {
+        double total = 0.0;
+        const double* row = packed_.data();
+        for (int i = 0; i < n_; i ++)
+        {
+            double s = 0.0;
+            for (int j = i + 1; j < n_; j ++) s += row[j - i] * w[j];
+            total += w[i] * (row[0] * w[i] + 2.0 * s);
+            row += n_ - i;
+        }
+        return scale_ * total;
+    }
+
+    // Dense n x n copy, both triangles filled.
+    void unpack(double* out) const
+    {
+        for (int i = 0; i < n_; i ++)
+        {
+            for (int j = i; j < n_; j ++)
+            {
+                out[(size_t)i * n_ + j] = out[(size_t)j * n_ + i] = covariance(i, j);
+            }
+        }
+    }
+
+private:
+    static constexpr double RENORM_BELOW = 1e-100;
+
+    int n_;
+    int window_;
+    double lambda_;
+    double scale_ = 1.0;
+    long ticks_ = 0;
+    bool primed_ = false;
+    std::vector<double> packed_;  // upper triangle, row i holds columns i..n-1
+    std::vector<double> prevMid_;
+    std::vector<double> ret_;
+    std::vector<double> mids_;
+    std::vector<double> history_; // ring of the last window_ return vectors
+
+    size_t rowOffset(int i) const { return (size_t)i * n_ - (size_t)i * (i - 1) / 2; }
+
+    void renormalise()
+    {
+        for (double& x : packed_) x *= scale_;
+        scale_ = 1.0;
+    }
+};
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_harness.hpp"
+#include "covariance.hpp"
+
+// Same fields as session-04's Quote.
+struct Quote
+{
+    double bid;
+    double ask;
+    double bid_qty;
+    double ask_qty;
+};
+
+// snapshots per timed batch
+constexpr int TICKS = 256;
+// returns kept for recompute
+constexpr int WINDOW = 512;
+
+// "100,500,1000" -> {100, 500, 1000}
+static std::vector<int> parseSizes(const char* s)
+{
+    std::vector<int> out;
+    while (*s)
+    {
+        char* end = nullptr;
+        long v = std::strtol(s, &end, 10);
+        if (end == s) break;
+        if (v > 0) out.push_back((int)v);
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return out;
+}
+
+static double uniform() { return (rand() + 0.5) / ((double)RAND_MAX + 1.0); }
+
+static double gaussian()
+{
+    return std::sqrt(-2.0 * std::log(uniform())) * std::cos(6.283185307179586 * uniform());
+}
+
+// One-factor random walk: r_i = beta_i * f + e_i, quoted one tick wide around the mid.
+static std::vector<Quote> makeQuotes(int n, int ticks)
+{
+    std::vector<double> beta(n), mid(n);
+    for (int i = 0; i < n; i ++)
+    {
+        beta[i] = 0.5 + uniform();
+        mid[i] = 20.0 + 180.0 * uniform();
+    }
+    std::vector<Quote> q((size_t)n * ticks);
+    for (int t = 0; t < ticks; t ++)
+    {
+        const double f = 1e-4 * gaussian();
+        for (int i = 0; i < n; i ++)
+        {
+            mid[i] *= std::exp(beta[i] * f + 5e-5 * gaussian());
+            q[(size_t)t * n + i] = {mid[i] - 0.005, mid[i] + 0.005, 100.0, 100.0};
+        }
+    }
+    return q;
+}
+
+// Baseline: dense n x n, both triangles, S = lambda S + (1 - lambda) r r^T.
+static void denseUpdate(double* S, const double* r, int n, double lambda)
+{
+    const double c = 1.0 - lambda;
+    for (int i = 0; i < n; i ++)
+    {
+        const double ci = c * r[i];
+        double* row = S + (size_t)i * n;
+        for (int j = 0; j < n; j ++) row[j] = lambda * row[j] + ci * r[j];
+    }
+}
+
+// largest |a - b| over the largest |b|
+static double relDiff(const std::vector<double>& a, const std::vector<double>& b)
+{
+    double diff = 0.0, norm = 0.0;
+    for (size_t x = 0; x < a.size(); x ++)
+    {
+        diff = std::max(diff, std::fabs(a[x] - b[x]));
+        norm = std::max(norm, std::fabs(b[x]));
+    }
+    return norm > 0.0 ? diff / norm : diff;
+}
+
+// Usage: ./covariance [n,n,...] [threads] [lambda]
+int main(int argc, char** argv)
+{
+    srand(12345);
+
+    std::vector<int> sizes = {100, 500, 1000};
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    double lambda = 0.97;
+    if (argc > 1) sizes = parseSizes(argv[1]);
+    if (argc > 2) threads = std::max(1, std::atoi(argv[2]));
+    if (argc > 3) lambda = std::atof(argv[3]);
+
+    bench::Runner runner;
+    runner.print_header(stdout);
+    std::printf("# lambda %.4f, window %d, %d ticks per batch, recompute threads %d\n",
+                lambda, WINDOW, TICKS, threads);
+
+    int failures = 0;
+    double checksum = 0.0;
+
+    for (const int n : sizes)
+    {
+        std::printf("n = %d\n", n);
+        const std::vector<Quote> quotes = makeQuotes(n, TICKS + 1);
+
+        // log returns of the same path, for the cases that skip the quote -> return step
+        std::vector<double> returns((size_t)n * TICKS);
+        for (int t = 0; t < TICKS; t ++)
+        {
+            for (int i = 0; i < n; i ++)
+            {
+                const Quote& a = quotes[(size_t)t * n + i];
+                const Quote& b = quotes[(size_t)(t + 1) * n + i];
+                returns[(size_t)t * n + i] = std::log((b.bid + b.ask) / (a.bid + a.ask));
+            }
+        }
+
+        // Correctness first, on fewer ticks than the window so recompute sees
+        // every return: incremental == recompute == dense, up to rounding.
+        {
+            EwmaCovariance cov(n, lambda, WINDOW);
+            std::vector<double> dense((size_t)n * n, 0.0);
+            for (int t = 0; t <= TICKS; t ++) cov.updateQuotes(quotes.data() + (size_t)t * n);
+            for (int t = 0; t < TICKS; t ++) denseUpdate(dense.data(), returns.data() + (size_t)t * n, n, lambda);
+
+            std::vector<double> incremental((size_t)n * n), rebuilt((size_t)n * n);
+            cov.unpack(incremental.data());
+            cov.recompute(threads);
+            cov.unpack(rebuilt.data());
+
+            std::vector<double> w(n);
+            for (int i = 0; i < n; i ++) w[i] = (i % 3 == 0) ? -1.0 : 1.0;
+            double wSw = 0.0;
+            for (int i = 0; i < n; i ++)
+            {
+                for (int j = 0; j < n; j ++) wSw += w[i] * dense[(size_t)i * n + j] * w[j];
+            }
+
+            const double dDense = relDiff(incremental, dense);
+            const double dRebuilt = relDiff(incremental, rebuilt);
+            const double dPortfolio = std::fabs(cov.portfolioVariance(w.data()) - wSw) / std::fabs(wSw);
+            std::printf("  check: incremental vs dense %.2e, vs recompute %.2e, portfolio variance %.2e\n",
+                        dDense, dRebuilt, dPortfolio);
+            if (!(dDense < 1e-9 && dRebuilt < 1e-9 && dPortfolio < 1e-9))
+            {
+                ++failures;
+                std::fprintf(stderr, "covariance mismatch at n=%d\n", n);
+            }
+        }
+
+        const bench::Params params = {{"n", std::to_string(n)}, {"threads", "1"}};
+        auto perTick = [&](const bench::CaseResult& r) {
+            bench::Runner::print_case(stdout, r);
+            std::printf("    %-16s %10.3f us/tick\n", r.name.c_str(), r.ns_per_op() / 1e3);
+        };
+
+        // one op = one tick across all n instruments
+        EwmaCovariance cov(n, lambda, WINDOW);
+        cov.updateQuotes(quotes.data());
+        perTick(runner.run("update_quotes", params, TICKS, [&] {
+            for (int t = 1; t <= TICKS; t ++) cov.updateQuotes(quotes.data() + (size_t)t * n);
+        }));
+        perTick(runner.run("update_packed", params, TICKS, [&] {
+            for (int t = 0; t < TICKS; t ++) cov.updateReturns(returns.data() + (size_t)t * n);
+        }));
+        checksum += cov.variance(0);
+
+        std::vector<double> dense((size_t)n * n, 0.0);
+        perTick(runner.run("update_dense", params, TICKS, [&] {
+            for (int t = 0; t < TICKS; t ++) denseUpdate(dense.data(), returns.data() + (size_t)t * n, n, lambda);
+            bench::do_not_optimize(dense[0]);
+        }));
+        checksum += dense[0];
+
+        // Tail of single ticks (the batch cases above only give the mean).
+        std::vector<double> tickNs;
+        tickNs.reserve(TICKS * 8);
+        for (int rep = 0; rep < 8; rep ++)
+        {
+            for (int t = 0; t < TICKS; t ++)
+            {
+                const auto t0 = std::chrono::steady_clock::now();
+                cov.updateReturns(returns.data() + (size_t)t * n);
+                const auto t1 = std::chrono::steady_clock::now();
+                tickNs.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+            }
+        }
+        const bench::Stats ts = bench::Stats::from(tickNs);
+        std::printf("    single tick      p50 %.3f us  p99 %.3f us  max %.3f us\n",
+                    ts.median / 1e3, ts.p99 / 1e3, ts.max / 1e3);
+
+        // cov now holds more ticks than the window, as it would in production
+        const bench::CaseResult& rc = runner.run("recompute",
+            {{"n", std::to_string(n)}, {"threads", std::to_string(threads)}}, 1, [&] { cov.recompute(threads); });
+        bench::Runner::print_case(stdout, rc);
+        std::printf("    %-16s %10.3f ms (%d returns)\n", "recompute", rc.stats.median / 1e6, WINDOW);
+        checksum += cov.variance(n - 1);
+    }
+
+    std::printf("%g\n", checksum);
+    runner.write_reports();
+    return failures == 0 ? 0 : 1;
+}
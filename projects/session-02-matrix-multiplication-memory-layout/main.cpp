@@ -1,201 +1,251 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
-#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
 
-class Matrix
-{
-public:
-    static double avg(const double* arr, int trials) {
-        double s = 0.0;
-        for (int i = 0; i < trials; ++i)
-            s += arr[i];
-        return s / trials;
-    }
+#include "bench_harness.hpp"
+#include "matrix.hpp"
+#include "matrix_alloc.hpp"
+#include "matrix_layout.hpp"
 
-    static double* allocateContig(const int N)
-    {
-        return new double[N*N];
-    }
+// rows / contig / contig_ikj are too slow to sweep past this size
+constexpr int NAIVE_MAX_N = 1000;
 
-    static void fillContig(const int N, double* contig)
+// "500,1000,2000" -> {500, 1000, 2000}
+static std::vector<int> parseSizes(const char* s)
+{
+    std::vector<int> out;
+    while (*s)
     {
-        for (int i = 0; i < N; i++)
-        {
-            for (int j = 0; j < N; j++)
-            {
-                contig[i*N+j] = rand() % 10 + 1;
-            }
-        }
+        char* end = nullptr;
+        long v = std::strtol(s, &end, 10);
+        if (end == s) break;
+        if (v > 0) out.push_back((int)v);
+        s = (*end == ',') ? end + 1 : end;
     }
+    return out;
+}
+
+// Layout x allocator grid: for every cell, the packed GEMM (GFLOP/s) and a
+// row-order and column-order sweep over A (GB/s), with the dTLB misses per
+// op coming from the harness counters. Results are checked against `ref`.
+static int runLayouts(bench::Runner& runner, int N, int threads,
+                      const double* contigA, const double* contigB, const double* ref, double& checksum)
+{
+    const LayoutKind layouts[] = {LayoutKind::Contig, LayoutKind::Padded, LayoutKind::Morton};
+    const AllocKind allocs[] = {AllocKind::Heap, AllocKind::Aligned, AllocKind::HugePage, AllocKind::HugeTLB};
 
-    static void deallocateContig(const double* ptr)
-    {
-        delete[] ptr;
-    }
+    // integer entries, so the sums are exact in any order
+    double sumA = 0.0;
+    for (size_t x = 0; x < (size_t)N * N; x ++) sumA += contigA[x];
 
-    static double ** allocateRows(const int N)
+    int mismatches = 0;
+    std::vector<double> out((size_t)N * N);
+    for (const LayoutKind lk : layouts)
     {
-        auto ** ptr = new double*[N];
-        for (int i = 0; i < N; i ++)
+        const MatrixLayout layout(lk, N);
+        for (const AllocKind ak : allocs)
         {
-            ptr[i] = new double[N];
-        }
-        return ptr;
-    }
+            Allocation A = MatrixAllocator::allocate(layout.elements(), ak, threads);
+            Allocation B = MatrixAllocator::allocate(layout.elements(), ak, threads);
+            Allocation C = MatrixAllocator::allocate(layout.elements(), ak, threads);
+            // a fallback cell would just repeat the one before it
+            if (A.kind != ak)
+            {
+                std::printf("  %s/%s: unavailable (fell back to %s), skipped\n", MatrixLayout::kindName(lk),
+                            MatrixAllocator::kindName(ak), MatrixAllocator::kindName(A.kind));
+                MatrixAllocator::deallocate(A);
+                MatrixAllocator::deallocate(B);
+                MatrixAllocator::deallocate(C);
+                continue;
+            }
+            const double hugeMB = (double)MatrixAllocator::hugePageBytes(A) / (1 << 20);
+            std::printf("  %s/%s: ld %d, %.1f MB per matrix, %.1f MB on huge pages\n",
+                        MatrixLayout::kindName(lk), MatrixAllocator::kindName(A.kind), layout.ld(),
+                        (double)A.bytes / (1 << 20), hugeMB);
+            layout.load(contigA, A.data);
+            layout.load(contigB, B.data);
+
+            const bench::Params params = {{"N", std::to_string(N)},
+                                          {"layout", MatrixLayout::kindName(lk)},
+                                          {"alloc", MatrixAllocator::kindName(A.kind)},
+                                          {"threads", std::to_string(threads)}};
+            const auto tag = std::string(MatrixLayout::kindName(lk)) + "/" + MatrixAllocator::kindName(A.kind);
+
+            bool checked = false;
+            const bench::CaseResult& g = runner.run("layout_gemm", params, (double)N * N * N, [&](bench::Timing& tm) {
+                tm.start();
+                layout.multiply(A.data, B.data, C.data, threads);
+                tm.stop();
+                if (!checked)
+                {
+                    checked = true;
+                    layout.store(C.data, out.data());
+                    if (!std::equal(out.begin(), out.end(), ref))
+                    {
+                        ++mismatches;
+                        std::fprintf(stderr, "result mismatch: layout_gemm %s N=%d\n", tag.c_str(), N);
+                    }
+                }
+            });
+            bench::Runner::print_case(stdout, g);
+            std::printf("    %-16s %8.2f GFLOP/s\n", tag.c_str(), 2.0 * g.ops_per_sec() / 1e9);
 
-    static void fillRows(const int N, double **ptr)
-    {
-        for (int i = 0; i < N; i ++)
-        {
-            for (int j = 0; j < N; j ++)
+            // one op = one element read
+            for (const bool byRows : {true, false})
             {
-                *(*(ptr + i) + j) = rand() % 10 + 1;
+                double sum = 0.0;
+                const bench::CaseResult& r = runner.run(byRows ? "layout_sweep_rows" : "layout_sweep_cols", params,
+                                                        (double)N * N, [&](bench::Timing& tm) {
+                    tm.start();
+                    sum = byRows ? layout.sweepRows(A.data) : layout.sweepCols(A.data);
+                    tm.stop();
+                    bench::do_not_optimize(sum);
+                });
+                if (sum != sumA)
+                {
+                    ++mismatches;
+                    std::fprintf(stderr, "sum mismatch: %s %s N=%d\n", r.name.c_str(), tag.c_str(), N);
+                }
+                checksum += sum;
+                bench::Runner::print_case(stdout, r);
+                std::printf("    %-16s %8.2f GB/s\n", tag.c_str(), 8.0 * r.ops_per_sec() / 1e9);
             }
+
+            MatrixAllocator::deallocate(A);
+            MatrixAllocator::deallocate(B);
+            MatrixAllocator::deallocate(C);
         }
     }
+    return mismatches;
+}
+
+// Usage: ./matmul [N,N,...] [threads] [kernels|layouts|all]
+int main(int argc, char** argv)
+{
+    srand(12345);
+    double checksum = 0.0;
+
+    std::vector<int> sizes = {500, 1000, 2000, 3000, 4096};
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    if (argc > 1) sizes = parseSizes(argv[1]);
+    if (argc > 2) threads = std::max(1, std::atoi(argv[2]));
+    const std::string mode = (argc > 3) ? argv[3] : "all";
+    const bool doKernels = mode == "kernels" || mode == "all";
+    const bool doLayouts = mode == "layouts" || mode == "all";
+
+    // warmup, repeat-until-stable, stats, counters and CSV/JSON output
+    bench::Runner runner;
+    runner.print_header(stdout);
+    std::printf("# packed kernel: %s, threads: %d\n", Matrix::packedKernelName(), threads);
 
-    static void deallocateRows(double** ptr, const int N)
+    int mismatches = 0;
+
+    for (const int N : sizes)
     {
-        for (int i = 0; i < N; i ++)
+        const bool naive = doKernels && N <= NAIVE_MAX_N;
+
+        // allocate matrices
+        double* contigA = Matrix::allocateContig(N);
+        double* contigB = Matrix::allocateContig(N);
+        double* contigC = Matrix::allocateContig(N);
+        double* contigRef = Matrix::allocateContig(N);
+
+        double** rowsA = naive ? Matrix::allocateRows(N) : nullptr;
+        double** rowsB = naive ? Matrix::allocateRows(N) : nullptr;
+        double** rowsC = naive ? Matrix::allocateRows(N) : nullptr;
+
+        // fill matrices
+        Matrix::fillContig(N, contigA);
+        Matrix::fillContig(N, contigB);
+        if (naive)
         {
-            delete[] ptr[i];
+            Matrix::fillRows(N, rowsA);
+            Matrix::fillRows(N, rowsB);
         }
-        delete[] ptr;
-    }
 
-    static void matmulContig(const double* A, const double* B, double* C, int N)
-    {
-        for (int i = 0; i < N; i ++)
-        {
-            for (int j = 0; j < N; j ++)
-            {
-                C[i * N + j] = 0;
-                for (int k = 0; k < N; k ++)
+        // Entries are small integers, so every kernel's sums are exact and
+        // must match the reference bit for bit whatever the summation order.
+        Matrix::matmulBlocked(contigA, contigB, contigRef, N);
+
+        // one op = one multiply-add (2 flops)
+        const double ops = (double)N * N * N;
+        int t = 0;
+
+        std::cout << "N = " << N << "\n";
+
+        auto report = [&](const bench::CaseResult& r) {
+            bench::Runner::print_case(stdout, r);
+            std::printf("    %-12s %8.2f GFLOP/s\n", r.name.c_str(), 2.0 * r.ops_per_sec() / 1e9);
+        };
+
+        // times `kernel` on the contiguous matrices and checks C once against the reference
+        auto runContig = [&](const char* name, int kernelThreads, auto kernel) {
+            bool checked = false;
+            const bench::Params params = {{"N", std::to_string(N)}, {"threads", std::to_string(kernelThreads)}};
+            report(runner.run(name, params, ops, [&](bench::Timing& tm) {
+                tm.start();
+                kernel();
+                tm.stop();
+                checksum += contigC[(t % N)*N + (t % N)];
+                ++t;
+                if (!checked)
                 {
-                    C[i * N + j] += A[i * N + k] * B[k * N + j];
+                    checked = true;
+                    if (!std::equal(contigC, contigC + (size_t)N * N, contigRef))
+                    {
+                        ++mismatches;
+                        std::fprintf(stderr, "result mismatch: %s N=%d\n", name, N);
+                    }
                 }
-            }
-        }
+            }));
+        };
 
-    }
-    static void matmulRows (double** A, double** B, double** C, int N)
-    {
-        for (int i = 0; i < N; i ++)
+        if (naive)
         {
-            for (int j = 0; j < N; j ++)
+            report(runner.run("rows", {{"N", std::to_string(N)}, {"threads", "1"}}, ops, [&](bench::Timing& tm) {
+                tm.start();
+                Matrix::matmulRows(rowsA, rowsB, rowsC, N);
+                tm.stop();
+                checksum += rowsC[t % N][t % N];
+                ++t;
+            }));
+
+            runContig("contig", 1, [&] { Matrix::matmulContig(contigA, contigB, contigC, N); });
+            runContig("contig_ikj", 1, [&] { Matrix::matmulContigIKJ(contigA, contigB, contigC, N); });
+        }
+        if (doKernels)
+        {
+            runContig("blocked", 1, [&] { Matrix::matmulBlocked(contigA, contigB, contigC, N); });
+            runContig("packed", 1, [&] { Matrix::matmulPacked(contigA, contigB, contigC, N); });
+            if (threads > 1)
             {
-                *(*(C + i) + j) = 0.0;
-                for (int k = 0; k < N; k ++)
-                {
-                    // *(*(C + i) + j ) += (*(*(A+i)+k)) * (*(*(B+k)+j));
-                    C[i][j] += A[i][k]*B[k][j];
-                }
+                runContig("parallel", threads, [&] { Matrix::matmulParallel(contigA, contigB, contigC, N, threads); });
             }
         }
-    }
-};
+        if (doLayouts)
+        {
+            mismatches += runLayouts(runner, N, threads, contigA, contigB, contigRef, checksum);
+        }
 
-int main()
-{
-    srand(12345);
-    using clk = std::chrono::steady_clock;
-    using ms  = std::chrono::duration<double, std::milli>;
-    double checksum = 0.0;
+        // cleanup
+        Matrix::deallocateContig(contigA);
+        Matrix::deallocateContig(contigB);
+        Matrix::deallocateContig(contigC);
+        Matrix::deallocateContig(contigRef);
 
-    const int N1 = 500;
-    const int N2 = 1000;
-    constexpr int trials = 5;
-
-    // allocate matrices
-    double* contigA1 = Matrix::allocateContig(N1);
-    double* contigB1 = Matrix::allocateContig(N1);
-    double* contigC1 = Matrix::allocateContig(N1);
-    double* contigA2 = Matrix::allocateContig(N2);
-    double* contigB2 = Matrix::allocateContig(N2);
-    double* contigC2 = Matrix::allocateContig(N2);
-
-    double** rowsA1 = Matrix::allocateRows(N1);
-    double** rowsB1 = Matrix::allocateRows(N1);
-    double** rowsC1 = Matrix::allocateRows(N1);
-    double** rowsA2 = Matrix::allocateRows(N2);
-    double** rowsB2 = Matrix::allocateRows(N2);
-    double** rowsC2 = Matrix::allocateRows(N2);
-
-    // fill matrices
-    Matrix::fillContig(N1, contigA1);
-    Matrix::fillContig(N1, contigB1);
-    Matrix::fillContig(N2, contigA2);
-    Matrix::fillContig(N2, contigB2);
-
-    Matrix::fillRows(N1, rowsA1);
-    Matrix::fillRows(N1, rowsB1);
-    Matrix::fillRows(N2, rowsA2);
-    Matrix::fillRows(N2, rowsB2);
-
-    // untimed warmup
-    Matrix::matmulRows(rowsA1, rowsB1, rowsC1, N1);
-    Matrix::matmulRows(rowsA2, rowsB2, rowsC2, N2);
-    Matrix::matmulContig(contigA1, contigB1, contigC1, N1);
-    Matrix::matmulContig(contigA2, contigB2, contigC2, N2);
-
-    // trials
-    double rowsResults1[trials];
-    double contigResults1[trials];
-    double rowsResults2[trials];
-    double contigResults2[trials];
-
-    for (int t = 0; t < trials; ++t) {
-        // rows N1
-        auto t0 = clk::now();
-        Matrix::matmulRows(rowsA1, rowsB1, rowsC1, N1);
-        auto t1 = clk::now();
-        rowsResults1[t] = std::chrono::duration_cast<ms>(t1 - t0).count();
-        checksum += rowsC1[t % N1][t % N1];
-
-        // contig N1
-        t0 = clk::now();
-        Matrix::matmulContig(contigA1, contigB1, contigC1, N1);
-        t1 = clk::now();
-        contigResults1[t] = std::chrono::duration_cast<ms>(t1 - t0).count();
-        checksum += contigC1[(t % N1)*N1 + (t % N1)];
-
-        // rows N2
-        t0 = clk::now();
-        Matrix::matmulRows(rowsA2, rowsB2, rowsC2, N2);
-        t1 = clk::now();
-        rowsResults2[t] = std::chrono::duration_cast<ms>(t1 - t0).count();
-        checksum += rowsC2[t % N2][t % N2];              // FIX: use N2
-
-        // contig N2
-        t0 = clk::now();
-        Matrix::matmulContig(contigA2, contigB2, contigC2, N2);
-        t1 = clk::now();
-        contigResults2[t] = std::chrono::duration_cast<ms>(t1 - t0).count();
-        checksum += contigC2[(t % N2)*N2 + (t % N2)];     // FIX: use contigC2 and N2
+        if (naive)
+        {
+            Matrix::deallocateRows(rowsA, N);
+            Matrix::deallocateRows(rowsB, N);
+            Matrix::deallocateRows(rowsC, N);
+        }
     }
 
     std::cout << checksum << std::endl;
-    std::cout << "N = " << N1 << "\n";
-    std::cout << "  rows   avg: " << Matrix::avg(rowsResults1, trials)   << " ms\n";
-    std::cout << "  contig avg: " << Matrix::avg(contigResults1, trials) << " ms\n";
-
-    std::cout << "N = " << N2 << "\n";
-    std::cout << "  rows   avg: " << Matrix::avg(rowsResults2, trials)   << " ms\n";
-    std::cout << "  contig avg: " << Matrix::avg(contigResults2, trials) << " ms\n";
-
-    // cleanup
-    Matrix::deallocateContig(contigA1);
-    Matrix::deallocateContig(contigB1);
-    Matrix::deallocateContig(contigC1);
-    Matrix::deallocateContig(contigA2);
-    Matrix::deallocateContig(contigB2);
-    Matrix::deallocateContig(contigC2);
-
-    Matrix::deallocateRows(rowsA1, N1);
-    Matrix::deallocateRows(rowsB1, N1);
-    Matrix::deallocateRows(rowsC1, N1);
-    Matrix::deallocateRows(rowsA2, N2);
-    Matrix::deallocateRows(rowsB2, N2);
-    Matrix::deallocateRows(rowsC2, N2);
-
-    return 0;
-}
\ No newline at end of file
+    runner.write_reports();
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,358 @@
+#pragma once
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+// Dense N x N matrix helpers and multiplication kernels, from the naive
+// triple loops (rows / contig) up to a packed, vectorised, threaded GEMM.
+class Matrix
+{
+public:
+    static double* allocateContig(const int N)
+    {
+        return new double[N*N];
+    }
+
+    static void fillContig(const int N, double* contig)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            for (int j = 0; j < N; j++)
+            {
+                contig[i*N+j] = rand() % 10 + 1;
+            }
+        }
+    }
+
+    static void deallocateContig(const double* ptr)
+    {
+        delete[] ptr;
+    }
+
+    static double ** allocateRows(const int N)
+    {
+        auto ** ptr = new double*[N];
+        for (int i = 0; i < N; i ++)
+        {
+            ptr[i] = new double[N];
+        }
+        return ptr;
+    }
+
+    static void fillRows(const int N, double **ptr)
+    {
+        for (int i = 0; i < N; i ++)
+        {
+            for (int j = 0; j < N; j ++)
+            {
+                *(*(ptr + i) + j) = rand() % 10 + 1;
+            }
+        }
+    }
+
+    static void deallocateRows(double** ptr, const int N)
+    {
+        for (int i = 0; i < N; i ++)
+        {
+            delete[] ptr[i];
+        }
+        delete[] ptr;
+    }
+
+    static void matmulContig(const double* A, const double* B, double* C, int N)
+    {
+        for (int i = 0; i < N; i ++)
+        {
+            for (int j = 0; j < N; j ++)
+            {
+                C[i * N + j] = 0;
+                for (int k = 0; k < N; k ++)
+                {
+                    C[i * N + j] += A[i * N + k] * B[k * N + j];
+                }
+            }
+        }
+
+    }
+    static void matmulRows (double** A, double** B, double** C, int N)
+    {
+        for (int i = 0; i < N; i ++)
+        {
+            for (int j = 0; j < N; j ++)
+            {
+                *(*(C + i) + j) = 0.0;
+                for (int k = 0; k < N; k ++)
+                {
+                    // *(*(C + i) + j ) += (*(*(A+i)+k)) * (*(*(B+k)+j));
+                    C[i][j] += A[i][k]*B[k][j];
+                }
+            }
+        }
+    }
+
+    // Same loops as matmulContig with k and j swapped: the inner loop walks a
+    // row of B and a row of C with unit stride instead of a column of B.
+    static void matmulContigIKJ(const double* A, const double* B, double* C, int N)
+    {
+        std::fill(C, C + (size_t)N * N, 0.0);
+        for (int i = 0; i < N; i ++)
+        {
+            for (int k = 0; k < N; k ++)
+            {
+                const double a = A[i * N + k];
+                for (int j = 0; j < N; j ++)
+                {
+                    C[i * N + j] += a * B[k * N + j];
+                }
+            }
+        }
+    }
+
+    // i-k-j ordering over BLOCK x BLOCK tiles so that the B tile and the C row
+    // segment being updated stay in L1/L2 while a tile of A is swept.
+    static void matmulBlocked(const double* A, const double* B, double* C, int N)
+    {
+        constexpr int BLOCK = 64;
+        std::fill(C, C + (size_t)N * N, 0.0);
+        for (int ii = 0; ii < N; ii += BLOCK)
+        {
+            const int iEnd = std::min(ii + BLOCK, N);
+            for (int kk = 0; kk < N; kk += BLOCK)
+            {
+                const int kEnd = std::min(kk + BLOCK, N);
+                for (int jj = 0; jj < N; jj += BLOCK)
+                {
+                    const int jEnd = std::min(jj + BLOCK, N);
+                    for (int i = ii; i < iEnd; i ++)
+                    {
+                        for (int k = kk; k < kEnd; k ++)
+                        {
+                            const double a = A[i * N + k];
+                            for (int j = jj; j < jEnd; j ++)
+                            {
+                                C[i * N + j] += a * B[k * N + j];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Packed GEMM (Goto/BLIS scheme). B is packed into KC x NR column panels
+    // and A into MC x KC row panels, both zero-padded to whole panels, and a
+    // 6x8 register-blocked micro-kernel (AVX2/FMA when available) runs over
+    // the packed data with unit stride.
+    static void matmulPacked(const double* A, const double* B, double* C, int N)
+    {
+        gemmPacked(A, B, C, N, N, N, N, N, N);
+    }
+
+    // matmulPacked with the rows of C split across `threads` std::threads.
+    // Each thread packs its own copy of B, which is O(N^2) against O(N^3/threads) of work.
+    static void matmulParallel(const double* A, const double* B, double* C, int N, int threads)
+    {
+        gemmParallel(A, B, C, N, N, N, N, N, N, threads);
+    }
+
+    // gemmPacked with whole MR-row panels of C split evenly across threads.
+    static void gemmParallel(const double* A, const double* B, double* C,
+                             int M, int N, int K, int lda, int ldb, int ldc, int threads)
+    {
+        if (threads <= 1)
+        {
+            gemmPacked(A, B, C, M, N, K, lda, ldb, ldc);
+            return;
+        }
+        const int panels = (M + MR - 1) / MR;
+        std::vector<std::thread> pool;
+        pool.reserve(threads);
+        for (int t = 0; t < threads; t ++)
+        {
+            const int i0 = std::min(M, panels * t / threads * MR);
+            const int i1 = std::min(M, panels * (t + 1) / threads * MR);
+            if (i0 >= i1) continue;
+            pool.emplace_back([=] {
+                gemmPacked(A + (size_t)i0 * lda, B, C + (size_t)i0 * ldc, i1 - i0, N, K, lda, ldb, ldc);
+            });
+        }
+        for (auto& th : pool) th.join();
+    }
+
+    // Name of the micro-kernel compiled into matmulPacked.
+    static const char* packedKernelName()
+    {
+#if defined(__AVX2__) && defined(__FMA__)
+        return "avx2_fma_6x8";
+#else
+        return "scalar_6x8";
+#endif
+    }
+
+    // C (M x N) = A (M x K) * B (K x N), row-major with leading dimensions.
+    // With accumulate, C += A * B instead, so a tiled layout can sum over
+    // tile products.
+    static void gemmPacked(const double* A, const double* B, double* C,
+                           int M, int N, int K, int lda, int ldb, int ldc,
+                           bool accumulate = false)
+    {
+        if (!accumulate)
+        {
+            for (int i = 0; i < M; i ++)
+            {
+                std::fill(C + (size_t)i * ldc, C + (size_t)i * ldc + N, 0.0);
+            }
+        }
+
+        // Packing buffers are kept per thread and only grow, so many small
+        // calls (one per tile) do not each pay for a large malloc/free.
+        const int ncMax = std::min(NC, roundUp(N, NR));
+        const int mcMax = std::min(MC, roundUp(M, MR));
+        thread_local std::vector<double> Bp, Ap;
+        if (Bp.size() < (size_t)KC * ncMax) Bp.resize((size_t)KC * ncMax);
+        if (Ap.size() < (size_t)mcMax * KC) Ap.resize((size_t)mcMax * KC);
+
+        for (int jc = 0; jc < N; jc += NC)
+        {
+            const int nc = std::min(NC, N - jc);
+            for (int pc = 0; pc < K; pc += KC)
+            {
+                const int kc = std::min(KC, K - pc);
+                packB(B + (size_t)pc * ldb + jc, ldb, kc, nc, Bp.data());
+                for (int ic = 0; ic < M; ic += MC)
+                {
+                    const int mc = std::min(MC, M - ic);
+                    packA(A + (size_t)ic * lda + pc, lda, mc, kc, Ap.data());
+                    for (int jr = 0; jr < nc; jr += NR)
+                    {
+                        for (int ir = 0; ir < mc; ir += MR)
+                        {
+                            microKernel(kc, Ap.data() + (size_t)ir * kc, Bp.data() + (size_t)jr * kc,
+                                        C + (size_t)(ic + ir) * ldc + jc + jr, ldc,
+                                        std::min(MR, mc - ir), std::min(NR, nc - jr));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    // Register block and cache block sizes (BLIS Haswell defaults):
+    // an MR x NR tile of C lives in 12 ymm registers, a KC x NR panel of B
+    // (16 KB) in L1, an MC x KC block of A (144 KB) in L2.
+    static constexpr int MR = 6;
+    static constexpr int NR = 8;
+    static constexpr int MC = 72;
+    static constexpr int KC = 256;
+    static constexpr int NC = 4080;
+
+    static int roundUp(int x, int m) { return (x + m - 1) / m * m; }
+
+    // Bp[panel][k][0..NR): NR consecutive columns of row k, zero-padded.
+    static void packB(const double* B, int ldb, int kc, int nc, double* Bp)
+    {
+        for (int jr = 0; jr < nc; jr += NR)
+        {
+            const int nr = std::min(NR, nc - jr);
+            for (int k = 0; k < kc; k ++)
+            {
+                const double* src = B + (size_t)k * ldb + jr;
+                int j = 0;
+                for (; j < nr; j ++) Bp[j] = src[j];
+                for (; j < NR; j ++) Bp[j] = 0.0;
+                Bp += NR;
+            }
+        }
+    }
+
+    // Ap[panel][k][0..MR): MR consecutive rows of column k, zero-padded.
+    static void packA(const double* A, int lda, int mc, int kc, double* Ap)
+    {
+        for (int ir = 0; ir < mc; ir += MR)
+        {
+            const int mr = std::min(MR, mc - ir);
+            for (int k = 0; k < kc; k ++)
+            {
+                int i = 0;
+                for (; i < mr; i ++) Ap[i] = A[(size_t)(ir + i) * lda + k];
+                for (; i < MR; i ++) Ap[i] = 0.0;
+                Ap += MR;
+            }
+        }
+    }
+
+    // C[0..mr)[0..nr) += Ap (MR x kc) * Bp (kc x NR). Full tiles are updated
+    // in place; edge tiles go through a small buffer.
+    static void microKernel(int kc, const double* Ap, const double* Bp,
+                            double* C, int ldc, int mr, int nr)
+    {
+        alignas(32) double acc[MR * NR];
+#if defined(__AVX2__) && defined(__FMA__)
+        __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+        __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+        __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+        __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+        __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+        __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+        for (int k = 0; k < kc; k ++)
+        {
+            const __m256d b0 = _mm256_loadu_pd(Bp);
+            const __m256d b1 = _mm256_loadu_pd(Bp + 4);
+            __m256d a;
+            a = _mm256_broadcast_sd(Ap + 0); c00 = _mm256_fmadd_pd(a, b0, c00); c01 = _mm256_fmadd_pd(a, b1, c01);
+            a = _mm256_broadcast_sd(Ap + 1); c10 = _mm256_fmadd_pd(a, b0, c10); c11 = _mm256_fmadd_pd(a, b1, c11);
+            a = _mm256_broadcast_sd(Ap + 2); c20 = _mm256_fmadd_pd(a, b0, c20); c21 = _mm256_fmadd_pd(a, b1, c21);
+            a = _mm256_broadcast_sd(Ap + 3); c30 = _mm256_fmadd_pd(a, b0, c30); c31 = _mm256_fmadd_pd(a, b1, c31);
+            a = _mm256_broadcast_sd(Ap + 4); c40 = _mm256_fmadd_pd(a, b0, c40); c41 = _mm256_fmadd_pd(a, b1, c41);
+            a = _mm256_broadcast_sd(Ap + 5); c50 = _mm256_fmadd_pd(a, b0, c50); c51 = _mm256_fmadd_pd(a, b1, c51);
+            Ap += MR;
+            Bp += NR;
+        }
+        if (mr == MR && nr == NR)
+        {
+            double* c = C;
+            _mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), c00)); _mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), c01)); c += ldc;
+            _mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), c10)); _mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), c11)); c += ldc;
+            _mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), c20)); _mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), c21)); c += ldc;
+            _mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), c30)); _mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), c31)); c += ldc;
+            _mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), c40)); _mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), c41)); c += ldc;
+            _mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), c50)); _mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), c51));
+            return;
+        }
+        _mm256_store_pd(acc +  0, c00); _mm256_store_pd(acc +  4, c01);
+        _mm256_store_pd(acc +  8, c10); _mm256_store_pd(acc + 12, c11);
+        _mm256_store_pd(acc + 16, c20); _mm256_store_pd(acc + 20, c21);
+        _mm256_store_pd(acc + 24, c30); _mm256_store_pd(acc + 28, c31);
+        _mm256_store_pd(acc + 32, c40); _mm256_store_pd(acc + 36, c41);
+        _mm256_store_pd(acc + 40, c50); _mm256_store_pd(acc + 44, c51);
+#else
+        for (int x = 0; x < MR * NR; x ++) acc[x] = 0.0;
+        for (int k = 0; k < kc; k ++)
+        {
+            for (int i = 0; i < MR; i ++)
+            {
+                const double a = Ap[i];
+                for (int j = 0; j < NR; j ++)
+                {
+                    acc[i * NR + j] += a * Bp[j];
+                }
+            }
+            Ap += MR;
+            Bp += NR;
+        }
+#endif
+        for (int i = 0; i < mr; i ++)
+        {
+            for (int j = 0; j < nr; j ++)
+            {
+                C[(size_t)i * ldc + j] += acc[i * NR + j];
+            }
+        }
+    }
+};
@@ -0,0 +1,177 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+// Where the backing memory of a matrix comes from.
+//
+//   heap     plain new double[] (16-byte aligned, 4 KB pages)
+//   aligned  64-byte aligned, so rows of a padded layout start on a cache line
+//   thp      2 MB aligned + madvise(MADV_HUGEPAGE): transparent huge pages
+//   hugetlb  mmap(MAP_HUGETLB) from the reserved pool (vm.nr_hugepages);
+//            falls back to thp when the pool is empty
+//
+// Every allocation is zeroed by `threads` threads, each touching a contiguous
+// slice, before it is returned. Linux places a page on the NUMA node of the
+// thread that first writes it, so as long as the compute threads take the
+// same slices (matmulParallel splits rows the same way) each one works on
+// node-local memory. It also keeps page faults out of the timed region.
+enum class AllocKind { Heap, Aligned, HugePage, HugeTLB };
+
+struct Allocation
+{
+    double* data = nullptr;
+    size_t bytes = 0;
+    AllocKind kind = AllocKind::Heap; // what was actually used, after any fallback
+};
+
+class MatrixAllocator
+{
+public:
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr size_t HUGE_PAGE = 2u << 20;
+
+    static Allocation allocate(size_t count, AllocKind kind, int threads = 1)
+    {
+        Allocation a;
+        a.kind = kind;
+        a.bytes = count * sizeof(double);
+        switch (kind)
+        {
+            case AllocKind::Heap:
+                a.data = new double[count];
+                break;
+            case AllocKind::Aligned:
+                a.bytes = roundUp(a.bytes, CACHE_LINE);
+                a.data = static_cast<double*>(std::aligned_alloc(CACHE_LINE, a.bytes));
+                break;
+            case AllocKind::HugeTLB:
+#if defined(__linux__) && defined(MAP_HUGETLB)
+            {
+                const size_t bytes = roundUp(a.bytes, HUGE_PAGE);
+                void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (p != MAP_FAILED)
+                {
+                    a.bytes = bytes;
+                    a.data = static_cast<double*>(p);
+                    break;
+                }
+            }
+#endif
+                a.kind = AllocKind::HugePage;
+                [[fallthrough]];
+            case AllocKind::HugePage:
+                a.bytes = roundUp(a.bytes, HUGE_PAGE);
+                a.data = static_cast<double*>(std::aligned_alloc(HUGE_PAGE, a.bytes));
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+                if (a.data) madvise(a.data, a.bytes, MADV_HUGEPAGE);
+#endif
+                break;
+        }
+        if (!a.data) throw std::bad_alloc();
+        firstTouch(a.data, a.bytes, threads);
+        return a;
+    }
+
+    static void deallocate(Allocation& a)
+    {
+        if (!a.data) return;
+        switch (a.kind)
+        {
+            case AllocKind::Heap:
+                delete[] a.data;
+                break;
+            case AllocKind::HugeTLB:
+#if defined(__linux__)
+                munmap(a.data, a.bytes);
+#endif
+                break;
+            case AllocKind::Aligned:
+            case AllocKind::HugePage:
+                std::free(a.data);
+                break;
+        }
+        a.data = nullptr;
+        a.bytes = 0;
+    }
+
+    static const char* kindName(AllocKind kind)
+    {
+        switch (kind)
+        {
+            case AllocKind::Heap:     return "heap";
+            case AllocKind::Aligned:  return "aligned";
+            case AllocKind::HugePage: return "thp";
+            case AllocKind::HugeTLB:  return "hugetlb";
+        }
+        return "unknown";
+    }
+
+    // Bytes of [a.data, a.data + a.bytes) backed by huge pages, from the
+    // AnonHugePages / Private_Hugetlb fields of /proc/self/smaps. Returns 0 when
+    // not on Linux or the mapping is not found.
+    static size_t hugePageBytes(const Allocation& a)
+    {
+        size_t total = 0;
+#if defined(__linux__)
+        std::FILE* f = std::fopen("/proc/self/smaps", "r");
+        if (!f) return 0;
+        const auto lo = reinterpret_cast<unsigned long>(a.data);
+        const auto hi = lo + a.bytes;
+        bool inside = false;
+        char line[256];
+        while (std::fgets(line, sizeof(line), f))
+        {
+            unsigned long start = 0, end = 0;
+            if (std::sscanf(line, "%lx-%lx ", &start, &end) == 2)
+            {
+                inside = start < hi && end > lo;
+                continue;
+            }
+            size_t kb = 0;
+            if (inside && (std::sscanf(line, "AnonHugePages: %zu kB", &kb) == 1 ||
+                           std::sscanf(line, "Private_Hugetlb: %zu kB", &kb) == 1))
+            {
+                total += kb * 1024;
+            }
+        }
+        std::fclose(f);
+#else
+        (void)a;
+#endif
+        return std::min(total, a.bytes);
+    }
+
+private:
+    static size_t roundUp(size_t x, size_t m) { return (x + m - 1) / m * m; }
+
+    // Zero `bytes` at p, each of `threads` threads writing its own slice.
+    static void firstTouch(double* p, size_t bytes, int threads)
+    {
+        char* base = reinterpret_cast<char*>(p);
+        if (threads <= 1)
+        {
+            std::memset(base, 0, bytes);
+            return;
+        }
+        std::vector<std::thread> pool;
+        pool.reserve(threads);
+        for (int t = 0; t < threads; t ++)
+        {
+            const size_t b0 = bytes * t / threads;
+            const size_t b1 = bytes * (t + 1) / threads;
+            pool.emplace_back([=] { std::memset(base + b0, 0, b1 - b0); });
+        }
+        for (auto& th : pool) th.join();
+    }
+};
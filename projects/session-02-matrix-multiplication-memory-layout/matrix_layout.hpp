@@ -0,0 +1,226 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "matrix.hpp"
+
+// How the logical N x N matrix is laid out in one allocation.
+//
+//   contig  row-major, leading dimension N (what Matrix::allocateContig gives)
+//   padded  row-major, leading dimension rounded up to a whole number of cache
+//           lines, and to an odd number of them. With N a multiple of 512
+//           every row starts at the same offset mod 4 KB, so a column walk uses
+//           only one of the 64 L1 sets. An odd line count spreads the rows
+//           over all of them.
+//   morton  TILE x TILE row-major tiles, stored in Z-order (Morton) of their
+//           (tile row, tile col). Tiles near each other in 2-D are near each
+//           other in memory, so row and column walks both stay within a few
+//           pages.
+enum class LayoutKind { Contig, Padded, Morton };
+
+class MatrixLayout
+{
+public:
+    static constexpr int TILE = 128;
+
+    MatrixLayout(LayoutKind kind, int n) : kind_(kind), n_(n)
+    {
+        switch (kind)
+        {
+            case LayoutKind::Contig:
+                ld_ = n;
+                break;
+            case LayoutKind::Padded:
+            {
+                constexpr int LINE = 8; // doubles per cache line
+                int lines = (n + LINE - 1) / LINE;
+                if (lines % 2 == 0) lines ++;
+                ld_ = lines * LINE;
+                break;
+            }
+            case LayoutKind::Morton:
+            {
+                ld_ = TILE;
+                tiles_ = (n + TILE - 1) / TILE;
+                // Rank of each tile in Z-order, skipping codes that fall outside
+                // the tiles_ x tiles_ grid so that non-power-of-two sizes are
+                // stored without holes.
+                tileRank_.assign((size_t)tiles_ * tiles_, 0);
+                uint32_t side = 1;
+                while ((int)side < tiles_) side <<= 1;
+                size_t rank = 0;
+                for (uint64_t code = 0; code < (uint64_t)side * side; code ++)
+                {
+                    const int r = (int)compact(code >> 1);
+                    const int c = (int)compact(code);
+                    if (r < tiles_ && c < tiles_) tileRank_[(size_t)r * tiles_ + c] = rank ++;
+                }
+                break;
+            }
+        }
+    }
+
+    LayoutKind kind() const { return kind_; }
+    int n() const { return n_; }
+    int ld() const { return ld_; }
+
+    // Doubles to allocate for one matrix.
+    size_t elements() const
+    {
+        if (kind_ == LayoutKind::Morton) return (size_t)tiles_ * tiles_ * TILE * TILE;
+        return (size_t)n_ * ld_;
+    }
+
+    size_t offset(int i, int j) const
+    {
+        if (kind_ != LayoutKind::Morton) return (size_t)i * ld_ + j;
+        return tileOffset(i / TILE, j / TILE) + (size_t)(i % TILE) * TILE + (j % TILE);
+    }
+
+    // Copy a contiguous N x N matrix in / out of this layout. Padding is left as is
+    // (zero from the allocator).
+    void load(const double* src, double* dst) const
+    {
+        for (int i = 0; i < n_; i ++)
+        {
+            for (int j = 0; j < n_; j ++) dst[offset(i, j)] = src[(size_t)i * n_ + j];
+        }
+    }
+
+    void store(const double* src, double* dst) const
+    {
+        for (int i = 0; i < n_; i ++)
+        {
+            for (int j = 0; j < n_; j ++) dst[(size_t)i * n_ + j] = src[offset(i, j)];
+        }
+    }
+
+    // C = A * B with all three in this layout, using the packed GEMM on
+    // `threads` threads. For morton this is a product over tiles,
+    // C(i,j) = sum_k A(i,k) * B(k,j), with edge tiles trimmed to the matrix so
+    // no flops go to padding, and tile rows of C split across the threads.
+    void multiply(const double* A, const double* B, double* C, int threads = 1) const
+    {
+        if (kind_ != LayoutKind::Morton)
+        {
+            Matrix::gemmParallel(A, B, C, n_, n_, n_, ld_, ld_, ld_, threads);
+            return;
+        }
+        if (threads <= 1)
+        {
+            multiplyTiles(A, B, C, 0, tiles_);
+            return;
+        }
+        std::vector<std::thread> pool;
+        pool.reserve(threads);
+        for (int t = 0; t < threads; t ++)
+        {
+            const int t0 = tiles_ * t / threads;
+            const int t1 = tiles_ * (t + 1) / threads;
+            if (t0 < t1) pool.emplace_back([=] { multiplyTiles(A, B, C, t0, t1); });
+        }
+        for (auto& th : pool) th.join();
+    }
+
+    // Sum of all elements visited row by row / column by column in logical
+    // order, walking each contiguous (row) or ld-strided (column) run with a
+    // pointer. Four independent accumulators keep the loop bound by memory
+    // rather than by add latency.
+    double sweepRows(const double* p) const
+    {
+        double s = 0.0;
+        for (int i = 0; i < n_; i ++)
+        {
+            for (int j0 = 0; j0 < n_; j0 += run())
+            {
+                s += sumRun(p + offset(i, j0), 1, std::min(run(), n_ - j0));
+            }
+        }
+        return s;
+    }
+
+    double sweepCols(const double* p) const
+    {
+        double s = 0.0;
+        for (int j = 0; j < n_; j ++)
+        {
+            for (int i0 = 0; i0 < n_; i0 += run())
+            {
+                s += sumRun(p + offset(i0, j), ld_, std::min(run(), n_ - i0));
+            }
+        }
+        return s;
+    }
+
+    static const char* kindName(LayoutKind kind)
+    {
+        switch (kind)
+        {
+            case LayoutKind::Contig: return "contig";
+            case LayoutKind::Padded: return "padded";
+            case LayoutKind::Morton: return "morton";
+        }
+        return "unknown";
+    }
+
+private:
+    LayoutKind kind_;
+    int n_;
+    int ld_ = 0;
+    int tiles_ = 0;
+    std::vector<size_t> tileRank_;
+
+    size_t tileOffset(int ti, int tj) const
+    {
+        return tileRank_[(size_t)ti * tiles_ + tj] * TILE * TILE;
+    }
+
+    // Tile rows [t0, t1) of C = A * B.
+    void multiplyTiles(const double* A, const double* B, double* C, int t0, int t1) const
+    {
+        for (int ti = t0; ti < t1; ti ++)
+        {
+            const int m = std::min(TILE, n_ - ti * TILE);
+            for (int tj = 0; tj < tiles_; tj ++)
+            {
+                const int n = std::min(TILE, n_ - tj * TILE);
+                for (int tk = 0; tk < tiles_; tk ++)
+                {
+                    const int k = std::min(TILE, n_ - tk * TILE);
+                    Matrix::gemmPacked(A + tileOffset(ti, tk), B + tileOffset(tk, tj), C + tileOffset(ti, tj),
+                                       m, n, k, TILE, TILE, TILE, tk > 0);
+                }
+            }
+        }
+    }
+
+    // Length of a logical row or column segment that stays inside one tile.
+    int run() const { return kind_ == LayoutKind::Morton ? TILE : n_; }
+
+    static double sumRun(const double* p, size_t stride, int len)
+    {
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        int k = 0;
+        for (; k + 4 <= len; k += 4, p += 4 * stride)
+        {
+            s0 += p[0]; s1 += p[stride]; s2 += p[2 * stride]; s3 += p[3 * stride];
+        }
+        for (; k < len; k ++, p += stride) s0 += *p;
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    // Every other bit of x, packed down: the inverse of bit interleaving.
+    static uint32_t compact(uint64_t x)
+    {
+        x &= 0x5555555555555555ull;
+        x = (x | (x >> 1)) & 0x3333333333333333ull;
+        x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0full;
+        x = (x | (x >> 4)) & 0x00ff00ff00ff00ffull;
+        x = (x | (x >> 8)) & 0x0000ffff0000ffffull;
+        x = (x | (x >> 16)) & 0x00000000ffffffffull;
+        return (uint32_t)x;
+    }
+};
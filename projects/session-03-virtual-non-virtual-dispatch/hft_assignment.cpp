@@ -1,30 +1,94 @@
 #include <cstring>
+#include <cstdlib>
+#include <string>
 #include <vector>
 #include <random>
-#include <chrono>
 #include <cstdio>
-#include <fstream>
 #include <algorithm>
+#include <variant>
+#include <atomic>
+#include <thread>
+
+#include "bench_harness.hpp"
 
 const uint64_t ORDERS_DEFAULT = 20000000;
 const int REPEATS_DEFAULT = 10;
 
 static volatile uint64_t g_sink = 0;
 
-void write_csv_header(FILE* out) {
-    std::fprintf(out, "pattern,impl,repeat,orders,elapsed_ns,ops_per_sec,checksum\n");
+
+struct BookState {
+    uint64_t Book1[64];
+    uint64_t Book2[64];
+    int counters[32];
+
+    uint64_t xor_book1(int i, uint64_t v) { return Book1[i] ^= v; }
+    uint64_t add_book2(int i, uint64_t v) { return Book2[i] += v; }
+    int add_counter(int i, int d) { return counters[i] += d; }
+};
+
+// Same book, but shared by every thread: each update is an atomic RMW on a
+// handful of hot cache lines (atomic contention + true sharing).
+struct SharedBookState {
+    std::atomic<uint64_t> Book1[64];
+    std::atomic<uint64_t> Book2[64];
+    std::atomic<int> counters[32];
+
+    uint64_t xor_book1(int i, uint64_t v) { return Book1[i].fetch_xor(v, std::memory_order_relaxed) ^ v; }
+    uint64_t add_book2(int i, uint64_t v) { return Book2[i].fetch_add(v, std::memory_order_relaxed) + v; }
+    int add_counter(int i, int d) { return counters[i].fetch_add(d, std::memory_order_relaxed) + d; }
+};
+
+// Per-thread private book on its own cache lines.
+struct alignas(64) PaddedBookState : BookState {};
+
+static BookState g_state;
+
+void reset_state(BookState& st)
+{
+    std::memset(&st, 0, sizeof(st));
 }
 
+void reset_state(SharedBookState& st)
+{
+    for (auto& v : st.Book1) v.store(0, std::memory_order_relaxed);
+    for (auto& v : st.Book2) v.store(0, std::memory_order_relaxed);
+    for (auto& c : st.counters) c.store(0, std::memory_order_relaxed);
+}
 
-static uint64_t Book1[64];
-static uint64_t Book2[64];
-static int counters[32];
+void reset_state() { reset_state(g_state); }
+
+// Fold a thread's private book into `into`. Book1 is xor-ed and Book2 and the
+// counters are summed, exactly what sequential processing would have done.
+void merge_state(BookState& into, const BookState& from)
+{
+    for (int i = 0; i < 64; ++i) {
+        into.Book1[i] ^= from.Book1[i];
+        into.Book2[i] += from.Book2[i];
+    }
+    for (int i = 0; i < 32; ++i) into.counters[i] += from.counters[i];
+}
+
+void load_state(BookState& into, const SharedBookState& from)
+{
+    for (int i = 0; i < 64; ++i) {
+        into.Book1[i] = from.Book1[i].load(std::memory_order_relaxed);
+        into.Book2[i] = from.Book2[i].load(std::memory_order_relaxed);
+    }
+    for (int i = 0; i < 32; ++i) into.counters[i] = from.counters[i].load(std::memory_order_relaxed);
+}
 
-void reset_state()
+// workA/workB only xor/add into Book1/Book2 and +-1 the counters, so the
+// final state does not depend on the order the orders were processed in.
+// This is what reordering impls (sort-then-batch, threads) are verified against.
+uint64_t state_checksum(const BookState& st)
 {
-    std::memset(Book1, 0, sizeof(Book1));
-    std::memset(Book2, 0, sizeof(Book2));
-    std::memset(counters, 0, sizeof(counters));
+    uint64_t h = 0xcbf29ce484222325ULL; // FNV-1a offset basis
+    auto mix = [&](uint64_t v) { h ^= v; h *= 0x100000001b3ULL; };
+    for (uint64_t v : st.Book1) mix(v);
+    for (uint64_t v : st.Book2) mix(v);
+    for (int c : st.counters) mix((uint64_t)(uint32_t)c);
+    return h;
 }
 
 struct Order
@@ -92,45 +156,49 @@ std::vector<Strat> make_assignments_bursty(size_t N) {
     return assignments;
 }
 
-uint64_t workA(Order& o)
+template <class State>
+uint64_t workA(Order& o, State& st)
 {
     int p = (o.price + (o.qty ^ (o.side * 7)));
     int q = (o.qty + 3) * 2 - (o.side ? 1 : 0);
     int index = (int)((o.id + p) & 63);
     int cix = (p + q) & 31;
+    int c;
     if ((p & 1) == 0)
     {
-        counters[cix] += 1;
+        c = st.add_counter(cix, 1);
     } else
     {
-        counters[cix] -= 1;
+        c = st.add_counter(cix, -1);
     };
-    Book1[index] = (Book1[index] ^ (uint64_t)p);
-    Book2[index] = (Book2[index] + (uint64_t)q);
+    uint64_t b1 = st.xor_book1(index, (uint64_t)p);
+    uint64_t b2 = st.add_book2(index, (uint64_t)q);
     o.payload[0] = p;
     o.payload[1] = q;
-    return (Book1[index] + (Book2[index] << 1)) ^ (uint64_t)(counters[cix] & 0xffff);
+    return (b1 + (b2 << 1)) ^ (uint64_t)(c & 0xffff);
 
 };
 
-uint64_t workB(Order& o)
+template <class State>
+uint64_t workB(Order& o, State& st)
 {
     int p = (o.price + (o.qty ^ (o.side * 4)));
     int q = (o.qty + 1) * 2 - (o.side ? 1 : 0);
     int index = (int)((o.id + p) & 63);   // 0..63
     int cix = (p + q) & 31;
+    int c;
     if ((p & 1) == 0)
     {
-        counters[cix] += 1;
+        c = st.add_counter(cix, 1);
     } else
     {
-        counters[cix] -= 1;
+        c = st.add_counter(cix, -1);
     };
-    Book1[index] = (Book1[index] ^ (uint64_t)q);
-    Book2[index] = (Book2[index] + (uint64_t)p);
+    uint64_t b1 = st.xor_book1(index, (uint64_t)q);
+    uint64_t b2 = st.add_book2(index, (uint64_t)p);
     o.payload[0] = q;
     o.payload[1] = p;
-    return (Book1[index] + (Book2[index] << 1)) ^ (uint64_t)(counters[cix] & 0xffff);
+    return (b1 + (b2 << 1)) ^ (uint64_t)(c & 0xffff);
 };
 
 struct Processor {
@@ -138,116 +206,305 @@ struct Processor {
     virtual uint64_t process(Order& o) = 0;
 };
 
+// Strategies are bound to the book they write to (the global one when
+// single-threaded, a per-thread or shared one in the parallel mode).
+template <class State>
 struct StrategyA_V final : Processor {
-    uint64_t process(Order& o) override { return workA(o); }
+    State& st;
+    explicit StrategyA_V(State& s) : st(s) {}
+    uint64_t process(Order& o) override { return workA(o, st); }
 };
 
+template <class State>
 struct StrategyB_V final : Processor {
-    uint64_t process(Order& o) override { return workB(o); }
+    State& st;
+    explicit StrategyB_V(State& s) : st(s) {}
+    uint64_t process(Order& o) override { return workB(o, st); }
 };
 
+template <class State>
 struct StrategyA_NV
 {
-    uint64_t run(Order& o) { return workA(o); }
+    State* st;
+    uint64_t run(Order& o) { return workA(o, *st); }
 };
+template <class State>
 struct StrategyB_NV
 {
-    uint64_t run(Order& o) { return workB(o); }
+    State* st;
+    uint64_t run(Order& o) { return workB(o, *st); }
 };
 
 
-enum class Impl : uint8_t { Virtual=0, NonVirtual=1 };
+// std::variant over the non-virtual strategies, dispatched with std::visit.
+template <class State>
+using StrategyVariant = std::variant<StrategyA_NV<State>, StrategyB_NV<State>>;
+
+// Plain function-pointer table indexed by strategy.
+template <class State>
+using WorkFn = uint64_t (*)(Order&, State&);
+
+enum class Impl : uint8_t { Virtual=0, NonVirtual=1, Variant=2, FnTable=3, SortBatch=4 };
+
+const Impl ALL_IMPLS[] = { Impl::Virtual, Impl::NonVirtual, Impl::Variant, Impl::FnTable, Impl::SortBatch };
+
+const char* impl_name(Impl impl) {
+    switch (impl) {
+        case Impl::Virtual:    return "virtual";
+        case Impl::NonVirtual: return "nonvirtual";
+        case Impl::Variant:    return "variant";
+        case Impl::FnTable:    return "fntable";
+        case Impl::SortBatch:  return "sortbatch";
+    }
+    return "unknown";
+}
+
+// SortBatch reorders orders, so its per-order return values (and hence
+// `checksum`) differ from the in-order impls; only state_checksum is comparable.
+bool impl_reorders(Impl impl) { return impl == Impl::SortBatch; }
+
+// How threads share memory in the parallel mode:
+//   Padded     – private book per thread, per-thread result slots 64 B apart
+//   FalseShare – private book per thread, result slots packed 8 B apart
+//   Atomic     – one SharedBookState updated with atomic RMWs by every thread
+enum class Sharing : uint8_t { Padded=0, FalseShare=1, Atomic=2 };
+
+const char* sharing_name(Sharing s) {
+    switch (s) {
+        case Sharing::Padded:     return "padded";
+        case Sharing::FalseShare: return "falseshare";
+        case Sharing::Atomic:     return "atomic";
+    }
+    return "unknown";
+}
+
+// Accumulates per-order results. LocalSum stays in a register; SlotSum is
+// written back to memory on every order so where it lives (own cache line or
+// packed next to other threads' slots) shows up in the timing.
+struct LocalSum {
+    uint64_t v = 0;
+    void add(uint64_t x) { v += x; }
+};
+
+struct SlotSum {
+    std::atomic<uint64_t> v{0};
+    void add(uint64_t x) { v.store(v.load(std::memory_order_relaxed) + x, std::memory_order_relaxed); }
+};
+
+struct alignas(64) PaddedSlot { SlotSum s; };
+
+// Process orders[0..n) with the given dispatch impl against `st`.
+// batch_idx must have room for n entries when impl == SortBatch.
+template <class State, class Sum>
+void dispatch_range(Impl impl, State& st, Sum& sum,
+                    Order* orders, const Strat* assignments, size_t n,
+                    uint32_t* batch_idx)
+{
+    if (impl == Impl::Virtual) {
+        StrategyA_V<State> av(st); StrategyB_V<State> bv(st); Processor* procs[2] = { &av, &bv };
+        for (size_t i = 0; i < n; ++i) {
+            int idx = (assignments[i] == Strat::A) ? 0 : 1;
+            sum.add(procs[idx]->process(orders[i]));
+        }
+    } else if (impl == Impl::NonVirtual) {
+        StrategyA_NV<State> an{&st}; StrategyB_NV<State> bn{&st};
+        for (size_t i = 0; i < n; ++i) {
+            if (assignments[i] == Strat::A) sum.add(an.run(orders[i]));
+            else                             sum.add(bn.run(orders[i]));
+        }
+    } else if (impl == Impl::Variant) {
+        StrategyVariant<State> strats[2] = { StrategyA_NV<State>{&st}, StrategyB_NV<State>{&st} };
+        for (size_t i = 0; i < n; ++i) {
+            Order& o = orders[i];
+            sum.add(std::visit([&o](auto& s) { return s.run(o); },
+                               strats[(size_t)assignments[i]]));
+        }
+    } else if (impl == Impl::FnTable) {
+        static const WorkFn<State> table[2] = { &workA<State>, &workB<State> };
+        for (size_t i = 0; i < n; ++i)
+            sum.add(table[(size_t)assignments[i]](orders[i], st));
+    } else {
+        // Stable partition of order indices by strategy (counted in the timing),
+        // then one homogeneous run per strategy with no per-order dispatch.
+        size_t nA = 0;
+        for (size_t i = 0; i < n; ++i)
+            nA += (assignments[i] == Strat::A);
+        size_t a = 0, b = nA;
+        for (size_t i = 0; i < n; ++i) {
+            if (assignments[i] == Strat::A) batch_idx[a++] = (uint32_t)i;
+            else                             batch_idx[b++] = (uint32_t)i;
+        }
+        StrategyA_NV<State> an{&st}; StrategyB_NV<State> bn{&st};
+        for (size_t i = 0; i < nA; ++i) sum.add(an.run(orders[batch_idx[i]]));
+        for (size_t i = nA; i < n; ++i) sum.add(bn.run(orders[batch_idx[i]]));
+    }
+}
 
+// What a run produced, for verification. Timing and counters go through
+// bench::Timing, which only covers the dispatch loop itself.
 struct Result {
-    const char* pattern;  // fill at call site
-    const char* impl;     // fill at call site
-    int repeat;           // fill at call site
-    uint64_t orders;
-    uint64_t elapsed_ns;
-    double   ops_per_sec;
     uint64_t checksum;
+    uint64_t state_checksum;
 };
 
-Result run_once(Impl impl,
-                const char* pattern_name,
+Result run_once(bench::Timing& timing,
+                Impl impl,
                 const std::vector<Order>& orders_base,
                 const std::vector<Strat>& assignments)
 {
     reset_state();
     auto orders = orders_base; // identical inputs each run
 
-    auto t0 = std::chrono::high_resolution_clock::now();
+    // scratch for SortBatch, allocated outside the timed region
+    std::vector<uint32_t> batch_idx;
+    if (impl == Impl::SortBatch) batch_idx.resize(orders.size());
 
-    uint64_t sum = 0;
-    if (impl == Impl::Virtual) {
-        StrategyA_V av; StrategyB_V bv; Processor* procs[2] = { &av, &bv };
-        for (size_t i = 0; i < orders.size(); ++i) {
-            int idx = (assignments[i] == Strat::A) ? 0 : 1;
-            sum += procs[idx]->process(orders[i]);
-        }
-    } else {
-        StrategyA_NV an; StrategyB_NV bn;
-        for (size_t i = 0; i < orders.size(); ++i) {
-            if (assignments[i] == Strat::A) sum += an.run(orders[i]);
-            else                             sum += bn.run(orders[i]);
-        }
+    timing.start();
+
+    LocalSum sum;
+    dispatch_range(impl, g_state, sum, orders.data(), assignments.data(),
+                   orders.size(), batch_idx.data());
+
+    timing.stop();
+
+    g_sink += sum.v; // prevent optimization
+
+    Result r{};
+    r.checksum   = sum.v;
+    r.state_checksum = state_checksum(g_state);
+    return r;
+}
+
+// Split the order stream into `threads` contiguous chunks, one per thread.
+// Threads are started before the clock and released together, so thread
+// creation is not timed; the clock stops when the last chunk is done.
+// The harness opens its counters before any worker exists, so they are
+// inherited by the workers.
+Result run_parallel(bench::Timing& timing,
+                    Impl impl,
+                    int threads,
+                    Sharing sharing,
+                    const std::vector<Order>& orders_base,
+                    const std::vector<Strat>& assignments)
+{
+    auto orders = orders_base; // identical inputs each run
+    const size_t N = orders.size();
+
+    std::vector<uint32_t> batch_idx;
+    if (impl == Impl::SortBatch) batch_idx.resize(N);
+
+    std::vector<PaddedBookState> books(sharing == Sharing::Atomic ? 0 : threads);
+    for (auto& b : books) reset_state(b);
+    static SharedBookState shared;
+    reset_state(shared);
+
+    std::vector<PaddedSlot> padded(threads);
+    std::vector<SlotSum> packed(threads);
+
+    std::atomic<bool> go{false};
+    std::atomic<int> done{0};
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+
+    for (int t = 0; t < threads; ++t) {
+        size_t begin = N * (size_t)t / (size_t)threads;
+        size_t end   = N * (size_t)(t + 1) / (size_t)threads;
+        pool.emplace_back([&, t, begin, end] {
+            while (!go.load(std::memory_order_acquire)) {}
+            SlotSum& sum = (sharing == Sharing::FalseShare) ? packed[t] : padded[t].s;
+            uint32_t* idx = batch_idx.empty() ? nullptr : batch_idx.data() + begin;
+            if (sharing == Sharing::Atomic)
+                dispatch_range(impl, shared, sum, orders.data() + begin,
+                               assignments.data() + begin, end - begin, idx);
+            else
+                dispatch_range(impl, static_cast<BookState&>(books[t]), sum, orders.data() + begin,
+                               assignments.data() + begin, end - begin, idx);
+            done.fetch_add(1, std::memory_order_release);
+        });
     }
 
-    auto t1 = std::chrono::high_resolution_clock::now();
-    uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
-    double ops_s = (ns == 0) ? 0.0 : (double)orders.size() * 1e9 / (double)ns;
+    // counters include the main thread's wait loop on `done`
+    timing.start();
+    go.store(true, std::memory_order_release);
+    while (done.load(std::memory_order_acquire) < threads) {}
+    timing.stop();
+
+    for (auto& th : pool) th.join();
+
+    uint64_t sum = 0;
+    for (int t = 0; t < threads; ++t)
+        sum += (sharing == Sharing::FalseShare ? packed[t].v : padded[t].s.v).load();
+
+    BookState final_state;
+    reset_state(final_state);
+    if (sharing == Sharing::Atomic) load_state(final_state, shared);
+    else for (auto& b : books) merge_state(final_state, b);
 
     g_sink += sum; // prevent optimization
 
     Result r{};
-    r.pattern    = pattern_name;
-    r.impl       = (impl == Impl::Virtual) ? "virtual" : "nonvirtual";
-    r.repeat     = -1; // caller sets
-    r.orders     = (uint64_t)orders.size();
-    r.elapsed_ns = ns;
-    r.ops_per_sec= ops_s;
     r.checksum   = sum;
+    r.state_checksum = state_checksum(final_state);
     return r;
 }
 
-void write_csv_row(FILE* out, const Result& r) {
-    std::fprintf(out, "%s,%s,%d,%llu,%llu,%.6f,%llu\n",
-        r.pattern, r.impl, r.repeat,
-        (unsigned long long)r.orders,
-        (unsigned long long)r.elapsed_ns,
-        r.ops_per_sec,
-        (unsigned long long)r.checksum);
+// "1,2,4,8" -> {1,2,4,8}
+std::vector<int> parse_thread_list(const char* s) {
+    std::vector<int> out;
+    while (*s) {
+        char* end = nullptr;
+        long v = std::strtol(s, &end, 10);
+        if (end == s) break;
+        if (v > 0) out.push_back((int)v);
+        s = (*end == ',') ? end + 1 : end;
+    }
+    if (out.empty()) out.push_back(1);
+    return out;
 }
 
-void warmup() {
-    const size_t W = 1000000; // at least a million
-    auto warm_orders = make_orders(W, 0xABCDEFULL);
-    auto warm_asg    = make_assignments_mixed50(W, 0xBEEFULL);
-    (void)run_once(Impl::Virtual,    "warm", warm_orders, warm_asg);
-    (void)run_once(Impl::NonVirtual, "warm", warm_orders, warm_asg);
-}
-int main() {
+// Usage: ./hft_bench [orders] [repeats] [threads,...] [padded|falseshare|atomic]
+// With the defaults (one thread, no sharing mode) this is the original
+// single-threaded benchmark. Any other combination uses run_parallel.
+// `repeats` is the minimum number of measured runs per case; bench::Runner
+// adds warmup and repeats further until the timings are stable (BENCH_* env).
+// Per-case summaries go to stderr, the result CSV to stdout and results.csv/.json.
+int main(int argc, char** argv) {
     uint64_t ORDERS = ORDERS_DEFAULT;
     int REPEATS = REPEATS_DEFAULT;
+    std::vector<int> THREADS = {1};
+    bool parallel_mode = false;
+    Sharing SHARING = Sharing::Padded;
+
+    if (argc > 1) ORDERS  = std::strtoull(argv[1], nullptr, 10);
+    if (argc > 2) REPEATS = std::atoi(argv[2]);
+    if (argc > 3) THREADS = parse_thread_list(argv[3]);
+    if (argc > 4) {
+        std::string mode = argv[4];
+        parallel_mode = true;
+        if (mode == "falseshare")  SHARING = Sharing::FalseShare;
+        else if (mode == "atomic") SHARING = Sharing::Atomic;
+        else if (mode != "padded") {
+            std::fprintf(stderr, "unknown sharing mode: %s\n", argv[4]);
+            return 2;
+        }
+    }
+    if (REPEATS < 1) REPEATS = 1;
+
+    // constructed before any worker thread so its counters are inherited
+    bench::Runner runner;
+    runner.config().min_reps = REPEATS;
+    runner.config().max_reps = std::max(runner.config().max_reps, REPEATS);
+    // the scaling columns, as well as inside params
+    runner.add_csv_column("threads");
+    runner.add_csv_column("sharing");
+    runner.print_header(stderr);
 
     auto orders_base = make_orders(ORDERS, 0xDEADBEEFCAFEBABEULL);
     auto asg_homo  = make_assignments_homogeneous(ORDERS);
     auto asg_mixed = make_assignments_mixed50(ORDERS, 0x2222ULL);
     auto asg_burst = make_assignments_bursty(ORDERS);
 
-    warmup();
-
-    write_csv_header(stdout);
-    std::ofstream file("results.csv");
-    file << "pattern,impl,repeat,orders,elapsed_ns,ops_per_sec,checksum\n";
-
-    auto emit = [&](Result r, int rep){
-        r.repeat = rep;
-        write_csv_row(stdout, r);
-        file << r.pattern << "," << r.impl << "," << r.repeat << ","
-             << r.orders << "," << r.elapsed_ns << ","
-             << r.ops_per_sec << "," << r.checksum << "\n";
-    };
+    int mismatches = 0;
 
     struct P { const char* name; const std::vector<Strat>* asg; } patterns[] = {
         {"homogeneous", &asg_homo},
@@ -256,29 +513,53 @@ int main() {
     };
 
     for (auto& p : patterns) {
-        for (Impl impl : { Impl::Virtual, Impl::NonVirtual }) {
-            std::vector<uint64_t> times;
-            times.reserve(REPEATS);
-
-            for (int rep = 0; rep < REPEATS; ++rep) {
-                Result r = run_once(impl, p.name, orders_base, *p.asg);
-                emit(r, rep);
-                times.push_back(r.elapsed_ns);
+        // in-order reference: every run must reproduce its final state, and
+        // every single-threaded impl that keeps the order sequence must
+        // reproduce its checksum
+        uint64_t ref_checksum = 0, ref_state = 0;
+        bool have_ref_checksum = false, have_ref_state = false;
+
+        for (int threads : THREADS) {
+            const bool parallel = parallel_mode || threads > 1;
+            const char* sharing = parallel ? sharing_name(SHARING) : "none";
+
+            for (Impl impl : ALL_IMPLS) {
+                const bool in_order = !impl_reorders(impl) && threads == 1;
+                const bench::Params params = {
+                    {"pattern", p.name},
+                    {"threads", std::to_string(threads)},
+                    {"sharing", sharing},
+                };
+
+                const auto& res = runner.run(impl_name(impl), params, (double)ORDERS,
+                                             [&](bench::Timing& t) {
+                    Result r = parallel
+                        ? run_parallel(t, impl, threads, SHARING, orders_base, *p.asg)
+                        : run_once(t, impl, orders_base, *p.asg);
+
+                    if (!have_ref_state) {
+                        ref_state = r.state_checksum;
+                        have_ref_state = true;
+                    }
+                    if (in_order && !have_ref_checksum) {
+                        ref_checksum = r.checksum;
+                        have_ref_checksum = true;
+                    }
+                    bool ok = (r.state_checksum == ref_state) &&
+                              (!in_order || r.checksum == ref_checksum);
+                    if (!ok) {
+                        ++mismatches;
+                        std::fprintf(stderr, "checksum mismatch: pattern=%s impl=%s threads=%d\n",
+                                     p.name, impl_name(impl), threads);
+                    }
+                });
+                bench::Runner::print_case(stderr, res);
             }
-
-            // compute best + median
-            std::sort(times.begin(), times.end());
-            uint64_t best = times.front();
-            uint64_t median = times[times.size()/2];
-            std::fprintf(stdout,
-                "# summary pattern=%s impl=%s best_ns=%llu median_ns=%llu\n",
-                p.name,
-                (impl==Impl::Virtual)?"virtual":"nonvirtual",
-                (unsigned long long)best,
-                (unsigned long long)median);
         }
     }
 
-    std::fprintf(stdout, "checksum_sink=%llu\n", (unsigned long long)g_sink);
-    return 0;
-}
\ No newline at end of file
+    runner.write_csv(stdout);
+    runner.write_reports();
+    std::fprintf(stderr, "checksum_sink=%llu\n", (unsigned long long)g_sink);
+    return mismatches == 0 ? 0 : 1;
+}
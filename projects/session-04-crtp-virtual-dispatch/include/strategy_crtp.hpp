@@ -2,10 +2,12 @@
 #include "market_data.hpp"
 
 // CRTP base: static (non-virtual) dispatch.
-// Derived must implement: double on_tick_impl(const Quote&)
+// Derived must implement: double on_tick_impl(const Q&) for the quote
+// types it takes (Quote, or e.g. phase-03's BookFeatures).
 template <typename Derived>
 struct StrategyBase {
-    double on_tick(const Quote& q) const {
+    template <typename Q>
+    double on_tick(const Q& q) const {
         return static_cast<const Derived*>(this)->on_tick_impl(q);
     }
 };
@@ -18,7 +20,11 @@ struct SignalStrategyCRTP : StrategyBase<SignalStrategyCRTP> {
     explicit SignalStrategyCRTP(double a1, double a2)
         : alpha1(a1), alpha2(a2) {}
 
-    double on_tick_impl(const Quote& q) const {
+    // Any Q with mid / microprice / imbalance overloads, found by ADL.
+    // phase-03's BookFeatures carries them precomputed, so a book-driven
+    // strategy does not rebuild a Quote per event.
+    template <typename Q>
+    double on_tick_impl(const Q& q) const {
         const double mp  = microprice(q);
         const double m   = mid(q);
         const double imb = imbalance(q);
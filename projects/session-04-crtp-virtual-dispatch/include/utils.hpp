@@ -1,5 +1,4 @@
 #pragma once
-#include <chrono>
 #include <cstdint>
 
 // Prevent the optimizer from eliding computations.
@@ -14,16 +13,6 @@ inline void do_not_optimize_away(T const& value) {
 #endif
 }
 
-struct Timer {
-    using clock = std::chrono::steady_clock;
-    clock::time_point t0{};
-    void start() { t0 = clock::now(); }
-    double stop_ns() const {
-        auto t1 = clock::now();
-        return std::chrono::duration<double, std::nano>(t1 - t0).count();
-    }
-};
-
 // Simple, fast xorshift32 PRNG (deterministic)
 struct XorShift32 {
     std::uint32_t state;
@@ -6,6 +6,7 @@
 
 #include "market_data.hpp"
 #include "utils.hpp"
+#include "bench_harness.hpp"       // bench::Runner (../common/include)
 #include "strategy_virtual.hpp"  // StrategyVirtual / SignalStrategyVirtual
 #include "strategy_crtp.hpp"     // StrategyBase<>, SignalStrategyCRTP
 
@@ -34,24 +35,25 @@ static void generate_ticks(std::vector<Quote>& out, std::uint32_t n, std::uint32
     }
 }
 
+// One sample = `iters` passes over the ticks. The runner handles warmup,
+// repeats until stable, and reports the median.
 // Prevent dead code elimination by accumulating a checksum
 template <typename F>
-static double run_bench(const char* name, const std::vector<Quote>& ticks, F&& func, int iters) {
-    Timer t; t.start();
+static const bench::CaseResult& run_bench(bench::Runner& runner, const char* name,
+                                          const std::vector<Quote>& ticks, F&& func, int iters) {
     double sink = 0.0;
-
-    for (int r = 0; r < iters; ++r) {
-        for (const auto& q : ticks) {
-            double s = func(q);
-            sink += s * 1e-9; // keep it small
+    const auto& r = runner.run(name, {}, static_cast<double>(ticks.size()) * iters, [&] {
+        for (int it = 0; it < iters; ++it) {
+            for (const auto& q : ticks) {
+                double s = func(q);
+                sink += s * 1e-9; // keep it small
+            }
         }
-    }
-
-    do_not_optimize_away(sink);
+        do_not_optimize_away(sink);
+    });
 
-    double ns = t.stop_ns();
-    std::printf("%-18s  time: %.3f ms  sink=%.6f\n", name, ns / 1e6, sink);
-    return ns;
+    std::printf("%-18s  time: %.3f ms  sink=%.6f\n", name, r.stats.median / 1e6, sink);
+    return r;
 }
 
 int main(int argc, char** argv) {
@@ -65,39 +67,52 @@ int main(int argc, char** argv) {
     if (argc > 1) n_ticks = static_cast<std::uint32_t>(std::strtoul(argv[1], nullptr, 10));
     if (argc > 2) iters   = std::atoi(argv[2]);
 
+    bench::Runner runner;
+    runner.print_header(stdout);
+
     std::cout << "Generating " << n_ticks << " ticks, iters=" << iters << "...\n";
     std::vector<Quote> ticks;
     generate_ticks(ticks, n_ticks, seed);
 
     // Baseline (free function)
-    auto ns_free = run_bench("free_function", ticks,
+    auto r_free = run_bench(runner, "free_function", ticks,
         [=](const Quote& q) { return signal_free(q, a1, a2); }, iters);
 
     // Runtime polymorphism (virtual)
     SignalStrategyVirtual virt(a1, a2);
     StrategyVirtual* s = &virt; // If your base is named IStrategy, change this type accordingly.
-    auto ns_virtual = run_bench("virtual_call", ticks,
+    auto r_virtual = run_bench(runner, "virtual_call", ticks,
         [=](const Quote& q) { return s->on_tick(q); }, iters);
 
     // CRTP static polymorphism
     SignalStrategyCRTP crtp(a1, a2);
-    auto ns_crtp = run_bench("crtp_call", ticks,
+    auto r_crtp = run_bench(runner, "crtp_call", ticks,
         [=](const Quote& q) { return crtp.on_tick(q); }, iters);
 
     const double total_ops = static_cast<double>(n_ticks) * iters;
 
-    auto report = [&](const char* name, double ns) {
-        double ns_per_tick = ns / total_ops;
+    auto report = [&](const char* name, const bench::CaseResult& r) {
+        double ns_per_tick = r.stats.median / total_ops;
         double tps = 1e9 / ns_per_tick;
-        std::printf("%-18s  ns/tick: %.3f  ticks/sec: %.2f M\n",
-                    name, ns_per_tick, tps / 1e6);
+        std::printf("%-18s  ns/tick: %.3f  ticks/sec: %.2f M  (mad %.2f%%, n=%zu)\n",
+                    name, ns_per_tick, tps / 1e6, 100.0 * r.stats.rel_mad(), r.stats.n);
+        if (r.perf.any()) {
+            std::printf("%-18s  IPC: %.3f  cycles/tick: %.3f  br miss/tick: %.5f"
+                        "  L1d miss/tick: %.5f  LLC miss/tick: %.6f  dTLB miss/tick: %.6f\n",
+                        "", r.perf.ipc(),
+                        r.per_op(PerfEvent::Cycles),
+                        r.per_op(PerfEvent::BranchMisses),
+                        r.per_op(PerfEvent::L1DMisses),
+                        r.per_op(PerfEvent::LLCMisses),
+                        r.per_op(PerfEvent::DTLBMisses));
+        }
     };
 
     std::puts("\n=== Summary ===");
-    report("free_function", ns_free);
-    report("virtual_call", ns_virtual);
-    report("crtp_call", ns_crtp);
+    report("free_function", r_free);
+    report("virtual_call", r_virtual);
+    report("crtp_call", r_crtp);
 
-    std::puts("\nTip: run `perf stat -e cycles,instructions,branches,branch-misses ./hft [N] [iters]` on Linux.");
+    runner.write_reports();
     return 0;
 }